@@ -0,0 +1,50 @@
+#include <time.h>
+#include "bench.h"
+#include "benchFormat.h"
+#include "benchUTF.h"
+#include "benchJSON.h"
+#include "benchQueue.h"
+#include "benchPool.h"
+#include "benchMap.h"
+
+void bench_all() {
+    bench_format();
+    bench_UTF();
+    bench_JSON();
+    bench_queue();
+    bench_pool();
+    bench_map();
+}
+
+int main(int argc, char *argv[]) {
+    printf(BLUE BOLD "Running benchmarks..." RESET "\n");
+
+    bench_all();
+
+    printf("\n");
+}
+
+double bench_now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (double) time.tv_sec + (double) time.tv_nsec / 1e9;
+}
+
+void bench_heading(char * name) {
+    printf("\n" BLUE BOLD "%s" RESET "\n" LINE "\n", name);
+}
+
+void bench_report(char * name, u64 operations, u64 bytes, double seconds) {
+    double millionOpsPerSecond = (double) operations / seconds / 1e6;
+    double megabytesPerSecond = (double) bytes / seconds / 1e6;
+
+    if(bytes == 0) {
+        printf(MAGENTA "%-44s" RESET " " YELLOW "%10.4f Mops/s" RESET "\n", name, millionOpsPerSecond);
+    } else if(operations == 0) {
+        printf(MAGENTA "%-44s" RESET " " GREEN "%9.1f MB/s" RESET "\n", name, megabytesPerSecond);
+    } else {
+        printf(MAGENTA "%-44s" RESET " " YELLOW "%10.4f Mops/s" RESET "  " GREEN "%9.1f MB/s" RESET "\n",
+               name, millionOpsPerSecond, megabytesPerSecond);
+    }
+}
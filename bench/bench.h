@@ -0,0 +1,52 @@
+#ifndef __CLIB_bench_h
+#define __CLIB_bench_h
+
+#include "../src/datatypes.h"
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <memory.h>
+#include <stdlib.h>
+
+
+
+//
+// Print Constants
+//
+
+#define LINE "-------------------------------------"
+
+
+
+//
+// Timing
+//
+
+/*!
+ * Returns the current time in seconds, from a clock that is not affected by changes to the system time.
+ */
+double bench_now();
+
+/*!
+ * Print a heading for a group of benchmarks called {name}.
+ */
+void bench_heading(char * name);
+
+/*!
+ * Print the throughput of a benchmark called {name} that performed {operations}
+ * operations over {bytes} bytes in {seconds} seconds.
+ *
+ * If {bytes} is 0, only the rate of operations will be printed, and
+ * if {operations} is 0, only the rate of bytes will be printed.
+ */
+void bench_report(char * name, u64 operations, u64 bytes, double seconds);
+
+/*!
+ * Stops the compiler from optimising away the computation of {value}.
+ */
+#define bench_use(value)                              \
+    do {                                              \
+        __asm__ volatile("" : : "g"(value) : "memory"); \
+    } while(0)
+
+#endif
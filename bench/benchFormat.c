@@ -0,0 +1,96 @@
+#include "bench.h"
+#include "benchFormat.h"
+
+//
+// Baselines
+//
+
+/*
+ * The previous implementation of str_format, which measured the
+ * formatted length using vsnprintf before formatting it again.
+ */
+static String twoPassFormat(char * format, ...) {
+    va_list arguments;
+    va_list argumentsCopy;
+
+    va_start(arguments, format);
+    va_copy(argumentsCopy, arguments);
+
+    s64 length = vsnprintf(NULL, 0, format, arguments);
+    va_end(arguments);
+
+    char * data = malloc((size_t) length + 1);
+    vsprintf(data, format, argumentsCopy);
+    va_end(argumentsCopy);
+
+    return str_createOfLength(data, length);
+}
+
+
+
+//
+// Benchmarks
+//
+
+/*
+ * Time {iterations} calls of {formatCall}, which should produce a String called formatted.
+ */
+#define bench_formatCall(name, iterations, formatCall)                  \
+    do {                                                                \
+        u64 bytes = 0;                                                  \
+        double start = bench_now();                                     \
+                                                                        \
+        for(u64 index = 0; index < (iterations); ++index) {             \
+            String formatted = formatCall;                              \
+            bytes += (u64) formatted.length;                            \
+            bench_use(formatted.data);                                  \
+            str_destroy(&formatted);                                    \
+        }                                                               \
+                                                                        \
+        bench_report(name, (iterations), bytes, bench_now() - start);   \
+    } while(0)
+
+void bench_format() {
+    const u64 iterations = 2000000;
+
+    char * name = "CLib";
+    char * url = "https://github.com/Sothatsit/CLib";
+
+    char longValue[2048];
+    memset(longValue, 'x', sizeof(longValue) - 1);
+    longValue[sizeof(longValue) - 1] = '\0';
+
+    bench_heading("str_format");
+
+    bench_formatCall("short, two pass (before)", iterations,
+                     twoPassFormat("%s %d", name, 1));
+    bench_formatCall("short, str_format", iterations,
+                     str_format("%s %d", name, 1));
+
+    bench_formatCall("medium, two pass (before)", iterations,
+                     twoPassFormat("name: %s, version: %i, url: %s, ratio: %f", name, 1, url, 0.75));
+    bench_formatCall("medium, str_format", iterations,
+                     str_format("name: %s, version: %i, url: %s, ratio: %f", name, 1, url, 0.75));
+
+    bench_formatCall("long, two pass (before)", iterations / 10,
+                     twoPassFormat("%s: %s", name, longValue));
+    bench_formatCall("long, str_format", iterations / 10,
+                     str_format("%s: %s", name, longValue));
+
+    bench_heading("builder_appendFormat");
+
+    Builder builder = builder_create(0);
+    {
+        u64 bytes = 0;
+        double start = bench_now();
+
+        for(u64 index = 0; index < iterations; ++index) {
+            builder.length = 0;
+            builder_appendFormat(&builder, "name: %s, version: %i, url: %s, ratio: %f", name, 1, url, 0.75);
+            bytes += (u64) builder.length;
+        }
+
+        bench_report("medium, reused builder", iterations, bytes, bench_now() - start);
+    }
+    builder_destroy(&builder);
+}
@@ -0,0 +1,9 @@
+#ifndef __CLIB_benchFormat_h
+#define __CLIB_benchFormat_h
+
+/*
+ * Benchmark formatting Strings.
+ */
+void bench_format();
+
+#endif
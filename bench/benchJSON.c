@@ -0,0 +1,343 @@
+#include "bench.h"
+#include "benchJSON.h"
+
+//
+// Inputs
+//
+
+/*
+ * The approximate size of the generated JSON document.
+ */
+#define BENCH_JSON_LENGTH ((s64) 64 * 1024 * 1024)
+
+/*
+ * Create a JSON array of roughly {length} chars of records containing a mix of
+ * strings, numbers, literals and nested arrays and objects, similar to pass1.json.
+ */
+static String createJSON(s64 length) {
+    Builder builder = builder_create(length + 1024);
+
+    srand(17);
+    builder_appendChar(&builder, '[');
+
+    for(s64 record = 0; builder.length < length; ++record) {
+        builder_appendFormat(
+            &builder,
+            "%s\n  {\"id\": %lld, \"name\": \"user %d\", \"score\": %d.%02d, \"ratio\": %de-%d, \"active\": %s,"
+            " \"tags\": [\"alpha\", \"beta\", \"gamma\"], \"text\": \"a \\\"quoted\\\" line\\nwith \\u00e9scapes\","
+            " \"nested\": {\"values\": [%d, %d, %d], \"empty\": {}, \"none\": null}}",
+            (record == 0 ? "" : ","), (long long) record, rand() % 100000, rand() % 1000, rand() % 100,
+            rand() % 10, rand() % 20, (rand() % 2 == 0 ? "true" : "false"), rand(), -rand(), rand() % 1000);
+    }
+
+    builder_appendC(&builder, "\n]");
+    return builder_str(builder);
+}
+
+
+/*
+ * Create a JSON object with {fields} members of mixed types, ending with a member "last".
+ */
+static String createWideObject(s64 fields) {
+    Builder builder = builder_create(0);
+    builder_appendChar(&builder, '{');
+
+    for(s64 field = 0; field < fields; ++field) {
+        switch(field % 4) {
+            case 0:
+                builder_appendFormat(&builder, "\"field%lld\": %lld, ", (long long) field, (long long) field * 7919);
+                break;
+            case 1:
+                builder_appendFormat(&builder, "\"field%lld\": \"some text \\\"%lld\\\"\", ", (long long) field, (long long) field);
+                break;
+            case 2:
+                builder_appendFormat(&builder, "\"field%lld\": [1.5, true, null, {\"x\": \"]}\"}], ", (long long) field);
+                break;
+            default:
+                builder_appendFormat(&builder, "\"field%lld\": {\"a\": {\"b\": [1, 2, 3]}, \"c\": false}, ", (long long) field);
+                break;
+        }
+    }
+
+    builder_appendC(&builder, "\"last\": 42}");
+    return builder_str(builder);
+}
+
+
+
+//
+// Benchmarks
+//
+
+/*
+ * Time parsing {json} into a JSONDoc using {method}.
+ */
+static void benchParse(char * name, String json, JSONParseMethod method) {
+    double start = bench_now();
+
+    JSONDoc doc = json_parseUsing(json, method);
+    bench_use(doc.nodeCount);
+
+    double seconds = bench_now() - start;
+
+    if(json_isErrored(doc)) {
+        printf("%s failed with %s\n", name, errtype_c(json_getErrorType(doc)));
+    }
+
+    bench_report(name, 0, (u64) json.length, seconds);
+    json_destroy(&doc);
+}
+
+/*
+ * Time finding the structural chars of {json}.
+ */
+static void benchIndex(char * name, String json) {
+    double start = bench_now();
+
+    JSONIndex index = json_createIndex(json);
+    bench_use(index.count);
+
+    bench_report(name, 0, (u64) json.length, bench_now() - start);
+    json_destroyIndex(&index);
+}
+
+/*
+ * A JSONEventCallback that counts the events in a document.
+ */
+static void countEvent(JSONEvent event, String text, void * context) {
+    (void) event;
+    (void) text;
+
+    *((s64 *) context) += 1;
+}
+
+/*
+ * Time streaming the events of {json} in chunks of {chunkSize} chars.
+ */
+static void benchStream(char * name, String json, s64 chunkSize) {
+    s64 events = 0;
+    double start = bench_now();
+
+    JSONStream stream = json_createStream(countEvent, &events, false);
+    for(s64 offset = 0; offset < json.length; offset += chunkSize) {
+        s64 end = (json.length - offset < chunkSize ? json.length : offset + chunkSize);
+        json_streamFeed(&stream, str_substring(json, offset, end));
+    }
+
+    if(json_streamFinish(&stream) != ERROR_SUCCESS) {
+        printf("%s failed with %s\n", name, errtype_c(json_getStreamErrorType(stream)));
+    }
+
+    bench_use(events);
+    bench_report(name, 0, (u64) json.length, bench_now() - start);
+    json_destroyStream(&stream);
+}
+
+/*
+ * Time reading three fields from {json} {repeats} times using compiled JSONPaths, and then by building a JSONDoc.
+ */
+static void benchFind(String json, s64 repeats) {
+    char * fields[3] = {"field10", "field101.a.b[2]", "last"};
+
+    JSONPath paths[3];
+    for(s64 index = 0; index < 3; ++index) {
+        paths[index] = json_compilePath(str_create(fields[index]));
+    }
+
+    double start = bench_now();
+    for(s64 repeat = 0; repeat < repeats; ++repeat) {
+        for(s64 index = 0; index < 3; ++index) {
+            JSONValue value;
+            json_find(json, paths[index], &value);
+            bench_use(value.chars.length);
+        }
+    }
+    bench_report("200 fields, 3 x json_find", (u64) repeats, (u64) (json.length * repeats), bench_now() - start);
+
+    start = bench_now();
+    for(s64 repeat = 0; repeat < repeats; ++repeat) {
+        JSONDoc doc = json_parse(json);
+        JSONNode * root = json_root(doc);
+
+        bench_use(json_objectGetC(root, "field10"));
+        bench_use(json_arrayGet(json_objectGetC(json_objectGetC(json_objectGetC(root, "field101"), "a"), "b"), 2));
+        bench_use(json_objectGetC(root, "last"));
+
+        json_destroy(&doc);
+    }
+    bench_report("200 fields, json_parse + 3 x get", (u64) repeats, (u64) (json.length * repeats), bench_now() - start);
+
+    for(s64 index = 0; index < 3; ++index) {
+        json_destroyPath(&paths[index]);
+    }
+}
+
+/*
+ * Time writing {count} records like those of createJSON using a JSONWriter, and then using builder_appendFormat.
+ */
+static void benchWrite(s64 count) {
+    JSONWriter writer = json_createWriter(0);
+    Builder builder = builder_create(0);
+    String text = str_create("a \"quoted\" line\nwith \xC3\xA9scapes, and some more text after them to copy in bulk");
+
+    // Write the records once first, so that neither output is growing while being timed.
+    for(s64 pass = 0; pass < 2; ++pass) {
+        json_resetWriter(&writer);
+        double start = bench_now();
+
+        for(s64 record = 0; record < count; ++record) {
+            json_writeStartObject(&writer);
+            json_writeKeyC(&writer, "id");
+            json_writeS64(&writer, record);
+            json_writeKeyC(&writer, "score");
+            json_writeDouble(&writer, (double) record / 7.0);
+            json_writeKeyC(&writer, "active");
+            json_writeBool(&writer, (record & 1) != 0);
+            json_writeKeyC(&writer, "text");
+            json_writeString(&writer, text);
+            json_writeKeyC(&writer, "values");
+            json_writeStartArray(&writer);
+            json_writeS64(&writer, record * 3);
+            json_writeNull(&writer);
+            json_writeEndArray(&writer);
+            json_writeEndObject(&writer);
+        }
+
+        if(pass == 1) {
+            bench_report("records, JSONWriter", (u64) count, (u64) writer.output.length, bench_now() - start);
+        }
+    }
+
+    for(s64 pass = 0; pass < 2; ++pass) {
+        builder.length = 0;
+        double start = bench_now();
+
+        for(s64 record = 0; record < count; ++record) {
+            builder_appendFormat(&builder, "{\"id\":%lld,\"score\":%.17g,\"active\":%s,\"text\":\"%s\",\"values\":[%lld,null]}\n",
+                                 (long long) record, (double) record / 7.0, ((record & 1) != 0 ? "true" : "false"),
+                                 "a \\\"quoted\\\" line\\nwith \xC3\xA9scapes, and some more text after them to copy in bulk",
+                                 (long long) record * 3);
+        }
+
+        if(pass == 1) {
+            bench_report("records, builder_appendFormat", (u64) count, (u64) builder.length, bench_now() - start);
+        }
+    }
+
+    // A long string with an escape every 256 chars.
+    Builder longString = builder_create(0);
+    for(s64 index = 0; index < 16 * 1024 * 1024; ++index) {
+        builder_appendChar(&longString, (index % 256 == 255 ? '"' : (char) ('a' + index % 26)));
+    }
+
+    json_resetWriter(&writer);
+    json_writeString(&writer, builder_str(longString));
+    json_resetWriter(&writer);
+
+    double start = bench_now();
+    json_writeString(&writer, builder_str(longString));
+    bench_report("16MB string, json_writeString", 0, (u64) longString.length, bench_now() - start);
+
+    builder_destroy(&longString);
+    builder_destroy(&builder);
+    json_destroyWriter(&writer);
+}
+
+/*
+ * An NDJSONCallback that counts the nodes in each document.
+ */
+static void countNodes(JSONDoc doc, String record, s64 thread, void * context) {
+    (void) record;
+    (void) thread;
+
+    __atomic_fetch_add((s64 *) context, doc.nodeCount, __ATOMIC_RELAXED);
+}
+
+/*
+ * Time parsing each line of {lines} using json_parse on one thread, and then
+ * parsing them from the file {filename} using ndjson_parallelParse.
+ */
+static void benchNDJSON(char * filename, String lines) {
+    s64 nodes = 0;
+    double start = bench_now();
+
+    for(s64 index = 0; index < lines.length;) {
+        s64 end = str_indexOfCharAfter(lines, '\n', index);
+        if(end < 0) {
+            end = lines.length;
+        }
+
+        JSONDoc doc = json_parse(str_substring(lines, index, end));
+        nodes += doc.nodeCount;
+        json_destroy(&doc);
+
+        index = end + 1;
+    }
+
+    bench_use(nodes);
+    bench_report("ndjson, json_parse per line", 0, (u64) lines.length, bench_now() - start);
+
+    s64 threadCounts[4] = {1, 2, 4, 8};
+    for(s64 index = 0; index < 4; ++index) {
+        for(int ordered = 0; ordered < 2; ++ordered) {
+            char name[64];
+            snprintf(name, sizeof(name), "ndjson, %lld threads, %s", (long long) threadCounts[index], (ordered ? "ordered" : "unordered"));
+
+            nodes = 0;
+            start = bench_now();
+
+            CLibErrorType result = ndjson_parallelParse(filename, threadCounts[index], ordered, &countNodes, &nodes);
+            if(result != ERROR_SUCCESS) {
+                printf("%s failed with %s\n", name, errtype_c(result));
+            }
+
+            bench_use(nodes);
+            bench_report(name, 0, (u64) lines.length, bench_now() - start);
+        }
+    }
+}
+
+void bench_JSON() {
+    bench_heading("json_parse");
+
+    String json = createJSON(BENCH_JSON_LENGTH);
+
+    benchIndex("records, json_createIndex", json);
+    benchParse("records, JSON_PARSE_INDEXED", json, JSON_PARSE_INDEXED);
+    benchParse("records, JSON_PARSE_SEQUENTIAL", json, JSON_PARSE_SEQUENTIAL);
+    benchStream("records, json_streamFeed 64KB chunks", json, 64 * 1024);
+
+    // Write each of the records on its own line as newline delimited JSON.
+    {
+        char * filename = "bench_ndjson.tmp";
+
+        JSONDoc doc = json_parse(json);
+        JSONWriter writer = json_createWriter(0);
+
+        JSONNode * root = json_root(doc);
+        JSONNode * record = root + 1;
+        for(s64 index = 0; index < root->length; ++index) {
+            json_writeNode(&writer, record);
+            record = json_next(record);
+        }
+
+        String lines = json_writerStr(writer);
+        FileWriter file = writer_create(filename, 0);
+        writer_appendStr(&file, lines);
+        writer_destroy(&file);
+
+        benchNDJSON(filename, lines);
+
+        remove(filename);
+        json_destroyWriter(&writer);
+        json_destroy(&doc);
+    }
+
+    str_destroy(&json);
+    json = createWideObject(200);
+    benchFind(json, 20000);
+
+    benchWrite(1000000);
+
+    str_destroy(&json);
+}
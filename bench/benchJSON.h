@@ -0,0 +1,9 @@
+#ifndef __CLIB_benchJSON_h
+#define __CLIB_benchJSON_h
+
+/*
+ * Benchmark JSON parsing.
+ */
+void bench_JSON();
+
+#endif
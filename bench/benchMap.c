@@ -0,0 +1,214 @@
+#include <pthread.h>
+#include "bench.h"
+#include "benchMap.h"
+
+//
+// Inputs
+//
+
+/*
+ * The number of distinct keys used.
+ */
+#define BENCH_MAP_KEYS ((s64) 1024 * 1024)
+
+/*
+ * The number of operations performed by each benchmark, split between its threads.
+ */
+#define BENCH_MAP_OPERATIONS ((s64) 2 * 1024 * 1024)
+
+/*
+ * The largest number of threads benchmarked.
+ */
+#define BENCH_MAP_MAX_THREADS 64
+
+/*
+ * Create BENCH_MAP_KEYS distinct keys, as views into {text}, which should be destroyed after the keys.
+ */
+static String * createKeys(String * text) {
+    Builder builder = builder_create(BENCH_MAP_KEYS * 16);
+    s64 * offsets = malloc((BENCH_MAP_KEYS + 1) * sizeof(s64));
+
+    for(s64 index = 0; index < BENCH_MAP_KEYS; ++index) {
+        offsets[index] = builder.length;
+        builder_appendC(&builder, "user:");
+        builder_appendS64(&builder, index * 7919);
+    }
+    offsets[BENCH_MAP_KEYS] = builder.length;
+
+    *text = builder_str(builder);
+
+    String * keys = malloc(BENCH_MAP_KEYS * sizeof(String));
+    for(s64 index = 0; index < BENCH_MAP_KEYS; ++index) {
+        keys[index] = str_substring(*text, offsets[index], offsets[index + 1]);
+    }
+
+    free(offsets);
+    return keys;
+}
+
+/*
+ * The operation performed by each thread of a benchmark.
+ */
+typedef enum MapOperation {
+    MAP_INSERT,
+    MAP_GET,
+    MAP_UPSERT
+} MapOperation;
+
+/*
+ * A thread of a benchmark, which performs {operations} operations starting from the key {first}.
+ * If {lock} is not NULL, it is held around every operation, to compare against a single lock.
+ */
+typedef struct MapBenchThread {
+    ConcurrentMap * map;
+    pthread_mutex_t * lock;
+    String * keys;
+    MapOperation operation;
+    s64 first;
+    s64 operations;
+    u64 sum;
+} MapBenchThread;
+
+static u64 incrementValue(String key, u64 value, bool exists, void * context) {
+    (void) key;
+    (void) context;
+    return (exists ? value + 1 : 1);
+}
+
+static void * mapBenchThread(void * argument) {
+    MapBenchThread * thread = argument;
+    u64 sum = 0;
+
+    // Stepping by a large prime visits the keys in an order that doesn't follow their shards.
+    s64 key = thread->first;
+    for(s64 index = 0; index < thread->operations; ++index) {
+        key = (key + 104729) & (BENCH_MAP_KEYS - 1);
+
+        if(thread->lock != NULL) {
+            pthread_mutex_lock(thread->lock);
+        }
+
+        u64 value = 0;
+        if(thread->operation == MAP_INSERT) {
+            cmap_insertIfAbsent(thread->map, thread->keys[key], (u64) key, &value);
+        } else if(thread->operation == MAP_GET) {
+            cmap_get(*thread->map, thread->keys[key], &value);
+        } else {
+            cmap_upsert(thread->map, thread->keys[key], &incrementValue, NULL, &value);
+        }
+        sum += value;
+
+        if(thread->lock != NULL) {
+            pthread_mutex_unlock(thread->lock);
+        }
+    }
+
+    thread->sum = sum;
+    return NULL;
+}
+
+
+
+//
+// Benchmarks
+//
+
+/*
+ * Time hashing each of {keys}, and then {text} as a whole.
+ */
+static void benchHash(String * keys, String text) {
+    double start = bench_now();
+
+    u64 hash = 0;
+    for(s64 index = 0; index < BENCH_MAP_KEYS; ++index) {
+        hash ^= str_hash(keys[index], 17);
+    }
+    bench_use(hash);
+
+    bench_report("str_hash, short keys", (u64) BENCH_MAP_KEYS, 0, bench_now() - start);
+
+    start = bench_now();
+
+    for(int repeat = 0; repeat < 20; ++repeat) {
+        hash ^= str_hash(text, (u64) repeat);
+    }
+    bench_use(hash);
+
+    bench_report("str_hash, one long string", 0, (u64) text.length * 20, bench_now() - start);
+}
+
+/*
+ * Time {threads} threads performing {operation} on {map}, holding a single lock if {locked}.
+ */
+static void benchMapThreads(char * name, ConcurrentMap * map, String * keys, MapOperation operation, s64 threads, bool locked) {
+    MapBenchThread benchThreads[BENCH_MAP_MAX_THREADS];
+    pthread_t handles[BENCH_MAP_MAX_THREADS];
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+    double start = bench_now();
+
+    for(s64 index = 0; index < threads; ++index) {
+        benchThreads[index] = (MapBenchThread) {
+            .map = map, .lock = (locked ? &lock : NULL), .keys = keys, .operation = operation,
+            .first = index * (BENCH_MAP_KEYS / threads), .operations = BENCH_MAP_OPERATIONS / threads
+        };
+        pthread_create(&handles[index], NULL, &mapBenchThread, &benchThreads[index]);
+    }
+
+    u64 sum = 0;
+    for(s64 index = 0; index < threads; ++index) {
+        pthread_join(handles[index], NULL);
+        sum += benchThreads[index].sum;
+    }
+    bench_use(sum);
+
+    bench_report(name, (u64) BENCH_MAP_OPERATIONS, 0, bench_now() - start);
+}
+
+/*
+ * Time each operation from 1 to BENCH_MAP_MAX_THREADS threads, with a ConcurrentMap that has
+ * a shard for each processor, and with a single lock held around each operation.
+ */
+static void benchScaling(char * heading, String * keys, MapOperation operation) {
+    bench_heading(heading);
+
+    // Reads and updates are of keys that are already in the map, so they share one map.
+    ConcurrentMap filled = cmap_create(0, 0x5EED);
+    if(operation != MAP_INSERT) {
+        for(s64 index = 0; index < BENCH_MAP_KEYS; ++index) {
+            cmap_insertIfAbsent(&filled, keys[index], (u64) index, NULL);
+        }
+    }
+
+    char name[128];
+    for(s64 threads = 1; threads <= BENCH_MAP_MAX_THREADS; threads *= 2) {
+        for(int locked = 1; locked >= 0; --locked) {
+            ConcurrentMap map = (operation == MAP_INSERT ? cmap_create(0, 0x5EED) : filled);
+
+            snprintf(name, sizeof(name), "%lld thread%s, %s", (long long) threads, (threads == 1 ? "" : "s"),
+                     (locked ? "single lock" : "ConcurrentMap"));
+            benchMapThreads(name, &map, keys, operation, threads, locked);
+
+            if(operation == MAP_INSERT) {
+                cmap_destroy(&map);
+            }
+        }
+    }
+
+    cmap_destroy(&filled);
+}
+
+void bench_map() {
+    String text;
+    String * keys = createKeys(&text);
+
+    bench_heading("str_hash");
+    benchHash(keys, text);
+
+    benchScaling("cmap_insertIfAbsent, each key inserted about twice", keys, MAP_INSERT);
+    benchScaling("cmap_get", keys, MAP_GET);
+    benchScaling("cmap_upsert", keys, MAP_UPSERT);
+
+    free(keys);
+    str_destroy(&text);
+}
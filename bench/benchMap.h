@@ -0,0 +1,9 @@
+#ifndef __CLIB_benchMap_h
+#define __CLIB_benchMap_h
+
+/*
+ * Benchmark str_hash, and the scaling of ConcurrentMap from 1 to 64 threads.
+ */
+void bench_map();
+
+#endif
@@ -0,0 +1,156 @@
+#include "bench.h"
+#include "benchPool.h"
+
+//
+// Inputs
+//
+
+/*
+ * The number of values sorted.
+ */
+#define BENCH_POOL_SORT_LENGTH ((u64) 8 * 1024 * 1024)
+
+/*
+ * The length of the String searched.
+ */
+#define BENCH_POOL_SEARCH_LENGTH ((s64) 256 * 1024 * 1024)
+
+/*
+ * The number of tasks spawned.
+ */
+#define BENCH_POOL_TASKS ((s64) 1024 * 1024)
+
+/*
+ * Fill {array} with {length} random values.
+ */
+static void fillRandom(u64 * array, u64 length) {
+    srand(53);
+    for(u64 index = 0; index < length; ++index) {
+        array[index] = ((u64) rand() << 32) ^ (u64) rand();
+    }
+}
+
+static void emptyTask(void * context) {
+    bench_use(context);
+}
+
+static void sumRange(s64 start, s64 end, void * context) {
+    s64 sum = 0;
+    for(s64 index = start; index < end; ++index) {
+        sum += index;
+    }
+    __atomic_add_fetch((s64 *) context, sum, __ATOMIC_RELAXED);
+}
+
+
+
+//
+// Benchmarks
+//
+
+/*
+ * Time spawning BENCH_POOL_TASKS empty tasks in a single TaskGroup from outside of {pool}.
+ */
+static void benchSpawn(char * name, ThreadPool pool) {
+    double start = bench_now();
+
+    TaskGroup group = taskgroup_create(pool);
+    for(s64 index = 0; index < BENCH_POOL_TASKS; ++index) {
+        taskgroup_run(&group, &emptyTask, NULL);
+    }
+    taskgroup_wait(&group);
+
+    bench_report(name, (u64) BENCH_POOL_TASKS, 0, bench_now() - start);
+}
+
+/*
+ * Time a parallel_for over BENCH_POOL_TASKS indices with a {grain} of 1, to measure the cost of each part.
+ */
+static void benchParallelFor(char * name, ThreadPool pool) {
+    double start = bench_now();
+
+    s64 sum = 0;
+    parallel_for(pool, 0, BENCH_POOL_TASKS, 1, &sumRange, &sum);
+    bench_use(sum);
+
+    bench_report(name, (u64) BENCH_POOL_TASKS, 0, bench_now() - start);
+}
+
+/*
+ * Time sorting a copy of {values} using u64_parallelSort, or u64_mergeSort if {pool} is errored.
+ */
+static void benchSort(char * name, ThreadPool pool, u64 * values, u64 * array) {
+    memcpy(array, values, BENCH_POOL_SORT_LENGTH * sizeof(u64));
+
+    double start = bench_now();
+
+    u64_parallelSort(pool, array, BENCH_POOL_SORT_LENGTH);
+    bench_use(array[0]);
+
+    bench_report(name, BENCH_POOL_SORT_LENGTH, BENCH_POOL_SORT_LENGTH * sizeof(u64), bench_now() - start);
+}
+
+/*
+ * Time searching {string} for the char at its end using str_parallelIndexOfChar.
+ */
+static void benchSearch(char * name, ThreadPool pool, String string) {
+    double start = bench_now();
+
+    for(int repeat = 0; repeat < 4; ++repeat) {
+        s64 index = str_parallelIndexOfChar(pool, string, 'b');
+        bench_use(index);
+    }
+
+    bench_report(name, 0, (u64) string.length * 4, bench_now() - start);
+}
+
+void bench_pool() {
+    ThreadPool errored = pool_create(-1, false);
+    ThreadPool pools[] = {pool_create(1, false), pool_create(2, false), pool_create(0, true)};
+    char * names[] = {"1 worker", "2 workers", "pinned, 1 per CPU"};
+
+    char name[128];
+
+    bench_heading("taskgroup_run and parallel_for");
+
+    for(int index = 0; index < 3; ++index) {
+        snprintf(name, sizeof(name), "taskgroup_run, %s", names[index]);
+        benchSpawn(name, pools[index]);
+
+        snprintf(name, sizeof(name), "parallel_for, grain 1, %s", names[index]);
+        benchParallelFor(name, pools[index]);
+    }
+
+    bench_heading("u64_parallelSort");
+
+    u64 * values = malloc(BENCH_POOL_SORT_LENGTH * sizeof(u64));
+    u64 * array = malloc(BENCH_POOL_SORT_LENGTH * sizeof(u64));
+    fillRandom(values, BENCH_POOL_SORT_LENGTH);
+
+    benchSort("u64_mergeSort", errored, values, array);
+    for(int index = 0; index < 3; ++index) {
+        snprintf(name, sizeof(name), "u64_parallelSort, %s", names[index]);
+        benchSort(name, pools[index], values, array);
+    }
+
+    free(values);
+    free(array);
+
+    bench_heading("str_parallelIndexOfChar");
+
+    String string = str_createUninitialised(BENCH_POOL_SEARCH_LENGTH);
+    memset(string.data, 'a', (size_t) string.length);
+    string.data[string.length - 1] = 'b';
+
+    benchSearch("str_indexOfChar", errored, string);
+    for(int index = 0; index < 3; ++index) {
+        snprintf(name, sizeof(name), "str_parallelIndexOfChar, %s", names[index]);
+        benchSearch(name, pools[index], string);
+    }
+
+    str_destroy(&string);
+
+    for(int index = 0; index < 3; ++index) {
+        pool_destroy(&pools[index]);
+    }
+}
@@ -0,0 +1,9 @@
+#ifndef __CLIB_benchPool_h
+#define __CLIB_benchPool_h
+
+/*
+ * Benchmark running tasks, parallel_for and the parallel algorithms built on ThreadPool.
+ */
+void bench_pool();
+
+#endif
@@ -0,0 +1,241 @@
+#include <pthread.h>
+#include "bench.h"
+#include "benchQueue.h"
+
+//
+// Inputs
+//
+
+/*
+ * The number of Strings passed through each queue.
+ */
+#define BENCH_QUEUE_ITEMS ((s64) 4 * 1024 * 1024)
+
+/*
+ * The capacity of each queue.
+ */
+#define BENCH_QUEUE_CAPACITY 1024
+
+/*
+ * The largest batch of Strings pushed or popped at once.
+ */
+#define BENCH_QUEUE_MAX_BATCH 64
+
+/*
+ * A queue guarded by a mutex, to compare the lock-free queues against.
+ */
+typedef struct LockedQueue {
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+    String * slots;
+    s64 capacity;
+    s64 head;
+    s64 tail;
+    bool closed;
+} LockedQueue;
+
+/*
+ * The queue used by a benchmark, and the number of Strings each thread should push or pop at once.
+ */
+typedef struct BenchQueue {
+    LockedQueue * locked;
+    SPSCQueue * spsc;
+    MPMCQueue * mpmc;
+    s64 items;
+    s64 batch;
+    s64 sum;
+} BenchQueue;
+
+static s64 lockedPushBatch(LockedQueue * queue, String * strings, s64 count) {
+    pthread_mutex_lock(&queue->mutex);
+    while(queue->tail - queue->head == queue->capacity) {
+        pthread_cond_wait(&queue->changed, &queue->mutex);
+    }
+
+    s64 pushed = min(count, queue->capacity - (queue->tail - queue->head));
+    for(s64 index = 0; index < pushed; ++index) {
+        queue->slots[(queue->tail + index) % queue->capacity] = strings[index];
+    }
+    queue->tail += pushed;
+
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->mutex);
+    return pushed;
+}
+
+static s64 lockedPopBatch(LockedQueue * queue, String * strings, s64 count) {
+    pthread_mutex_lock(&queue->mutex);
+    while(queue->tail == queue->head && !queue->closed) {
+        pthread_cond_wait(&queue->changed, &queue->mutex);
+    }
+
+    s64 popped = min(count, queue->tail - queue->head);
+    for(s64 index = 0; index < popped; ++index) {
+        strings[index] = queue->slots[(queue->head + index) % queue->capacity];
+    }
+    queue->head += popped;
+
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->mutex);
+    return popped;
+}
+
+static void lockedClose(LockedQueue * queue) {
+    pthread_mutex_lock(&queue->mutex);
+    queue->closed = true;
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+/*
+ * Push {bench->items} Strings, whose lengths are their index, in batches of {bench->batch}.
+ */
+static void * benchProducer(void * argument) {
+    BenchQueue * bench = argument;
+    String strings[BENCH_QUEUE_MAX_BATCH];
+
+    for(s64 number = 0; number < bench->items; number += bench->batch) {
+        s64 count = min(bench->batch, bench->items - number);
+        for(s64 index = 0; index < count; ++index) {
+            strings[index] = (String) {.data = NULL, .length = number + index, .flags = 0};
+        }
+
+        s64 pushed = 0;
+        while(pushed < count) {
+            if(bench->locked != NULL) {
+                pushed += lockedPushBatch(bench->locked, &strings[pushed], count - pushed);
+            } else if(bench->spsc != NULL) {
+                pushed += spsc_pushBatch(bench->spsc, &strings[pushed], count - pushed);
+            } else {
+                pushed += mpmc_pushBatch(bench->mpmc, &strings[pushed], count - pushed);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Pop Strings in batches of {bench->batch} until the queue is closed, summing their lengths.
+ */
+static void * benchConsumer(void * argument) {
+    BenchQueue * bench = argument;
+    String strings[BENCH_QUEUE_MAX_BATCH];
+
+    while(true) {
+        s64 popped;
+        if(bench->locked != NULL) {
+            popped = lockedPopBatch(bench->locked, strings, bench->batch);
+        } else if(bench->spsc != NULL) {
+            popped = spsc_popBatch(bench->spsc, strings, bench->batch);
+        } else {
+            popped = mpmc_popBatch(bench->mpmc, strings, bench->batch);
+        }
+
+        if(popped == 0)
+            return NULL;
+
+        for(s64 index = 0; index < popped; ++index) {
+            bench->sum += strings[index].length;
+        }
+    }
+}
+
+
+
+//
+// Benchmarks
+//
+
+/*
+ * Time passing BENCH_QUEUE_ITEMS Strings from {producers} threads to {consumers} threads through the queue in {bench}.
+ */
+static void benchQueue(char * name, BenchQueue bench, int producers, int consumers) {
+    pthread_t threads[16];
+    BenchQueue producerBenches[8];
+    BenchQueue consumerBenches[8];
+
+    double start = bench_now();
+
+    for(int index = 0; index < producers; ++index) {
+        producerBenches[index] = bench;
+        producerBenches[index].items = BENCH_QUEUE_ITEMS / producers;
+        pthread_create(&threads[index], NULL, &benchProducer, &producerBenches[index]);
+    }
+
+    for(int index = 0; index < consumers; ++index) {
+        consumerBenches[index] = bench;
+        pthread_create(&threads[producers + index], NULL, &benchConsumer, &consumerBenches[index]);
+    }
+
+    for(int index = 0; index < producers; ++index) {
+        pthread_join(threads[index], NULL);
+    }
+
+    if(bench.locked != NULL) {
+        lockedClose(bench.locked);
+    } else if(bench.spsc != NULL) {
+        spsc_close(bench.spsc);
+    } else {
+        mpmc_close(bench.mpmc);
+    }
+
+    s64 sum = 0;
+    for(int index = 0; index < consumers; ++index) {
+        pthread_join(threads[producers + index], NULL);
+        sum += consumerBenches[index].sum;
+    }
+    bench_use(sum);
+
+    bench_report(name, (u64) BENCH_QUEUE_ITEMS, 0, bench_now() - start);
+}
+
+static void benchLocked(char * name, s64 batch, int producers, int consumers) {
+    LockedQueue queue = {.capacity = BENCH_QUEUE_CAPACITY};
+    pthread_mutex_init(&queue.mutex, NULL);
+    pthread_cond_init(&queue.changed, NULL);
+    queue.slots = malloc(BENCH_QUEUE_CAPACITY * sizeof(String));
+
+    benchQueue(name, (BenchQueue) {.locked = &queue, .batch = batch}, producers, consumers);
+
+    free(queue.slots);
+    pthread_cond_destroy(&queue.changed);
+    pthread_mutex_destroy(&queue.mutex);
+}
+
+static void benchSPSC(char * name, QueueWaitMode waitMode, s64 batch) {
+    SPSCQueue queue = spsc_create(BENCH_QUEUE_CAPACITY, waitMode);
+
+    benchQueue(name, (BenchQueue) {.spsc = &queue, .batch = batch}, 1, 1);
+
+    // The Strings do not own any data, so there is nothing left to destroy.
+    spsc_destroy(&queue);
+}
+
+static void benchMPMC(char * name, QueueWaitMode waitMode, s64 batch, int producers, int consumers) {
+    MPMCQueue queue = mpmc_create(BENCH_QUEUE_CAPACITY, waitMode);
+
+    benchQueue(name, (BenchQueue) {.mpmc = &queue, .batch = batch}, producers, consumers);
+
+    mpmc_destroy(&queue);
+}
+
+void bench_queue() {
+    bench_heading("SPSCQueue, 1 producer and 1 consumer");
+
+    benchLocked("mutex queue", 1, 1, 1);
+    benchSPSC("SPSCQueue, spin", QUEUE_WAIT_SPIN, 1);
+    benchSPSC("SPSCQueue, futex", QUEUE_WAIT_FUTEX, 1);
+    benchLocked("mutex queue, batches of 64", 64, 1, 1);
+    benchSPSC("SPSCQueue, spin, batches of 64", QUEUE_WAIT_SPIN, 64);
+    benchSPSC("SPSCQueue, futex, batches of 64", QUEUE_WAIT_FUTEX, 64);
+
+    bench_heading("MPMCQueue, 4 producers and 4 consumers");
+
+    benchLocked("mutex queue", 1, 4, 4);
+    benchMPMC("MPMCQueue, spin", QUEUE_WAIT_SPIN, 1, 4, 4);
+    benchMPMC("MPMCQueue, futex", QUEUE_WAIT_FUTEX, 1, 4, 4);
+    benchLocked("mutex queue, batches of 64", 64, 4, 4);
+    benchMPMC("MPMCQueue, spin, batches of 64", QUEUE_WAIT_SPIN, 64, 4, 4);
+    benchMPMC("MPMCQueue, futex, batches of 64", QUEUE_WAIT_FUTEX, 64, 4, 4);
+}
@@ -0,0 +1,9 @@
+#ifndef __CLIB_benchQueue_h
+#define __CLIB_benchQueue_h
+
+/*
+ * Benchmark passing Strings between threads using SPSCQueue and MPMCQueue.
+ */
+void bench_queue();
+
+#endif
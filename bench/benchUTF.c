@@ -0,0 +1,250 @@
+#include "bench.h"
+#include "benchUTF.h"
+
+//
+// Inputs
+//
+
+/*
+ * The size of each of the generated inputs.
+ */
+#define BENCH_UTF_LENGTH ((s64) 64 * 1024 * 1024)
+
+/*
+ * Create a String of {length} chars of UTF-8 text, where roughly one in
+ * every {nonAsciiRatio} characters is not ASCII.
+ */
+static String createUTF8(s64 length, int nonAsciiRatio) {
+    Builder builder = builder_create(length + 4);
+
+    srand(17);
+    while(builder.length < length - 4) {
+        u32 codepoint;
+
+        if(nonAsciiRatio > 0 && rand() % nonAsciiRatio == 0) {
+            // Mostly 3 char CJK characters, with some 2 and 4 char characters
+            int kind = rand() % 8;
+            codepoint = (u32) (kind == 0 ? 0x80 + rand() % 0x700 : (kind == 1 ? 0x10000 + rand() % 0x10000 : 0x4E00 + rand() % 0x5000));
+        } else {
+            codepoint = (u32) ('a' + rand() % 26);
+        }
+
+        utf8_appendCodepoint(&builder, codepoint);
+    }
+
+    return builder_str(builder);
+}
+
+
+
+//
+// Benchmarks
+//
+
+/*
+ * Time validating {string} by decoding each codepoint using utf8_toCodepoint.
+ */
+static void benchDecodeLoop(char * name, String string) {
+    double start = bench_now();
+
+    String remaining = string;
+    u64 codepoints = 0;
+    while(remaining.length > 0) {
+        utf8_toCodepoint(&remaining);
+        codepoints += 1;
+    }
+    bench_use(codepoints);
+
+    bench_report(name, 0, (u64) string.length, bench_now() - start);
+}
+
+/*
+ * Time validating {string} {repeats} times using utf8_validate.
+ */
+static void benchValidate(char * name, String string, int repeats) {
+    double start = bench_now();
+
+    for(int repeat = 0; repeat < repeats; ++repeat) {
+        s64 invalid = utf8_validate(string);
+        bench_use(invalid);
+    }
+
+    bench_report(name, 0, (u64) string.length * (u64) repeats, bench_now() - start);
+}
+
+/*
+ * Time converting {string} to UTF-16LE one codepoint at a time.
+ */
+static void benchTranscodeLoop(char * name, String string) {
+    double start = bench_now();
+
+    Builder builder = builder_create(string.length * 2);
+    String remaining = string;
+    while(remaining.length > 0) {
+        utf16le_appendCodepoint(&builder, utf8_toCodepoint(&remaining));
+    }
+    bench_use(builder.length);
+    builder_destroy(&builder);
+
+    bench_report(name, 0, (u64) string.length, bench_now() - start);
+}
+
+/*
+ * Time converting {string} to UTF-16LE and back {repeats} times using utf8_toUtf16le and utf16le_toUtf8.
+ */
+static void benchTranscode(char * name, String string, int repeats) {
+    double toUtf16Seconds = 0;
+    double toUtf8Seconds = 0;
+
+    for(int repeat = 0; repeat < repeats; ++repeat) {
+        double start = bench_now();
+        String utf16 = utf8_toUtf16le(string, NULL);
+        double middle = bench_now();
+        String utf8 = utf16le_toUtf8(utf16, NULL);
+        double end = bench_now();
+
+        bench_use(utf8.data);
+        str_destroy(&utf16);
+        str_destroy(&utf8);
+
+        toUtf16Seconds += middle - start;
+        toUtf8Seconds += end - middle;
+    }
+
+    String label = str_format("%s, utf8_toUtf16le", name);
+    char * labelC = str_c_destroy(&label);
+    bench_report(labelC, 0, (u64) string.length * (u64) repeats, toUtf16Seconds);
+    free(labelC);
+
+    label = str_format("%s, utf16le_toUtf8", name);
+    labelC = str_c_destroy(&label);
+    bench_report(labelC, 0, (u64) string.length * (u64) repeats, toUtf8Seconds);
+    free(labelC);
+}
+
+/*
+ * Time appending the {count} codepoints in {codepoints} to a Builder, one at a time and then all at once.
+ */
+static void benchAppendCodepoints(char * name, u32 * codepoints, s64 count) {
+    Builder builder = builder_create(0);
+
+    double start = bench_now();
+    for(s64 index = 0; index < count; ++index) {
+        utf8_appendCodepoint(&builder, codepoints[index]);
+    }
+    double middle = bench_now();
+
+    s64 length = builder.length;
+    builder.length = 0;
+
+    utf8_appendCodepoints(&builder, codepoints, count);
+    double end = bench_now();
+
+    bench_use(builder.length);
+    builder_destroy(&builder);
+
+    String label = str_format("%s, utf8_appendCodepoint", name);
+    char * labelC = str_c_destroy(&label);
+    bench_report(labelC, (u64) count, (u64) length, middle - start);
+    free(labelC);
+
+    label = str_format("%s, utf8_appendCodepoints", name);
+    labelC = str_c_destroy(&label);
+    bench_report(labelC, (u64) count, (u64) length, end - middle);
+    free(labelC);
+}
+
+/*
+ * Decode all of the codepoints in the UTF-8 String {string} into a new array, and store its length in {count}.
+ */
+static u32 * decodeCodepoints(String string, s64 * count) {
+    u32 * codepoints = malloc((size_t) string.length * sizeof(u32));
+
+    *count = 0;
+    String remaining = string;
+    while(remaining.length > 0) {
+        codepoints[(*count)++] = utf8_toCodepoint(&remaining);
+    }
+
+    return codepoints;
+}
+
+/*
+ * Time counting the codepoints in {string} {repeats} times using utf8_countCodepoints.
+ */
+static void benchCount(char * name, String string, int repeats) {
+    double start = bench_now();
+
+    for(int repeat = 0; repeat < repeats; ++repeat) {
+        s64 count = utf8_countCodepoints(string);
+        bench_use(count);
+    }
+
+    bench_report(name, 0, (u64) string.length * (u64) repeats, bench_now() - start);
+}
+
+/*
+ * Time taking {lookups} random 10 codepoint substrings of {string}, using a UTF8Index if {useIndex} is true.
+ */
+static void benchSubstring(char * name, String string, bool useIndex, int lookups) {
+    UTF8Index index = utf8_createIndex(string, 0);
+    s64 count = index.codepointCount;
+
+    srand(19);
+    double start = bench_now();
+
+    for(int lookup = 0; lookup < lookups; ++lookup) {
+        s64 codepoint = (s64) (((u64) rand() * (u64) RAND_MAX + (u64) rand()) % (u64) (count - 10));
+        String substring = utf8_substringByCodepoint(string, (useIndex ? &index : NULL), codepoint, codepoint + 10);
+        bench_use(substring.data);
+    }
+
+    bench_report(name, (u64) lookups, 0, bench_now() - start);
+    utf8_destroyIndex(&index);
+}
+
+void bench_UTF() {
+    String ascii = createUTF8(BENCH_UTF_LENGTH, 0);
+    String mostlyAscii = createUTF8(BENCH_UTF_LENGTH, 20);
+    String mixed = createUTF8(BENCH_UTF_LENGTH, 2);
+
+    bench_heading("utf8_validate");
+
+    benchDecodeLoop("ASCII, utf8_toCodepoint loop", ascii);
+    benchValidate("ASCII, utf8_validate", ascii, 10);
+
+    benchDecodeLoop("5% non-ASCII, utf8_toCodepoint loop", mostlyAscii);
+    benchValidate("5% non-ASCII, utf8_validate", mostlyAscii, 10);
+
+    benchDecodeLoop("50% non-ASCII, utf8_toCodepoint loop", mixed);
+    benchValidate("50% non-ASCII, utf8_validate", mixed, 10);
+
+    bench_heading("utf8_countCodepoints and utf8_substringByCodepoint");
+
+    benchCount("50% non-ASCII, utf8_countCodepoints", mixed, 10);
+    benchSubstring("50% non-ASCII, substring without index", mixed, false, 20);
+    benchSubstring("50% non-ASCII, substring with index", mixed, true, 1000000);
+
+    bench_heading("utf8_toUtf16le and utf16le_toUtf8");
+
+    benchTranscodeLoop("ASCII, codepoint loop", ascii);
+    benchTranscode("ASCII", ascii, 5);
+
+    benchTranscodeLoop("50% non-ASCII, codepoint loop", mixed);
+    benchTranscode("50% non-ASCII", mixed, 5);
+
+    bench_heading("utf8_appendCodepoints");
+
+    s64 count;
+    u32 * codepoints = decodeCodepoints(mostlyAscii, &count);
+    benchAppendCodepoints("5% non-ASCII", codepoints, count);
+    free(codepoints);
+
+    codepoints = decodeCodepoints(mixed, &count);
+    benchAppendCodepoints("50% non-ASCII", codepoints, count);
+    free(codepoints);
+
+    str_destroy(&ascii);
+    str_destroy(&mostlyAscii);
+    str_destroy(&mixed);
+}
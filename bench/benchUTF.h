@@ -0,0 +1,9 @@
+#ifndef __CLIB_benchUTF_h
+#define __CLIB_benchUTF_h
+
+/*
+ * Benchmark the processing of UTF-8 and UTF-16.
+ */
+void bench_UTF();
+
+#endif
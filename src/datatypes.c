@@ -1,7 +1,31 @@
+#define _GNU_SOURCE
+
 #include <memory.h>
 #include <stdio.h>
 #include <limits.h>
 #include <errno.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <sched.h>
+
+#if defined(__linux__) && defined(__has_include)
+    #if __has_include(<linux/io_uring.h>)
+        #define CLIB_HAS_IO_URING
+        #include <stdint.h>
+        #include <sys/syscall.h>
+        #include <linux/io_uring.h>
+    #endif
+#endif
+
+#ifdef __linux__
+    #define CLIB_HAS_FUTEX
+    #include <sys/syscall.h>
+    #include <linux/futex.h>
+#endif
 #include "datatypes.h"
 
 //
@@ -32,7 +56,22 @@ char * CLibErrorTypeStrings[ERROR_COUNT] = {
     "ERROR_FILE_READ: Error reading file",
     "ERROR_FILE_CLOSE: Error closing file",
 
-    "ERROR_INVALID_CODEPOINT: Invalid codepoint"
+    "ERROR_INVALID_CODEPOINT: Invalid codepoint",
+
+    "ERROR_FILE_STAT: Error getting the status of file",
+    "ERROR_FILE_MAP: Error memory mapping file",
+    "ERROR_FILE_WRITE: Error writing to file",
+    "ERROR_FILE_SYNC: Error syncing file to disk",
+
+    "ERROR_UNSUPPORTED: Operation is not supported on this system",
+
+    "ERROR_JSON_SYNTAX: Invalid JSON syntax",
+    "ERROR_JSON_DEPTH: JSON is nested too deeply",
+    "ERROR_JSON_NOT_FOUND: No JSON value found",
+
+    "ERROR_QUEUE_CLOSED: The queue has been closed",
+
+    "ERROR_MAP_KEY_EXISTS: The key is already in the map"
 };
 
 
@@ -665,11 +704,17 @@ bool str_isOwnAllocation(String string) {
     return str_isFlagSet(string, STRING_FLAG_IS_OWN_ALLOCATION);
 }
 
+bool str_isMapped(String string) {
+    return str_isFlagSet(string, STRING_FLAG_IS_MAPPED);
+}
+
 void str_destroy(String * string) {
     if(str_isErrored(*string))
         return;
 
-    if(string->data != NULL && str_isOwnAllocation(*string)) {
+    if(string->data != NULL && str_isMapped(*string)) {
+        munmap(string->data, (size_t) string->length);
+    } else if(string->data != NULL && str_isOwnAllocation(*string)) {
         free(string->data);
     }
 
@@ -738,28 +783,38 @@ char * str_formatC(char * format, ...) {
     return formattedString;
 }
 
+/*!
+ * The size of the stack buffer str_vformat formats into before allocating the result.
+ */
+#define STR_FORMAT_SCRATCH_SIZE 512
+
 String str_vformat(char * format, va_list arguments) {
-    va_list argumentsCopy = {};
+    va_list argumentsCopy;
     va_copy(argumentsCopy, arguments);
 
-    s64 length = vsnprintf(NULL, 0, format, arguments);
-    if(length < 0)
-        return str_createErrored(ERROR_FORMAT, errno);
-
-    // For the null character
-    length += 1;
-    if(!can_cast_s64_to_sizet(length))
-        return str_createErrored(ERROR_CAST, 0);
+    // Most formatted Strings are short, so format into the stack first to find the length.
+    char scratch[STR_FORMAT_SCRATCH_SIZE];
 
-    char * data = malloc((size_t) length);
-    if(data == NULL)
-        return str_createErrored(ERROR_ALLOC, errno);
+    s64 length = vsnprintf(scratch, sizeof(scratch), format, arguments);
+    if(length < 0) {
+        va_end(argumentsCopy);
+        return str_createErrored(ERROR_FORMAT, errno);
+    }
 
-    vsprintf(data, format, argumentsCopy);
+    String string = str_createUninitialised(length);
+    if(str_isErrored(string) || length == 0) {
+        va_end(argumentsCopy);
+        return string;
+    }
 
-    String string = str_createOfLength(data, length - 1);
-    str_setFlag(&string, STRING_FLAG_IS_NULL_TERMINATED, true);
+    if(length < (s64) sizeof(scratch)) {
+        memcpy(string.data, scratch, (size_t) length);
+    } else {
+        // It didn't fit, so format it again straight into the String, which has space for the null character.
+        vsnprintf(string.data, (size_t) (length + 1), format, argumentsCopy);
+    }
 
+    va_end(argumentsCopy);
     return string;
 }
 
@@ -788,6 +843,98 @@ bool str_equalsC(String string1, char * string2) {
     return str_equals(string1, str_create(string2));
 }
 
+/*!
+ * Multiply {a} and {b} into a 128 bit product, and fold its halves together.
+ */
+static inline u64 hash_mix(u64 a, u64 b) {
+    __uint128_t product = (__uint128_t) a * b;
+    return (u64) product ^ (u64) (product >> 64);
+}
+
+/*!
+ * Read the 8 chars at {data} as a u64, in the byte order of the machine.
+ */
+static inline u64 hash_read64(char * data) {
+    u64 value;
+    memcpy(&value, data, sizeof(u64));
+    return value;
+}
+
+/*!
+ * Read the 4 chars at {data} as a u64, in the byte order of the machine.
+ */
+static inline u64 hash_read32(char * data) {
+    u32 value;
+    memcpy(&value, data, sizeof(u32));
+    return value;
+}
+
+u64 str_hash(String string, u64 seed) {
+    const u64 secret0 = 0xa0761d6478bd642fULL;
+    const u64 secret1 = 0xe7037ed1a0b428dbULL;
+    const u64 secret2 = 0x8ebc6af09c88c6e3ULL;
+    const u64 secret3 = 0x589965cc75374cc3ULL;
+
+    char * data = string.data;
+    s64 length = (str_isErrored(string) ? 0 : string.length);
+
+    seed ^= hash_mix(seed ^ secret0, secret1);
+
+    u64 a;
+    u64 b;
+
+    if(length <= 16) {
+        if(length >= 4) {
+            // Two overlapping pairs of 4 chars cover the whole string.
+            s64 offset = (length >> 3) << 2;
+            a = (hash_read32(data) << 32) | hash_read32(data + offset);
+            b = (hash_read32(data + length - 4) << 32) | hash_read32(data + length - 4 - offset);
+        } else if(length > 0) {
+            a = ((u64) (u8) data[0] << 16) | ((u64) (u8) data[length >> 1] << 8) | (u64) (u8) data[length - 1];
+            b = 0;
+        } else {
+            a = 0;
+            b = 0;
+        }
+    } else {
+        s64 remaining = length;
+
+        if(remaining > 48) {
+            u64 seed1 = seed;
+            u64 seed2 = seed;
+
+            // Three independent lanes, so that the multiplies can overlap.
+            do {
+                seed = hash_mix(hash_read64(data) ^ secret1, hash_read64(data + 8) ^ seed);
+                seed1 = hash_mix(hash_read64(data + 16) ^ secret2, hash_read64(data + 24) ^ seed1);
+                seed2 = hash_mix(hash_read64(data + 32) ^ secret3, hash_read64(data + 40) ^ seed2);
+
+                data += 48;
+                remaining -= 48;
+            } while(remaining > 48);
+
+            seed ^= seed1 ^ seed2;
+        }
+
+        while(remaining > 16) {
+            seed = hash_mix(hash_read64(data) ^ secret1, hash_read64(data + 8) ^ seed);
+
+            data += 16;
+            remaining -= 16;
+        }
+
+        // The last 16 chars, which may overlap chars that have already been mixed.
+        a = hash_read64(data + remaining - 16);
+        b = hash_read64(data + remaining - 8);
+    }
+
+    __uint128_t product = (__uint128_t) (a ^ secret1) * (b ^ seed);
+    a = (u64) product;
+    b = (u64) (product >> 64);
+
+    return hash_mix(a ^ secret0 ^ (u64) length, b ^ secret1);
+}
+
 bool str_startsWith(String string, String prefix) {
     if(str_isErrored(string) || str_isErrored(prefix))
         return false;
@@ -1226,426 +1373,9083 @@ String str_splitAtC(String * remaining, char * delimiter) {
 // File IO
 //
 
-String str_readFile(char * filename) {
-    FILE * file = fopen(filename, "rb");
-    if(file == NULL)
-        return str_createErrored(ERROR_FILE_OPEN, errno);
-
-    if(fseek(file, 0, SEEK_END) != 0)
-        return str_createErrored(ERROR_FILE_SEEK, errno);
+/*!
+ * Reads the {size} chars of the open regular file {file} into a String.
+ *
+ * If the file is shorter than {size} when it is read, the returned String will be shortened to match.
+ */
+static String file_readSized(int file, s64 size) {
+    String contents = str_createUninitialised(size);
+    if(str_isErrored(contents))
+        return contents;
 
-    long position = ftell(file);
-    if(position < 0)
-        return str_createErrored(ERROR_FILE_TELL, errno);
-    if(position == 0)
-        return str_createEmpty();
+    s64 offset = 0;
+    while(offset < size) {
+        ssize_t bytesRead = pread(file, &contents.data[offset], (size_t) (size - offset), (off_t) offset);
 
-    if(!can_cast_long_to_s64(position))
-        return str_createErrored(ERROR_CAST, 0);
+        if(bytesRead == 0)
+            break;
 
-    s64 length = (s64) position;
-    String buffer = str_createUninitialised(length);
-    if(str_isErrored(buffer))
-        return buffer;
-    if(fseek(file, 0, SEEK_SET) != 0)
-        return str_createErrored(ERROR_FILE_SEEK, errno);
-    if(!can_cast_s64_to_sizet(length))
-        return str_createErrored(ERROR_CAST, 0);
+        if(bytesRead < 0) {
+            if(errno == EINTR)
+                continue;
 
-    size_t read = fread(buffer.data, 1, (size_t) length, file);
+            int errnum = errno;
+            str_destroy(&contents);
+            return str_createErrored(ERROR_FILE_READ, errnum);
+        }
 
-    if(read != length) {
-        str_destroy(&buffer);
-        return str_createErrored(ERROR_FILE_READ, errno);
+        offset += bytesRead;
     }
 
-    if(fclose(file) != 0) {
-        str_destroy(&buffer);
-        return str_createErrored(ERROR_FILE_CLOSE, errno);
+    if(offset == 0) {
+        str_destroy(&contents);
+        return str_createEmpty();
     }
 
-    return buffer;
+    contents.length = offset;
+    contents.data[offset] = '\0';
+
+    return contents;
 }
 
+/*!
+ * Reads the remaining contents of the open file {file} into a String,
+ * for files whose size is not known before they are read.
+ */
+static String file_readUnsized(int file) {
+    Builder builder = builder_create(4096);
+
+    while(builder_isValid(builder)) {
+        if(builder.length == builder.buffer.size) {
+            CLibErrorType errorType = builder_ensureCapacity(&builder, builder.length + 1);
+            if(errorType != ERROR_SUCCESS)
+                return str_createErrored(errorType, 0);
+        }
 
+        ssize_t bytesRead = read(file, &builder.buffer.start[builder.length], (size_t) (builder.buffer.size - builder.length));
 
-//
-// Builder
-//
+        if(bytesRead == 0)
+            break;
 
-Builder builder_create(s64 initialSize) {
-    Builder builder;
+        if(bytesRead < 0) {
+            if(errno == EINTR)
+                continue;
 
-    builder.buffer = buf_create(initialSize);
-    builder.length = 0;
+            int errnum = errno;
+            builder_destroy(&builder);
+            return str_createErrored(ERROR_FILE_READ, errnum);
+        }
 
-    return builder;
-}
+        builder.length += bytesRead;
+    }
 
-Builder builder_createErrored(CLibErrorType errorType, int errnum) {
-    return builder_create(err_create(errorType, errnum));
-}
+    if(builder.length == 0) {
+        builder_destroy(&builder);
+        return str_createEmpty();
+    }
 
-bool builder_isErrored(Builder builder) {
-    return buf_isErrored(builder.buffer);
-}
+    // NUL-terminate the contents, as file_readSized does
+    CLibErrorType errorType = builder_ensureCapacity(&builder, builder.length + 1);
+    if(errorType != ERROR_SUCCESS)
+        return str_createErrored(errorType, 0);
 
-bool builder_isValid(Builder builder) {
-    return !builder_isErrored(builder);
+    builder.buffer.start[builder.length] = '\0';
+
+    return builder_str(builder);
 }
 
-void builder_destroy(Builder * builder) {
-    if(builder_isErrored(*builder))
-        return;
+String str_readFile(char * filename) {
+    if(filename == NULL)
+        return str_createErrored(ERROR_ARG_NULL, 0);
 
-    buf_destroy(&builder->buffer);
-    *builder = builder_createErrored(ERROR_FREED, 0);
-}
+    int file = open(filename, O_RDONLY | O_CLOEXEC);
+    if(file < 0)
+        return str_createErrored(ERROR_FILE_OPEN, errno);
 
-String builder_str(Builder builder) {
-    if(builder_isErrored(builder)) {
-        CLibErrorType errorType = buf_getErrorType(builder.buffer);
-        int errnum = buf_getErrorNum(builder.buffer);
-        return str_createErrored(errorType, errnum);
+    struct stat status;
+    if(fstat(file, &status) != 0) {
+        int errnum = errno;
+        close(file);
+        return str_createErrored(ERROR_FILE_STAT, errnum);
     }
 
-    return str_createOfLength(builder.buffer.start, builder.length);
-}
+    String contents;
 
-Buffer builder_buf(Builder builder) {
-    if(builder_isErrored(builder)) {
-        CLibErrorType errorType = buf_getErrorType(builder.buffer);
-        int errnum = buf_getErrorNum(builder.buffer);
-        return buf_createErrored(errorType, errnum);
+    // Files such as pipes and those in /proc do not report their size up front
+    if(!S_ISREG(status.st_mode) || status.st_size == 0) {
+        contents = file_readUnsized(file);
+    } else if(!can_cast_s64_to_sizet((s64) status.st_size)) {
+        contents = str_createErrored(ERROR_CAST, 0);
+    } else {
+        contents = file_readSized(file, (s64) status.st_size);
     }
 
-    return buf_createUsing(builder.buffer.start, builder.length);
-}
-
-String builder_strCopy(Builder builder) {
-    return str_copy(builder_str(builder));
-}
+    if(close(file) != 0 && str_isValid(contents)) {
+        int errnum = errno;
+        str_destroy(&contents);
+        return str_createErrored(ERROR_FILE_CLOSE, errnum);
+    }
 
-Buffer builder_bufCopy(Builder builder) {
-    return buf_copy(builder_buf(builder));
+    return contents;
 }
 
-CLibErrorType builder_setCapacity(Builder * builder, s64 capacity) {
-    if(capacity < builder->length) {
-        builder->buffer = buf_createErrored(ERROR_ARG_INVALID, 0);
-        return ERROR_ARG_INVALID;
-    }
+Buffer buf_mapFile(char * filename, u8 hints) {
+    if(filename == NULL)
+        return buf_createErrored(ERROR_ARG_NULL, 0);
 
-    return buf_setCapacity(&builder->buffer, capacity);
-}
+    int file = open(filename, O_RDONLY | O_CLOEXEC);
+    if(file < 0)
+        return buf_createErrored(ERROR_FILE_OPEN, errno);
 
-CLibErrorType builder_ensureCapacity(Builder * builder, s64 requiredCapacity) {
-    return buf_ensureCapacity(&builder->buffer, requiredCapacity);
-}
+    struct stat status;
+    if(fstat(file, &status) != 0) {
+        int errnum = errno;
+        close(file);
+        return buf_createErrored(ERROR_FILE_STAT, errnum);
+    }
 
-CLibErrorType builder_trimToLength(Builder * builder) {
-    if(builder_isErrored(*builder))
-        return ERROR_ARG_INVALID;
+    // Pipes and other files that are not regular files cannot be mapped
+    if(!S_ISREG(status.st_mode)) {
+        close(file);
+        return buf_createErrored(ERROR_FILE_MAP, ENODEV);
+    }
 
-    return builder_setCapacity(builder, builder->length);
-}
+    // Files in /proc report a size of zero, but still have contents to read
+    if(status.st_size == 0) {
+        char probe;
+        ssize_t bytesRead;
+        do {
+            bytesRead = read(file, &probe, 1);
+        } while(bytesRead < 0 && errno == EINTR);
 
-CLibErrorType builder_appendChar(Builder * builder, char character) {
-    if(builder_isErrored(*builder))
-        return ERROR_ARG_INVALID;
+        int errnum = errno;
+        close(file);
 
-    s64 requiredCapacity = builder->length + 1;
-    CLibErrorType result = builder_ensureCapacity(builder, requiredCapacity);
-    if(result != ERROR_SUCCESS)
-        return result;
+        if(bytesRead < 0)
+            return buf_createErrored(ERROR_FILE_READ, errnum);
+        if(bytesRead > 0)
+            return buf_createErrored(ERROR_FILE_MAP, ENODEV);
 
-    s64 end = builder->length;
-    builder->length += 1;
-    builder->buffer.start[end] = character;
+        return buf_createEmpty();
+    }
 
-    return ERROR_SUCCESS;
-}
+    if(!can_cast_s64_to_sizet((s64) status.st_size)) {
+        close(file);
+        return buf_createErrored(ERROR_CAST, 0);
+    }
 
-CLibErrorType builder_appendStr(Builder * builder, String string) {
-    if(builder_isErrored(*builder))
-        return ERROR_ARG_INVALID;
-    if(str_isErrored(string))
-        return err_type(string.length);
+    size_t size = (size_t) status.st_size;
+    void * data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+    int errnum = errno;
 
-    if(string.length == 0)
-        return ERROR_SUCCESS;
+    // The mapping keeps its own reference to the file
+    close(file);
 
-    s64 requiredCapacity = builder->length + string.length;
-    CLibErrorType result = builder_ensureCapacity(builder, requiredCapacity);
-    if(result != ERROR_SUCCESS)
-        return result;
+    if(data == MAP_FAILED)
+        return buf_createErrored(ERROR_FILE_MAP, errnum);
 
-    s64 end = builder->length;
-    builder->length += string.length;
-    memcpy(&builder->buffer.start[end], string.data, string.length);
+    // The hints are only advice, so failing to apply them is not an error
+    if(hints & FILE_MAP_SEQUENTIAL) {
+        madvise(data, size, MADV_SEQUENTIAL);
+    }
+    if(hints & FILE_MAP_WILLNEED) {
+        madvise(data, size, MADV_WILLNEED);
+    }
+#ifdef MADV_HUGEPAGE
+    if(hints & FILE_MAP_HUGEPAGE) {
+        madvise(data, size, MADV_HUGEPAGE);
+    }
+#endif
 
-    return ERROR_SUCCESS;
+    return buf_createUsing(data, (s64) size);
 }
 
-CLibErrorType builder_appendBuf(Builder * builder, Buffer buffer) {
-    return builder_appendStr(builder, str_createOfLength(buffer.start, buffer.size));
-}
+String str_mapFile(char * filename, u8 hints) {
+    Buffer buffer = buf_mapFile(filename, hints);
+    if(buf_isErrored(buffer))
+        return str_createErrored(buf_getErrorType(buffer), buf_getErrorNum(buffer));
+    if(buf_isEmpty(buffer))
+        return str_createEmpty();
 
-CLibErrorType builder_appendC(Builder * builder, char * string) {
-    return builder_appendStr(builder, str_create(string));
-}
+    String string;
 
-CLibErrorType builder_appendSubstring(Builder * builder, String string, s64 start, s64 end) {
-    return builder_appendStr(builder, str_substring(string, start, end));
+    string.data = buffer.start;
+    string.length = buffer.size;
+    string.flags = STRING_FLAG_IS_MAPPED;
+
+    return string;
 }
 
+void buf_unmapFile(Buffer * buffer) {
+    if(buf_isErrored(*buffer))
+        return;
 
+    if(buffer->start != NULL) {
+        munmap(buffer->start, (size_t) buffer->size);
+    }
 
-//
-// Unicode
-//
+    *buffer = buf_createErrored(ERROR_FREED, 0);
+}
 
-#define __utf8ToCodepoint_nextChar(remaining, next)   \
-    do {                                              \
-        if(remaining->length == 0)                    \
-            return 0;                                 \
-                                                      \
-        next = (u8) remaining->data[0];               \
-                                                      \
-        remaining->length -= 1;                       \
-        remaining->data += 1;                         \
-    } while(0)
+/*!
+ * The state shared by the threads loading files in file_loadAllThreads.
+ */
+typedef struct FileLoadThreads {
+    char ** filenames;
+    String * contents;
+    s64 count;
+
+    /*!
+     * If not NULL, the already open files to read instead of opening {filenames}. Each file
+     * is read into the String in {contents} at the index in {indices}, and then closed.
+     */
+    int * files;
+    s64 * indices;
+
+    /*!
+     * The index of the next file to be loaded.
+     */
+    s64 next;
+} FileLoadThreads;
 
-#define __utf8ToCodepoint_appendChar(remaining, next, codepoint)   \
-    do {                                                           \
-        __utf8ToCodepoint_nextChar(remaining, next);               \
-        codepoint <<= 6;                                           \
-        codepoint |= (u32) (next & 0b00111111);                    \
-    } while(0)
+/*!
+ * Loads files from the FileLoadThreads {argument} until there are none left.
+ */
+static void * file_loadThread(void * argument) {
+    FileLoadThreads * state = argument;
 
-u32 utf8_toCodepoint(String * remaining) {
-    u8 next;
+    while(true) {
+        s64 index = __atomic_fetch_add(&state->next, 1, __ATOMIC_RELAXED);
+        if(index >= state->count)
+            break;
 
-    __utf8ToCodepoint_nextChar(remaining, next);
+        if(state->files != NULL) {
+            state->contents[state->indices[index]] = file_readUnsized(state->files[index]);
+            close(state->files[index]);
+        } else {
+            state->contents[index] = str_readFile(state->filenames[index]);
+        }
+    }
 
-    // 0xxxxxxx
-    if(next < 0b10000000)
-        return (u32) next;
+    return NULL;
+}
 
-    // 10xxxxxx
-    if(next < 0b11000000) {
-        // This char is the middle of a codepoint.
-        return 0;
+/*!
+ * Loads all of the files in {state} using a pool of threads.
+ */
+static void file_runLoadThreads(FileLoadThreads * state) {
+    // Reading files spends most of its time waiting, so use more threads than there are cores
+    s64 threadCount = min(state->count, FILE_LOAD_MAX_IN_FLIGHT) - 1;
+    pthread_t threads[FILE_LOAD_MAX_IN_FLIGHT];
+
+    s64 started = 0;
+    for(; started < threadCount; ++started) {
+        if(pthread_create(&threads[started], NULL, &file_loadThread, state) != 0)
+            break;
     }
 
-    // 110xxxxx 10xxxxxx
-    if(next < 0b11100000) {
-        u32 codepoint = (u32) (next & 0b00011111);
-
-        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
+    // The calling thread also loads files, so this still completes if no threads could be started
+    file_loadThread(state);
 
-        return codepoint;
+    for(s64 index = 0; index < started; ++index) {
+        pthread_join(threads[index], NULL);
     }
+}
 
-    // 1110xxxx 10xxxxxx 10xxxxxx
-    if(next < 0b11110000) {
-        u32 codepoint = (u32) (next & 0b00001111);
+/*!
+ * Loads the {count} files in {filenames} into {contents} using a pool of threads.
+ */
+static CLibErrorType file_loadAllThreads(char ** filenames, s64 count, String * contents) {
+    FileLoadThreads state;
 
-        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
-        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
+    state.filenames = filenames;
+    state.contents = contents;
+    state.count = count;
+    state.files = NULL;
+    state.indices = NULL;
+    state.next = 0;
 
-        return codepoint;
-    }
+    file_runLoadThreads(&state);
 
-    // 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
-    if(next < 0b11111000) {
-        u32 codepoint = (u32) (next & 0b00000111);
+    return ERROR_SUCCESS;
+}
 
-        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
-        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
-        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
+#ifdef CLIB_HAS_IO_URING
 
-        return codepoint;
-    }
+/*!
+ * The stages of loading a file using io_uring, stored in the low bits of the user data of each request.
+ */
+#define FILE_URING_OPEN ((u64) 0)
+#define FILE_URING_STAT ((u64) 1)
+#define FILE_URING_READ ((u64) 2)
+#define FILE_URING_STAGE_BITS 2
 
-    // 111110xx 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx
-    if(next < 0b11111100) {
-        u32 codepoint = (u32) (next & 0b00000011);
+/*!
+ * An io_uring instance with its submission and completion queues mapped into memory.
+ */
+typedef struct FileRing {
+    int fd;
+
+    void * sqRing;
+    size_t sqRingSize;
+    u32 * sqHead;
+    u32 * sqTail;
+    u32 sqMask;
+    u32 * sqArray;
+
+    struct io_uring_sqe * sqes;
+    size_t sqesSize;
+
+    void * cqRing;
+    size_t cqRingSize;
+    u32 * cqHead;
+    u32 * cqTail;
+    u32 cqMask;
+    struct io_uring_cqe * cqes;
+
+    /*!
+     * The number of requests that have been added to the submission queue but not yet submitted.
+     */
+    u32 unsubmitted;
+
+    /*!
+     * The number of requests that have been submitted, but whose completions have not yet been consumed.
+     */
+    u32 pending;
+} FileRing;
 
-        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
-        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
-        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
-        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
+/*!
+ * The progress of a file being loaded using io_uring.
+ */
+typedef struct FileRingLoad {
+    int file;
+    bool finished;
+    s64 offset;
+    struct statx status;
+} FileRingLoad;
 
-        return codepoint;
+/*!
+ * Unmaps the queues of {ring} and closes it.
+ */
+static void file_ringDestroy(FileRing * ring) {
+    if(ring->sqes != NULL && ring->sqes != MAP_FAILED) {
+        munmap(ring->sqes, ring->sqesSize);
+    }
+    if(ring->cqRing != NULL && ring->cqRing != MAP_FAILED && ring->cqRing != ring->sqRing) {
+        munmap(ring->cqRing, ring->cqRingSize);
+    }
+    if(ring->sqRing != NULL && ring->sqRing != MAP_FAILED) {
+        munmap(ring->sqRing, ring->sqRingSize);
+    }
+    if(ring->fd >= 0) {
+        close(ring->fd);
     }
+}
 
-    // 1111110x 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx
-    if(next < 0b11111110) {
-        u32 codepoint = (u32) (next & 0b00000001);
+/*!
+ * Returns whether the io_uring {ring} supports the operations required to load files.
+ */
+static bool file_ringSupportsLoading(FileRing * ring) {
+    size_t probeSize = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe * probe = calloc(1, probeSize);
+    if(probe == NULL)
+        return false;
 
-        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
-        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
-        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
-        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
-        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
+    bool supported = false;
+    if(syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PROBE, probe, 256) == 0) {
+        u8 required[3] = {IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ};
 
-        return codepoint;
+        supported = true;
+        for(int index = 0; index < 3; ++index) {
+            u8 op = required[index];
+            if(op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+                supported = false;
+            }
+        }
     }
 
-    // Invalid character
-    return 0;
+    free(probe);
+    return supported;
 }
 
-#undef __utf8ToCodepoint_nextChar
-#undef __utf8ToCodepoint_appendChar
+/*!
+ * Creates an io_uring with room for {entries} submissions in {ring}.
+ */
+static CLibErrorType file_ringCreate(FileRing * ring, u32 entries) {
+    memset(ring, 0, sizeof(FileRing));
 
-String utf8_fromCodepoint(u32 codepoint) {
-    Builder builder = builder_create(4);
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
 
-    utf8_appendCodepoint(&builder, codepoint);
+    ring->fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+    if(ring->fd < 0)
+        return ERROR_UNSUPPORTED;
 
-    return builder_str(builder);
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(u32);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    bool singleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if(singleMapping) {
+        ring->sqRingSize = max(ring->sqRingSize, ring->cqRingSize);
+        ring->cqRingSize = ring->sqRingSize;
+    }
+
+    ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if(ring->sqRing == MAP_FAILED) {
+        file_ringDestroy(ring);
+        return ERROR_UNSUPPORTED;
+    }
+
+    if(singleMapping) {
+        ring->cqRing = ring->sqRing;
+    } else {
+        ring->cqRing = mmap(NULL, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if(ring->cqRing == MAP_FAILED) {
+            file_ringDestroy(ring);
+            return ERROR_UNSUPPORTED;
+        }
+    }
+
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if(ring->sqes == MAP_FAILED) {
+        file_ringDestroy(ring);
+        return ERROR_UNSUPPORTED;
+    }
+
+    char * sqRing = ring->sqRing;
+    ring->sqHead = (u32 *) (sqRing + params.sq_off.head);
+    ring->sqTail = (u32 *) (sqRing + params.sq_off.tail);
+    ring->sqMask = *(u32 *) (sqRing + params.sq_off.ring_mask);
+    ring->sqArray = (u32 *) (sqRing + params.sq_off.array);
+
+    char * cqRing = ring->cqRing;
+    ring->cqHead = (u32 *) (cqRing + params.cq_off.head);
+    ring->cqTail = (u32 *) (cqRing + params.cq_off.tail);
+    ring->cqMask = *(u32 *) (cqRing + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cqRing + params.cq_off.cqes);
+
+    if(!file_ringSupportsLoading(ring)) {
+        file_ringDestroy(ring);
+        return ERROR_UNSUPPORTED;
+    }
+
+    return ERROR_SUCCESS;
 }
 
-CLibErrorType utf8_appendCodepoint(Builder *builder, u32 codepoint) {
-    if((codepoint & 0x80000000) != 0)
-        return ERROR_INVALID_CODEPOINT;
+/*!
+ * Adds a new request to the submission queue of {ring}, and returns it to be filled in.
+ */
+static struct io_uring_sqe * file_ringNext(FileRing * ring, u8 opcode, u64 userData) {
+    u32 tail = *ring->sqTail + ring->unsubmitted;
+    u32 index = tail & ring->sqMask;
+
+    struct io_uring_sqe * sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+
+    sqe->opcode = opcode;
+    sqe->user_data = userData;
 
-    // If the codepoint can fit into 7 bits.
-    if(codepoint <= 0x007F) {
-        // 0xxxxxxx
-        return builder_appendChar(builder, (char) codepoint);
+    ring->sqArray[index] = index;
+    ring->unsubmitted += 1;
+
+    return sqe;
+}
+
+/*!
+ * Submits the queued requests in {ring}, and waits until at least one request has completed.
+ *
+ * Returns ERROR_FILE_READ if the requests could not be submitted, with the reason stored in errno.
+ */
+static CLibErrorType file_ringSubmitAndWait(FileRing * ring) {
+    __atomic_store_n(ring->sqTail, *ring->sqTail + ring->unsubmitted, __ATOMIC_RELEASE);
+
+    u32 toSubmit = ring->unsubmitted;
+    ring->unsubmitted = 0;
+
+    while(true) {
+        long submitted = syscall(__NR_io_uring_enter, ring->fd, toSubmit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+
+        if(submitted >= 0) {
+            toSubmit -= (u32) submitted;
+            ring->pending += (u32) submitted;
+            if(toSubmit == 0)
+                return ERROR_SUCCESS;
+        } else if(errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            return ERROR_FILE_READ;
+        }
     }
+}
 
-    // If the codepoint can fit into 11 bits.
-    if(codepoint <= 0x07FF) {
-        // 110xxxxx 10xxxxxx
+/*!
+ * Waits for every request that has been submitted to {ring} to complete, without submitting any more,
+ * so that the kernel is no longer writing into any of {loads} or the Strings they are read into.
+ *
+ * Any files opened by the completed requests are recorded in {loads} so that they can be closed.
+ *
+ * Returns whether all of the requests completed.
+ */
+static bool file_ringDrain(FileRing * ring, FileRingLoad * loads) {
+    while(ring->pending > 0) {
+        u32 head = *ring->cqHead;
+        u32 tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+
+        for(; head != tail; ++head) {
+            struct io_uring_cqe * cqe = &ring->cqes[head & ring->cqMask];
+
+            s64 index = (s64) (cqe->user_data >> FILE_URING_STAGE_BITS);
+            u64 stage = cqe->user_data & ((1u << FILE_URING_STAGE_BITS) - 1);
+
+            if(stage == FILE_URING_OPEN && cqe->res >= 0) {
+                loads[index].file = cqe->res;
+            }
 
-        builder_appendChar(builder, (char) (0xC0 | (codepoint >> 6)));
-        return builder_appendChar(builder, (char) (0x80 | (codepoint & 0x3F)));
+            ring->pending -= 1;
+        }
+
+        __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+
+        if(ring->pending == 0)
+            break;
+
+        if(syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0) {
+            if(errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                return false;
+        }
     }
 
-    // If the codepoint can fit into 16 bits.
-    if(codepoint <= 0xFFFF) {
-        // 1110xxxx 10xxxxxx 10xxxxxx
+    return true;
+}
+
+/*!
+ * Queues a read of the remainder of the file {index}, that is being loaded into {contents}.
+ */
+static void file_ringQueueRead(FileRing * ring, FileRingLoad * load, String contents, s64 index) {
+    struct io_uring_sqe * sqe = file_ringNext(ring, IORING_OP_READ, ((u64) index << FILE_URING_STAGE_BITS) | FILE_URING_READ);
+
+    sqe->fd = load->file;
+    sqe->addr = (u64) (uintptr_t) &contents.data[load->offset];
+    sqe->len = (u32) min(contents.length - load->offset, (s64) 0x7FFFF000);
+    sqe->off = (u64) load->offset;
+}
 
-        builder_appendChar(builder, (char) (0xE0 | (codepoint >> 12)));
-        builder_appendChar(builder, (char) (0x80 | ((codepoint >> 6) & 0x3F)));
-        return builder_appendChar(builder, (char) (0x80 | (codepoint & 0x3F)));
+/*!
+ * Loads the {count} files in {filenames} into {contents} using io_uring.
+ */
+static CLibErrorType file_loadAllUring(char ** filenames, s64 count, String * contents) {
+    FileRing ring;
+    CLibErrorType errorType = file_ringCreate(&ring, 2 * FILE_LOAD_MAX_IN_FLIGHT);
+    if(errorType != ERROR_SUCCESS)
+        return errorType;
+
+    FileRingLoad * loads = malloc((size_t) count * sizeof(FileRingLoad));
+    s64 * deferredIndices = malloc((size_t) count * sizeof(s64));
+    int * deferredFiles = malloc((size_t) count * sizeof(int));
+    if(loads == NULL || deferredIndices == NULL || deferredFiles == NULL) {
+        free(loads);
+        free(deferredIndices);
+        free(deferredFiles);
+        file_ringDestroy(&ring);
+
+        for(s64 index = 0; index < count; ++index) {
+            contents[index] = str_createErrored(ERROR_ALLOC, 0);
+        }
+        return ERROR_ALLOC;
     }
 
-    // If the codepoint can fit into 21 bits.
-    if(codepoint <= 0x001FFFFF) {
-        // 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
+    s64 next = 0;
+    s64 inFlight = 0;
+    s64 completed = 0;
+    s64 deferredCount = 0;
+    int errnum = 0;
+
+    while(completed < count) {
+        // Start loading more files, each of which is opened, then stat'd, and then read
+        while(inFlight < FILE_LOAD_MAX_IN_FLIGHT && next < count) {
+            FileRingLoad * load = &loads[next];
+
+            load->file = -1;
+            load->finished = false;
+            load->offset = 0;
+            contents[next] = str_createErrored(ERROR_FILE_READ, 0);
+
+            struct io_uring_sqe * open = file_ringNext(&ring, IORING_OP_OPENAT, ((u64) next << FILE_URING_STAGE_BITS) | FILE_URING_OPEN);
+            open->fd = AT_FDCWD;
+            open->addr = (u64) (uintptr_t) filenames[next];
+            open->open_flags = O_RDONLY | O_CLOEXEC;
+
+            next += 1;
+            inFlight += 1;
+        }
+
+        errorType = file_ringSubmitAndWait(&ring);
+        if(errorType != ERROR_SUCCESS) {
+            errnum = errno;
+            break;
+        }
+
+        u32 head = *ring.cqHead;
+        u32 tail = __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE);
+
+        for(; head != tail; ++head) {
+            struct io_uring_cqe * cqe = &ring.cqes[head & ring.cqMask];
+
+            s64 index = (s64) (cqe->user_data >> FILE_URING_STAGE_BITS);
+            u64 stage = cqe->user_data & ((1u << FILE_URING_STAGE_BITS) - 1);
+            int result = cqe->res;
+
+            FileRingLoad * load = &loads[index];
+            bool finished = false;
+
+            ring.pending -= 1;
+
+            if(stage == FILE_URING_OPEN) {
+                if(result < 0) {
+                    finished = true;
+                    contents[index] = str_createErrored(ERROR_FILE_OPEN, -result);
+                } else {
+                    // Stat the opened file, rather than its name, in case the name now refers to another file
+                    load->file = result;
+
+                    struct io_uring_sqe * stat = file_ringNext(&ring, IORING_OP_STATX, ((u64) index << FILE_URING_STAGE_BITS) | FILE_URING_STAT);
+                    stat->fd = load->file;
+                    stat->addr = (u64) (uintptr_t) "";
+                    stat->statx_flags = AT_EMPTY_PATH;
+                    stat->len = STATX_TYPE | STATX_SIZE;
+                    stat->off = (u64) (uintptr_t) &load->status;
+                }
+            } else if(stage == FILE_URING_STAT) {
+                finished = true;
+
+                if(result < 0) {
+                    contents[index] = str_createErrored(ERROR_FILE_STAT, -result);
+                } else if(!S_ISREG(load->status.stx_mode) || load->status.stx_size == 0) {
+                    // Files such as pipes and those in /proc do not report their size up front, and reading
+                    // them could block, so they are read using threads once the other files have loaded
+                    deferredIndices[deferredCount] = index;
+                    deferredFiles[deferredCount] = load->file;
+                    deferredCount += 1;
+                    load->file = -1;
+                } else if(!can_cast_s64_to_sizet((s64) load->status.stx_size)) {
+                    contents[index] = str_createErrored(ERROR_CAST, 0);
+                } else {
+                    contents[index] = str_createUninitialised((s64) load->status.stx_size);
+
+                    if(str_isValid(contents[index])) {
+                        file_ringQueueRead(&ring, load, contents[index], index);
+                        finished = false;
+                    }
+                }
+            } else {
+                finished = true;
+
+                if(result < 0) {
+                    str_destroy(&contents[index]);
+                    contents[index] = str_createErrored(ERROR_FILE_READ, -result);
+                } else if(result == 0) {
+                    // The file shrunk since it was stat'd
+                    contents[index].length = load->offset;
+                    if(load->offset == 0) {
+                        str_destroy(&contents[index]);
+                        contents[index] = str_createEmpty();
+                    }
+                } else {
+                    load->offset += result;
+
+                    if(load->offset < contents[index].length) {
+                        file_ringQueueRead(&ring, load, contents[index], index);
+                        finished = false;
+                    }
+                }
+            }
+
+            if(finished) {
+                load->finished = true;
 
-        builder_appendChar(builder, (char) (0xF0 | (codepoint >> 18)));
-        builder_appendChar(builder, (char) (0x80 | ((codepoint >> 12) & 0x3F)));
-        builder_appendChar(builder, (char) (0x80 | ((codepoint >> 6) & 0x3F)));
-        return builder_appendChar(builder, (char) (0x80 | (codepoint & 0x3F)));
+                if(load->file >= 0) {
+                    close(load->file);
+                    load->file = -1;
+                }
+
+                if(str_isValid(contents[index]) && contents[index].length > 0) {
+                    contents[index].data[contents[index].length] = '\0';
+                }
+
+                inFlight -= 1;
+                completed += 1;
+            }
+        }
+
+        __atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
     }
 
-    // If the codepoint can fit into 26 bits.
-    if(codepoint <= 0x03FFFFFF) {
-        // 111110xx 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx
+    if(errorType == ERROR_SUCCESS && deferredCount > 0) {
+        FileLoadThreads state;
+
+        state.filenames = filenames;
+        state.contents = contents;
+        state.count = deferredCount;
+        state.files = deferredFiles;
+        state.indices = deferredIndices;
+        state.next = 0;
 
-        builder_appendChar(builder, (char) (0xF8 | (codepoint >> 24)));
-        builder_appendChar(builder, (char) (0x80 | ((codepoint >> 18) & 0x3F)));
-        builder_appendChar(builder, (char) (0x80 | ((codepoint >> 12) & 0x3F)));
-        builder_appendChar(builder, (char) (0x80 | ((codepoint >> 6) & 0x3F)));
-        return builder_appendChar(builder, (char) (0x80 | (codepoint & 0x3F)));
+        file_runLoadThreads(&state);
     }
 
-    // If the codepoint can fit into 31 bits.
-    if(codepoint <= 0x7FFFFFFF) {
-        // 1111110x 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx
+    if(errorType != ERROR_SUCCESS) {
+        // Reads that are still in flight must complete before their Strings can be free'd
+        bool drained = file_ringDrain(&ring, loads);
+
+        for(s64 index = 0; index < deferredCount; ++index) {
+            close(deferredFiles[index]);
+        }
+
+        for(s64 index = 0; index < next; ++index) {
+            if(loads[index].file >= 0) {
+                close(loads[index].file);
+            }
+
+            // If the kernel may still be writing into a String, it is leaked rather than free'd
+            if(drained || loads[index].finished) {
+                str_destroy(&contents[index]);
+            }
+        }
 
-        builder_appendChar(builder, (char) (0xFC | (codepoint >> 30)));
-        builder_appendChar(builder, (char) (0x80 | ((codepoint >> 24) & 0x3F)));
-        builder_appendChar(builder, (char) (0x80 | ((codepoint >> 18) & 0x3F)));
-        builder_appendChar(builder, (char) (0x80 | ((codepoint >> 12) & 0x3F)));
-        builder_appendChar(builder, (char) (0x80 | ((codepoint >> 6) & 0x3F)));
-        return builder_appendChar(builder, (char) (0x80 | (codepoint & 0x3F)));
+        for(s64 index = 0; index < count; ++index) {
+            contents[index] = str_createErrored(errorType, errnum);
+        }
     }
 
-    // Invalid codepoint.
-    return ERROR_INVALID_CODEPOINT;
+    file_ringDestroy(&ring);
+    free(loads);
+    free(deferredIndices);
+    free(deferredFiles);
+    return errorType;
 }
 
-#define __utf16leToCodepoint_nextChar(remaining, next)                                   \
-    do {                                                                                 \
-        if(remaining->length < 2)                                                        \
-            return 0;                                                                    \
-                                                                                         \
-        next = (remaining->data[0] & 0xff) | ((u16) (remaining->data[1] & 0xff) << 8);   \
-                                                                                         \
-        remaining->length -= 2;                                                          \
-        remaining->data += 2;                                                            \
-    } while(0)
+#endif
 
-u32 utf16le_toCodepoint(String * remaining) {
-    u16 lo;
-    u16 hi;
+CLibErrorType file_loadAll(char ** filenames, s64 count, String * contents, FileLoadMethod method) {
+    if(count < 0)
+        return ERROR_NEG_LENGTH;
+    if(count == 0)
+        return ERROR_SUCCESS;
+    if(filenames == NULL || contents == NULL)
+        return ERROR_ARG_NULL;
 
-    __utf16leToCodepoint_nextChar(remaining, lo);
+    for(s64 index = 0; index < count; ++index) {
+        if(filenames[index] == NULL)
+            return ERROR_ARG_NULL;
+    }
 
-    // Single character
-    if(lo < 0xD800 || lo > 0xDFFF)
-        return (u32) lo;
+    if(method == FILE_LOAD_THREADS)
+        return file_loadAllThreads(filenames, count, contents);
 
-    // lo is the second half of a surrogate pair.
-    if(lo > 0xDBFF)
-        return 0;
+#ifdef CLIB_HAS_IO_URING
+    CLibErrorType errorType = file_loadAllUring(filenames, count, contents);
+    if(errorType == ERROR_SUCCESS || method == FILE_LOAD_IO_URING)
+        return errorType;
+#else
+    if(method == FILE_LOAD_IO_URING)
+        return ERROR_UNSUPPORTED;
+#endif
 
-    __utf16leToCodepoint_nextChar(remaining, hi);
+    return file_loadAllThreads(filenames, count, contents);
+}
 
-    // hi is not the second half of a surrogate pair.
-    if(hi < 0xDC00 || hi > 0xDFFF)
+/*!
+ * Map the contents of {filename} into memory to be read once from start to end,
+ * or read them into memory if the file cannot be mapped.
+ */
+static String file_mapOrRead(char * filename) {
+    // Files that do not report their size, such as pipes and those in /proc, cannot be mapped
+    struct stat status;
+    if(stat(filename, &status) == 0 && (!S_ISREG(status.st_mode) || status.st_size == 0))
+        return str_readFile(filename);
+
+    String contents = str_mapFile(filename, FILE_MAP_SEQUENTIAL | FILE_MAP_WILLNEED);
+
+    // Files that fail to map for other reasons are read into memory instead
+    if(str_getErrorType(contents) == ERROR_FILE_MAP) {
+        contents = str_readFile(filename);
+    }
+
+    return contents;
+}
+
+/*!
+ * The state shared by the threads of file_parallelForEachRecord.
+ */
+typedef struct FileRecordThreads {
+    String contents;
+    char delimiter;
+    s64 threadCount;
+    FileRecordCallback callback;
+    void * context;
+} FileRecordThreads;
+
+/*!
+ * The arguments passed to each thread started by file_parallelForEachRecord.
+ */
+typedef struct FileRecordThread {
+    FileRecordThreads * state;
+    s64 thread;
+} FileRecordThread;
+
+/*!
+ * Returns the index of the first record in {state} that starts at or after {index}.
+ */
+static s64 file_recordStart(FileRecordThreads * state, s64 index) {
+    if(index <= 0)
         return 0;
+    if(index >= state->contents.length)
+        return state->contents.length;
 
-    const u32 low10bits = (1 << 10) - 1;
+    char * data = state->contents.data;
+    char * found = memchr(&data[index - 1], state->delimiter, (size_t) (state->contents.length - index + 1));
 
-    return (((u32) lo & low10bits) << 10) + (hi & low10bits) + 0x10000;
+    return (found == NULL ? state->contents.length : (found - data) + 1);
 }
 
-#undef __utf16leToCodepoint_nextChar
+/*!
+ * Calls the callback of {state} with each of the records in the range of the file assigned to {thread}.
+ */
+static void file_forEachRecordInRange(FileRecordThreads * state, s64 thread) {
+    s64 length = state->contents.length;
 
-String utf16le_fromCodepoint(u32 codepoint) {
-    Builder builder = builder_create(4);
+    s64 count = state->threadCount;
 
-    utf16le_appendCodepoint(&builder, codepoint);
+    // Split so that length is never multiplied by the thread count, which could overflow
+    s64 start = file_recordStart(state, (length / count) * thread + (length % count) * thread / count);
+    s64 end = file_recordStart(state, (length / count) * (thread + 1) + (length % count) * (thread + 1) / count);
 
-    return builder_str(builder);
+    char * data = state->contents.data;
+
+    while(start < end) {
+        char * found = memchr(&data[start], state->delimiter, (size_t) (end - start));
+        s64 recordEnd = (found == NULL ? end : found - data);
+
+        String record;
+
+        record.data = (recordEnd > start ? &data[start] : NULL);
+        record.length = recordEnd - start;
+        record.flags = 0;
+
+        state->callback(record, thread, state->context);
+
+        start = recordEnd + 1;
+    }
 }
 
-#define __utf16leAppendCodepoint_append(builder, value, res)                        \
-    do {                                                                            \
-        const u8 low8bits = (1 << 8) - 1;                                           \
-        res = builder_appendChar(builder, (char) ((value) & low8bits));          \
-        res = builder_appendChar(builder, (char) (((value) >> 8) & low8bits));   \
-    } while(0);
+/*!
+ * The entry point of the threads started by file_parallelForEachRecord.
+ */
+static void * file_recordThread(void * argument) {
+    FileRecordThread * thread = argument;
 
-CLibErrorType utf16le_appendCodepoint(Builder * builder, u32 codepoint) {
-    CLibErrorType res;
+    file_forEachRecordInRange(thread->state, thread->thread);
 
-    if(codepoint < 0x10000) {
-        __utf16leAppendCodepoint_append(builder, (u16) codepoint, res);
-        return res;
+    return NULL;
+}
+
+CLibErrorType file_parallelForEachRecord(char * filename, char delimiter, s64 threads,
+                                         FileRecordCallback callback, void * context) {
+    if(filename == NULL || callback == NULL)
+        return ERROR_ARG_NULL;
+    if(threads < 0)
+        return ERROR_ARG_INVALID;
+
+    if(threads == 0) {
+        threads = max((s64) sysconf(_SC_NPROCESSORS_ONLN), (s64) 1);
     }
 
-    const u16 low10bits = (1 << 10) - 1;
+    String contents = file_mapOrRead(filename);
+    if(str_isErrored(contents))
+        return str_getErrorType(contents);
 
-    codepoint -= 0x10000;
+    if(str_isEmpty(contents)) {
+        str_destroy(&contents);
+        return ERROR_SUCCESS;
+    }
 
-    u16 lo = (u16) 0xD800 | (u16) ((codepoint >> 10) & low10bits);
-    u16 hi = (u16) 0xDC00 | (u16) (codepoint & low10bits);
+    FileRecordThreads state;
+
+    state.contents = contents;
+    state.delimiter = delimiter;
+    state.threadCount = min(threads, contents.length);
+    state.callback = callback;
+    state.context = context;
+
+    FileRecordThread * arguments = malloc((size_t) state.threadCount * sizeof(FileRecordThread));
+    pthread_t * handles = malloc((size_t) state.threadCount * sizeof(pthread_t));
+
+    if(arguments == NULL || handles == NULL) {
+        free(arguments);
+        free(handles);
+        str_destroy(&contents);
+        return ERROR_ALLOC;
+    }
+
+    for(s64 thread = 0; thread < state.threadCount; ++thread) {
+        arguments[thread].state = &state;
+        arguments[thread].thread = thread;
+    }
+
+    // The calling thread handles the first range itself
+    s64 started = 1;
+    for(; started < state.threadCount; ++started) {
+        if(pthread_create(&handles[started], NULL, &file_recordThread, &arguments[started]) != 0)
+            break;
+    }
+
+    file_forEachRecordInRange(&state, 0);
+
+    // Any ranges whose threads could not be started are handled by the calling thread
+    for(s64 thread = started; thread < state.threadCount; ++thread) {
+        file_forEachRecordInRange(&state, thread);
+    }
+
+    for(s64 thread = 1; thread < started; ++thread) {
+        pthread_join(handles[thread], NULL);
+    }
+
+    free(arguments);
+    free(handles);
+    str_destroy(&contents);
+
+    return ERROR_SUCCESS;
+}
+
+
+
+//
+// Builder
+//
+
+/*!
+ * Returns the size of the memory mapping used to store a mapped buffer of {capacity} chars.
+ */
+static s64 builder_mappingSize(s64 capacity);
+
+/*!
+ * Returns whether a buffer of {capacity} chars in {builder} should be stored in a memory mapping.
+ */
+static bool builder_shouldMap(Builder builder, s64 capacity);
+
+/*!
+ * Returns the capacity {builder} should grow to using its growth strategy
+ * so that it can store {requiredCapacity} chars.
+ *
+ * Will return 0 if the new capacity would overflow.
+ */
+static s64 builder_nextCapacity(Builder builder, s64 requiredCapacity);
+
+/*!
+ * Changes the capacity of the buffer of {builder} to {capacity}, storing it in a memory mapping
+ * if {mapped} is true or allocating it using malloc otherwise.
+ */
+static CLibErrorType builder_resize(Builder * builder, s64 capacity, bool mapped);
+
+/*!
+ * Moves the chunk being appended to in {builder} into its full chunks,
+ * and allocates a new chunk with space for at least {minimumSize} chars.
+ */
+static CLibErrorType builder_nextChunk(Builder * builder, s64 minimumSize);
+
+/*!
+ * Copies the contents of the chunked Builder {builder} into {destination}.
+ */
+static void builder_joinChunks(Builder builder, char * destination);
+
+/*!
+ * Frees the full chunks of {builder}.
+ */
+static void builder_freeChunks(Builder * builder);
+
+/*!
+ * Makes room for {count} contiguous chars at the end of {builder} and increases
+ * its length by {count}, setting {destination} to where they should be written.
+ */
+static CLibErrorType builder_claim(Builder * builder, s64 count, char ** destination);
+
+Builder builder_create(s64 initialSize) {
+    Builder builder;
+
+    builder.buffer = buf_create(initialSize);
+    builder.length = 0;
+    builder.growth = BUILDER_GROWTH_POWER_OF_2;
+    builder.growthParameter = 0;
+    builder.reallocCount = 0;
+    builder.isMapped = false;
+    builder.chunks = buf_createEmpty();
+    builder.chunkCount = 0;
+    builder.chunksLength = 0;
+
+    return builder;
+}
+
+Builder builder_createErrored(CLibErrorType errorType, int errnum) {
+    return builder_create(err_create(errorType, errnum));
+}
+
+CLibErrorType builder_setGrowth(Builder * builder, BuilderGrowth growth, s64 parameter) {
+    if(builder_isErrored(*builder))
+        return ERROR_ARG_INVALID;
+    if(growth < 0 || growth >= BUILDER_GROWTH_COUNT || parameter < 0)
+        return ERROR_ARG_INVALID;
+    if(growth == BUILDER_GROWTH_FIXED && parameter == 0)
+        return ERROR_ARG_INVALID;
+
+    // Join the chunks back together if the new strategy is not chunked.
+    if(builder->chunkCount > 0 && growth != BUILDER_GROWTH_CHUNKED) {
+        Buffer joined = buf_create(builder->length);
+        if(buf_isErrored(joined))
+            return buf_getErrorType(joined);
+
+        builder_joinChunks(*builder, joined.start);
+        builder_freeChunks(builder);
+        buf_destroy(&builder->buffer);
+
+        builder->buffer = joined;
+        builder->reallocCount += 1;
+    }
+
+    builder->growth = growth;
+    builder->growthParameter = parameter;
+
+    // Move the data out of its mapping if the new strategy wouldn't have mapped it.
+    if(builder->isMapped && !builder_shouldMap(*builder, builder->buffer.size))
+        return builder_resize(builder, builder->buffer.size, false);
+
+    return ERROR_SUCCESS;
+}
+
+bool builder_isErrored(Builder builder) {
+    return buf_isErrored(builder.buffer);
+}
+
+bool builder_isValid(Builder builder) {
+    return !builder_isErrored(builder);
+}
+
+void builder_destroy(Builder * builder) {
+    if(builder_isErrored(*builder))
+        return;
+
+    builder_freeChunks(builder);
+
+    if(builder->isMapped) {
+        munmap(builder->buffer.start, (size_t) builder_mappingSize(builder->buffer.size));
+    } else {
+        buf_destroy(&builder->buffer);
+    }
+
+    *builder = builder_createErrored(ERROR_FREED, 0);
+}
+
+String builder_str(Builder builder) {
+    if(builder_isErrored(builder)) {
+        CLibErrorType errorType = buf_getErrorType(builder.buffer);
+        int errnum = buf_getErrorNum(builder.buffer);
+        return str_createErrored(errorType, errnum);
+    }
+
+    if(builder.growth == BUILDER_GROWTH_CHUNKED) {
+        String joined = str_createUninitialised(builder.length);
+        if(str_isErrored(joined) || str_isEmpty(joined))
+            return joined;
+
+        builder_joinChunks(builder, joined.data);
+        return joined;
+    }
+
+    String string = str_createOfLength(builder.buffer.start, builder.length);
+
+    // Mapped data must be released using builder_destroy.
+    if(builder.isMapped) {
+        str_setFlag(&string, STRING_FLAG_IS_OWN_ALLOCATION, false);
+    }
+
+    return string;
+}
+
+Buffer builder_buf(Builder builder) {
+    if(builder_isErrored(builder)) {
+        CLibErrorType errorType = buf_getErrorType(builder.buffer);
+        int errnum = buf_getErrorNum(builder.buffer);
+        return buf_createErrored(errorType, errnum);
+    }
+
+    if(builder.growth == BUILDER_GROWTH_CHUNKED) {
+        Buffer joined = buf_create(builder.length);
+        if(buf_isErrored(joined) || buf_isEmpty(joined))
+            return joined;
+
+        builder_joinChunks(builder, joined.start);
+        return joined;
+    }
+
+    // Buffers do not track ownership, and destroying one would free() the mapped data.
+    if(builder.isMapped)
+        return buf_copy(buf_createUsing(builder.buffer.start, builder.length));
+
+    return buf_createUsing(builder.buffer.start, builder.length);
+}
+
+String builder_strCopy(Builder builder) {
+    // Chunked Builders already return a copy.
+    if(builder.growth == BUILDER_GROWTH_CHUNKED)
+        return builder_str(builder);
+
+    return str_copy(builder_str(builder));
+}
+
+Buffer builder_bufCopy(Builder builder) {
+    // Chunked and mapped Builders already return a copy.
+    if(builder.growth == BUILDER_GROWTH_CHUNKED || builder.isMapped)
+        return builder_buf(builder);
+
+    return buf_copy(builder_buf(builder));
+}
+
+s64 builder_iovecCount(Builder builder) {
+    if(builder_isErrored(builder))
+        return -1;
+
+    s64 tailLength = builder.length - builder.chunksLength;
+
+    return builder.chunkCount + (tailLength > 0 ? 1 : 0);
+}
+
+s64 builder_iovecs(Builder builder, struct iovec * iovecs, s64 maxIovecs) {
+    if(builder_isErrored(builder) || maxIovecs < 0)
+        return -1;
+    if(iovecs == NULL && maxIovecs > 0)
+        return -1;
+
+    struct iovec * chunks = (struct iovec *) builder.chunks.start;
+
+    s64 count = min(builder.chunkCount, maxIovecs);
+    for(s64 index = 0; index < count; ++index) {
+        iovecs[index] = chunks[index];
+    }
+
+    s64 tailLength = builder.length - builder.chunksLength;
+    if(tailLength > 0 && count == builder.chunkCount && count < maxIovecs) {
+        iovecs[count].iov_base = builder.buffer.start;
+        iovecs[count].iov_len = (size_t) tailLength;
+        count += 1;
+    }
+
+    return count;
+}
+
+static CLibErrorType builder_nextChunk(Builder * builder, s64 minimumSize) {
+    s64 chunkSize = (builder->growthParameter > 0 ? builder->growthParameter : BUILDER_DEFAULT_CHUNK_SIZE);
+    chunkSize = max(chunkSize, minimumSize);
+
+    s64 tailLength = builder->length - builder->chunksLength;
+
+    if(tailLength > 0) {
+        // Grow a copy of the chunks, as a failed realloc leaves the original chunks to be free'd
+        Buffer chunksCopy = builder->chunks;
+        s64 requiredCapacity = (builder->chunkCount + 1) * (s64) sizeof(struct iovec);
+
+        CLibErrorType result = buf_ensureCapacity(&chunksCopy, requiredCapacity);
+        if(result != ERROR_SUCCESS) {
+            int errnum = buf_getErrorNum(chunksCopy);
+
+            builder_freeChunks(builder);
+            buf_destroy(&builder->buffer);
+            builder->buffer = buf_createErrored(result, errnum);
+            return result;
+        }
+
+        builder->chunks = chunksCopy;
+
+        struct iovec * chunks = (struct iovec *) builder->chunks.start;
+        chunks[builder->chunkCount].iov_base = builder->buffer.start;
+        chunks[builder->chunkCount].iov_len = (size_t) tailLength;
+
+        builder->chunkCount += 1;
+        builder->chunksLength += tailLength;
+        builder->buffer = buf_createEmpty();
+    }
+
+    Buffer bufferCopy = builder->buffer;
+
+    CLibErrorType result = buf_setCapacity(&bufferCopy, chunkSize);
+    if(result != ERROR_SUCCESS) {
+        builder_freeChunks(builder);
+        buf_destroy(&builder->buffer);
+        builder->buffer = bufferCopy;
+        return result;
+    }
+
+    builder->buffer = bufferCopy;
+    return ERROR_SUCCESS;
+}
+
+static void builder_joinChunks(Builder builder, char * destination) {
+    struct iovec * chunks = (struct iovec *) builder.chunks.start;
+
+    for(s64 index = 0; index < builder.chunkCount; ++index) {
+        memcpy(destination, chunks[index].iov_base, chunks[index].iov_len);
+        destination += chunks[index].iov_len;
+    }
+
+    s64 tailLength = builder.length - builder.chunksLength;
+    if(tailLength > 0) {
+        memcpy(destination, builder.buffer.start, (size_t) tailLength);
+    }
+}
+
+static void builder_freeChunks(Builder * builder) {
+    struct iovec * chunks = (struct iovec *) builder->chunks.start;
+
+    for(s64 index = 0; index < builder->chunkCount; ++index) {
+        free(chunks[index].iov_base);
+    }
+
+    buf_destroy(&builder->chunks);
+
+    builder->chunks = buf_createEmpty();
+    builder->chunkCount = 0;
+    builder->chunksLength = 0;
+}
+
+static CLibErrorType builder_claim(Builder * builder, s64 count, char ** destination) {
+    if(builder_isErrored(*builder))
+        return ERROR_ARG_INVALID;
+    if(count > S64_MAX - builder->length)
+        return ERROR_OVERFLOW;
+
+    CLibErrorType result = builder_ensureCapacity(builder, builder->length + count);
+    if(result != ERROR_SUCCESS)
+        return result;
+
+    *destination = &builder->buffer.start[builder->length - builder->chunksLength];
+    builder->length += count;
+
+    return ERROR_SUCCESS;
+}
+
+static s64 builder_mappingSize(s64 capacity) {
+    s64 pageSize = (s64) sysconf(_SC_PAGESIZE);
+    if(pageSize <= 0) {
+        pageSize = 4096;
+    }
+
+    return ((capacity + pageSize - 1) / pageSize) * pageSize;
+}
+
+static bool builder_shouldMap(Builder builder, s64 capacity) {
+    if(builder.growth != BUILDER_GROWTH_HUGE)
+        return false;
+
+    s64 threshold = builder.growthParameter;
+    if(threshold == 0) {
+        threshold = BUILDER_DEFAULT_HUGE_THRESHOLD;
+    }
+
+    return capacity > threshold;
+}
+
+static s64 builder_nextCapacity(Builder builder, s64 requiredCapacity) {
+    s64 capacity = builder.buffer.size;
+
+    switch(builder.growth) {
+        case BUILDER_GROWTH_ONE_AND_A_HALF:
+        case BUILDER_GROWTH_HUGE: {
+            if(capacity > S64_MAX - capacity / 2)
+                return requiredCapacity;
+
+            s64 grown = capacity + capacity / 2;
+            return max(grown, requiredCapacity);
+        }
+
+        case BUILDER_GROWTH_FIXED: {
+            s64 increment = builder.growthParameter;
+            s64 increments = (requiredCapacity - capacity + increment - 1) / increment;
+            if(increments > (S64_MAX - capacity) / increment)
+                return 0;
+
+            return capacity + increments * increment;
+        }
+
+        case BUILDER_GROWTH_POWER_OF_2:
+        default:
+            return s64_nextPowerOf2(requiredCapacity);
+    }
+}
+
+static CLibErrorType builder_resize(Builder * builder, s64 capacity, bool mapped) {
+    if(builder->buffer.size == capacity && builder->isMapped == mapped)
+        return ERROR_SUCCESS;
+
+    if(!builder->isMapped && !mapped) {
+        CLibErrorType result = buf_setCapacity(&builder->buffer, capacity);
+        if(result == ERROR_SUCCESS) {
+            builder->reallocCount += 1;
+        }
+
+        return result;
+    }
+
+    if(!can_cast_s64_to_sizet(builder_mappingSize(capacity))) {
+        builder->buffer = buf_createErrored(ERROR_CAST, 0);
+        return ERROR_CAST;
+    }
+
+    char * oldData = builder->buffer.start;
+    size_t oldSize = (size_t) (builder->isMapped ? builder_mappingSize(builder->buffer.size) : builder->buffer.size);
+    size_t newSize = (size_t) (mapped ? builder_mappingSize(capacity) : capacity);
+    size_t keep = (size_t) min(builder->length, capacity);
+
+    char * newData;
+
+    if(capacity == 0) {
+        newData = NULL;
+    } else if(builder->isMapped && mapped) {
+#ifdef MREMAP_MAYMOVE
+        newData = mremap(oldData, oldSize, newSize, MREMAP_MAYMOVE);
+        if(newData == MAP_FAILED) {
+            int errnum = errno;
+            munmap(oldData, oldSize);
+            builder->buffer = buf_createErrored(ERROR_ALLOC, errnum);
+            return ERROR_ALLOC;
+        }
+
+        // The old mapping has been moved into the new mapping.
+        oldData = NULL;
+#else
+        newData = mmap(NULL, newSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#endif
+    } else if(mapped) {
+        newData = mmap(NULL, newSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    } else {
+        newData = malloc(newSize);
+    }
+
+    if(newData == MAP_FAILED || (capacity > 0 && newData == NULL)) {
+        int errnum = errno;
+
+        if(builder->isMapped) {
+            munmap(oldData, oldSize);
+        } else if(oldData != NULL) {
+            free(oldData);
+        }
+
+        builder->buffer = buf_createErrored(ERROR_ALLOC, errnum);
+        return ERROR_ALLOC;
+    }
+
+    if(oldData != NULL) {
+        if(keep > 0) {
+            memcpy(newData, oldData, keep);
+        }
+
+        if(builder->isMapped) {
+            munmap(oldData, oldSize);
+        } else {
+            free(oldData);
+        }
+    }
+
+    builder->buffer.start = newData;
+    builder->buffer.size = capacity;
+    builder->isMapped = (mapped && capacity > 0);
+    builder->reallocCount += 1;
+
+    return ERROR_SUCCESS;
+}
+
+CLibErrorType builder_setCapacity(Builder * builder, s64 capacity) {
+    if(capacity < builder->length) {
+        builder->buffer = buf_createErrored(ERROR_ARG_INVALID, 0);
+        return ERROR_ARG_INVALID;
+    }
+    if(builder_isErrored(*builder))
+        return ERROR_ARG_INVALID;
+
+    if(builder->growth == BUILDER_GROWTH_CHUNKED) {
+        CLibErrorType result = buf_setCapacity(&builder->buffer, capacity - builder->chunksLength);
+        if(result != ERROR_SUCCESS) {
+            builder_freeChunks(builder);
+            return result;
+        }
+
+        builder->reallocCount += 1;
+        return ERROR_SUCCESS;
+    }
+
+    return builder_resize(builder, capacity, builder_shouldMap(*builder, capacity));
+}
+
+CLibErrorType builder_ensureCapacity(Builder * builder, s64 requiredCapacity) {
+    if(builder_isErrored(*builder))
+        return ERROR_ARG_INVALID;
+    if(requiredCapacity <= builder->chunksLength + builder->buffer.size)
+        return ERROR_SUCCESS;
+
+    if(builder->growth == BUILDER_GROWTH_CHUNKED)
+        return builder_nextChunk(builder, requiredCapacity - builder->length);
+
+    s64 newCapacity = builder_nextCapacity(*builder, requiredCapacity);
+    if(newCapacity == 0) {
+        builder->buffer = buf_createErrored(ERROR_OVERFLOW, 0);
+        return ERROR_OVERFLOW;
+    }
+
+    return builder_resize(builder, newCapacity, builder_shouldMap(*builder, newCapacity));
+}
+
+CLibErrorType builder_reserve(Builder * builder, s64 additional) {
+    if(builder_isErrored(*builder))
+        return ERROR_ARG_INVALID;
+    if(additional < 0)
+        return ERROR_NEG_LENGTH;
+    if(additional > S64_MAX - builder->length)
+        return ERROR_OVERFLOW;
+
+    s64 requiredCapacity = builder->length + additional;
+    if(requiredCapacity <= builder->chunksLength + builder->buffer.size)
+        return ERROR_SUCCESS;
+
+    if(builder->growth == BUILDER_GROWTH_CHUNKED)
+        return builder_nextChunk(builder, additional);
+
+    return builder_resize(builder, requiredCapacity, builder_shouldMap(*builder, requiredCapacity));
+}
+
+CLibErrorType builder_trimToLength(Builder * builder) {
+    if(builder_isErrored(*builder))
+        return ERROR_ARG_INVALID;
+
+    return builder_setCapacity(builder, builder->length);
+}
+
+CLibErrorType builder_appendChar(Builder * builder, char character) {
+    char * destination;
+    CLibErrorType result = builder_claim(builder, 1, &destination);
+    if(result != ERROR_SUCCESS)
+        return result;
+
+    *destination = character;
+
+    return ERROR_SUCCESS;
+}
+
+CLibErrorType builder_appendStr(Builder * builder, String string) {
+    if(builder_isErrored(*builder))
+        return ERROR_ARG_INVALID;
+    if(str_isErrored(string))
+        return err_type(string.length);
+
+    if(string.length == 0)
+        return ERROR_SUCCESS;
+
+    // Chunked Builders fill the remainder of the current chunk before starting a new one.
+    if(builder->growth == BUILDER_GROWTH_CHUNKED) {
+        s64 copied = 0;
+
+        while(copied < string.length) {
+            s64 spare = builder->buffer.size - (builder->length - builder->chunksLength);
+            if(spare == 0) {
+                CLibErrorType result = builder_nextChunk(builder, 0);
+                if(result != ERROR_SUCCESS)
+                    return result;
+
+                continue;
+            }
+
+            s64 count = min(spare, string.length - copied);
+            memcpy(&builder->buffer.start[builder->length - builder->chunksLength], &string.data[copied], (size_t) count);
+
+            builder->length += count;
+            copied += count;
+        }
+
+        return ERROR_SUCCESS;
+    }
+
+    char * destination;
+    CLibErrorType result = builder_claim(builder, string.length, &destination);
+    if(result != ERROR_SUCCESS)
+        return result;
+
+    memcpy(destination, string.data, string.length);
+
+    return ERROR_SUCCESS;
+}
+
+CLibErrorType builder_appendBuf(Builder * builder, Buffer buffer) {
+    return builder_appendStr(builder, str_createOfLength(buffer.start, buffer.size));
+}
+
+CLibErrorType builder_appendC(Builder * builder, char * string) {
+    return builder_appendStr(builder, str_create(string));
+}
+
+CLibErrorType builder_appendSubstring(Builder * builder, String string, s64 start, s64 end) {
+    return builder_appendStr(builder, str_substring(string, start, end));
+}
+
+CLibErrorType builder_appendFormat(Builder * builder, char * format, ...) {
+    va_list argList;
+    va_start(argList, format);
+
+    CLibErrorType result = builder_vappendFormat(builder, format, argList);
+
+    va_end(argList);
+
+    return result;
+}
+
+CLibErrorType builder_vappendFormat(Builder * builder, char * format, va_list arguments) {
+    if(builder_isErrored(*builder))
+        return ERROR_ARG_INVALID;
+    if(format == NULL)
+        return ERROR_ARG_NULL;
+
+    va_list argumentsCopy;
+    va_copy(argumentsCopy, arguments);
+
+    // Try to format straight into the spare capacity of the builder.
+    s64 end = builder->length - builder->chunksLength;
+    s64 spare = builder->buffer.size - end;
+    char * destination = (spare > 0 ? &builder->buffer.start[end] : NULL);
+
+    s64 length = vsnprintf(destination, (size_t) spare, format, arguments);
+    if(length < 0) {
+        va_end(argumentsCopy);
+        return ERROR_FORMAT;
+    }
+
+    // vsnprintf needs space for a null character, even though it is not kept.
+    if(length < spare) {
+        builder->length += length;
+        va_end(argumentsCopy);
+        return ERROR_SUCCESS;
+    }
+
+    // It didn't fit, so grow the builder and format it again.
+    CLibErrorType result = builder_claim(builder, length + 1, &destination);
+    if(result != ERROR_SUCCESS) {
+        va_end(argumentsCopy);
+        return result;
+    }
+
+    vsnprintf(destination, (size_t) (length + 1), format, argumentsCopy);
+    builder->length -= 1;
+
+    va_end(argumentsCopy);
+    return ERROR_SUCCESS;
+}
+
+
+
+//
+// File Reader
+//
+
+/*!
+ * Returns a String that points to the chars from {start} to {end} in the buffer of {reader}.
+ */
+static String reader_view(FileReader * reader, s64 start, s64 end);
+
+/*!
+ * Makes room in the buffer of {reader} for at least {required} unconsumed chars, and then reads more data into it.
+ *
+ * Unconsumed chars are moved to the start of the buffer before the buffer is grown.
+ */
+static CLibErrorType reader_fill(FileReader * reader, s64 required);
+
+FileReader reader_create(char * filename, s64 capacity) {
+    if(filename == NULL)
+        return reader_createErrored(ERROR_ARG_NULL, 0);
+
+    int file = open(filename, O_RDONLY | O_CLOEXEC);
+    if(file < 0)
+        return reader_createErrored(ERROR_FILE_OPEN, errno);
+
+    FileReader reader = reader_createUsing(file, capacity);
+    if(reader_isErrored(reader)) {
+        close(file);
+        return reader;
+    }
+
+    reader.ownsFile = true;
+    return reader;
+}
+
+FileReader reader_createUsing(int file, s64 capacity) {
+    if(file < 0)
+        return reader_createErrored(ERROR_ARG_INVALID, 0);
+    if(capacity < 0)
+        return reader_createErrored(ERROR_NEG_LENGTH, 0);
+    if(capacity == 0) {
+        capacity = FILE_READER_DEFAULT_CAPACITY;
+    }
+
+    FileReader reader;
+
+    reader.file = file;
+    reader.ownsFile = false;
+    reader.isEndOfFile = false;
+    reader.buffer = buf_create(capacity);
+    reader.start = 0;
+    reader.end = 0;
+
+    return reader;
+}
+
+FileReader reader_createErrored(CLibErrorType errorType, int errnum) {
+    FileReader reader;
+
+    reader.file = -1;
+    reader.ownsFile = false;
+    reader.isEndOfFile = true;
+    reader.buffer = buf_createErrored(errorType, errnum);
+    reader.start = 0;
+    reader.end = 0;
+
+    return reader;
+}
+
+bool reader_isErrored(FileReader reader) {
+    return buf_isErrored(reader.buffer);
+}
+
+bool reader_isValid(FileReader reader) {
+    return buf_isValid(reader.buffer);
+}
+
+CLibErrorType reader_getErrorType(FileReader reader) {
+    return buf_getErrorType(reader.buffer);
+}
+
+void reader_destroy(FileReader * reader) {
+    if(reader_isErrored(*reader))
+        return;
+
+    if(reader->ownsFile) {
+        close(reader->file);
+    }
+
+    buf_destroy(&reader->buffer);
+
+    *reader = reader_createErrored(ERROR_FREED, 0);
+}
+
+static String reader_view(FileReader * reader, s64 start, s64 end) {
+    if(start == end)
+        return str_createEmpty();
+
+    String view;
+
+    view.data = &reader->buffer.start[start];
+    view.length = end - start;
+    view.flags = 0;
+
+    return view;
+}
+
+static CLibErrorType reader_fill(FileReader * reader, s64 required) {
+    s64 unconsumed = reader->end - reader->start;
+
+    if(reader->start + required > reader->buffer.size || reader->end == reader->buffer.size) {
+        if(unconsumed > 0) {
+            memmove(reader->buffer.start, &reader->buffer.start[reader->start], (size_t) unconsumed);
+        }
+
+        reader->start = 0;
+        reader->end = unconsumed;
+    }
+
+    if(required > reader->buffer.size || reader->end == reader->buffer.size) {
+        s64 capacity = reader->buffer.size;
+        while(capacity < required || capacity == reader->end) {
+            if(capacity > S64_MAX / 2)
+                return ERROR_OVERFLOW;
+
+            capacity *= 2;
+        }
+
+        CLibErrorType errorType = buf_setCapacity(&reader->buffer, capacity);
+        if(errorType != ERROR_SUCCESS)
+            return errorType;
+    }
+
+    ssize_t bytesRead;
+    do {
+        bytesRead = read(reader->file, &reader->buffer.start[reader->end], (size_t) (reader->buffer.size - reader->end));
+    } while(bytesRead < 0 && errno == EINTR);
+
+    if(bytesRead < 0)
+        return ERROR_FILE_READ;
+
+    if(bytesRead == 0) {
+        reader->isEndOfFile = true;
+    }
+
+    reader->end += bytesRead;
+    return ERROR_SUCCESS;
+}
+
+String reader_nextUntil(FileReader * reader, char delimiter) {
+    if(reader_isErrored(*reader))
+        return str_createErrored(ERROR_ARG_INVALID, 0);
+
+    // The number of unconsumed chars that have already been searched for the delimiter
+    s64 searched = 0;
+
+    while(true) {
+        s64 searchStart = reader->start + searched;
+        char * found = memchr(&reader->buffer.start[searchStart], delimiter, (size_t) (reader->end - searchStart));
+
+        if(found != NULL) {
+            s64 start = reader->start;
+            s64 end = found - reader->buffer.start;
+
+            reader->start = end + 1;
+            return reader_view(reader, start, end);
+        }
+
+        if(reader->isEndOfFile) {
+            if(reader->start == reader->end)
+                return str_createErrored(ERROR_STRING_EXHAUSTED, 0);
+
+            s64 start = reader->start;
+
+            reader->start = reader->end;
+            return reader_view(reader, start, reader->end);
+        }
+
+        searched = reader->end - reader->start;
+
+        CLibErrorType errorType = reader_fill(reader, searched + 1);
+        if(errorType != ERROR_SUCCESS)
+            return str_createErrored(errorType, errorType == ERROR_FILE_READ ? errno : 0);
+    }
+}
+
+String reader_nextLine(FileReader * reader) {
+    String line = reader_nextUntil(reader, '\n');
+
+    if(line.length > 0 && line.data[line.length - 1] == '\r') {
+        line.length -= 1;
+    }
+
+    return line;
+}
+
+String reader_read(FileReader * reader, s64 count) {
+    if(reader_isErrored(*reader))
+        return str_createErrored(ERROR_ARG_INVALID, 0);
+    if(count < 0)
+        return str_createErrored(ERROR_NEG_LENGTH, 0);
+
+    while(reader->end - reader->start < count && !reader->isEndOfFile) {
+        CLibErrorType errorType = reader_fill(reader, count);
+        if(errorType != ERROR_SUCCESS)
+            return str_createErrored(errorType, errorType == ERROR_FILE_READ ? errno : 0);
+    }
+
+    if(reader->start == reader->end && count > 0)
+        return str_createErrored(ERROR_STRING_EXHAUSTED, 0);
+
+    s64 start = reader->start;
+    s64 end = (reader->end - start < count ? reader->end : start + count);
+
+    reader->start = end;
+    return reader_view(reader, start, end);
+}
+
+
+
+//
+// File Writer
+//
+
+#ifndef IOV_MAX
+    #define IOV_MAX 1024
+#endif
+
+// Systems such as macOS do not declare fdatasync, so fsync is used instead
+#if defined(_POSIX_SYNCHRONIZED_IO) && _POSIX_SYNCHRONIZED_IO > 0
+    #define writer_syncFile(file) fdatasync(file)
+#else
+    #define writer_syncFile(file) fsync(file)
+#endif
+
+/*!
+ * The number of iovecs that can be written by writer_writeIovecs without allocating.
+ */
+#define WRITER_STACK_IOVECS 64
+
+/*!
+ * Writes all of the data in the {count} buffers in {iovecs} to {file}, retrying after partial writes.
+ *
+ * The contents of {iovecs} will be modified as data is written.
+ */
+static CLibErrorType writer_writeAll(int file, struct iovec * iovecs, s64 count);
+
+/*!
+ * Writes the data buffered in {writer} followed by the {count} buffers in {iovecs}, and then empties the buffer.
+ *
+ * The contents of {iovecs} will be modified as data is written.
+ */
+static CLibErrorType writer_writeBuffered(FileWriter * writer, struct iovec * iovecs, s64 count);
+
+FileWriter writer_create(char * filename, s64 capacity) {
+    if(filename == NULL)
+        return writer_createErrored(ERROR_ARG_NULL, 0);
+
+    int file = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(file < 0)
+        return writer_createErrored(ERROR_FILE_OPEN, errno);
+
+    FileWriter writer = writer_createUsing(file, capacity);
+    if(writer_isErrored(writer)) {
+        close(file);
+        return writer;
+    }
+
+    writer.ownsFile = true;
+    return writer;
+}
+
+FileWriter writer_createUsing(int file, s64 capacity) {
+    if(file < 0)
+        return writer_createErrored(ERROR_ARG_INVALID, 0);
+    if(capacity < 0)
+        return writer_createErrored(ERROR_NEG_LENGTH, 0);
+    if(capacity == 0) {
+        capacity = FILE_WRITER_DEFAULT_CAPACITY;
+    }
+
+    FileWriter writer;
+
+    writer.file = file;
+    writer.ownsFile = false;
+    writer.builder = builder_create(capacity);
+    writer.syncInterval = 0;
+    writer.unsyncedFlushes = 0;
+
+    return writer;
+}
+
+FileWriter writer_createErrored(CLibErrorType errorType, int errnum) {
+    FileWriter writer;
+
+    writer.file = -1;
+    writer.ownsFile = false;
+    writer.builder = builder_createErrored(errorType, errnum);
+    writer.syncInterval = 0;
+    writer.unsyncedFlushes = 0;
+
+    return writer;
+}
+
+bool writer_isErrored(FileWriter writer) {
+    return builder_isErrored(writer.builder);
+}
+
+bool writer_isValid(FileWriter writer) {
+    return builder_isValid(writer.builder);
+}
+
+CLibErrorType writer_getErrorType(FileWriter writer) {
+    return buf_getErrorType(writer.builder.buffer);
+}
+
+CLibErrorType writer_destroy(FileWriter * writer) {
+    if(writer_isErrored(*writer))
+        return ERROR_ARG_INVALID;
+
+    CLibErrorType errorType = writer_flush(writer);
+
+    if(writer->ownsFile && close(writer->file) != 0 && errorType == ERROR_SUCCESS) {
+        errorType = ERROR_FILE_CLOSE;
+    }
+
+    builder_destroy(&writer->builder);
+
+    *writer = writer_createErrored(ERROR_FREED, 0);
+
+    return errorType;
+}
+
+CLibErrorType writer_setSyncInterval(FileWriter * writer, s64 interval) {
+    if(writer_isErrored(*writer))
+        return ERROR_ARG_INVALID;
+    if(interval < 0)
+        return ERROR_NEG_LENGTH;
+
+    writer->syncInterval = interval;
+    return ERROR_SUCCESS;
+}
+
+static CLibErrorType writer_writeAll(int file, struct iovec * iovecs, s64 count) {
+    while(count > 0) {
+        if(iovecs->iov_len == 0) {
+            iovecs += 1;
+            count -= 1;
+            continue;
+        }
+
+        int batch = (int) (count < IOV_MAX ? count : IOV_MAX);
+
+        ssize_t written;
+        do {
+            written = writev(file, iovecs, batch);
+        } while(written < 0 && errno == EINTR);
+
+        if(written < 0)
+            return ERROR_FILE_WRITE;
+
+        // Skip past the buffers that have been completely written
+        while(count > 0 && (size_t) written >= iovecs->iov_len) {
+            written -= iovecs->iov_len;
+            iovecs += 1;
+            count -= 1;
+        }
+
+        if(written > 0) {
+            iovecs->iov_base = (char *) iovecs->iov_base + written;
+            iovecs->iov_len -= (size_t) written;
+        }
+    }
+
+    return ERROR_SUCCESS;
+}
+
+static CLibErrorType writer_writeBuffered(FileWriter * writer, struct iovec * iovecs, s64 count) {
+    iovecs[0].iov_base = writer->builder.buffer.start;
+    iovecs[0].iov_len = (size_t) writer->builder.length;
+
+    CLibErrorType errorType = writer_writeAll(writer->file, iovecs, count);
+    if(errorType != ERROR_SUCCESS)
+        return errorType;
+
+    writer->builder.length = 0;
+    writer->unsyncedFlushes += 1;
+
+    if(writer->syncInterval > 0 && writer->unsyncedFlushes >= writer->syncInterval) {
+        if(writer_syncFile(writer->file) != 0)
+            return ERROR_FILE_SYNC;
+
+        writer->unsyncedFlushes = 0;
+    }
+
+    return ERROR_SUCCESS;
+}
+
+CLibErrorType writer_flush(FileWriter * writer) {
+    if(writer_isErrored(*writer))
+        return ERROR_ARG_INVALID;
+    if(writer->builder.length == 0)
+        return ERROR_SUCCESS;
+
+    struct iovec iovec;
+    return writer_writeBuffered(writer, &iovec, 1);
+}
+
+CLibErrorType writer_sync(FileWriter * writer) {
+    CLibErrorType errorType = writer_flush(writer);
+    if(errorType != ERROR_SUCCESS)
+        return errorType;
+
+    if(writer_syncFile(writer->file) != 0)
+        return ERROR_FILE_SYNC;
+
+    writer->unsyncedFlushes = 0;
+    return ERROR_SUCCESS;
+}
+
+CLibErrorType writer_appendChar(FileWriter * writer, char character) {
+    if(writer_isErrored(*writer))
+        return ERROR_ARG_INVALID;
+
+    if(writer->builder.length >= writer->builder.buffer.size) {
+        CLibErrorType errorType = writer_flush(writer);
+        if(errorType != ERROR_SUCCESS)
+            return errorType;
+    }
+
+    return builder_appendChar(&writer->builder, character);
+}
+
+CLibErrorType writer_appendStr(FileWriter * writer, String string) {
+    if(writer_isErrored(*writer) || str_isErrored(string))
+        return ERROR_ARG_INVALID;
+
+    s64 capacity = writer->builder.buffer.size;
+
+    if(writer->builder.length + string.length <= capacity)
+        return builder_appendStr(&writer->builder, string);
+
+    // Large appends are written straight from string instead of being copied into the buffer
+    if(string.length >= capacity) {
+        struct iovec iovecs[2];
+
+        iovecs[1].iov_base = string.data;
+        iovecs[1].iov_len = (size_t) string.length;
+
+        return writer_writeBuffered(writer, iovecs, 2);
+    }
+
+    CLibErrorType errorType = writer_flush(writer);
+    if(errorType != ERROR_SUCCESS)
+        return errorType;
+
+    return builder_appendStr(&writer->builder, string);
+}
+
+CLibErrorType writer_appendBuf(FileWriter * writer, Buffer buffer) {
+    if(buf_isErrored(buffer))
+        return ERROR_ARG_INVALID;
+
+    return writer_appendStr(writer, str_createOfLength(buffer.start, buffer.size));
+}
+
+CLibErrorType writer_appendC(FileWriter * writer, char * string) {
+    if(string == NULL)
+        return ERROR_ARG_NULL;
+
+    return writer_appendStr(writer, str_create(string));
+}
+
+CLibErrorType writer_writeBuilder(FileWriter * writer, Builder builder) {
+    if(writer_isErrored(*writer) || builder_isErrored(builder))
+        return ERROR_ARG_INVALID;
+
+    s64 count = builder_iovecCount(builder);
+
+    struct iovec stackIovecs[WRITER_STACK_IOVECS];
+    struct iovec * iovecs = stackIovecs;
+
+    if(count + 1 > WRITER_STACK_IOVECS) {
+        if(!can_cast_s64_to_sizet((count + 1) * (s64) sizeof(struct iovec)))
+            return ERROR_CAST;
+
+        iovecs = malloc((size_t) (count + 1) * sizeof(struct iovec));
+        if(iovecs == NULL)
+            return ERROR_ALLOC;
+    }
+
+    builder_iovecs(builder, &iovecs[1], count);
+
+    CLibErrorType errorType = writer_writeBuffered(writer, iovecs, count + 1);
+
+    if(iovecs != stackIovecs) {
+        free(iovecs);
+    }
+
+    return errorType;
+}
+
+CLibErrorType writer_writeIovecs(FileWriter * writer, struct iovec * iovecs, s64 count) {
+    if(writer_isErrored(*writer))
+        return ERROR_ARG_INVALID;
+    if(iovecs == NULL && count > 0)
+        return ERROR_ARG_NULL;
+    if(count < 0)
+        return ERROR_NEG_LENGTH;
+
+    struct iovec stackIovecs[WRITER_STACK_IOVECS];
+    struct iovec * copy = stackIovecs;
+
+    // The iovecs are copied as writer_writeAll modifies them after partial writes
+    if(count + 1 > WRITER_STACK_IOVECS) {
+        if(!can_cast_s64_to_sizet((count + 1) * (s64) sizeof(struct iovec)))
+            return ERROR_CAST;
+
+        copy = malloc((size_t) (count + 1) * sizeof(struct iovec));
+        if(copy == NULL)
+            return ERROR_ALLOC;
+    }
+
+    if(count > 0) {
+        memcpy(&copy[1], iovecs, (size_t) count * sizeof(struct iovec));
+    }
+
+    CLibErrorType errorType = writer_writeBuffered(writer, copy, count + 1);
+
+    if(copy != stackIovecs) {
+        free(copy);
+    }
+
+    return errorType;
+}
+
+
+
+//
+// Number Conversion
+//
+
+/*!
+ * The two chars for each number from 0 to 99, used to write integers two digits at a time.
+ */
+static const char number_digitPairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/*!
+ * The powers of 10 that can be represented exactly by a double.
+ */
+static const double number_exactPowersOf10[23] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/*!
+ * The powers of 10 that fit in a u64.
+ */
+static const u64 number_powersOf10[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+    1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+    1000000000000000000ULL, 10000000000000000000ULL
+};
+
+/*!
+ * Returns the number of digits needed to write {value} in base 10.
+ */
+static s64 u64_countDigits(u64 value) {
+    s64 digits = 1;
+
+    for(;;) {
+        if(value < 10)
+            return digits;
+        if(value < 100)
+            return digits + 1;
+        if(value < 1000)
+            return digits + 2;
+        if(value < 10000)
+            return digits + 3;
+
+        value /= 10000;
+        digits += 4;
+    }
+}
+
+/*!
+ * Writes the {digits} digits of {value} in base 10 into {destination}.
+ */
+static void u64_writeDigits(u64 value, s64 digits, char * destination) {
+    char * end = &destination[digits];
+
+    while(value >= 100) {
+        u64 pair = (value % 100) * 2;
+        value /= 100;
+
+        end -= 2;
+        end[0] = number_digitPairs[pair];
+        end[1] = number_digitPairs[pair + 1];
+    }
+
+    if(value >= 10) {
+        end -= 2;
+        end[0] = number_digitPairs[value * 2];
+        end[1] = number_digitPairs[value * 2 + 1];
+    } else {
+        end -= 1;
+        end[0] = (char) ('0' + value);
+    }
+}
+
+CLibErrorType builder_appendU64(Builder * builder, u64 value) {
+    s64 digits = u64_countDigits(value);
+
+    char * destination;
+    CLibErrorType result = builder_claim(builder, digits, &destination);
+    if(result != ERROR_SUCCESS)
+        return result;
+
+    u64_writeDigits(value, digits, destination);
+
+    return ERROR_SUCCESS;
+}
+
+CLibErrorType builder_appendS64(Builder * builder, s64 value) {
+    u64 magnitude = (value < 0 ? (u64) 0 - (u64) value : (u64) value);
+    s64 digits = u64_countDigits(magnitude);
+    s64 signLength = (value < 0 ? 1 : 0);
+
+    char * destination;
+    CLibErrorType result = builder_claim(builder, signLength + digits, &destination);
+    if(result != ERROR_SUCCESS)
+        return result;
+
+    if(value < 0) {
+        destination[0] = '-';
+    }
+
+    u64_writeDigits(magnitude, digits, &destination[signLength]);
+
+    return ERROR_SUCCESS;
+}
+
+
+
+/*!
+ * A floating point number with a 64 bit significand {f} and a binary exponent {e}.
+ */
+typedef struct DiyFp {
+    u64 f;
+    int e;
+} DiyFp;
+
+/*!
+ * Normalised approximations of the powers of 10 from 1e-348 to 1e340 in steps of 8, used by Grisu2.
+ */
+static const DiyFp grisu_cachedPowers[87] = {
+    { 0xfa8fd5a0081c0288ULL, -1220 }, // 1e-348
+    { 0xbaaee17fa23ebf76ULL, -1193 }, // 1e-340
+    { 0x8b16fb203055ac76ULL, -1166 }, // 1e-332
+    { 0xcf42894a5dce35eaULL, -1140 }, // 1e-324
+    { 0x9a6bb0aa55653b2dULL, -1113 }, // 1e-316
+    { 0xe61acf033d1a45dfULL, -1087 }, // 1e-308
+    { 0xab70fe17c79ac6caULL, -1060 }, // 1e-300
+    { 0xff77b1fcbebcdc4fULL, -1034 }, // 1e-292
+    { 0xbe5691ef416bd60cULL, -1007 }, // 1e-284
+    { 0x8dd01fad907ffc3cULL,  -980 }, // 1e-276
+    { 0xd3515c2831559a83ULL,  -954 }, // 1e-268
+    { 0x9d71ac8fada6c9b5ULL,  -927 }, // 1e-260
+    { 0xea9c227723ee8bcbULL,  -901 }, // 1e-252
+    { 0xaecc49914078536dULL,  -874 }, // 1e-244
+    { 0x823c12795db6ce57ULL,  -847 }, // 1e-236
+    { 0xc21094364dfb5637ULL,  -821 }, // 1e-228
+    { 0x9096ea6f3848984fULL,  -794 }, // 1e-220
+    { 0xd77485cb25823ac7ULL,  -768 }, // 1e-212
+    { 0xa086cfcd97bf97f4ULL,  -741 }, // 1e-204
+    { 0xef340a98172aace5ULL,  -715 }, // 1e-196
+    { 0xb23867fb2a35b28eULL,  -688 }, // 1e-188
+    { 0x84c8d4dfd2c63f3bULL,  -661 }, // 1e-180
+    { 0xc5dd44271ad3cdbaULL,  -635 }, // 1e-172
+    { 0x936b9fcebb25c996ULL,  -608 }, // 1e-164
+    { 0xdbac6c247d62a584ULL,  -582 }, // 1e-156
+    { 0xa3ab66580d5fdaf6ULL,  -555 }, // 1e-148
+    { 0xf3e2f893dec3f126ULL,  -529 }, // 1e-140
+    { 0xb5b5ada8aaff80b8ULL,  -502 }, // 1e-132
+    { 0x87625f056c7c4a8bULL,  -475 }, // 1e-124
+    { 0xc9bcff6034c13053ULL,  -449 }, // 1e-116
+    { 0x964e858c91ba2655ULL,  -422 }, // 1e-108
+    { 0xdff9772470297ebdULL,  -396 }, // 1e-100
+    { 0xa6dfbd9fb8e5b88fULL,  -369 }, // 1e-92
+    { 0xf8a95fcf88747d94ULL,  -343 }, // 1e-84
+    { 0xb94470938fa89bcfULL,  -316 }, // 1e-76
+    { 0x8a08f0f8bf0f156bULL,  -289 }, // 1e-68
+    { 0xcdb02555653131b6ULL,  -263 }, // 1e-60
+    { 0x993fe2c6d07b7facULL,  -236 }, // 1e-52
+    { 0xe45c10c42a2b3b06ULL,  -210 }, // 1e-44
+    { 0xaa242499697392d3ULL,  -183 }, // 1e-36
+    { 0xfd87b5f28300ca0eULL,  -157 }, // 1e-28
+    { 0xbce5086492111aebULL,  -130 }, // 1e-20
+    { 0x8cbccc096f5088ccULL,  -103 }, // 1e-12
+    { 0xd1b71758e219652cULL,   -77 }, // 1e-4
+    { 0x9c40000000000000ULL,   -50 }, // 1e4
+    { 0xe8d4a51000000000ULL,   -24 }, // 1e12
+    { 0xad78ebc5ac620000ULL,     3 }, // 1e20
+    { 0x813f3978f8940984ULL,    30 }, // 1e28
+    { 0xc097ce7bc90715b3ULL,    56 }, // 1e36
+    { 0x8f7e32ce7bea5c70ULL,    83 }, // 1e44
+    { 0xd5d238a4abe98068ULL,   109 }, // 1e52
+    { 0x9f4f2726179a2245ULL,   136 }, // 1e60
+    { 0xed63a231d4c4fb27ULL,   162 }, // 1e68
+    { 0xb0de65388cc8ada8ULL,   189 }, // 1e76
+    { 0x83c7088e1aab65dbULL,   216 }, // 1e84
+    { 0xc45d1df942711d9aULL,   242 }, // 1e92
+    { 0x924d692ca61be758ULL,   269 }, // 1e100
+    { 0xda01ee641a708deaULL,   295 }, // 1e108
+    { 0xa26da3999aef774aULL,   322 }, // 1e116
+    { 0xf209787bb47d6b85ULL,   348 }, // 1e124
+    { 0xb454e4a179dd1877ULL,   375 }, // 1e132
+    { 0x865b86925b9bc5c2ULL,   402 }, // 1e140
+    { 0xc83553c5c8965d3dULL,   428 }, // 1e148
+    { 0x952ab45cfa97a0b3ULL,   455 }, // 1e156
+    { 0xde469fbd99a05fe3ULL,   481 }, // 1e164
+    { 0xa59bc234db398c25ULL,   508 }, // 1e172
+    { 0xf6c69a72a3989f5cULL,   534 }, // 1e180
+    { 0xb7dcbf5354e9beceULL,   561 }, // 1e188
+    { 0x88fcf317f22241e2ULL,   588 }, // 1e196
+    { 0xcc20ce9bd35c78a5ULL,   614 }, // 1e204
+    { 0x98165af37b2153dfULL,   641 }, // 1e212
+    { 0xe2a0b5dc971f303aULL,   667 }, // 1e220
+    { 0xa8d9d1535ce3b396ULL,   694 }, // 1e228
+    { 0xfb9b7cd9a4a7443cULL,   720 }, // 1e236
+    { 0xbb764c4ca7a44410ULL,   747 }, // 1e244
+    { 0x8bab8eefb6409c1aULL,   774 }, // 1e252
+    { 0xd01fef10a657842cULL,   800 }, // 1e260
+    { 0x9b10a4e5e9913129ULL,   827 }, // 1e268
+    { 0xe7109bfba19c0c9dULL,   853 }, // 1e276
+    { 0xac2820d9623bf429ULL,   880 }, // 1e284
+    { 0x80444b5e7aa7cf85ULL,   907 }, // 1e292
+    { 0xbf21e44003acdd2dULL,   933 }, // 1e300
+    { 0x8e679c2f5e44ff8fULL,   960 }, // 1e308
+    { 0xd433179d9c8cb841ULL,   986 }, // 1e316
+    { 0x9e19db92b4e31ba9ULL,  1013 }, // 1e324
+    { 0xeb96bf6ebadf77d9ULL,  1039 }, // 1e332
+    { 0xaf87023b9bf0ee6bULL,  1066 }  // 1e340
+};
+
+/*!
+ * Returns the product of {x} and {y}, rounded to 64 bits.
+ */
+static DiyFp diyfp_multiply(DiyFp x, DiyFp y) {
+    const u64 low32bits = 0xFFFFFFFFULL;
+
+    u64 a = x.f >> 32;
+    u64 b = x.f & low32bits;
+    u64 c = y.f >> 32;
+    u64 d = y.f & low32bits;
+
+    u64 ac = a * c;
+    u64 bc = b * c;
+    u64 ad = a * d;
+    u64 bd = b * d;
+
+    u64 middle = (bd >> 32) + (ad & low32bits) + (bc & low32bits);
+    middle += 1ULL << 31;
+
+    return (DiyFp) {
+        .f = ac + (ad >> 32) + (bc >> 32) + (middle >> 32),
+        .e = x.e + y.e + 64
+    };
+}
+
+/*!
+ * Shifts the significand of {x}, which must not be 0, so that its highest bit is set.
+ */
+static DiyFp diyfp_normalize(DiyFp x) {
+    int shift = __builtin_clzll(x.f);
+
+    return (DiyFp) {
+        .f = x.f << shift,
+        .e = x.e - shift
+    };
+}
+
+/*!
+ * Moves the last digit of {digits} closer to the exact value while it stays within the rounding interval.
+ */
+static void grisu_round(char * digits, int length, u64 delta, u64 rest, u64 tenKappa, u64 distance) {
+    while(rest < distance && delta - rest >= tenKappa
+          && (rest + tenKappa < distance || distance - rest > rest + tenKappa - distance)) {
+        digits[length - 1] -= 1;
+        rest += tenKappa;
+    }
+}
+
+/*!
+ * Generates the shortest digits that lie between the boundaries {low} and {high} of {w}, writing them
+ * into {digits} and {length}, and adjusting the decimal exponent {K} by the digits that were not needed.
+ */
+static void grisu_generateDigits(DiyFp w, DiyFp high, u64 delta, char * digits, int * length, int * K) {
+    DiyFp one = { 1ULL << -high.e, high.e };
+    u64 distance = high.f - w.f;
+
+    u32 p1 = (u32) (high.f >> -one.e);
+    u64 p2 = high.f & (one.f - 1);
+    int kappa = (int) u64_countDigits(p1);
+
+    *length = 0;
+
+    while(kappa > 0) {
+        u32 divisor = (u32) number_powersOf10[kappa - 1];
+        u32 digit = p1 / divisor;
+        p1 %= divisor;
+
+        if(digit != 0 || *length != 0) {
+            digits[(*length)++] = (char) ('0' + digit);
+        }
+
+        kappa -= 1;
+
+        u64 rest = ((u64) p1 << -one.e) + p2;
+        if(rest <= delta) {
+            *K += kappa;
+            grisu_round(digits, *length, delta, rest, number_powersOf10[kappa] << -one.e, distance);
+            return;
+        }
+    }
+
+    for(;;) {
+        p2 *= 10;
+        delta *= 10;
+
+        char digit = (char) (p2 >> -one.e);
+        if(digit != 0 || *length != 0) {
+            digits[(*length)++] = (char) ('0' + digit);
+        }
+
+        p2 &= one.f - 1;
+        kappa -= 1;
+
+        if(p2 < delta) {
+            *K += kappa;
+            int index = -kappa;
+            grisu_round(digits, *length, delta, p2, one.f, distance * (index < 20 ? number_powersOf10[index] : 0));
+            return;
+        }
+    }
+}
+
+/*!
+ * Generates digits that parse back to the positive, finite {value} using the Grisu2 algorithm,
+ * such that {value} is the digits multiplied by 10 to the power of {K}. The digits are usually,
+ * but not always, the shortest possible.
+ */
+static void grisu2(double value, char * digits, int * length, int * K) {
+    const u64 hiddenBit = 1ULL << 52;
+
+    u64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    int biasedExponent = (int) ((bits >> 52) & 0x7FF);
+    u64 significand = bits & (hiddenBit - 1);
+
+    DiyFp v;
+    if(biasedExponent != 0) {
+        v.f = significand + hiddenBit;
+        v.e = biasedExponent - 1075;
+    } else {
+        v.f = significand;
+        v.e = -1074;
+    }
+
+    // The boundaries halfway between value and its neighbouring doubles.
+    DiyFp high = { (v.f << 1) + 1, v.e - 1 };
+    while((high.f & (hiddenBit << 1)) == 0) {
+        high.f <<= 1;
+        high.e -= 1;
+    }
+    high.f <<= 10;
+    high.e -= 10;
+
+    DiyFp low;
+    if(v.f == hiddenBit) {
+        low = (DiyFp) { (v.f << 2) - 1, v.e - 2 };
+    } else {
+        low = (DiyFp) { (v.f << 1) - 1, v.e - 1 };
+    }
+    low.f <<= low.e - high.e;
+    low.e = high.e;
+
+    // Find a cached power of 10 that brings the exponent of high into the range [-60, -32].
+    double dk = (-61 - high.e) * 0.30102999566398114 + 347;
+    int k = (int) dk;
+    if(dk - k > 0.0) {
+        k += 1;
+    }
+
+    int index = (k >> 3) + 1;
+    *K = -(-348 + index * 8);
+
+    DiyFp cachedPower = grisu_cachedPowers[index];
+
+    DiyFp scaled = diyfp_multiply(diyfp_normalize(v), cachedPower);
+    DiyFp scaledHigh = diyfp_multiply(high, cachedPower);
+    DiyFp scaledLow = diyfp_multiply(low, cachedPower);
+
+    scaledLow.f += 1;
+    scaledHigh.f -= 1;
+
+    grisu_generateDigits(scaled, scaledHigh, scaledHigh.f - scaledLow.f, digits, length, K);
+}
+
+/*!
+ * Writes the exponent {exponent} into {destination}, returning the end of what was written.
+ */
+static char * number_writeExponent(int exponent, char * destination) {
+    if(exponent < 0) {
+        *destination++ = '-';
+        exponent = -exponent;
+    }
+
+    if(exponent >= 100) {
+        *destination++ = (char) ('0' + exponent / 100);
+        exponent %= 100;
+
+        *destination++ = number_digitPairs[exponent * 2];
+        *destination++ = number_digitPairs[exponent * 2 + 1];
+    } else if(exponent >= 10) {
+        *destination++ = number_digitPairs[exponent * 2];
+        *destination++ = number_digitPairs[exponent * 2 + 1];
+    } else {
+        *destination++ = (char) ('0' + exponent);
+    }
+
+    return destination;
+}
+
+/*!
+ * Writes {value} into {destination} as described by builder_appendDouble.
+ *
+ * {destination} must have space for NUMBER_MAX_DOUBLE_CHARS chars. Returns the number of chars written.
+ */
+static s64 number_writeDouble(double value, char * destination) {
+    char * start = destination;
+
+    if(isnan(value)) {
+        memcpy(destination, "NaN", 3);
+        return 3;
+    }
+
+    if(signbit(value)) {
+        *destination++ = '-';
+        value = -value;
+    }
+
+    if(isinf(value)) {
+        memcpy(destination, "Infinity", 8);
+        return (destination - start) + 8;
+    }
+
+    if(value == 0.0) {
+        memcpy(destination, "0.0", 3);
+        return (destination - start) + 3;
+    }
+
+    int length;
+    int K;
+    grisu2(value, destination, &length, &K);
+
+    // The position of the decimal point relative to the start of the digits.
+    int point = length + K;
+
+    if(K >= 0 && point <= 21) {
+        // 1234e7 -> 12340000000.0
+        for(int index = length; index < point; ++index) {
+            destination[index] = '0';
+        }
+
+        destination[point] = '.';
+        destination[point + 1] = '0';
+        destination += point + 2;
+    } else if(point > 0 && point <= 21) {
+        // 1234e-2 -> 12.34
+        memmove(&destination[point + 1], &destination[point], (size_t) (length - point));
+        destination[point] = '.';
+        destination += length + 1;
+    } else if(point > -6 && point <= 0) {
+        // 1234e-6 -> 0.001234
+        int offset = 2 - point;
+
+        memmove(&destination[offset], destination, (size_t) length);
+        destination[0] = '0';
+        destination[1] = '.';
+        for(int index = 2; index < offset; ++index) {
+            destination[index] = '0';
+        }
+
+        destination += length + offset;
+    } else if(length == 1) {
+        // 1e30
+        destination[1] = 'e';
+        destination = number_writeExponent(point - 1, &destination[2]);
+    } else {
+        // 1234e30 -> 1.234e33
+        memmove(&destination[2], &destination[1], (size_t) (length - 1));
+        destination[1] = '.';
+        destination[length + 1] = 'e';
+        destination = number_writeExponent(point - 1, &destination[length + 2]);
+    }
+
+    return destination - start;
+}
+
+CLibErrorType builder_appendDouble(Builder * builder, double value) {
+    char buffer[NUMBER_MAX_DOUBLE_CHARS];
+    s64 length = number_writeDouble(value, buffer);
+
+    return builder_appendStr(builder, str_createOfLength(buffer, length));
+}
+
+
+
+/*!
+ * Loads the 8 chars at {data} so that the first char is in the lowest byte.
+ */
+static u64 number_loadEightChars(char * data) {
+    u64 chunk;
+    memcpy(&chunk, data, sizeof(chunk));
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    chunk = __builtin_bswap64(chunk);
+#endif
+
+    return chunk;
+}
+
+/*!
+ * Returns whether all 8 chars in {chunk} are digits.
+ */
+static bool number_isEightDigits(u64 chunk) {
+    u64 highNibbles = chunk & 0xF0F0F0F0F0F0F0F0ULL;
+    u64 carriedNibbles = ((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4;
+
+    return (highNibbles | carriedNibbles) == 0x3333333333333333ULL;
+}
+
+/*!
+ * Converts the 8 digits in {chunk} into a number, with the first digit in the lowest byte being the most significant.
+ */
+static u64 number_parseEightDigits(u64 chunk) {
+    const u64 mask = 0x000000FF000000FFULL;
+    const u64 multiplier1 = 100 + (1000000ULL << 32);
+    const u64 multiplier2 = 1 + (10000ULL << 32);
+
+    chunk -= 0x3030303030303030ULL;
+
+    // Combine neighbouring digits into pairs, then pairs into groups of 4 and 8.
+    chunk = (chunk * 10) + (chunk >> 8);
+    chunk = (((chunk & mask) * multiplier1) + (((chunk >> 16) & mask) * multiplier2)) >> 32;
+
+    return (u64) (u32) chunk;
+}
+
+/*!
+ * Parses the {length} digits at {data} into {value}, returning false if any of them are not digits.
+ *
+ * {length} must be at most 19 so that the result cannot overflow.
+ */
+static bool number_parseDigits(char * data, s64 length, u64 * value) {
+    u64 result = 0;
+    s64 index = 0;
+
+    while(length - index >= 16) {
+        u64 high = number_loadEightChars(&data[index]);
+        u64 low = number_loadEightChars(&data[index + 8]);
+        if(!number_isEightDigits(high) || !number_isEightDigits(low))
+            return false;
+
+        result = result * 10000000000000000ULL + number_parseEightDigits(high) * 100000000ULL + number_parseEightDigits(low);
+        index += 16;
+    }
+
+    if(length - index >= 8) {
+        u64 chunk = number_loadEightChars(&data[index]);
+        if(!number_isEightDigits(chunk))
+            return false;
+
+        result = result * 100000000ULL + number_parseEightDigits(chunk);
+        index += 8;
+    }
+
+    for(; index < length; ++index) {
+        char character = data[index];
+        if(!char_isDigit(character))
+            return false;
+
+        result = result * 10 + (u64) (character - '0');
+    }
+
+    *value = result;
+    return true;
+}
+
+/*!
+ * Parses the {length} chars at {data} as an unsigned base 10 integer into {value}.
+ */
+static CLibErrorType number_parseU64(char * data, s64 length, u64 * value) {
+    if(length <= 0)
+        return ERROR_ARG_INVALID;
+
+    // Leading zeros don't count towards the number of digits that can fit in a u64.
+    while(length > 1 && data[0] == '0') {
+        data += 1;
+        length -= 1;
+    }
+
+    if(length <= 19) {
+        if(!number_parseDigits(data, length, value))
+            return ERROR_ARG_INVALID;
+
+        return ERROR_SUCCESS;
+    }
+
+    u64 high;
+    if(!number_parseDigits(data, 19, &high))
+        return ERROR_ARG_INVALID;
+
+    for(s64 index = 19; index < length; ++index) {
+        if(!char_isDigit(data[index]))
+            return ERROR_ARG_INVALID;
+    }
+
+    if(length > 20)
+        return ERROR_OVERFLOW;
+
+    u64 last = (u64) (data[19] - '0');
+    if(high > (U64_MAX - last) / 10)
+        return ERROR_OVERFLOW;
+
+    *value = high * 10 + last;
+    return ERROR_SUCCESS;
+}
+
+CLibErrorType str_parseU64(String string, u64 * value) {
+    if(str_isErrored(string))
+        return ERROR_ARG_INVALID;
+    if(value == NULL)
+        return ERROR_ARG_NULL;
+
+    return number_parseU64(string.data, string.length, value);
+}
+
+CLibErrorType str_parseS64(String string, s64 * value) {
+    if(str_isErrored(string))
+        return ERROR_ARG_INVALID;
+    if(value == NULL)
+        return ERROR_ARG_NULL;
+    if(string.length == 0)
+        return ERROR_ARG_INVALID;
+
+    bool negative = (string.data[0] == '-');
+    s64 signLength = (negative || string.data[0] == '+' ? 1 : 0);
+
+    u64 magnitude;
+    CLibErrorType result = number_parseU64(&string.data[signLength], string.length - signLength, &magnitude);
+    if(result != ERROR_SUCCESS)
+        return result;
+
+    if(negative) {
+        if(magnitude > (u64) S64_MAX + 1)
+            return ERROR_OVERFLOW;
+
+        *value = (magnitude == (u64) S64_MAX + 1 ? S64_MIN : -((s64) magnitude));
+    } else {
+        if(magnitude > (u64) S64_MAX)
+            return ERROR_OVERFLOW;
+
+        *value = (s64) magnitude;
+    }
+
+    return ERROR_SUCCESS;
+}
+
+/*!
+ * Converts the {digitCount} digits in {digits}, skipping a '.', multiplied by 10 to the power of {exponent}
+ * into the closest double using strtod. The digits are written out without a decimal point so that the
+ * decimal point of the current locale does not matter.
+ */
+static CLibErrorType number_parseDoubleSlow(char * digits, s64 digitCount, s64 exponent, double * value) {
+    char stackBuffer[128];
+    s64 bufferLength = digitCount + 32;
+
+    char * buffer = stackBuffer;
+    if(bufferLength > (s64) sizeof(stackBuffer)) {
+        if(!can_cast_s64_to_sizet(bufferLength))
+            return ERROR_CAST;
+
+        buffer = malloc((size_t) bufferLength);
+        if(buffer == NULL)
+            return ERROR_ALLOC;
+    }
+
+    s64 length = 0;
+    for(s64 index = 0; length < digitCount; ++index) {
+        if(digits[index] != '.') {
+            buffer[length++] = digits[index];
+        }
+    }
+
+    buffer[length++] = 'e';
+    length += snprintf(&buffer[length], 24, "%lld", (long long) exponent);
+
+    errno = 0;
+    *value = strtod(buffer, NULL);
+
+    if(buffer != stackBuffer) {
+        free(buffer);
+    }
+
+    if(isinf(*value))
+        return ERROR_OVERFLOW;
+
+    return ERROR_SUCCESS;
+}
+
+CLibErrorType str_parseDouble(String string, double * value) {
+    if(str_isErrored(string))
+        return ERROR_ARG_INVALID;
+    if(value == NULL)
+        return ERROR_ARG_NULL;
+
+    char * data = string.data;
+    s64 length = string.length;
+    s64 index = 0;
+
+    bool negative = false;
+    if(length > 0 && (data[0] == '-' || data[0] == '+')) {
+        negative = (data[0] == '-');
+        index += 1;
+    }
+
+    // Only compare against the special values when they are possible, as most numbers start with a digit.
+    if(index < length && (data[index] == 'N' || data[index] == 'I')) {
+        String unsignedPart = str_createOfLength(&data[index], length - index);
+        if(str_equalsC(unsignedPart, "NaN")) {
+            *value = NAN;
+            return ERROR_SUCCESS;
+        }
+        if(str_equalsC(unsignedPart, "Infinity")) {
+            *value = (negative ? -INFINITY : INFINITY);
+            return ERROR_SUCCESS;
+        }
+    }
+
+    // Accumulate up to 19 significant digits, which always fit in a u64.
+    u64 mantissa = 0;
+    s64 significantDigits = 0;
+    s64 exponent = 0;
+    bool truncated = false;
+
+    s64 digitsStart = index;
+    s64 digitCount = 0;
+    s64 fractionDigits = 0;
+
+    for(; index < length && char_isDigit(data[index]); ++index) {
+        u64 digit = (u64) (data[index] - '0');
+
+        if(significantDigits < 19) {
+            mantissa = mantissa * 10 + digit;
+            significantDigits += (mantissa != 0 ? 1 : 0);
+        } else {
+            truncated |= (digit != 0);
+            exponent += 1;
+        }
+    }
+    digitCount += index - digitsStart;
+
+    if(index < length && data[index] == '.') {
+        index += 1;
+
+        s64 fractionStart = index;
+        for(; index < length && char_isDigit(data[index]); ++index) {
+            u64 digit = (u64) (data[index] - '0');
+
+            if(significantDigits < 19) {
+                mantissa = mantissa * 10 + digit;
+                significantDigits += (mantissa != 0 ? 1 : 0);
+                exponent -= 1;
+            } else {
+                truncated |= (digit != 0);
+            }
+        }
+        fractionDigits = index - fractionStart;
+        digitCount += fractionDigits;
+    }
+
+    if(digitCount == 0)
+        return ERROR_ARG_INVALID;
+
+    s64 explicitExponent = 0;
+
+    if(index < length && (data[index] == 'e' || data[index] == 'E')) {
+        index += 1;
+
+        bool negativeExponent = false;
+        if(index < length && (data[index] == '-' || data[index] == '+')) {
+            negativeExponent = (data[index] == '-');
+            index += 1;
+        }
+
+        s64 exponentStart = index;
+        for(; index < length && char_isDigit(data[index]); ++index) {
+            // Stop accumulating once the result is guaranteed to be 0 or infinity.
+            if(explicitExponent < 1000000) {
+                explicitExponent = explicitExponent * 10 + (data[index] - '0');
+            }
+        }
+
+        if(index == exponentStart)
+            return ERROR_ARG_INVALID;
+
+        if(negativeExponent) {
+            explicitExponent = -explicitExponent;
+        }
+    }
+
+    if(index != length)
+        return ERROR_ARG_INVALID;
+
+    exponent += explicitExponent;
+
+    double result;
+    if(mantissa == 0) {
+        result = 0.0;
+    } else if(!truncated && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+        // Both the mantissa and the power of 10 are exact doubles, so this is correctly rounded.
+        result = (double) mantissa;
+
+        if(exponent < 0) {
+            result /= number_exactPowersOf10[-exponent];
+        } else {
+            result *= number_exactPowersOf10[exponent];
+        }
+    } else {
+        CLibErrorType parseResult = number_parseDoubleSlow(&data[digitsStart], digitCount, explicitExponent - fractionDigits, &result);
+        if(parseResult != ERROR_SUCCESS)
+            return parseResult;
+    }
+
+    *value = (negative ? -result : result);
+    return ERROR_SUCCESS;
+}
+
+
+
+//
+// Unicode
+//
+
+/*!
+ * Writes the UTF-16 code unit {unit} to {output} in little-endian order.
+ */
+static inline void utf16le_writeUnit(u8 * output, u16 unit) {
+    output[0] = (u8) (unit & 0xFF);
+    output[1] = (u8) (unit >> 8);
+}
+
+/*!
+ * Reads the UTF-16 code unit stored in little-endian order at {input}.
+ */
+static inline u16 utf16le_readUnit(u8 * input) {
+    return (u16) (input[0] | ((u16) input[1] << 8));
+}
+
+#define __utf8ToCodepoint_nextChar(remaining, next)   \
+    do {                                              \
+        if(remaining->length == 0)                    \
+            return 0;                                 \
+                                                      \
+        next = (u8) remaining->data[0];               \
+                                                      \
+        remaining->length -= 1;                       \
+        remaining->data += 1;                         \
+    } while(0)
+
+#define __utf8ToCodepoint_appendChar(remaining, next, codepoint)   \
+    do {                                                           \
+        __utf8ToCodepoint_nextChar(remaining, next);               \
+        codepoint <<= 6;                                           \
+        codepoint |= (u32) (next & 0b00111111);                    \
+    } while(0)
+
+u32 utf8_toCodepoint(String * remaining) {
+    u8 next;
+
+    __utf8ToCodepoint_nextChar(remaining, next);
+
+    // 0xxxxxxx
+    if(next < 0b10000000)
+        return (u32) next;
+
+    // 10xxxxxx
+    if(next < 0b11000000) {
+        // This char is the middle of a codepoint.
+        return 0;
+    }
+
+    // 110xxxxx 10xxxxxx
+    if(next < 0b11100000) {
+        u32 codepoint = (u32) (next & 0b00011111);
+
+        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
+
+        return codepoint;
+    }
+
+    // 1110xxxx 10xxxxxx 10xxxxxx
+    if(next < 0b11110000) {
+        u32 codepoint = (u32) (next & 0b00001111);
+
+        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
+        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
+
+        return codepoint;
+    }
+
+    // 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
+    if(next < 0b11111000) {
+        u32 codepoint = (u32) (next & 0b00000111);
+
+        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
+        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
+        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
+
+        return codepoint;
+    }
+
+    // 111110xx 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx
+    if(next < 0b11111100) {
+        u32 codepoint = (u32) (next & 0b00000011);
+
+        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
+        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
+        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
+        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
+
+        return codepoint;
+    }
+
+    // 1111110x 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx
+    if(next < 0b11111110) {
+        u32 codepoint = (u32) (next & 0b00000001);
+
+        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
+        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
+        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
+        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
+        __utf8ToCodepoint_appendChar(remaining, next, codepoint);
+
+        return codepoint;
+    }
+
+    // Invalid character
+    return 0;
+}
+
+#undef __utf8ToCodepoint_nextChar
+#undef __utf8ToCodepoint_appendChar
+
+String utf8_fromCodepoint(u32 codepoint) {
+    Builder builder = builder_create(4);
+
+    utf8_appendCodepoint(&builder, codepoint);
+
+    return builder_str(builder);
+}
+
+/*!
+ * Returns the number of chars needed to store {codepoint} in UTF-8, or 0 if it cannot be stored.
+ */
+static inline s64 utf8_codepointLength(u32 codepoint) {
+    if(codepoint <= 0x7F)
+        return 1;
+    if(codepoint <= 0x7FF)
+        return 2;
+    if(codepoint <= 0xFFFF)
+        return 3;
+    if(codepoint <= 0x001FFFFF)
+        return 4;
+    if(codepoint <= 0x03FFFFFF)
+        return 5;
+    if(codepoint <= 0x7FFFFFFF)
+        return 6;
+
+    return 0;
+}
+
+/*!
+ * Writes the {length} char UTF-8 encoding of {codepoint} to {destination}.
+ */
+static inline void utf8_encodeCodepoint(u32 codepoint, s64 length, u8 * destination) {
+    // The bits marking the start of characters of each length
+    static const u8 leadingBits[7] = {0x00, 0x00, 0xC0, 0xE0, 0xF0, 0xF8, 0xFC};
+
+    // 10xxxxxx continuation chars are filled in from the end
+    for(s64 index = length - 1; index > 0; --index) {
+        destination[index] = (u8) (0x80 | (codepoint & 0x3F));
+        codepoint >>= 6;
+    }
+
+    destination[0] = (u8) (leadingBits[length] | codepoint);
+}
+
+CLibErrorType utf8_appendCodepoint(Builder * builder, u32 codepoint) {
+    s64 length = utf8_codepointLength(codepoint);
+    if(length == 0)
+        return ERROR_INVALID_CODEPOINT;
+
+    char * destination;
+    CLibErrorType result = builder_claim(builder, length, &destination);
+    if(result != ERROR_SUCCESS)
+        return result;
+
+    utf8_encodeCodepoint(codepoint, length, (u8 *) destination);
+
+    return ERROR_SUCCESS;
+}
+
+#define __utf16leToCodepoint_nextChar(remaining, next)                                   \
+    do {                                                                                 \
+        if(remaining->length < 2)                                                        \
+            return 0;                                                                    \
+                                                                                         \
+        next = (remaining->data[0] & 0xff) | ((u16) (remaining->data[1] & 0xff) << 8);   \
+                                                                                         \
+        remaining->length -= 2;                                                          \
+        remaining->data += 2;                                                            \
+    } while(0)
+
+u32 utf16le_toCodepoint(String * remaining) {
+    u16 lo;
+    u16 hi;
+
+    __utf16leToCodepoint_nextChar(remaining, lo);
+
+    // Single character
+    if(lo < 0xD800 || lo > 0xDFFF)
+        return (u32) lo;
+
+    // lo is the second half of a surrogate pair.
+    if(lo > 0xDBFF)
+        return 0;
+
+    __utf16leToCodepoint_nextChar(remaining, hi);
+
+    // hi is not the second half of a surrogate pair.
+    if(hi < 0xDC00 || hi > 0xDFFF)
+        return 0;
+
+    const u32 low10bits = (1 << 10) - 1;
+
+    return (((u32) lo & low10bits) << 10) + (hi & low10bits) + 0x10000;
+}
+
+#undef __utf16leToCodepoint_nextChar
+
+String utf16le_fromCodepoint(u32 codepoint) {
+    Builder builder = builder_create(4);
+
+    utf16le_appendCodepoint(&builder, codepoint);
+
+    return builder_str(builder);
+}
+
+CLibErrorType utf16le_appendCodepoint(Builder * builder, u32 codepoint) {
+    if(codepoint > 0x10FFFF)
+        return ERROR_INVALID_CODEPOINT;
+
+    char * destination;
+
+    if(codepoint < 0x10000) {
+        CLibErrorType result = builder_claim(builder, 2, &destination);
+        if(result != ERROR_SUCCESS)
+            return result;
+
+        utf16le_writeUnit((u8 *) destination, (u16) codepoint);
+        return ERROR_SUCCESS;
+    }
+
+    CLibErrorType result = builder_claim(builder, 4, &destination);
+    if(result != ERROR_SUCCESS)
+        return result;
+
+    const u16 low10bits = (1 << 10) - 1;
+
+    codepoint -= 0x10000;
+
+    u16 lo = (u16) 0xD800 | (u16) ((codepoint >> 10) & low10bits);
+    u16 hi = (u16) 0xDC00 | (u16) (codepoint & low10bits);
+
+    utf16le_writeUnit((u8 *) destination, lo);
+    utf16le_writeUnit((u8 *) destination + 2, hi);
+    return ERROR_SUCCESS;
+}
+
+/*!
+ * Returns the number of chars in the UTF-8 character that starts with {lead}, or 0 if {lead}
+ * cannot start a character. Only valid for chars that are not ASCII.
+ */
+static s64 utf8_sequenceLength(u8 lead) {
+    if(lead < 0xC2)
+        return 0;
+    if(lead < 0xE0)
+        return 2;
+    if(lead < 0xF0)
+        return 3;
+    if(lead < 0xF5)
+        return 4;
+
+    return 0;
+}
+
+/*!
+ * Returns the index of the first invalid char in the {length} chars of {data}, or -1 if they are all valid.
+ *
+ * ASCII is skipped 8 chars at a time.
+ */
+static s64 utf8_validateScalar(u8 * data, s64 length) {
+    s64 index = 0;
+
+    while(index < length) {
+        if(index + 8 <= length) {
+            u64 chars;
+            memcpy(&chars, &data[index], 8);
+
+            if((chars & 0x8080808080808080ull) == 0) {
+                index += 8;
+                continue;
+            }
+        }
+
+        u8 lead = data[index];
+        if(lead < 0x80) {
+            index += 1;
+            continue;
+        }
+
+        s64 sequenceLength = utf8_sequenceLength(lead);
+        if(sequenceLength == 0 || index + sequenceLength > length)
+            return index;
+
+        // The range of the second char is restricted to rule out overlong encodings, surrogates and codepoints above U+10FFFF
+        u8 second = data[index + 1];
+        u8 secondMin = (lead == 0xE0 ? 0xA0 : (lead == 0xF0 ? 0x90 : 0x80));
+        u8 secondMax = (lead == 0xED ? 0x9F : (lead == 0xF4 ? 0x8F : 0xBF));
+
+        if(second < secondMin || second > secondMax)
+            return index;
+
+        for(s64 offset = 2; offset < sequenceLength; ++offset) {
+            if((data[index + offset] & 0xC0) != 0x80)
+                return index;
+        }
+
+        index += sequenceLength;
+    }
+
+    return -1;
+}
+
+/*!
+ * Returns the index of the start of the character that contains the char at {index}
+ * in {data}, given that all of the chars before {index} are valid UTF-8.
+ */
+static s64 utf8_characterStart(u8 * data, s64 index) {
+    if(index == 0)
+        return 0;
+
+    s64 start = index - 1;
+    while(start > 0 && start > index - 4 && (data[start] & 0xC0) == 0x80) {
+        start -= 1;
+    }
+
+    return start;
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+
+#include <immintrin.h>
+
+#define UTF8_SIMD_AVX2
+
+/*!
+ * The error bits used by the lookup tables of utf8_validateAVX2. Each names a
+ * way that two consecutive chars can be invalid UTF-8.
+ */
+#define UTF8_TOO_SHORT      (1 << 0)
+#define UTF8_TOO_LONG       (1 << 1)
+#define UTF8_OVERLONG_3     (1 << 2)
+#define UTF8_TOO_LARGE      (1 << 3)
+#define UTF8_SURROGATE      (1 << 4)
+#define UTF8_OVERLONG_2     (1 << 5)
+#define UTF8_TOO_LARGE_1000 (1 << 6)
+#define UTF8_OVERLONG_4     (1 << 6)
+#define UTF8_TWO_CONTS      (1 << 7)
+#define UTF8_CARRY          (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+/*!
+ * Repeats the 16 bytes of a lookup table into both lanes of an AVX2 register.
+ */
+#define utf8_lookupTable(...) _mm256_setr_epi8(__VA_ARGS__, __VA_ARGS__)
+
+/*!
+ * Returns the chars of {input} shifted along by {count} chars, filled in with the end of {previous}.
+ */
+#define utf8_previous(input, previous, count) \
+    _mm256_alignr_epi8((input), _mm256_permute2x128_si256((previous), (input), 0x21), 16 - (count))
+
+/*!
+ * Returns the index of the first invalid char in the {length} chars of {data}, or -1 if they are all valid.
+ *
+ * Uses the lookup table algorithm of Keiser and Lemire, which classifies each pair of
+ * consecutive chars using the high and low nibbles of the first and the high nibble of
+ * the second, and checks the 3rd and 4th chars of characters separately. Blocks of ASCII
+ * only need to check that the previous block did not end part way through a character.
+ */
+__attribute__((target("avx2")))
+static s64 utf8_validateAVX2(u8 * data, s64 length) {
+    const __m256i byte1High = utf8_lookupTable(
+        // 0_______ ________ <ASCII in byte 1>
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        // 10______ ________ <continuation in byte 1>
+        UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+        // 1100____ ________ <two byte lead in byte 1>
+        UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+        // 1101____ ________ <two byte lead in byte 1>
+        UTF8_TOO_SHORT,
+        // 1110____ ________ <three byte lead in byte 1>
+        UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+        // 1111____ ________ <four+ byte lead in byte 1>
+        UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4
+    );
+
+    const __m256i byte1Low = utf8_lookupTable(
+        // ____0000 ________
+        UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+        // ____0001 ________
+        UTF8_CARRY | UTF8_OVERLONG_2,
+        // ____001_ ________
+        UTF8_CARRY,
+        UTF8_CARRY,
+        // ____0100 ________
+        UTF8_CARRY | UTF8_TOO_LARGE,
+        // ____0101 ________
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        // ____011_ ________
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        // ____1___ ________
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        // ____1101 ________
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000
+    );
+
+    const __m256i byte2High = utf8_lookupTable(
+        // ________ 0_______ <ASCII in byte 2>
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        // ________ 1000____
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+        // ________ 1001____
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+        // ________ 101_____
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+        // ________ 11______
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT
+    );
+
+    // The last 3 chars of a block are incomplete if they start a character that is longer than the chars left
+    const __m256i maxComplete = _mm256_setr_epi8(
+        (char) 255, (char) 255, (char) 255, (char) 255, (char) 255, (char) 255, (char) 255, (char) 255,
+        (char) 255, (char) 255, (char) 255, (char) 255, (char) 255, (char) 255, (char) 255, (char) 255,
+        (char) 255, (char) 255, (char) 255, (char) 255, (char) 255, (char) 255, (char) 255, (char) 255,
+        (char) 255, (char) 255, (char) 255, (char) 255, (char) 255,
+        (char) (0xF0 - 1), (char) (0xE0 - 1), (char) (0xC0 - 1)
+    );
+
+    const __m256i lowNibble = _mm256_set1_epi8(0x0F);
+
+    __m256i previous = _mm256_setzero_si256();
+    __m256i previousIncomplete = _mm256_setzero_si256();
+
+    s64 index = 0;
+    for(; index + 32 <= length; index += 32) {
+        __m256i input = _mm256_loadu_si256((__m256i *) &data[index]);
+        __m256i error;
+
+        if(_mm256_movemask_epi8(input) == 0) {
+            error = previousIncomplete;
+            previousIncomplete = _mm256_setzero_si256();
+        } else {
+            __m256i previous1 = utf8_previous(input, previous, 1);
+
+            __m256i byte1HighNibbles = _mm256_and_si256(_mm256_srli_epi16(previous1, 4), lowNibble);
+            __m256i byte1LowNibbles = _mm256_and_si256(previous1, lowNibble);
+            __m256i byte2HighNibbles = _mm256_and_si256(_mm256_srli_epi16(input, 4), lowNibble);
+
+            __m256i specialCases = _mm256_and_si256(
+                _mm256_and_si256(
+                    _mm256_shuffle_epi8(byte1High, byte1HighNibbles),
+                    _mm256_shuffle_epi8(byte1Low, byte1LowNibbles)
+                ),
+                _mm256_shuffle_epi8(byte2High, byte2HighNibbles)
+            );
+
+            // Only the 3rd char of 3 and 4 char characters and the 4th char of 4 char characters have their top bit set
+            __m256i previous2 = utf8_previous(input, previous, 2);
+            __m256i previous3 = utf8_previous(input, previous, 3);
+            __m256i isThirdChar = _mm256_subs_epu8(previous2, _mm256_set1_epi8((char) (0xE0 - 0x80)));
+            __m256i isFourthChar = _mm256_subs_epu8(previous3, _mm256_set1_epi8((char) (0xF0 - 0x80)));
+            __m256i mustBeContinuation = _mm256_and_si256(_mm256_or_si256(isThirdChar, isFourthChar), _mm256_set1_epi8((char) 0x80));
+
+            error = _mm256_xor_si256(mustBeContinuation, specialCases);
+            previousIncomplete = _mm256_subs_epu8(input, maxComplete);
+        }
+
+        if(!_mm256_testz_si256(error, error)) {
+            s64 start = utf8_characterStart(data, index);
+            s64 invalid = utf8_validateScalar(&data[start], length - start);
+
+            return (invalid < 0 ? -1 : start + invalid);
+        }
+
+        previous = input;
+    }
+
+    // The remaining chars, and any character cut off at the end of the last block, are checked one at a time
+    s64 start = utf8_characterStart(data, index);
+    s64 invalid = utf8_validateScalar(&data[start], length - start);
+
+    return (invalid < 0 ? -1 : start + invalid);
+}
+
+#undef utf8_lookupTable
+#undef utf8_previous
+
+#endif
+
+s64 utf8_validate(String string) {
+    if(str_isErrored(string))
+        return -2;
+
+#ifdef UTF8_SIMD_AVX2
+    if(string.length >= 64 && __builtin_cpu_supports("avx2"))
+        return utf8_validateAVX2((u8 *) string.data, string.length);
+#endif
+
+    return utf8_validateScalar((u8 *) string.data, string.length);
+}
+
+/*!
+ * Returns a mask of the top bit of each of the 8 chars in {chars} that are not 10xxxxxx continuation chars.
+ */
+static inline u64 utf8_codepointStartMask(u64 chars) {
+    const u64 highBits = 0x8080808080808080ull;
+
+    // A char is a continuation char if its top bit is set and its second bit is not
+    return ~(chars & ~(chars << 1)) & highBits;
+}
+
+/*!
+ * Returns the number of chars that are not continuation chars in the {length} chars of {data}, 8 at a time.
+ */
+static s64 utf8_countCodepointsScalar(u8 * data, s64 length) {
+    s64 count = 0;
+    s64 index = 0;
+
+    for(; index + 8 <= length; index += 8) {
+        u64 chars;
+        memcpy(&chars, &data[index], 8);
+
+        count += __builtin_popcountll(utf8_codepointStartMask(chars));
+    }
+
+    for(; index < length; ++index) {
+        count += ((data[index] & 0xC0) != 0x80);
+    }
+
+    return count;
+}
+
+#ifdef UTF8_SIMD_AVX2
+
+/*!
+ * Returns the number of chars that are not continuation chars in the {length} chars of {data}, 32 at a time.
+ */
+__attribute__((target("avx2")))
+static s64 utf8_countCodepointsAVX2(u8 * data, s64 length) {
+    // Continuation chars are 0x80 to 0xBF, which are the lowest values as signed chars
+    const __m256i maxContinuation = _mm256_set1_epi8((char) 0xBF);
+
+    s64 count = 0;
+    s64 index = 0;
+
+    while(index + 32 <= length) {
+        // Each lane of the counts can be incremented at most 255 times before it overflows
+        __m256i counts = _mm256_setzero_si256();
+
+        s64 blocks = min((length - index) / 32, (s64) 255);
+        for(s64 block = 0; block < blocks; ++block, index += 32) {
+            __m256i chars = _mm256_loadu_si256((__m256i *) &data[index]);
+            __m256i isStart = _mm256_cmpgt_epi8(chars, maxContinuation);
+
+            counts = _mm256_sub_epi8(counts, isStart);
+        }
+
+        __m256i sums = _mm256_sad_epu8(counts, _mm256_setzero_si256());
+
+        count += _mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1)
+                 + _mm256_extract_epi64(sums, 2) + _mm256_extract_epi64(sums, 3);
+    }
+
+    return count + utf8_countCodepointsScalar(&data[index], length - index);
+}
+
+#endif
+
+s64 utf8_countCodepoints(String string) {
+    if(str_isErrored(string))
+        return -2;
+
+#ifdef UTF8_SIMD_AVX2
+    if(string.length >= 64 && __builtin_cpu_supports("avx2"))
+        return utf8_countCodepointsAVX2((u8 *) string.data, string.length);
+#endif
+
+    return utf8_countCodepointsScalar((u8 *) string.data, string.length);
+}
+
+/*!
+ * Returns the index of the char that starts the codepoint {codepoints} codepoints after the
+ * codepoint starting at {offset} in the {length} chars of {data}. Returns {length} if it would
+ * be the end of {data}, or -1 if there are not enough codepoints left.
+ */
+static s64 utf8_advance(u8 * data, s64 length, s64 offset, s64 codepoints) {
+    // The number of codepoint starts that still need to be passed, including the one at offset
+    s64 remaining = codepoints + 1;
+
+    for(; offset + 8 <= length; offset += 8) {
+        u64 chars;
+        memcpy(&chars, &data[offset], 8);
+
+        s64 starts = __builtin_popcountll(utf8_codepointStartMask(chars));
+        if(starts >= remaining)
+            break;
+
+        remaining -= starts;
+    }
+
+    for(; offset < length; ++offset) {
+        if((data[offset] & 0xC0) != 0x80) {
+            remaining -= 1;
+
+            if(remaining == 0)
+                return offset;
+        }
+    }
+
+    return (remaining == 1 ? length : -1);
+}
+
+UTF8Index utf8_createIndex(String string, s64 interval) {
+    UTF8Index index;
+
+    index.interval = (interval == 0 ? UTF8_INDEX_DEFAULT_INTERVAL : interval);
+    index.codepointCount = 0;
+
+    if(str_isErrored(string) || interval < 0) {
+        index.offsets = buf_createErrored(ERROR_ARG_INVALID, 0);
+        return index;
+    }
+
+    index.codepointCount = utf8_countCodepoints(string);
+
+    s64 offsetCount = index.codepointCount / index.interval + 1;
+    index.offsets = buf_create(offsetCount * (s64) sizeof(s64));
+    if(buf_isErrored(index.offsets))
+        return index;
+
+    s64 * offsets = (s64 *) index.offsets.start;
+    u8 * data = (u8 *) string.data;
+
+    offsets[0] = 0;
+    for(s64 entry = 1; entry < offsetCount; ++entry) {
+        offsets[entry] = utf8_advance(data, string.length, offsets[entry - 1], index.interval);
+    }
+
+    return index;
+}
+
+bool utf8_isIndexErrored(UTF8Index index) {
+    return buf_isErrored(index.offsets);
+}
+
+void utf8_destroyIndex(UTF8Index * index) {
+    buf_destroy(&index->offsets);
+}
+
+s64 utf8_offsetOfCodepoint(String string, UTF8Index * index, s64 codepoint) {
+    if(str_isErrored(string))
+        return -2;
+    if(codepoint < 0)
+        return -1;
+
+    s64 offset = 0;
+
+    if(index != NULL && !utf8_isIndexErrored(*index)) {
+        if(codepoint > index->codepointCount)
+            return -1;
+
+        s64 entry = codepoint / index->interval;
+
+        offset = ((s64 *) index->offsets.start)[entry];
+        codepoint -= entry * index->interval;
+    }
+
+    return utf8_advance((u8 *) string.data, string.length, offset, codepoint);
+}
+
+String utf8_substringByCodepoint(String string, UTF8Index * index, s64 start, s64 end) {
+    if(str_isErrored(string))
+        return string;
+    if(start < 0 || end < start)
+        return str_createErrored(ERROR_ARG_INVALID, 0);
+
+    s64 startOffset = utf8_offsetOfCodepoint(string, index, start);
+    if(startOffset < 0)
+        return str_createErrored(ERROR_ARG_INVALID, 0);
+
+    // Short substrings are found by counting on from their start instead of using the index
+    s64 endOffset;
+    if(index != NULL && end - start > index->interval) {
+        endOffset = utf8_offsetOfCodepoint(string, index, end);
+    } else {
+        endOffset = utf8_advance((u8 *) string.data, string.length, startOffset, end - start);
+    }
+
+    if(endOffset < 0)
+        return str_createErrored(ERROR_ARG_INVALID, 0);
+    if(startOffset == endOffset)
+        return str_createEmpty();
+
+    return str_substring(string, startOffset, endOffset);
+}
+
+#ifdef UTF8_SIMD_AVX2
+
+/*!
+ * Converts the longest run of ASCII at the start of the {length} UTF-8 chars in {input},
+ * that is a multiple of 16 chars long, into UTF-16LE code units in {output}.
+ *
+ * Returns the number of chars converted.
+ */
+__attribute__((target("avx2")))
+static s64 utf8_widenAsciiAVX2(u8 * input, s64 length, u8 * output) {
+    s64 index = 0;
+
+    for(; index + 16 <= length; index += 16) {
+        __m128i chars = _mm_loadu_si128((__m128i *) &input[index]);
+        if(_mm_movemask_epi8(chars) != 0)
+            break;
+
+        _mm256_storeu_si256((__m256i *) &output[2 * index], _mm256_cvtepu8_epi16(chars));
+    }
+
+    return index;
+}
+
+/*!
+ * Converts the longest run of ASCII at the start of the {units} UTF-16LE code units in {input},
+ * that is a multiple of 16 code units long, into UTF-8 chars in {output}.
+ *
+ * Returns the number of code units converted.
+ */
+__attribute__((target("avx2")))
+static s64 utf16le_narrowAsciiAVX2(u8 * input, s64 units, u8 * output) {
+    const __m256i notAscii = _mm256_set1_epi16((short) 0xFF80);
+
+    s64 index = 0;
+
+    for(; index + 16 <= units; index += 16) {
+        __m256i codeUnits = _mm256_loadu_si256((__m256i *) &input[2 * index]);
+        if(!_mm256_testz_si256(codeUnits, notAscii))
+            break;
+
+        __m256i packed = _mm256_packus_epi16(codeUnits, codeUnits);
+        packed = _mm256_permute4x64_epi64(packed, 0b00001000);
+
+        _mm_storeu_si128((__m128i *) &output[index], _mm256_castsi256_si128(packed));
+    }
+
+    return index;
+}
+
+#endif
+
+/*!
+ * Returns the number of UTF-16 code units needed to store the {length} chars of valid UTF-8 in {data}.
+ *
+ * Every character takes one code unit, apart from 4 char characters which take two.
+ * So, continuation chars are subtracted from the length, and 4 char leading chars are added back.
+ */
+static s64 utf8_countUtf16Units(u8 * data, s64 length) {
+    const u64 highBits = 0x8080808080808080ull;
+
+    s64 units = length;
+    s64 index = 0;
+
+    for(; index + 8 <= length; index += 8) {
+        u64 chars;
+        memcpy(&chars, &data[index], 8);
+
+        if((chars & highBits) == 0)
+            continue;
+
+        // Shifting left moves the lower bits of each char into its top bit, without crossing into the next char
+        u64 continuations = chars & ~(chars << 1) & highBits;
+        u64 fourCharLeads = chars & (chars << 1) & (chars << 2) & (chars << 3) & highBits;
+
+        units -= __builtin_popcountll(continuations);
+        units += __builtin_popcountll(fourCharLeads);
+    }
+
+    for(; index < length; ++index) {
+        u8 next = data[index];
+
+        if((next & 0xC0) == 0x80) {
+            units -= 1;
+        } else if(next >= 0xF0) {
+            units += 1;
+        }
+    }
+
+    return units;
+}
+
+String utf8_toUtf16le(String string, s64 * invalidIndex) {
+    if(invalidIndex != NULL) {
+        *invalidIndex = -1;
+    }
+
+    if(str_isErrored(string))
+        return str_createErrored(ERROR_ARG_INVALID, 0);
+
+    s64 invalid = utf8_validate(string);
+    if(invalid >= 0) {
+        if(invalidIndex != NULL) {
+            *invalidIndex = invalid;
+        }
+
+        return str_createErrored(ERROR_INVALID_CODEPOINT, 0);
+    }
+
+    u8 * input = (u8 *) string.data;
+    s64 length = string.length;
+
+    s64 units = utf8_countUtf16Units(input, length);
+    if(units > S64_MAX / 2)
+        return str_createErrored(ERROR_OVERFLOW, 0);
+
+    String utf16 = str_createUninitialised(2 * units);
+    if(str_isErrored(utf16) || units == 0)
+        return utf16;
+
+    u8 * output = (u8 *) utf16.data;
+
+#ifdef UTF8_SIMD_AVX2
+    bool useAVX2 = __builtin_cpu_supports("avx2");
+#endif
+
+    s64 index = 0;
+    while(index < length) {
+        u8 lead = input[index];
+
+        if(lead < 0x80) {
+#ifdef UTF8_SIMD_AVX2
+            if(useAVX2 && index + 16 <= length) {
+                s64 converted = utf8_widenAsciiAVX2(&input[index], length - index, output);
+                if(converted > 0) {
+                    index += converted;
+                    output += 2 * converted;
+                    continue;
+                }
+            }
+#endif
+
+            utf16le_writeUnit(output, lead);
+
+            index += 1;
+            output += 2;
+        } else if(lead < 0xE0) {
+            u32 codepoint = ((u32) (lead & 0x1F) << 6) | (input[index + 1] & 0x3F);
+
+            utf16le_writeUnit(output, (u16) codepoint);
+
+            index += 2;
+            output += 2;
+        } else if(lead < 0xF0) {
+            u32 codepoint = ((u32) (lead & 0x0F) << 12) | ((u32) (input[index + 1] & 0x3F) << 6) | (input[index + 2] & 0x3F);
+
+            utf16le_writeUnit(output, (u16) codepoint);
+
+            index += 3;
+            output += 2;
+        } else {
+            u32 codepoint = ((u32) (lead & 0x07) << 18) | ((u32) (input[index + 1] & 0x3F) << 12)
+                            | ((u32) (input[index + 2] & 0x3F) << 6) | (input[index + 3] & 0x3F);
+
+            codepoint -= 0x10000;
+
+            utf16le_writeUnit(output, (u16) (0xD800 | (codepoint >> 10)));
+            utf16le_writeUnit(output + 2, (u16) (0xDC00 | (codepoint & 0x3FF)));
+
+            index += 4;
+            output += 4;
+        }
+    }
+
+    return utf16;
+}
+
+String utf16le_toUtf8(String string, s64 * invalidIndex) {
+    if(invalidIndex != NULL) {
+        *invalidIndex = -1;
+    }
+
+    if(str_isErrored(string))
+        return str_createErrored(ERROR_ARG_INVALID, 0);
+
+    u8 * input = (u8 *) string.data;
+    s64 units = string.length / 2;
+
+    // Find the length of the UTF-8 output, and check that all surrogates are paired
+    s64 length = 0;
+    s64 invalid = (string.length % 2 != 0 ? string.length - 1 : -1);
+
+    for(s64 index = 0; index < units; ++index) {
+        u16 unit = utf16le_readUnit(&input[2 * index]);
+
+        if(unit < 0x80) {
+            length += 1;
+        } else if(unit < 0x800) {
+            length += 2;
+        } else if(unit < 0xD800 || unit > 0xDFFF) {
+            length += 3;
+        } else if(unit <= 0xDBFF && index + 1 < units) {
+            u16 low = utf16le_readUnit(&input[2 * (index + 1)]);
+            if(low < 0xDC00 || low > 0xDFFF) {
+                invalid = 2 * index;
+                break;
+            }
+
+            length += 4;
+            index += 1;
+        } else {
+            invalid = 2 * index;
+            break;
+        }
+    }
+
+    if(invalid >= 0) {
+        if(invalidIndex != NULL) {
+            *invalidIndex = invalid;
+        }
+
+        return str_createErrored(ERROR_INVALID_CODEPOINT, 0);
+    }
+
+    String utf8 = str_createUninitialised(length);
+    if(str_isErrored(utf8) || length == 0)
+        return utf8;
+
+    u8 * output = (u8 *) utf8.data;
+
+#ifdef UTF8_SIMD_AVX2
+    bool useAVX2 = __builtin_cpu_supports("avx2");
+#endif
+
+    s64 index = 0;
+    while(index < units) {
+        u16 unit = utf16le_readUnit(&input[2 * index]);
+
+        if(unit < 0x80) {
+#ifdef UTF8_SIMD_AVX2
+            if(useAVX2 && index + 16 <= units) {
+                s64 converted = utf16le_narrowAsciiAVX2(&input[2 * index], units - index, output);
+                if(converted > 0) {
+                    index += converted;
+                    output += converted;
+                    continue;
+                }
+            }
+#endif
+
+            output[0] = (u8) unit;
+
+            index += 1;
+            output += 1;
+        } else if(unit < 0x800) {
+            output[0] = (u8) (0xC0 | (unit >> 6));
+            output[1] = (u8) (0x80 | (unit & 0x3F));
+
+            index += 1;
+            output += 2;
+        } else if(unit < 0xD800 || unit > 0xDFFF) {
+            output[0] = (u8) (0xE0 | (unit >> 12));
+            output[1] = (u8) (0x80 | ((unit >> 6) & 0x3F));
+            output[2] = (u8) (0x80 | (unit & 0x3F));
+
+            index += 1;
+            output += 3;
+        } else {
+            u16 low = utf16le_readUnit(&input[2 * (index + 1)]);
+            u32 codepoint = (((u32) (unit & 0x3FF) << 10) | (low & 0x3FF)) + 0x10000;
+
+            output[0] = (u8) (0xF0 | (codepoint >> 18));
+            output[1] = (u8) (0x80 | ((codepoint >> 12) & 0x3F));
+            output[2] = (u8) (0x80 | ((codepoint >> 6) & 0x3F));
+            output[3] = (u8) (0x80 | (codepoint & 0x3F));
+
+            index += 2;
+            output += 4;
+        }
+    }
+
+    return utf8;
+}
+
+#ifdef UTF8_SIMD_AVX2
+
+/*!
+ * Writes the longest run of ASCII codepoints at the start of the {count} codepoints in {codepoints},
+ * that is a multiple of 16 codepoints long, as UTF-8 to {output}.
+ *
+ * Returns the number of codepoints written.
+ */
+__attribute__((target("avx2")))
+static s64 utf8_narrowAsciiCodepointsAVX2(const u32 * codepoints, s64 count, u8 * output) {
+    const __m256i notAscii = _mm256_set1_epi32((int) 0xFFFFFF80);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 0, 0, 0, 0);
+
+    s64 index = 0;
+
+    for(; index + 16 <= count; index += 16) {
+        __m256i first = _mm256_loadu_si256((__m256i *) &codepoints[index]);
+        __m256i second = _mm256_loadu_si256((__m256i *) &codepoints[index + 8]);
+
+        if(!_mm256_testz_si256(_mm256_or_si256(first, second), notAscii))
+            break;
+
+        // Packing works within each 128 bit lane, so the groups of 4 chars are put back in order afterwards
+        __m256i packed = _mm256_packus_epi32(first, second);
+        packed = _mm256_packus_epi16(packed, packed);
+        packed = _mm256_permutevar8x32_epi32(packed, order);
+
+        _mm_storeu_si128((__m128i *) &output[index], _mm256_castsi256_si128(packed));
+    }
+
+    return index;
+}
+
+#endif
+
+CLibErrorType utf8_appendCodepoints(Builder * builder, const u32 * codepoints, s64 count) {
+    if(builder_isErrored(*builder))
+        return ERROR_ARG_INVALID;
+    if(count < 0)
+        return ERROR_NEG_LENGTH;
+    if(count == 0)
+        return ERROR_SUCCESS;
+    if(codepoints == NULL)
+        return ERROR_ARG_NULL;
+
+    // Find the total length first, so that the builder only has to grow once
+    s64 length = 0;
+    bool invalid = false;
+
+    for(s64 index = 0; index < count; ++index) {
+        u32 codepoint = codepoints[index];
+
+        // Branch free so that the compiler can vectorise it
+        length += 1 + (codepoint > 0x7F) + (codepoint > 0x7FF) + (codepoint > 0xFFFF)
+                  + (codepoint > 0x001FFFFF) + (codepoint > 0x03FFFFFF);
+        invalid |= (codepoint > 0x7FFFFFFF);
+    }
+
+    if(invalid)
+        return ERROR_INVALID_CODEPOINT;
+
+    char * destination;
+    CLibErrorType result = builder_claim(builder, length, &destination);
+    if(result != ERROR_SUCCESS)
+        return result;
+
+    u8 * output = (u8 *) destination;
+
+#ifdef UTF8_SIMD_AVX2
+    bool useAVX2 = __builtin_cpu_supports("avx2");
+#endif
+
+    s64 index = 0;
+    while(index < count) {
+        u32 codepoint = codepoints[index];
+
+        if(codepoint <= 0x7F) {
+#ifdef UTF8_SIMD_AVX2
+            if(useAVX2 && index + 16 <= count) {
+                s64 written = utf8_narrowAsciiCodepointsAVX2(&codepoints[index], count - index, output);
+                if(written > 0) {
+                    index += written;
+                    output += written;
+                    continue;
+                }
+            }
+#endif
+
+            output[0] = (u8) codepoint;
+
+            index += 1;
+            output += 1;
+            continue;
+        }
+
+        s64 codepointLength = utf8_codepointLength(codepoint);
+        utf8_encodeCodepoint(codepoint, codepointLength, output);
+
+        index += 1;
+        output += codepointLength;
+    }
+
+    return ERROR_SUCCESS;
+}
+
+
+
+//
+// JSON
+//
+
+/*!
+ * The state of json_parseUsing as it moves through a document.
+ */
+typedef struct JSONParser {
+    char * data;
+    s64 length;
+    s64 index;
+
+    /*!
+     * The positions of the structural chars when parsing using an index, or NULL otherwise.
+     */
+    u32 * positions;
+    s64 positionCount;
+    s64 position;
+
+    JSONDoc * doc;
+
+    CLibErrorType error;
+    s64 errorOffset;
+} JSONParser;
+
+/*!
+ * Record that {parser} failed with {errorType} at the char {offset}. Always returns false.
+ */
+static bool json_fail(JSONParser * parser, CLibErrorType errorType, s64 offset) {
+    parser->error = errorType;
+    parser->errorOffset = offset;
+    return false;
+}
+
+/*!
+ * Move {parser} past any spaces, tabs, line feeds and carriage returns.
+ */
+static inline void json_skipWhitespace(JSONParser * parser) {
+    char * data = parser->data;
+    s64 index = parser->index;
+
+    while(index < parser->length) {
+        char character = data[index];
+        if(character != ' ' && character != '\n' && character != '\r' && character != '\t')
+            break;
+
+        index += 1;
+    }
+
+    parser->index = index;
+}
+
+/*!
+ * Append a new node of type {type} to the document of {parser}.
+ *
+ * The returned node is only valid until the next node is added, as adding nodes may move them all.
+ */
+static inline JSONNode * json_addNode(JSONParser * parser, JSONType type) {
+    JSONDoc * doc = parser->doc;
+
+    s64 requiredCapacity = (doc->nodeCount + 1) * (s64) sizeof(JSONNode);
+    if(requiredCapacity > doc->nodes.size && buf_ensureCapacity(&doc->nodes, requiredCapacity) != ERROR_SUCCESS) {
+        json_fail(parser, ERROR_ALLOC, parser->index);
+        return NULL;
+    }
+
+    JSONNode * node = &((JSONNode *) doc->nodes.start)[doc->nodeCount];
+    doc->nodeCount += 1;
+
+    node->type = (u8) type;
+    node->flags = 0;
+    node->length = 0;
+    node->value.descendants = 0;
+
+    return node;
+}
+
+/*!
+ * Allocate {length} chars to store an unescaped string in {doc}.
+ *
+ * Strings are allocated from blocks that are never moved, so that the chars of
+ * nodes can point into them while the rest of the document is parsed.
+ */
+static char * json_allocateString(JSONDoc * doc, s64 length) {
+    if(doc->strings.size - doc->stringsLength < length) {
+        s64 blockSize = (s64) sizeof(char *) + length;
+        if(blockSize < JSON_STRING_BLOCK_SIZE) {
+            blockSize = JSON_STRING_BLOCK_SIZE;
+        }
+
+        Buffer block = buf_create(blockSize);
+        if(buf_isErrored(block))
+            return NULL;
+
+        // Link the new block to the previous block so they can all be free'd by json_destroy.
+        memcpy(block.start, &doc->strings.start, sizeof(char *));
+
+        doc->strings = block;
+        doc->stringsLength = (s64) sizeof(char *);
+    }
+
+    char * chars = &doc->strings.start[doc->stringsLength];
+    doc->stringsLength += length;
+
+    return chars;
+}
+
+/*!
+ * Returns the index of the first '"', '\' or control char in {data} from {index}, or {length} if there is none.
+ */
+static inline s64 json_findStringSpecial(char * data, s64 index, s64 length) {
+    // Find the special chars 8 at a time, using the has-zero-byte and has-less-than tricks.
+    // Borrows can only cause false positives above a real match, so the lowest match is exact.
+    while(length - index >= 8) {
+        u64 chunk = number_loadEightChars(&data[index]);
+        u64 quotes = chunk ^ 0x2222222222222222ULL;
+        u64 backslashes = chunk ^ 0x5C5C5C5C5C5C5C5CULL;
+
+        u64 found = ((quotes - 0x0101010101010101ULL) & ~quotes)
+                  | ((backslashes - 0x0101010101010101ULL) & ~backslashes)
+                  | ((chunk - 0x2020202020202020ULL) & ~chunk);
+        found &= 0x8080808080808080ULL;
+
+        if(found != 0)
+            return index + (__builtin_ctzll(found) >> 3);
+
+        index += 8;
+    }
+
+    for(; index < length; ++index) {
+        u8 character = (u8) data[index];
+        if(character == '"' || character == '\\' || character < 0x20)
+            return index;
+    }
+
+    return length;
+}
+
+/*!
+ * Parse the 4 hex digits at {data} into {value}, returning whether they were all valid.
+ */
+static bool json_parseHex4(char * data, u32 * value) {
+    u32 result = 0;
+
+    for(s64 index = 0; index < 4; ++index) {
+        char character = data[index];
+
+        u32 digit;
+        if(character >= '0' && character <= '9') {
+            digit = (u32) (character - '0');
+        } else if(character >= 'a' && character <= 'f') {
+            digit = (u32) (character - 'a' + 10);
+        } else if(character >= 'A' && character <= 'F') {
+            digit = (u32) (character - 'A' + 10);
+        } else {
+            return false;
+        }
+
+        result = (result << 4) | digit;
+    }
+
+    *value = result;
+    return true;
+}
+
+/*!
+ * Unescape the chars of a string in {data} from {start} up to its closing quote at {end} into {output},
+ * which must have room for {end} - {start} chars, as escape sequences are never shorter than the UTF-8 they represent.
+ *
+ * Returns the number of chars written, or -1 after storing the error and the index of the escape that caused it
+ * in {errorType} and {errorIndex}.
+ */
+static s64 json_unescape(char * data, s64 start, s64 end, char * output, CLibErrorType * errorType, s64 * errorIndex) {
+    char * outputStart = output;
+    s64 index = start;
+
+    while(index < end) {
+        s64 next = json_findStringSpecial(data, index, end);
+        memcpy(output, &data[index], (size_t) (next - index));
+        output += next - index;
+        index = next;
+
+        if(index == end)
+            break;
+
+        char escaped = data[index + 1];
+        switch(escaped) {
+            case '"':
+            case '\\':
+            case '/':
+                *output++ = escaped;
+                break;
+            case 'b':
+                *output++ = '\b';
+                break;
+            case 'f':
+                *output++ = '\f';
+                break;
+            case 'n':
+                *output++ = '\n';
+                break;
+            case 'r':
+                *output++ = '\r';
+                break;
+            case 't':
+                *output++ = '\t';
+                break;
+            case 'u': {
+                u32 codepoint;
+                if(end - index < 6 || !json_parseHex4(&data[index + 2], &codepoint)) {
+                    *errorType = ERROR_JSON_SYNTAX;
+                    *errorIndex = index;
+                    return -1;
+                }
+
+                if(codepoint >= 0xDC00 && codepoint <= 0xDFFF) {
+                    *errorType = ERROR_INVALID_CODEPOINT;
+                    *errorIndex = index;
+                    return -1;
+                }
+
+                if(codepoint >= 0xD800 && codepoint <= 0xDBFF) {
+                    u32 low;
+                    if(end - index < 12 || data[index + 6] != '\\' || data[index + 7] != 'u'
+                       || !json_parseHex4(&data[index + 8], &low) || low < 0xDC00 || low > 0xDFFF) {
+                        *errorType = ERROR_INVALID_CODEPOINT;
+                        *errorIndex = index;
+                        return -1;
+                    }
+
+                    codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                    index += 6;
+                }
+
+                s64 codepointLength = utf8_codepointLength(codepoint);
+                utf8_encodeCodepoint(codepoint, codepointLength, (u8 *) output);
+                output += codepointLength;
+
+                index += 4;
+                break;
+            }
+            default:
+                *errorType = ERROR_JSON_SYNTAX;
+                *errorIndex = index;
+                return -1;
+        }
+
+        index += 2;
+    }
+
+    return output - outputStart;
+}
+
+/*!
+ * Unescape the chars of the string starting at {start} into {doc}, where {special}
+ * is the index of the first special char after {start}.
+ */
+static bool json_parseEscapedString(JSONParser * parser, s64 start, s64 special) {
+    char * data = parser->data;
+    s64 length = parser->length;
+
+    // Find the closing quote first, so that the unescaped string can be allocated at its final size.
+    s64 end = special;
+    while(true) {
+        if(end >= length)
+            return json_fail(parser, ERROR_JSON_SYNTAX, length);
+
+        char character = data[end];
+        if(character == '"')
+            break;
+        if(character != '\\')
+            return json_fail(parser, ERROR_JSON_SYNTAX, end);
+
+        end = json_findStringSpecial(data, end + 2, length);
+    }
+
+    char * chars = json_allocateString(parser->doc, end - start);
+    if(chars == NULL)
+        return json_fail(parser, ERROR_ALLOC, start);
+
+    CLibErrorType errorType;
+    s64 errorIndex;
+
+    s64 unescapedLength = json_unescape(data, start, end, chars, &errorType, &errorIndex);
+    if(unescapedLength < 0)
+        return json_fail(parser, errorType, errorIndex);
+
+    JSONNode * node = json_addNode(parser, JSON_STRING);
+    if(node == NULL)
+        return false;
+
+    node->flags = JSON_FLAG_UNESCAPED;
+    node->length = unescapedLength;
+    node->value.chars = chars;
+
+    parser->index = end + 1;
+    return true;
+}
+
+/*!
+ * Parse the string starting with the '"' at the current index of {parser}.
+ */
+static inline bool json_parseString(JSONParser * parser) {
+    s64 start = parser->index + 1;
+    s64 special = json_findStringSpecial(parser->data, start, parser->length);
+
+    if(special >= parser->length || parser->data[special] != '"')
+        return json_parseEscapedString(parser, start, special);
+
+    // Strings without escapes point straight into the document.
+    JSONNode * node = json_addNode(parser, JSON_STRING);
+    if(node == NULL)
+        return false;
+
+    node->length = special - start;
+    node->value.chars = &parser->data[start];
+
+    parser->index = special + 1;
+    return true;
+}
+
+/*!
+ * Parse the number starting at the current index of {parser}.
+ *
+ * Integers that fit in an s64 are stored exactly, and all other numbers as the closest double.
+ */
+static bool json_parseNumber(JSONParser * parser) {
+    char * data = parser->data;
+    s64 length = parser->length;
+    s64 start = parser->index;
+    s64 index = start;
+
+    bool negative = (data[index] == '-');
+    if(negative) {
+        index += 1;
+    }
+
+    if(index >= length || !char_isDigit(data[index]))
+        return json_fail(parser, ERROR_JSON_SYNTAX, index);
+
+    // Accumulate the digits as they are checked, so that most numbers don't need to be parsed again.
+    // The mantissa is only used if there are few enough digits that it cannot have overflowed.
+    u64 mantissa = 0;
+    s64 digitsStart = index;
+
+    // Leading zeros are not allowed, so a 0 must be the whole integer part.
+    if(data[index] == '0') {
+        index += 1;
+    } else {
+        for(; index < length && char_isDigit(data[index]); ++index) {
+            mantissa = mantissa * 10 + (u64) (data[index] - '0');
+        }
+    }
+
+    s64 integerDigits = index - digitsStart;
+    s64 fractionDigits = 0;
+    s64 exponent = 0;
+    bool isInteger = true;
+
+    if(index < length && data[index] == '.') {
+        index += 1;
+
+        s64 fractionStart = index;
+        for(; index < length && char_isDigit(data[index]); ++index) {
+            mantissa = mantissa * 10 + (u64) (data[index] - '0');
+        }
+
+        fractionDigits = index - fractionStart;
+        if(fractionDigits == 0)
+            return json_fail(parser, ERROR_JSON_SYNTAX, index);
+
+        isInteger = false;
+    }
+
+    if(index < length && (data[index] == 'e' || data[index] == 'E')) {
+        index += 1;
+
+        bool negativeExponent = false;
+        if(index < length && (data[index] == '-' || data[index] == '+')) {
+            negativeExponent = (data[index] == '-');
+            index += 1;
+        }
+
+        s64 exponentStart = index;
+        for(; index < length && char_isDigit(data[index]); ++index) {
+            if(exponent < 1000000) {
+                exponent = exponent * 10 + (data[index] - '0');
+            }
+        }
+
+        if(index == exponentStart)
+            return json_fail(parser, ERROR_JSON_SYNTAX, index);
+
+        exponent = (negativeExponent ? -exponent : exponent);
+        isInteger = false;
+    }
+
+    // -0 is kept as a double so that its sign is not lost.
+    if(negative && mantissa == 0) {
+        isInteger = false;
+    }
+
+    JSONNode * node = json_addNode(parser, JSON_NUMBER);
+    if(node == NULL)
+        return false;
+
+    parser->index = index;
+    String number = {&data[start], index - start, 0};
+
+    if(isInteger) {
+        s64 integer;
+        bool fits = true;
+
+        if(integerDigits <= 18) {
+            integer = (negative ? -((s64) mantissa) : (s64) mantissa);
+        } else {
+            fits = (str_parseS64(number, &integer) == ERROR_SUCCESS);
+        }
+
+        if(fits) {
+            node->flags = JSON_FLAG_INTEGER;
+            node->value.integer = integer;
+            return true;
+        }
+    }
+
+    // The same exact fast path as str_parseDouble, using the digits that have already been read.
+    exponent -= fractionDigits;
+    if(integerDigits + fractionDigits <= 19 && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+        double result = (double) mantissa;
+
+        if(exponent < 0) {
+            result /= number_exactPowersOf10[-exponent];
+        } else {
+            result *= number_exactPowersOf10[exponent];
+        }
+
+        node->value.number = (negative ? -result : result);
+        return true;
+    }
+
+    CLibErrorType result = str_parseDouble(number, &node->value.number);
+    if(result != ERROR_SUCCESS)
+        return json_fail(parser, (result == ERROR_OVERFLOW ? ERROR_OVERFLOW : ERROR_JSON_SYNTAX), start);
+
+    return true;
+}
+
+/*!
+ * Parse the literal {literal} of {length} chars at the current index of {parser}, as a node of type {type}.
+ */
+static inline bool json_parseLiteral(JSONParser * parser, char * literal, s64 length, JSONType type, bool value) {
+    if(parser->length - parser->index < length || memcmp(&parser->data[parser->index], literal, (size_t) length) != 0)
+        return json_fail(parser, ERROR_JSON_SYNTAX, parser->index);
+
+    JSONNode * node = json_addNode(parser, type);
+    if(node == NULL)
+        return false;
+
+    node->value.boolean = value;
+
+    parser->index += length;
+    return true;
+}
+
+/*!
+ * Parse the string, number, boolean or null starting with {character} at the current index of {parser}.
+ */
+static inline bool json_parseScalar(JSONParser * parser, char character) {
+    switch(character) {
+        case '"':
+            return json_parseString(parser);
+        case 't':
+            return json_parseLiteral(parser, "true", 4, JSON_BOOL, true);
+        case 'f':
+            return json_parseLiteral(parser, "false", 5, JSON_BOOL, false);
+        case 'n':
+            return json_parseLiteral(parser, "null", 4, JSON_NULL, false);
+        default:
+            if(character == '-' || char_isDigit(character))
+                return json_parseNumber(parser);
+
+            return json_fail(parser, ERROR_JSON_SYNTAX, parser->index);
+    }
+}
+
+/*!
+ * Parse an object key and the ':' after it, leaving {parser} at the start of the value.
+ */
+static bool json_parseKey(JSONParser * parser) {
+    json_skipWhitespace(parser);
+
+    if(parser->index >= parser->length || parser->data[parser->index] != '"')
+        return json_fail(parser, ERROR_JSON_SYNTAX, parser->index);
+    if(!json_parseString(parser))
+        return false;
+
+    json_skipWhitespace(parser);
+
+    if(parser->index >= parser->length || parser->data[parser->index] != ':')
+        return json_fail(parser, ERROR_JSON_SYNTAX, parser->index);
+
+    parser->index += 1;
+    return true;
+}
+
+/*!
+ * Parse the whole document of {parser}, which must contain exactly one value.
+ *
+ * Arrays and objects are tracked using a stack of the indices of their
+ * nodes, rather than by recursion, so that deep nesting is cheap.
+ */
+static bool json_parseDocument(JSONParser * parser) {
+    s64 stack[JSON_MAX_DEPTH];
+    s64 depth = 0;
+
+    while(true) {
+        json_skipWhitespace(parser);
+
+        if(parser->index >= parser->length)
+            return json_fail(parser, ERROR_JSON_SYNTAX, parser->index);
+
+        char character = parser->data[parser->index];
+
+        if(character == '[' || character == '{') {
+            if(depth == JSON_MAX_DEPTH)
+                return json_fail(parser, ERROR_JSON_DEPTH, parser->index);
+
+            JSONNode * node = json_addNode(parser, (character == '[' ? JSON_ARRAY : JSON_OBJECT));
+            if(node == NULL)
+                return false;
+
+            stack[depth] = parser->doc->nodeCount - 1;
+            depth += 1;
+
+            parser->index += 1;
+            json_skipWhitespace(parser);
+
+            char closing = (character == '[' ? ']' : '}');
+            if(parser->index >= parser->length || parser->data[parser->index] != closing) {
+                node->length = 1;
+
+                if(character == '{' && !json_parseKey(parser))
+                    return false;
+
+                continue;
+            }
+        } else if(!json_parseScalar(parser, character)) {
+            return false;
+        }
+
+        // Close the arrays and objects that end after this value, until the next value is found.
+        while(true) {
+            json_skipWhitespace(parser);
+
+            if(depth == 0) {
+                if(parser->index != parser->length)
+                    return json_fail(parser, ERROR_JSON_SYNTAX, parser->index);
+
+                return true;
+            }
+
+            if(parser->index >= parser->length)
+                return json_fail(parser, ERROR_JSON_SYNTAX, parser->index);
+
+            s64 containerIndex = stack[depth - 1];
+            JSONNode * container = &((JSONNode *) parser->doc->nodes.start)[containerIndex];
+
+            character = parser->data[parser->index];
+
+            if(character == ',') {
+                parser->index += 1;
+                container->length += 1;
+
+                if(container->type == JSON_OBJECT && !json_parseKey(parser))
+                    return false;
+
+                break;
+            }
+
+            if(character != (container->type == JSON_ARRAY ? ']' : '}'))
+                return json_fail(parser, ERROR_JSON_SYNTAX, parser->index);
+
+            parser->index += 1;
+            container->value.descendants = parser->doc->nodeCount - containerIndex - 1;
+            depth -= 1;
+        }
+    }
+}
+
+/*!
+ * Move {parser} to the next position in its index, or to the end of the document if there are none left.
+ */
+static inline void json_nextPosition(JSONParser * parser) {
+    if(parser->position < parser->positionCount) {
+        parser->index = parser->positions[parser->position];
+        parser->position += 1;
+    } else {
+        parser->index = parser->length;
+    }
+}
+
+/*!
+ * Returns whether {character} may directly follow a number or literal.
+ */
+static inline bool json_endsScalar(char character) {
+    switch(character) {
+        case ' ':
+        case '\t':
+        case '\n':
+        case '\r':
+        case ',':
+        case ':':
+        case '[':
+        case ']':
+        case '{':
+        case '}':
+        case '"':
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*!
+ * Parse an object key at the current position of {parser} and the ':' at the position
+ * after it, leaving {parser} at the position of the value.
+ */
+static bool json_parseIndexedKey(JSONParser * parser) {
+    if(parser->index >= parser->length || parser->data[parser->index] != '"')
+        return json_fail(parser, ERROR_JSON_SYNTAX, parser->index);
+    if(!json_parseString(parser))
+        return false;
+
+    json_nextPosition(parser);
+
+    if(parser->index >= parser->length || parser->data[parser->index] != ':')
+        return json_fail(parser, ERROR_JSON_SYNTAX, parser->index);
+
+    json_nextPosition(parser);
+    return true;
+}
+
+/*!
+ * Parse the whole document of {parser} in the same way as json_parseDocument, but by
+ * jumping between the positions of its index instead of skipping over whitespace.
+ *
+ * The index does not mark where numbers and literals end, so
+ * the char after each is checked to make sure they are not cut short.
+ */
+static bool json_parseIndexedDocument(JSONParser * parser) {
+    s64 stack[JSON_MAX_DEPTH];
+    s64 depth = 0;
+
+    json_nextPosition(parser);
+
+    while(true) {
+        if(parser->index >= parser->length)
+            return json_fail(parser, ERROR_JSON_SYNTAX, parser->index);
+
+        char character = parser->data[parser->index];
+
+        if(character == '[' || character == '{') {
+            if(depth == JSON_MAX_DEPTH)
+                return json_fail(parser, ERROR_JSON_DEPTH, parser->index);
+
+            JSONNode * node = json_addNode(parser, (character == '[' ? JSON_ARRAY : JSON_OBJECT));
+            if(node == NULL)
+                return false;
+
+            stack[depth] = parser->doc->nodeCount - 1;
+            depth += 1;
+
+            json_nextPosition(parser);
+
+            char closing = (character == '[' ? ']' : '}');
+            if(parser->index >= parser->length || parser->data[parser->index] != closing) {
+                node->length = 1;
+
+                if(character == '{' && !json_parseIndexedKey(parser))
+                    return false;
+
+                continue;
+            }
+        } else {
+            if(!json_parseScalar(parser, character))
+                return false;
+
+            if(character != '"' && parser->index < parser->length && !json_endsScalar(parser->data[parser->index]))
+                return json_fail(parser, ERROR_JSON_SYNTAX, parser->index);
+
+            json_nextPosition(parser);
+        }
+
+        // Close the arrays and objects that end after this value, until the next value is found.
+        while(true) {
+            if(depth == 0) {
+                if(parser->index != parser->length)
+                    return json_fail(parser, ERROR_JSON_SYNTAX, parser->index);
+
+                return true;
+            }
+
+            if(parser->index >= parser->length)
+                return json_fail(parser, ERROR_JSON_SYNTAX, parser->index);
+
+            s64 containerIndex = stack[depth - 1];
+            JSONNode * container = &((JSONNode *) parser->doc->nodes.start)[containerIndex];
+
+            character = parser->data[parser->index];
+
+            if(character == ',') {
+                container->length += 1;
+                json_nextPosition(parser);
+
+                if(container->type == JSON_OBJECT && !json_parseIndexedKey(parser))
+                    return false;
+
+                break;
+            }
+
+            if(character != (container->type == JSON_ARRAY ? ']' : '}'))
+                return json_fail(parser, ERROR_JSON_SYNTAX, parser->index);
+
+            container->value.descendants = parser->doc->nodeCount - containerIndex - 1;
+            depth -= 1;
+
+            json_nextPosition(parser);
+        }
+    }
+}
+
+/*!
+ * The number of 64 char blocks that json_createIndex processes between checking the capacity of its positions.
+ */
+#define JSON_INDEX_CHUNK_BLOCKS ((s64) 256)
+
+/*!
+ * Bitmaps of the chars in a 64 char block of a JSON document, where bit N is set if char N is of that kind.
+ */
+typedef struct JSONBlockMasks {
+    u64 quotes;
+    u64 backslashes;
+    u64 whitespace;
+    u64 structurals;
+} JSONBlockMasks;
+
+/*!
+ * The state that json_createIndex carries from each 64 char block to the next.
+ */
+typedef struct JSONIndexState {
+    /*!
+     * 1 if the first char of the next block is escaped by a backslash at the end of the last block.
+     */
+    u64 nextIsEscaped;
+
+    /*!
+     * All bits set if the last block ended inside a string, or 0 otherwise.
+     */
+    u64 inString;
+
+    /*!
+     * 1 if the last char of the last block was part of a number or literal.
+     */
+    u64 previousScalar;
+} JSONIndexState;
+
+/*!
+ * Returns the bitmap of the chars escaped by the backslashes {backslashes}. A run of backslashes
+ * escapes every second backslash in it, and the char after it if the run has an odd length.
+ *
+ * This is the branchless method used by simdjson, which finds where each run of backslashes
+ * starts on an even or odd bit by subtracting the starts of the runs from the odd bits.
+ */
+static inline u64 json_findEscaped(u64 backslashes, u64 * nextIsEscaped) {
+    const u64 oddBits = 0xAAAAAAAAAAAAAAAAULL;
+
+    if(backslashes == 0) {
+        u64 escaped = *nextIsEscaped;
+        *nextIsEscaped = 0;
+        return escaped;
+    }
+
+    u64 potentialEscapes = backslashes & ~*nextIsEscaped;
+    u64 maybeEscapedAndOddBits = (potentialEscapes << 1) | oddBits;
+    u64 evenSeriesCodesAndOddBits = maybeEscapedAndOddBits - potentialEscapes;
+    u64 escapeAndTerminalCodes = evenSeriesCodesAndOddBits ^ oddBits;
+
+    u64 escaped = escapeAndTerminalCodes ^ (backslashes | *nextIsEscaped);
+    u64 escapes = escapeAndTerminalCodes & backslashes;
+
+    *nextIsEscaped = escapes >> 63;
+    return escaped;
+}
+
+/*!
+ * Returns the bitmap of the positions in a block with the bitmaps {masks}, where {quotes}
+ * are the unescaped quotes and {quotesPrefixXor} is the prefix XOR of {quotes}.
+ */
+static inline u64 json_findPositions(JSONIndexState * state, JSONBlockMasks masks, u64 quotes, u64 quotesPrefixXor) {
+    // Every bit from an opening quote up to, but not including, its closing quote.
+    u64 inString = quotesPrefixXor ^ state->inString;
+    state->inString = (u64) ((s64) inString >> 63);
+
+    u64 stringStarts = quotes & inString;
+    u64 structurals = masks.structurals & ~inString;
+
+    // Numbers and literals are the runs of chars outside of strings that are not whitespace or structural.
+    u64 scalars = ~(masks.structurals | masks.whitespace | quotes | inString);
+    u64 scalarStarts = scalars & ~((scalars << 1) | state->previousScalar);
+    state->previousScalar = scalars >> 63;
+
+    return structurals | stringStarts | scalarStarts;
+}
+
+/*!
+ * Write the index of each bit set in {bits}, plus {base}, to {output}, returning the number of bits.
+ *
+ * Positions are written 8 at a time without checking whether they are set, as most blocks
+ * have few positions. Up to 7 extra positions may be written, which the next block overwrites.
+ */
+static inline s64 json_writePositions(u32 * output, u32 base, u64 bits) {
+    s64 count = __builtin_popcountll(bits);
+
+    for(s64 written = 0; written < count; written += 8) {
+        for(s64 index = 0; index < 8; ++index) {
+            // Bit 63 is set so that the count of trailing zeros is defined when no bits are left.
+            output[written + index] = base + (u32) __builtin_ctzll(bits | 0x8000000000000000ULL);
+            bits &= bits - 1;
+        }
+    }
+
+    return count;
+}
+
+/*!
+ * Find the positions of the {blockCount} blocks of 64 chars at {data} one char at a time, writing them to
+ * {output} using {base} as the offset of {data} in the document. Returns the number of positions written.
+ */
+static s64 json_indexScalar(u8 * data, s64 blockCount, u32 base, JSONIndexState * state, u32 * output) {
+    s64 count = 0;
+
+    for(s64 block = 0; block < blockCount; ++block) {
+        JSONBlockMasks masks = {0, 0, 0, 0};
+
+        for(s64 index = 0; index < 64; ++index) {
+            u64 bit = (u64) 1 << index;
+
+            switch(data[block * 64 + index]) {
+                case '"':
+                    masks.quotes |= bit;
+                    break;
+                case '\\':
+                    masks.backslashes |= bit;
+                    break;
+                case ' ':
+                case '\t':
+                case '\n':
+                case '\r':
+                    masks.whitespace |= bit;
+                    break;
+                case '{':
+                case '}':
+                case '[':
+                case ']':
+                case ':':
+                case ',':
+                    masks.structurals |= bit;
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        u64 quotes = masks.quotes & ~json_findEscaped(masks.backslashes, &state->nextIsEscaped);
+
+        u64 prefixXor = quotes;
+        prefixXor ^= prefixXor << 1;
+        prefixXor ^= prefixXor << 2;
+        prefixXor ^= prefixXor << 4;
+        prefixXor ^= prefixXor << 8;
+        prefixXor ^= prefixXor << 16;
+        prefixXor ^= prefixXor << 32;
+
+        u64 positions = json_findPositions(state, masks, quotes, prefixXor);
+        count += json_writePositions(&output[count], base + (u32) (block * 64), positions);
+    }
+
+    return count;
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+
+#include <immintrin.h>
+
+#define JSON_SIMD_AVX2
+
+/*!
+ * Returns the bitmap of the chars in the 64 chars {low} and {high} that are equal to {character}.
+ */
+__attribute__((target("avx2")))
+static inline u64 json_equalMaskAVX2(__m256i low, __m256i high, char character) {
+    __m256i find = _mm256_set1_epi8(character);
+
+    u32 lowMask = (u32) _mm256_movemask_epi8(_mm256_cmpeq_epi8(low, find));
+    u32 highMask = (u32) _mm256_movemask_epi8(_mm256_cmpeq_epi8(high, find));
+
+    return (u64) lowMask | ((u64) highMask << 32);
+}
+
+/*!
+ * Returns the bitmap of the chars in the 64 chars {low} and {high} whose classes contain any of the bits in {bits}.
+ */
+__attribute__((target("avx2")))
+static inline u64 json_classMaskAVX2(__m256i low, __m256i high, u8 bits) {
+    __m256i find = _mm256_set1_epi8((char) bits);
+    __m256i zero = _mm256_setzero_si256();
+
+    u32 lowMask = (u32) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(low, find), zero));
+    u32 highMask = (u32) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(high, find), zero));
+
+    return ~((u64) lowMask | ((u64) highMask << 32));
+}
+
+/*!
+ * Returns the class bits of each of the 32 chars in {chars}, by looking up their low and high
+ * 4 bits in separate tables and keeping only the bits that are set in both.
+ *
+ * The bits 1, 2 and 4 are for ',', ':', and the brackets, and the bits 8, 16, 32 and 64 are for ' ', '\t', '\n' and '\r'.
+ */
+__attribute__((target("avx2")))
+static inline __m256i json_classifyAVX2(__m256i chars) {
+    const __m256i lowTable = _mm256_setr_epi8(
+        8, 0, 0, 0, 0, 0, 0, 0, 0, 16, 2 | 32, 4, 1, 4 | 64, 0, 0,
+        8, 0, 0, 0, 0, 0, 0, 0, 0, 16, 2 | 32, 4, 1, 4 | 64, 0, 0);
+    const __m256i highTable = _mm256_setr_epi8(
+        16 | 32 | 64, 0, 1 | 8, 2, 0, 4, 0, 4, 0, 0, 0, 0, 0, 0, 0, 0,
+        16 | 32 | 64, 0, 1 | 8, 2, 0, 4, 0, 4, 0, 0, 0, 0, 0, 0, 0, 0);
+
+    // Chars of 0x80 and above look up 0 in the low table, as their top bit is set.
+    __m256i highNibbles = _mm256_and_si256(_mm256_srli_epi16(chars, 4), _mm256_set1_epi8(0x0F));
+
+    return _mm256_and_si256(_mm256_shuffle_epi8(lowTable, chars), _mm256_shuffle_epi8(highTable, highNibbles));
+}
+
+/*!
+ * The same as json_indexScalar, but classifying 32 chars at a time using AVX2, and
+ * finding the prefix XOR of the quotes by carry-less multiplying them by all 1s.
+ */
+__attribute__((target("avx2,pclmul")))
+static s64 json_indexAVX2(u8 * data, s64 blockCount, u32 base, JSONIndexState * state, u32 * output) {
+    __m128i allOnes = _mm_set1_epi8((char) 0xFF);
+    s64 count = 0;
+
+    for(s64 block = 0; block < blockCount; ++block) {
+        __m256i low = _mm256_loadu_si256((__m256i *) &data[block * 64]);
+        __m256i high = _mm256_loadu_si256((__m256i *) &data[block * 64 + 32]);
+
+        __m256i lowClasses = json_classifyAVX2(low);
+        __m256i highClasses = json_classifyAVX2(high);
+
+        JSONBlockMasks masks;
+        masks.quotes = json_equalMaskAVX2(low, high, '"');
+        masks.backslashes = json_equalMaskAVX2(low, high, '\\');
+        masks.structurals = json_classMaskAVX2(lowClasses, highClasses, 1 | 2 | 4);
+        masks.whitespace = json_classMaskAVX2(lowClasses, highClasses, 8 | 16 | 32 | 64);
+
+        u64 quotes = masks.quotes & ~json_findEscaped(masks.backslashes, &state->nextIsEscaped);
+
+        __m128i product = _mm_clmulepi64_si128(_mm_set_epi64x(0, (long long) quotes), allOnes, 0);
+        u64 prefixXor = (u64) _mm_cvtsi128_si64(product);
+
+        u64 positions = json_findPositions(state, masks, quotes, prefixXor);
+        count += json_writePositions(&output[count], base + (u32) (block * 64), positions);
+    }
+
+    return count;
+}
+
+#endif
+
+/*!
+ * Returns whether json_createIndex can use AVX2 on this CPU.
+ */
+static bool json_canIndexAVX2() {
+#ifdef JSON_SIMD_AVX2
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("pclmul");
+#else
+    return false;
+#endif
+}
+
+/*!
+ * Find the positions of the structural chars of {json} and store them in {index}.
+ *
+ * Returns ERROR_JSON_SYNTAX if the last string is not closed, in which case {index} is
+ * still filled in, so that json_parseUsing can find the first error in the document.
+ */
+static CLibErrorType json_fillIndex(String json, JSONIndex * index) {
+    index->count = 0;
+    index->positions = buf_create((json.length / 4 + 64) * (s64) sizeof(u32));
+    if(buf_isErrored(index->positions))
+        return buf_getErrorType(index->positions);
+
+    bool useAVX2 = json_canIndexAVX2();
+
+    JSONIndexState state = {0, 0, 0};
+    u8 * data = (u8 *) json.data;
+    s64 fullBlocks = json.length / 64;
+
+    for(s64 block = 0; block < fullBlocks; block += JSON_INDEX_CHUNK_BLOCKS) {
+        s64 blockCount = fullBlocks - block;
+        if(blockCount > JSON_INDEX_CHUNK_BLOCKS) {
+            blockCount = JSON_INDEX_CHUNK_BLOCKS;
+        }
+
+        CLibErrorType result = buf_ensureCapacity(&index->positions, (index->count + blockCount * 64 + 8) * (s64) sizeof(u32));
+        if(result != ERROR_SUCCESS)
+            return result;
+
+        u32 * output = &((u32 *) index->positions.start)[index->count];
+        u32 base = (u32) (block * 64);
+
+#ifdef JSON_SIMD_AVX2
+        if(useAVX2) {
+            index->count += json_indexAVX2(&data[block * 64], blockCount, base, &state, output);
+            continue;
+        }
+#endif
+
+        index->count += json_indexScalar(&data[block * 64], blockCount, base, &state, output);
+    }
+
+    // Pad the last partial block with whitespace, which has no effect on the positions.
+    s64 remaining = json.length - fullBlocks * 64;
+    if(remaining > 0) {
+        CLibErrorType result = buf_ensureCapacity(&index->positions, (index->count + 64 + 8) * (s64) sizeof(u32));
+        if(result != ERROR_SUCCESS)
+            return result;
+
+        u8 last[64];
+        memset(last, ' ', sizeof(last));
+        memcpy(last, &data[fullBlocks * 64], (size_t) remaining);
+
+        u32 * output = &((u32 *) index->positions.start)[index->count];
+        index->count += json_indexScalar(last, 1, (u32) (fullBlocks * 64), &state, output);
+    }
+
+    if(state.inString != 0)
+        return ERROR_JSON_SYNTAX;
+
+    return ERROR_SUCCESS;
+}
+
+JSONDoc json_parse(String json) {
+    return json_parseUsing(json, JSON_PARSE_AUTO);
+}
+
+JSONDoc json_parseUsing(String json, JSONParseMethod method) {
+    if(str_isErrored(json))
+        return json_createErrored(ERROR_ARG_INVALID, 0);
+
+    if(method == JSON_PARSE_AUTO) {
+        method = JSON_PARSE_SEQUENTIAL;
+    }
+
+    if(method != JSON_PARSE_INDEXED && method != JSON_PARSE_SEQUENTIAL)
+        return json_createErrored(ERROR_ARG_INVALID, 0);
+    if(method == JSON_PARSE_INDEXED && json.length > JSON_INDEX_MAX_LENGTH)
+        return json_createErrored(ERROR_ARG_INVALID, 0);
+
+    // Only strings may contain non-ASCII chars, so validating the whole document up front checks them all.
+    s64 invalidIndex = utf8_validate(json);
+    if(invalidIndex >= 0)
+        return json_createErrored(ERROR_INVALID_CODEPOINT, invalidIndex);
+
+    JSONParser parser;
+    parser.data = json.data;
+    parser.length = json.length;
+    parser.index = 0;
+    parser.positions = NULL;
+    parser.positionCount = 0;
+    parser.position = 0;
+    parser.error = ERROR_NONE;
+    parser.errorOffset = -1;
+
+    JSONIndex index;
+    s64 nodeCapacity = json.length / 8 + 16;
+
+    if(method == JSON_PARSE_INDEXED) {
+        // An unclosed string is found again while parsing, along with any errors before it.
+        CLibErrorType result = json_fillIndex(json, &index);
+        if(result != ERROR_SUCCESS && result != ERROR_JSON_SYNTAX) {
+            json_destroyIndex(&index);
+            return json_createErrored(result, 0);
+        }
+
+        parser.positions = (u32 *) index.positions.start;
+        parser.positionCount = index.count;
+
+        // Every node starts at a different position, so there can be no more nodes than positions.
+        nodeCapacity = index.count + 1;
+    }
+
+    JSONDoc doc;
+    doc.nodes = buf_create(nodeCapacity * (s64) sizeof(JSONNode));
+    doc.nodeCount = 0;
+    doc.strings = buf_createEmpty();
+    doc.stringsLength = 0;
+    doc.errorOffset = -1;
+
+    parser.doc = &doc;
+
+    bool success;
+    if(buf_isErrored(doc.nodes)) {
+        success = json_fail(&parser, buf_getErrorType(doc.nodes), 0);
+    } else if(method == JSON_PARSE_INDEXED) {
+        success = json_parseIndexedDocument(&parser);
+    } else {
+        success = json_parseDocument(&parser);
+    }
+
+    if(method == JSON_PARSE_INDEXED) {
+        json_destroyIndex(&index);
+    }
+
+    if(!success) {
+        json_destroy(&doc);
+        return json_createErrored(parser.error, parser.errorOffset);
+    }
+
+    return doc;
+}
+
+/*!
+ * Parse the JSON document {json} using JSON_PARSE_SEQUENTIAL, adding its nodes after
+ * those already in {doc}, and its unescaped strings to the string blocks of {doc}.
+ *
+ * Returns ERROR_SUCCESS, or the error found in {json} with its offset stored in {errorOffset}.
+ * The nodes of an invalid document are removed again, but its strings are kept until {doc} is cleared.
+ */
+static CLibErrorType json_parseAppend(JSONDoc * doc, String json, s64 * errorOffset) {
+    s64 invalidIndex = utf8_validate(json);
+    if(invalidIndex >= 0) {
+        *errorOffset = invalidIndex;
+        return ERROR_INVALID_CODEPOINT;
+    }
+
+    JSONParser parser;
+    parser.data = json.data;
+    parser.length = json.length;
+    parser.index = 0;
+    parser.positions = NULL;
+    parser.positionCount = 0;
+    parser.position = 0;
+    parser.doc = doc;
+    parser.error = ERROR_NONE;
+    parser.errorOffset = -1;
+
+    s64 firstNode = doc->nodeCount;
+    if(!json_parseDocument(&parser)) {
+        doc->nodeCount = firstNode;
+        *errorOffset = parser.errorOffset;
+        return parser.error;
+    }
+
+    return ERROR_SUCCESS;
+}
+
+/*!
+ * Remove all of the nodes and strings from {doc}, keeping the memory of its
+ * nodes and of its most recent string block to be reused by json_parseAppend.
+ */
+static void json_clearDoc(JSONDoc * doc) {
+    char * block = doc->strings.start;
+
+    if(block != NULL) {
+        char * previous;
+        memcpy(&previous, block, sizeof(char *));
+
+        while(previous != NULL) {
+            char * next;
+            memcpy(&next, previous, sizeof(char *));
+
+            free(previous);
+            previous = next;
+        }
+
+        memcpy(block, &previous, sizeof(char *));
+        doc->stringsLength = (s64) sizeof(char *);
+    }
+
+    doc->nodeCount = 0;
+}
+
+JSONDoc json_createErrored(CLibErrorType errorType, s64 offset) {
+    JSONDoc doc;
+    doc.nodes = buf_createErrored(errorType, 0);
+    doc.nodeCount = 0;
+    doc.strings = buf_createEmpty();
+    doc.stringsLength = 0;
+    doc.errorOffset = offset;
+    return doc;
+}
+
+bool json_isErrored(JSONDoc doc) {
+    return buf_isErrored(doc.nodes);
+}
+
+bool json_isValid(JSONDoc doc) {
+    return !json_isErrored(doc);
+}
+
+CLibErrorType json_getErrorType(JSONDoc doc) {
+    return buf_getErrorType(doc.nodes);
+}
+
+s64 json_getErrorOffset(JSONDoc doc) {
+    if(!json_isErrored(doc))
+        return -1;
+
+    return doc.errorOffset;
+}
+
+void json_destroy(JSONDoc * doc) {
+    char * block = doc->strings.start;
+    while(block != NULL) {
+        char * previous;
+        memcpy(&previous, block, sizeof(char *));
+
+        free(block);
+        block = previous;
+    }
+
+    buf_destroy(&doc->nodes);
+    doc->nodeCount = 0;
+    doc->strings = buf_createEmpty();
+    doc->stringsLength = 0;
+}
+
+JSONNode * json_root(JSONDoc doc) {
+    if(json_isErrored(doc) || doc.nodeCount == 0)
+        return NULL;
+
+    return (JSONNode *) doc.nodes.start;
+}
+
+JSONNode * json_next(JSONNode * node) {
+    if(node->type == JSON_ARRAY || node->type == JSON_OBJECT)
+        return node + 1 + node->value.descendants;
+
+    return node + 1;
+}
+
+JSONNode * json_arrayGet(JSONNode * array, s64 index) {
+    if(array == NULL || array->type != JSON_ARRAY || index < 0 || index >= array->length)
+        return NULL;
+
+    JSONNode * element = array + 1;
+    for(s64 skipped = 0; skipped < index; ++skipped) {
+        element = json_next(element);
+    }
+
+    return element;
+}
+
+JSONNode * json_objectGet(JSONNode * object, String key) {
+    if(object == NULL || object->type != JSON_OBJECT || str_isErrored(key))
+        return NULL;
+
+    // Keys are always strings, so each value directly follows its key.
+    JSONNode * member = object + 1;
+    for(s64 index = 0; index < object->length; ++index) {
+        if(member->length == key.length && (key.length == 0 || memcmp(member->value.chars, key.data, (size_t) key.length) == 0))
+            return member + 1;
+
+        member = json_next(member + 1);
+    }
+
+    return NULL;
+}
+
+JSONNode * json_objectGetC(JSONNode * object, char * key) {
+    return json_objectGet(object, str_create(key));
+}
+
+String json_getString(JSONNode * node) {
+    if(node == NULL || node->type != JSON_STRING)
+        return str_createErrored(ERROR_ARG_INVALID, 0);
+
+    return str_createOfLength(node->value.chars, node->length);
+}
+
+CLibErrorType json_getBool(JSONNode * node, bool * value) {
+    if(value == NULL)
+        return ERROR_ARG_NULL;
+    if(node == NULL || node->type != JSON_BOOL)
+        return ERROR_ARG_INVALID;
+
+    *value = node->value.boolean;
+    return ERROR_SUCCESS;
+}
+
+CLibErrorType json_getDouble(JSONNode * node, double * value) {
+    if(value == NULL)
+        return ERROR_ARG_NULL;
+    if(node == NULL || node->type != JSON_NUMBER)
+        return ERROR_ARG_INVALID;
+
+    *value = ((node->flags & JSON_FLAG_INTEGER) != 0 ? (double) node->value.integer : node->value.number);
+    return ERROR_SUCCESS;
+}
+
+CLibErrorType json_getS64(JSONNode * node, s64 * value) {
+    if(value == NULL)
+        return ERROR_ARG_NULL;
+    if(node == NULL || node->type != JSON_NUMBER)
+        return ERROR_ARG_INVALID;
+    if((node->flags & JSON_FLAG_INTEGER) == 0)
+        return ERROR_CAST;
+
+    *value = node->value.integer;
+    return ERROR_SUCCESS;
+}
+
+/*!
+ * Creates a JSONIndex that is in an errored state.
+ */
+static JSONIndex json_createErroredIndex(CLibErrorType errorType) {
+    JSONIndex index;
+    index.positions = buf_createErrored(errorType, 0);
+    index.count = 0;
+    return index;
+}
+
+JSONIndex json_createIndex(String json) {
+    if(str_isErrored(json) || json.length > JSON_INDEX_MAX_LENGTH)
+        return json_createErroredIndex(ERROR_ARG_INVALID);
+
+    JSONIndex index;
+    CLibErrorType result = json_fillIndex(json, &index);
+    if(result != ERROR_SUCCESS) {
+        json_destroyIndex(&index);
+        return json_createErroredIndex(result);
+    }
+
+    return index;
+}
+
+bool json_isIndexErrored(JSONIndex index) {
+    return buf_isErrored(index.positions);
+}
+
+CLibErrorType json_getIndexErrorType(JSONIndex index) {
+    return buf_getErrorType(index.positions);
+}
+
+void json_destroyIndex(JSONIndex * index) {
+    buf_destroy(&index->positions);
+    index->count = 0;
+}
+
+/*!
+ * The states of a JSONStream.
+ */
+typedef enum JSONStreamState {
+    JSON_STREAM_VALUE = 0,
+    JSON_STREAM_FIRST_VALUE,
+    JSON_STREAM_KEY,
+    JSON_STREAM_FIRST_KEY,
+    JSON_STREAM_COLON,
+    JSON_STREAM_AFTER_VALUE,
+    JSON_STREAM_DONE,
+    JSON_STREAM_STRING,
+    JSON_STREAM_ESCAPE,
+    JSON_STREAM_UNICODE,
+    JSON_STREAM_LOW_BACKSLASH,
+    JSON_STREAM_LOW_U,
+    JSON_STREAM_NUMBER,
+    JSON_STREAM_LITERAL
+} JSONStreamState;
+
+/*!
+ * The parts of a number that a JSONStream may have read so far.
+ */
+typedef enum JSONNumberState {
+    JSON_NUMBER_START = 0,
+    JSON_NUMBER_SIGN,
+    JSON_NUMBER_ZERO,
+    JSON_NUMBER_INTEGER,
+    JSON_NUMBER_DOT,
+    JSON_NUMBER_FRACTION,
+    JSON_NUMBER_EXPONENT,
+    JSON_NUMBER_EXPONENT_SIGN,
+    JSON_NUMBER_EXPONENT_DIGITS
+} JSONNumberState;
+
+/*!
+ * Returns the JSONNumberState after {character} is added to a number in {state}, or -1 if {character} ends the number.
+ */
+static inline s64 json_nextNumberState(s64 state, char character) {
+    bool isDigit = char_isDigit(character);
+
+    switch(state) {
+        case JSON_NUMBER_START:
+            if(character == '-')
+                return JSON_NUMBER_SIGN;
+            // fallthrough
+        case JSON_NUMBER_SIGN:
+            if(character == '0')
+                return JSON_NUMBER_ZERO;
+            return (isDigit ? JSON_NUMBER_INTEGER : -1);
+        case JSON_NUMBER_INTEGER:
+            if(isDigit)
+                return JSON_NUMBER_INTEGER;
+            // fallthrough
+        case JSON_NUMBER_ZERO:
+            if(character == '.')
+                return JSON_NUMBER_DOT;
+            return (character == 'e' || character == 'E' ? JSON_NUMBER_EXPONENT : -1);
+        case JSON_NUMBER_DOT:
+            return (isDigit ? JSON_NUMBER_FRACTION : -1);
+        case JSON_NUMBER_FRACTION:
+            if(isDigit)
+                return JSON_NUMBER_FRACTION;
+            return (character == 'e' || character == 'E' ? JSON_NUMBER_EXPONENT : -1);
+        case JSON_NUMBER_EXPONENT:
+            if(character == '-' || character == '+')
+                return JSON_NUMBER_EXPONENT_SIGN;
+            // fallthrough
+        case JSON_NUMBER_EXPONENT_SIGN:
+        case JSON_NUMBER_EXPONENT_DIGITS:
+            return (isDigit ? JSON_NUMBER_EXPONENT_DIGITS : -1);
+        default:
+            return -1;
+    }
+}
+
+/*!
+ * Returns whether a number that has been read up to {state} is complete.
+ */
+static inline bool json_isNumberComplete(s64 state) {
+    return state == JSON_NUMBER_ZERO || state == JSON_NUMBER_INTEGER
+        || state == JSON_NUMBER_FRACTION || state == JSON_NUMBER_EXPONENT_DIGITS;
+}
+
+/*!
+ * Record that {stream} failed with {errorType} at the char {offset} of the document, and return {errorType}.
+ */
+static CLibErrorType json_streamFail(JSONStream * stream, CLibErrorType errorType, s64 offset) {
+    stream->error = errorType;
+    stream->errorOffset = offset;
+    return errorType;
+}
+
+/*!
+ * Returns the index of the first char in {data} from {index} that is not whitespace, or {length} if there is none.
+ */
+static inline s64 json_skipWhitespaceFrom(char * data, s64 index, s64 length) {
+    while(index < length) {
+        char character = data[index];
+        if(character != ' ' && character != '\n' && character != '\r' && character != '\t')
+            break;
+
+        index += 1;
+    }
+
+    return index;
+}
+
+/*!
+ * Returns the chars of the token in {stream} that ends with the chars from {start} to {end} of {data}.
+ *
+ * Tokens that are wholly contained in {data} are returned as a view, and others are completed in {stream}'s pending Builder.
+ */
+static String json_streamToken(JSONStream * stream, char * data, s64 start, s64 end) {
+    if(!stream->isPending)
+        return str_createOfLength(&data[start], end - start);
+
+    if(builder_appendStr(&stream->pending, str_createOfLength(&data[start], end - start)) != ERROR_SUCCESS)
+        return str_createErrored(ERROR_ALLOC, 0);
+
+    return builder_str(stream->pending);
+}
+
+/*!
+ * Discard the chars of the token that {stream} has just finished, keeping the memory of its pending Builder.
+ */
+static inline void json_streamEndToken(JSONStream * stream) {
+    stream->pending.length = 0;
+    stream->isPending = false;
+}
+
+/*!
+ * Move {stream} past a value that has just ended, reporting the end of the document if it was a top level value.
+ */
+static void json_streamEndValue(JSONStream * stream) {
+    if(stream->depth > 0) {
+        stream->state = JSON_STREAM_AFTER_VALUE;
+        return;
+    }
+
+    stream->callback(JSON_EVENT_END_DOCUMENT, str_createEmpty(), stream->context);
+    stream->state = (stream->allowMultiple ? JSON_STREAM_VALUE : JSON_STREAM_DONE);
+}
+
+/*!
+ * Open an array or object in {stream}, where {offset} is the offset of its opening bracket in the document.
+ */
+static CLibErrorType json_streamOpen(JSONStream * stream, bool isObject, s64 offset) {
+    if(stream->depth == JSON_MAX_DEPTH)
+        return json_streamFail(stream, ERROR_JSON_DEPTH, offset);
+
+    u64 bit = 1ULL << (stream->depth & 63);
+    if(isObject) {
+        stream->containers[stream->depth >> 6] |= bit;
+    } else {
+        stream->containers[stream->depth >> 6] &= ~bit;
+    }
+
+    stream->depth += 1;
+    stream->callback((isObject ? JSON_EVENT_START_OBJECT : JSON_EVENT_START_ARRAY), str_createEmpty(), stream->context);
+    stream->state = (isObject ? JSON_STREAM_FIRST_KEY : JSON_STREAM_FIRST_VALUE);
+
+    return ERROR_SUCCESS;
+}
+
+/*!
+ * Returns whether the innermost open container of {stream} is an object.
+ */
+static inline bool json_streamInObject(JSONStream * stream) {
+    s64 top = stream->depth - 1;
+    return ((stream->containers[top >> 6] >> (top & 63)) & 1) != 0;
+}
+
+/*!
+ * Close the innermost open array or object of {stream}.
+ */
+static void json_streamClose(JSONStream * stream) {
+    bool isObject = json_streamInObject(stream);
+    stream->depth -= 1;
+
+    stream->callback((isObject ? JSON_EVENT_END_OBJECT : JSON_EVENT_END_ARRAY), str_createEmpty(), stream->context);
+    json_streamEndValue(stream);
+}
+
+/*!
+ * Report the string or key {text} in {stream}, after checking that it is valid UTF-8.
+ */
+static CLibErrorType json_streamEmitString(JSONStream * stream, String text) {
+    if(str_isErrored(text))
+        return json_streamFail(stream, ERROR_ALLOC, stream->tokenOffset);
+
+    s64 invalid = utf8_validate(text);
+    if(invalid >= 0) {
+        // Strings with escapes no longer line up with the document, so their errors are reported at the opening quote.
+        bool hasEscapes = (stream->escapeOffset > stream->tokenOffset);
+        s64 offset = (hasEscapes ? stream->tokenOffset : stream->tokenOffset + 1 + invalid);
+        return json_streamFail(stream, ERROR_INVALID_CODEPOINT, offset);
+    }
+
+    if(stream->isKey) {
+        stream->callback(JSON_EVENT_KEY, text, stream->context);
+        stream->state = JSON_STREAM_COLON;
+    } else {
+        stream->callback(JSON_EVENT_STRING, text, stream->context);
+        json_streamEndValue(stream);
+    }
+
+    json_streamEndToken(stream);
+    return ERROR_SUCCESS;
+}
+
+/*!
+ * Report the number {text} in {stream}.
+ */
+static CLibErrorType json_streamEmitNumber(JSONStream * stream, String text) {
+    if(str_isErrored(text))
+        return json_streamFail(stream, ERROR_ALLOC, stream->tokenOffset);
+
+    stream->callback(JSON_EVENT_NUMBER, text, stream->context);
+    json_streamEndToken(stream);
+    json_streamEndValue(stream);
+
+    return ERROR_SUCCESS;
+}
+
+/*!
+ * Add the codepoint of the \u escape that {stream} has just read to its pending chars.
+ */
+static CLibErrorType json_streamEndUnicode(JSONStream * stream) {
+    u32 codepoint = stream->codepoint;
+
+    if(stream->highSurrogate == 0) {
+        if(codepoint >= 0xDC00 && codepoint <= 0xDFFF)
+            return json_streamFail(stream, ERROR_INVALID_CODEPOINT, stream->escapeOffset);
+
+        if(codepoint >= 0xD800 && codepoint <= 0xDBFF) {
+            stream->highSurrogate = codepoint;
+            stream->state = JSON_STREAM_LOW_BACKSLASH;
+            return ERROR_SUCCESS;
+        }
+    } else {
+        if(codepoint < 0xDC00 || codepoint > 0xDFFF)
+            return json_streamFail(stream, ERROR_INVALID_CODEPOINT, stream->escapeOffset);
+
+        codepoint = 0x10000 + ((stream->highSurrogate - 0xD800) << 10) + (codepoint - 0xDC00);
+        stream->highSurrogate = 0;
+    }
+
+    u8 encoded[4];
+    s64 codepointLength = utf8_codepointLength(codepoint);
+    utf8_encodeCodepoint(codepoint, codepointLength, encoded);
+
+    if(builder_appendStr(&stream->pending, str_createOfLength((char *) encoded, codepointLength)) != ERROR_SUCCESS)
+        return json_streamFail(stream, ERROR_ALLOC, stream->escapeOffset);
+
+    stream->state = JSON_STREAM_STRING;
+    return ERROR_SUCCESS;
+}
+
+/*!
+ * Start reading a string or key in {stream} whose opening quote is at {offset} in the document.
+ */
+static inline void json_streamStartString(JSONStream * stream, bool isKey, s64 offset) {
+    stream->state = JSON_STREAM_STRING;
+    stream->isKey = isKey;
+    stream->tokenOffset = offset;
+}
+
+JSONStream json_createStream(JSONEventCallback callback, void * context, bool allowMultiple) {
+    JSONStream stream;
+    memset(&stream, 0, sizeof(JSONStream));
+
+    stream.callback = callback;
+    stream.context = context;
+    stream.allowMultiple = allowMultiple;
+    stream.state = JSON_STREAM_VALUE;
+    stream.pending = builder_create(0);
+    stream.error = ERROR_NONE;
+    stream.errorOffset = -1;
+
+    if(callback == NULL) {
+        stream.error = ERROR_ARG_NULL;
+        stream.errorOffset = 0;
+    }
+
+    return stream;
+}
+
+bool json_isStreamErrored(JSONStream stream) {
+    return stream.error != ERROR_NONE;
+}
+
+CLibErrorType json_getStreamErrorType(JSONStream stream) {
+    return stream.error;
+}
+
+s64 json_getStreamErrorOffset(JSONStream stream) {
+    return stream.errorOffset;
+}
+
+CLibErrorType json_streamFeed(JSONStream * stream, String chunk) {
+    if(stream->error != ERROR_NONE)
+        return stream->error;
+    if(str_isErrored(chunk))
+        return ERROR_ARG_INVALID;
+
+    char * data = chunk.data;
+    s64 length = chunk.length;
+    s64 offset = stream->offset;
+
+    // The first char of the current token that has not yet been added to the pending chars.
+    s64 tokenStart = 0;
+    s64 index = 0;
+
+    while(index < length) {
+        switch((JSONStreamState) stream->state) {
+            case JSON_STREAM_VALUE: {
+                index = json_skipWhitespaceFrom(data, index, length);
+                if(index == length)
+                    break;
+
+                char character = data[index];
+
+                if(character == '{' || character == '[') {
+                    if(json_streamOpen(stream, (character == '{'), offset + index) != ERROR_SUCCESS)
+                        return stream->error;
+
+                    index += 1;
+                } else if(character == '"') {
+                    json_streamStartString(stream, false, offset + index);
+                    index += 1;
+                    tokenStart = index;
+                } else if(character == '-' || char_isDigit(character)) {
+                    stream->state = JSON_STREAM_NUMBER;
+                    stream->numberState = JSON_NUMBER_START;
+                    stream->tokenOffset = offset + index;
+                    tokenStart = index;
+                } else if(character == 't' || character == 'f' || character == 'n') {
+                    stream->state = JSON_STREAM_LITERAL;
+                    stream->literal = (character == 't' ? "true" : (character == 'f' ? "false" : "null"));
+                    stream->literalIndex = 0;
+                    stream->tokenOffset = offset + index;
+                } else {
+                    return json_streamFail(stream, ERROR_JSON_SYNTAX, offset + index);
+                }
+
+                break;
+            }
+
+            case JSON_STREAM_FIRST_VALUE:
+                index = json_skipWhitespaceFrom(data, index, length);
+                if(index == length)
+                    break;
+
+                if(data[index] == ']') {
+                    json_streamClose(stream);
+                    index += 1;
+                } else {
+                    stream->state = JSON_STREAM_VALUE;
+                }
+
+                break;
+
+            case JSON_STREAM_FIRST_KEY:
+            case JSON_STREAM_KEY:
+                index = json_skipWhitespaceFrom(data, index, length);
+                if(index == length)
+                    break;
+
+                if(data[index] == '"') {
+                    json_streamStartString(stream, true, offset + index);
+                    index += 1;
+                    tokenStart = index;
+                } else if(data[index] == '}' && stream->state == JSON_STREAM_FIRST_KEY) {
+                    json_streamClose(stream);
+                    index += 1;
+                } else {
+                    return json_streamFail(stream, ERROR_JSON_SYNTAX, offset + index);
+                }
+
+                break;
+
+            case JSON_STREAM_COLON:
+                index = json_skipWhitespaceFrom(data, index, length);
+                if(index == length)
+                    break;
+
+                if(data[index] != ':')
+                    return json_streamFail(stream, ERROR_JSON_SYNTAX, offset + index);
+
+                stream->state = JSON_STREAM_VALUE;
+                index += 1;
+                break;
+
+            case JSON_STREAM_AFTER_VALUE: {
+                index = json_skipWhitespaceFrom(data, index, length);
+                if(index == length)
+                    break;
+
+                char character = data[index];
+                bool inObject = json_streamInObject(stream);
+
+                if(character == ',') {
+                    stream->state = (inObject ? JSON_STREAM_KEY : JSON_STREAM_VALUE);
+                } else if(character == (inObject ? '}' : ']')) {
+                    json_streamClose(stream);
+                } else {
+                    return json_streamFail(stream, ERROR_JSON_SYNTAX, offset + index);
+                }
+
+                index += 1;
+                break;
+            }
+
+            case JSON_STREAM_DONE:
+                index = json_skipWhitespaceFrom(data, index, length);
+                if(index < length)
+                    return json_streamFail(stream, ERROR_JSON_SYNTAX, offset + index);
+
+                break;
+
+            case JSON_STREAM_STRING: {
+                s64 special = json_findStringSpecial(data, index, length);
+                if(special == length) {
+                    index = length;
+                    break;
+                }
+
+                char character = data[special];
+
+                if(character == '"') {
+                    index = special + 1;
+                    if(json_streamEmitString(stream, json_streamToken(stream, data, tokenStart, special)) != ERROR_SUCCESS)
+                        return stream->error;
+                } else if(character == '\\') {
+                    if(builder_appendSubstring(&stream->pending, chunk, tokenStart, special) != ERROR_SUCCESS)
+                        return json_streamFail(stream, ERROR_ALLOC, offset + special);
+
+                    stream->isPending = true;
+                    stream->state = JSON_STREAM_ESCAPE;
+                    stream->escapeOffset = offset + special;
+                    index = special + 1;
+                } else {
+                    return json_streamFail(stream, ERROR_JSON_SYNTAX, offset + special);
+                }
+
+                break;
+            }
+
+            case JSON_STREAM_ESCAPE: {
+                char escaped = data[index];
+                char unescaped;
+
+                switch(escaped) {
+                    case '"':
+                    case '\\':
+                    case '/':
+                        unescaped = escaped;
+                        break;
+                    case 'b':
+                        unescaped = '\b';
+                        break;
+                    case 'f':
+                        unescaped = '\f';
+                        break;
+                    case 'n':
+                        unescaped = '\n';
+                        break;
+                    case 'r':
+                        unescaped = '\r';
+                        break;
+                    case 't':
+                        unescaped = '\t';
+                        break;
+                    case 'u':
+                        unescaped = 0;
+                        break;
+                    default:
+                        return json_streamFail(stream, ERROR_JSON_SYNTAX, stream->escapeOffset);
+                }
+
+                index += 1;
+                tokenStart = index;
+
+                if(escaped == 'u') {
+                    stream->state = JSON_STREAM_UNICODE;
+                    stream->codepoint = 0;
+                    stream->hexDigits = 0;
+                    break;
+                }
+
+                if(builder_appendChar(&stream->pending, unescaped) != ERROR_SUCCESS)
+                    return json_streamFail(stream, ERROR_ALLOC, stream->escapeOffset);
+
+                stream->state = JSON_STREAM_STRING;
+                break;
+            }
+
+            case JSON_STREAM_UNICODE: {
+                char character = data[index];
+
+                u32 digit;
+                if(character >= '0' && character <= '9') {
+                    digit = (u32) (character - '0');
+                } else if(character >= 'a' && character <= 'f') {
+                    digit = (u32) (character - 'a' + 10);
+                } else if(character >= 'A' && character <= 'F') {
+                    digit = (u32) (character - 'A' + 10);
+                } else {
+                    CLibErrorType errorType = (stream->highSurrogate != 0 ? ERROR_INVALID_CODEPOINT : ERROR_JSON_SYNTAX);
+                    return json_streamFail(stream, errorType, stream->escapeOffset);
+                }
+
+                stream->codepoint = (stream->codepoint << 4) | digit;
+                stream->hexDigits += 1;
+
+                index += 1;
+                tokenStart = index;
+
+                if(stream->hexDigits == 4 && json_streamEndUnicode(stream) != ERROR_SUCCESS)
+                    return stream->error;
+
+                break;
+            }
+
+            case JSON_STREAM_LOW_BACKSLASH:
+            case JSON_STREAM_LOW_U: {
+                char expected = (stream->state == JSON_STREAM_LOW_BACKSLASH ? '\\' : 'u');
+                if(data[index] != expected)
+                    return json_streamFail(stream, ERROR_INVALID_CODEPOINT, stream->escapeOffset);
+
+                if(stream->state == JSON_STREAM_LOW_BACKSLASH) {
+                    stream->state = JSON_STREAM_LOW_U;
+                } else {
+                    stream->state = JSON_STREAM_UNICODE;
+                    stream->codepoint = 0;
+                    stream->hexDigits = 0;
+                }
+
+                index += 1;
+                tokenStart = index;
+                break;
+            }
+
+            case JSON_STREAM_NUMBER: {
+                s64 numberState = stream->numberState;
+
+                while(index < length) {
+                    s64 next = json_nextNumberState(numberState, data[index]);
+                    if(next < 0)
+                        break;
+
+                    numberState = next;
+                    index += 1;
+                }
+
+                stream->numberState = (u8) numberState;
+                if(index == length)
+                    break;
+
+                if(!json_isNumberComplete(numberState))
+                    return json_streamFail(stream, ERROR_JSON_SYNTAX, offset + index);
+
+                if(json_streamEmitNumber(stream, json_streamToken(stream, data, tokenStart, index)) != ERROR_SUCCESS)
+                    return stream->error;
+
+                break;
+            }
+
+            case JSON_STREAM_LITERAL: {
+                char * literal = stream->literal;
+                s64 literalIndex = stream->literalIndex;
+
+                for(; index < length && literal[literalIndex] != '\0'; ++index, ++literalIndex) {
+                    if(data[index] != literal[literalIndex])
+                        return json_streamFail(stream, ERROR_JSON_SYNTAX, stream->tokenOffset);
+                }
+
+                stream->literalIndex = literalIndex;
+                if(literal[literalIndex] != '\0')
+                    break;
+
+                JSONEvent event = (literal[0] == 'n' ? JSON_EVENT_NULL : JSON_EVENT_BOOL);
+                stream->callback(event, str_createOfLength(literal, literalIndex), stream->context);
+                json_streamEndValue(stream);
+                break;
+            }
+        }
+    }
+
+    // Keep the chars of a string or number that continues into the next chunk.
+    if((stream->state == JSON_STREAM_STRING || stream->state == JSON_STREAM_NUMBER) && tokenStart < length) {
+        if(builder_appendSubstring(&stream->pending, chunk, tokenStart, length) != ERROR_SUCCESS)
+            return json_streamFail(stream, ERROR_ALLOC, offset + tokenStart);
+
+        stream->isPending = true;
+    }
+
+    stream->offset += length;
+    return ERROR_SUCCESS;
+}
+
+CLibErrorType json_streamFeedReader(JSONStream * stream, FileReader * reader) {
+    if(stream->error != ERROR_NONE)
+        return stream->error;
+    if(reader_isErrored(*reader))
+        return ERROR_ARG_INVALID;
+
+    while(true) {
+        String chunk = reader_read(reader, reader->buffer.size);
+
+        if(str_isErrored(chunk)) {
+            if(str_getErrorType(chunk) == ERROR_STRING_EXHAUSTED)
+                break;
+
+            return str_getErrorType(chunk);
+        }
+
+        CLibErrorType errorType = json_streamFeed(stream, chunk);
+        if(errorType != ERROR_SUCCESS)
+            return errorType;
+    }
+
+    return json_streamFinish(stream);
+}
+
+CLibErrorType json_streamFinish(JSONStream * stream) {
+    if(stream->error != ERROR_NONE)
+        return stream->error;
+
+    // A number is only known to have ended once the next char is seen.
+    if(stream->state == JSON_STREAM_NUMBER) {
+        if(!json_isNumberComplete(stream->numberState))
+            return json_streamFail(stream, ERROR_JSON_SYNTAX, stream->offset);
+
+        if(json_streamEmitNumber(stream, builder_str(stream->pending)) != ERROR_SUCCESS)
+            return stream->error;
+    }
+
+    bool complete = (stream->state == JSON_STREAM_DONE)
+                 || (stream->allowMultiple && stream->state == JSON_STREAM_VALUE && stream->depth == 0);
+
+    if(!complete)
+        return json_streamFail(stream, ERROR_JSON_SYNTAX, stream->offset);
+
+    return ERROR_SUCCESS;
+}
+
+void json_destroyStream(JSONStream * stream) {
+    builder_destroy(&stream->pending);
+    stream->isPending = false;
+    stream->depth = 0;
+}
+
+/*!
+ * Returns the index after the string whose opening quote is at {index} in {data}, or -1 if it is not closed.
+ *
+ * {isEscaped} is set to true if the string contains any escapes.
+ */
+static inline s64 json_skipString(char * data, s64 index, s64 length, bool * isEscaped) {
+    index += 1;
+
+    while(true) {
+        index = json_findStringSpecial(data, index, length);
+        if(index >= length)
+            return -1;
+
+        char character = data[index];
+        if(character == '"')
+            return index + 1;
+        if(character != '\\')
+            return -1;
+
+        *isEscaped = true;
+        index += 2;
+    }
+}
+
+/*!
+ * Returns the index of the first '"', '[', ']', '{' or '}' in {data} from {index}, or {length} if there is none.
+ */
+static inline s64 json_findBracketOrQuote(char * data, s64 index, s64 length) {
+    // Setting the 0x20 bit maps '[' and ']' onto '{' and '}', so only three chars need to be searched for.
+    while(length - index >= 8) {
+        u64 chunk = number_loadEightChars(&data[index]);
+        u64 lowered = chunk | 0x2020202020202020ULL;
+
+        u64 quotes = chunk ^ 0x2222222222222222ULL;
+        u64 opening = lowered ^ 0x7B7B7B7B7B7B7B7BULL;
+        u64 closing = lowered ^ 0x7D7D7D7D7D7D7D7DULL;
+
+        u64 found = ((quotes - 0x0101010101010101ULL) & ~quotes)
+                  | ((opening - 0x0101010101010101ULL) & ~opening)
+                  | ((closing - 0x0101010101010101ULL) & ~closing);
+        found &= 0x8080808080808080ULL;
+
+        if(found != 0)
+            return index + (__builtin_ctzll(found) >> 3);
+
+        index += 8;
+    }
+
+    for(; index < length; ++index) {
+        char character = data[index];
+        if(character == '"' || character == '[' || character == ']' || character == '{' || character == '}')
+            return index;
+    }
+
+    return length;
+}
+
+/*!
+ * Returns the index after the array or object whose opening bracket is at {index} in {data}, or -1 if it is not closed.
+ *
+ * Only the brackets and strings are looked at, so the contents are not checked, and any closing bracket closes any container.
+ */
+static s64 json_skipContainerScalar(char * data, s64 index, s64 length) {
+    s64 depth = 0;
+
+    while(true) {
+        index = json_findBracketOrQuote(data, index, length);
+        if(index >= length)
+            return -1;
+
+        char character = data[index];
+
+        if(character == '"') {
+            bool isEscaped = false;
+            index = json_skipString(data, index, length, &isEscaped);
+            if(index < 0)
+                return -1;
+
+            continue;
+        }
+
+        if(character == '[' || character == '{') {
+            depth += 1;
+        } else {
+            depth -= 1;
+            if(depth == 0)
+                return index + 1;
+        }
+
+        index += 1;
+    }
+}
+
+#ifdef JSON_SIMD_AVX2
+
+/*!
+ * The same as json_skipContainerScalar, but finding the brackets outside of strings 64 chars at a time using AVX2.
+ *
+ * The strings in each block are masked out in the same way as json_createIndex. Blocks that cannot contain the
+ * closing bracket, as they have fewer closing brackets than the depth, are skipped by counting their brackets.
+ */
+__attribute__((target("avx2,pclmul")))
+static s64 json_skipContainerAVX2(char * data, s64 index, s64 length) {
+    __m128i allOnes = _mm_set1_epi8((char) 0xFF);
+    __m256i lowerBit = _mm256_set1_epi8(0x20);
+
+    u64 nextIsEscaped = 0;
+    u64 previousInString = 0;
+    s64 depth = 0;
+
+    for(s64 start = index; start < length; start += 64) {
+        u8 padded[64];
+        u8 * block = (u8 *) &data[start];
+
+        // Pad the last partial block with whitespace.
+        if(length - start < 64) {
+            memset(padded, ' ', sizeof(padded));
+            memcpy(padded, block, (size_t) (length - start));
+            block = padded;
+        }
+
+        __m256i low = _mm256_loadu_si256((__m256i *) block);
+        __m256i high = _mm256_loadu_si256((__m256i *) &block[32]);
+
+        // Setting the 0x20 bit maps '[' and ']' onto '{' and '}'.
+        __m256i lowLowered = _mm256_or_si256(low, lowerBit);
+        __m256i highLowered = _mm256_or_si256(high, lowerBit);
+
+        u64 backslashes = json_equalMaskAVX2(low, high, '\\');
+        u64 quotes = json_equalMaskAVX2(low, high, '"') & ~json_findEscaped(backslashes, &nextIsEscaped);
+
+        __m128i product = _mm_clmulepi64_si128(_mm_set_epi64x(0, (long long) quotes), allOnes, 0);
+        u64 inString = (u64) _mm_cvtsi128_si64(product) ^ previousInString;
+        previousInString = (u64) ((s64) inString >> 63);
+
+        u64 opening = json_equalMaskAVX2(lowLowered, highLowered, '{') & ~inString;
+        u64 closing = json_equalMaskAVX2(lowLowered, highLowered, '}') & ~inString;
+
+        s64 closingCount = __builtin_popcountll(closing);
+        if(closingCount < depth) {
+            depth += __builtin_popcountll(opening) - closingCount;
+            continue;
+        }
+
+        u64 brackets = opening | closing;
+        while(brackets != 0) {
+            s64 bit = __builtin_ctzll(brackets);
+            brackets &= brackets - 1;
+
+            if((opening >> bit) & 1) {
+                depth += 1;
+            } else {
+                depth -= 1;
+                if(depth == 0)
+                    return start + bit + 1;
+            }
+        }
+    }
+
+    return -1;
+}
+
+#endif
+
+/*!
+ * Returns the index after the array or object whose opening bracket is at {index} in {data}, or -1 if it is not closed.
+ */
+static inline s64 json_skipContainer(char * data, s64 index, s64 length) {
+#ifdef JSON_SIMD_AVX2
+    if(json_canIndexAVX2())
+        return json_skipContainerAVX2(data, index, length);
+#endif
+
+    return json_skipContainerScalar(data, index, length);
+}
+
+/*!
+ * Read the value starting at {index} in {data} into {value}, returning the index after it, or -1 if it is malformed.
+ */
+static s64 json_readValue(char * data, s64 index, s64 length, JSONValue * value) {
+    if(index >= length)
+        return -1;
+
+    char character = data[index];
+    s64 end;
+
+    value->isEscaped = false;
+
+    if(character == '"') {
+        end = json_skipString(data, index, length, &value->isEscaped);
+        if(end < 0)
+            return -1;
+
+        value->type = JSON_STRING;
+        value->chars = str_createOfLength(&data[index + 1], end - index - 2);
+        return end;
+    }
+
+    if(character == '[' || character == '{') {
+        end = json_skipContainer(data, index, length);
+        value->type = (character == '[' ? JSON_ARRAY : JSON_OBJECT);
+    } else if(character == '-' || char_isDigit(character)) {
+        s64 numberState = JSON_NUMBER_START;
+
+        for(end = index; end < length; ++end) {
+            s64 next = json_nextNumberState(numberState, data[end]);
+            if(next < 0)
+                break;
+
+            numberState = next;
+        }
+
+        if(!json_isNumberComplete(numberState))
+            return -1;
+
+        value->type = JSON_NUMBER;
+    } else {
+        char * literal = (character == 't' ? "true" : (character == 'f' ? "false" : "null"));
+        s64 literalLength = (s64) strlen(literal);
+
+        if(length - index < literalLength || memcmp(&data[index], literal, (size_t) literalLength) != 0)
+            return -1;
+
+        end = index + literalLength;
+        value->type = (character == 'n' ? JSON_NULL : JSON_BOOL);
+    }
+
+    if(end < 0)
+        return -1;
+
+    value->chars = str_createOfLength(&data[index], end - index);
+    return end;
+}
+
+/*!
+ * Returns whether the char {character} could start a JSON value.
+ */
+static inline bool json_isValueStart(char character) {
+    return character == '{' || character == '[' || character == '"' || character == '-' || char_isDigit(character)
+        || character == 't' || character == 'f' || character == 'n';
+}
+
+/*!
+ * Returns the index after the value starting at {index} in {data}, or -1 if it is obviously malformed.
+ *
+ * Strings and containers are skipped using json_skipString and json_skipContainer, and
+ * numbers and literals by finding the next char that cannot be part of them, without checking them.
+ */
+static inline s64 json_skipValue(char * data, s64 index, s64 length) {
+    if(index >= length || !json_isValueStart(data[index]))
+        return -1;
+
+    char character = data[index];
+
+    if(character == '"') {
+        bool isEscaped = false;
+        return json_skipString(data, index, length, &isEscaped);
+    }
+
+    if(character == '[' || character == '{')
+        return json_skipContainer(data, index, length);
+
+    for(index += 1; index < length; ++index) {
+        character = data[index];
+        if(character <= ' ' || character == ',' || character == ']' || character == '}')
+            break;
+    }
+
+    return index;
+}
+
+/*!
+ * Check whether the key in {data} from {start} to its closing quote at {end} equals {key}, storing the result in {matches}.
+ */
+static CLibErrorType json_matchKey(char * data, s64 start, s64 end, bool isEscaped, String key, bool * matches) {
+    if(!isEscaped) {
+        *matches = (end - start == key.length && (key.length == 0 || memcmp(&data[start], key.data, (size_t) key.length) == 0));
+        return ERROR_SUCCESS;
+    }
+
+    // Escaped keys are never shorter than their unescaped chars.
+    if(end - start < key.length) {
+        *matches = false;
+        return ERROR_SUCCESS;
+    }
+
+    char stackChars[256];
+    char * chars = stackChars;
+
+    if(end - start > (s64) sizeof(stackChars)) {
+        chars = malloc((size_t) (end - start));
+        if(chars == NULL)
+            return ERROR_ALLOC;
+    }
+
+    CLibErrorType errorType = ERROR_SUCCESS;
+    s64 errorIndex;
+
+    s64 unescapedLength = json_unescape(data, start, end, chars, &errorType, &errorIndex);
+    if(unescapedLength >= 0) {
+        errorType = ERROR_SUCCESS;
+        *matches = (unescapedLength == key.length && (key.length == 0 || memcmp(chars, key.data, (size_t) key.length) == 0));
+    }
+
+    if(chars != stackChars) {
+        free(chars);
+    }
+
+    return errorType;
+}
+
+/*!
+ * Move {index} from the start of an object in {data} to the start of the value of its first member with the key {key}.
+ */
+static CLibErrorType json_findMember(char * data, s64 length, s64 * index, String key) {
+    s64 position = *index;
+
+    if(position >= length || data[position] != '{')
+        return (position < length && json_isValueStart(data[position]) ? ERROR_JSON_NOT_FOUND : ERROR_JSON_SYNTAX);
+
+    position = json_skipWhitespaceFrom(data, position + 1, length);
+    if(position < length && data[position] == '}')
+        return ERROR_JSON_NOT_FOUND;
+
+    while(true) {
+        if(position >= length || data[position] != '"')
+            return ERROR_JSON_SYNTAX;
+
+        bool isEscaped = false;
+        s64 keyEnd = json_skipString(data, position, length, &isEscaped);
+        if(keyEnd < 0)
+            return ERROR_JSON_SYNTAX;
+
+        bool matches = false;
+        CLibErrorType errorType = json_matchKey(data, position + 1, keyEnd - 1, isEscaped, key, &matches);
+        if(errorType != ERROR_SUCCESS)
+            return errorType;
+
+        position = json_skipWhitespaceFrom(data, keyEnd, length);
+        if(position >= length || data[position] != ':')
+            return ERROR_JSON_SYNTAX;
+
+        position = json_skipWhitespaceFrom(data, position + 1, length);
+        if(matches) {
+            *index = position;
+            return ERROR_SUCCESS;
+        }
+
+        position = json_skipValue(data, position, length);
+        if(position < 0)
+            return ERROR_JSON_SYNTAX;
+
+        position = json_skipWhitespaceFrom(data, position, length);
+        if(position >= length)
+            return ERROR_JSON_SYNTAX;
+        if(data[position] == '}')
+            return ERROR_JSON_NOT_FOUND;
+        if(data[position] != ',')
+            return ERROR_JSON_SYNTAX;
+
+        position = json_skipWhitespaceFrom(data, position + 1, length);
+    }
+}
+
+/*!
+ * Move {index} from the start of an array in {data} to the start of its element {element}.
+ */
+static CLibErrorType json_findElement(char * data, s64 length, s64 * index, s64 element) {
+    s64 position = *index;
+
+    if(position >= length || data[position] != '[')
+        return (position < length && json_isValueStart(data[position]) ? ERROR_JSON_NOT_FOUND : ERROR_JSON_SYNTAX);
+
+    position = json_skipWhitespaceFrom(data, position + 1, length);
+    if(position < length && data[position] == ']')
+        return ERROR_JSON_NOT_FOUND;
+
+    for(s64 current = 0; current < element; ++current) {
+        position = json_skipValue(data, position, length);
+        if(position < 0)
+            return ERROR_JSON_SYNTAX;
+
+        position = json_skipWhitespaceFrom(data, position, length);
+        if(position >= length)
+            return ERROR_JSON_SYNTAX;
+        if(data[position] == ']')
+            return ERROR_JSON_NOT_FOUND;
+        if(data[position] != ',')
+            return ERROR_JSON_SYNTAX;
+
+        position = json_skipWhitespaceFrom(data, position + 1, length);
+    }
+
+    *index = position;
+    return ERROR_SUCCESS;
+}
+
+/*!
+ * Create a JSONPath that is in an errored state.
+ */
+static JSONPath json_createErroredPath(CLibErrorType errorType) {
+    JSONPath path;
+
+    path.chars = str_createEmpty();
+    path.steps = buf_createErrored(errorType, 0);
+    path.stepCount = 0;
+
+    return path;
+}
+
+JSONPath json_compilePath(String path) {
+    if(str_isErrored(path))
+        return json_createErroredPath(ERROR_ARG_INVALID);
+
+    // Each step after the first starts with a '.' or '['.
+    s64 maxSteps = 1;
+    for(s64 index = 0; index < path.length; ++index) {
+        if(path.data[index] == '.' || path.data[index] == '[') {
+            maxSteps += 1;
+        }
+    }
+
+    JSONPath compiled;
+
+    compiled.chars = str_copy(path);
+    compiled.steps = buf_create(maxSteps * (s64) sizeof(JSONPathStep));
+    compiled.stepCount = 0;
+
+    if(str_isErrored(compiled.chars) || buf_isErrored(compiled.steps)) {
+        json_destroyPath(&compiled);
+        return json_createErroredPath(ERROR_ALLOC);
+    }
+
+    char * data = compiled.chars.data;
+    s64 length = compiled.chars.length;
+    JSONPathStep * steps = (JSONPathStep *) compiled.steps.start;
+
+    s64 index = 0;
+    bool expectKey = true;
+    bool isMalformed = false;
+
+    while(index < length && !isMalformed) {
+        JSONPathStep * step = &steps[compiled.stepCount];
+
+        if(data[index] == '[') {
+            index += 1;
+
+            s64 digitsStart = index;
+            s64 element = 0;
+            for(; index < length && char_isDigit(data[index]) && index - digitsStart < 18; ++index) {
+                element = element * 10 + (data[index] - '0');
+            }
+
+            if(index == digitsStart || index >= length || data[index] != ']') {
+                isMalformed = true;
+                break;
+            }
+
+            step->key = str_createEmpty();
+            step->index = element;
+            index += 1;
+        } else {
+            if(!expectKey) {
+                isMalformed = true;
+                break;
+            }
+
+            s64 keyStart = index;
+            while(index < length && data[index] != '.' && data[index] != '[') {
+                index += 1;
+            }
+
+            if(index == keyStart) {
+                isMalformed = true;
+                break;
+            }
+
+            step->key = str_createOfLength(&data[keyStart], index - keyStart);
+            step->index = -1;
+        }
+
+        compiled.stepCount += 1;
+
+        // Keys must be separated by a '.', which must be followed by another key.
+        expectKey = false;
+        if(index < length && data[index] == '.') {
+            index += 1;
+            expectKey = true;
+
+            isMalformed = (index == length || data[index] == '.' || data[index] == '[');
+        }
+    }
+
+    if(isMalformed) {
+        json_destroyPath(&compiled);
+        return json_createErroredPath(ERROR_FORMAT);
+    }
+
+    return compiled;
+}
+
+bool json_isPathErrored(JSONPath path) {
+    return buf_isErrored(path.steps);
+}
+
+CLibErrorType json_getPathErrorType(JSONPath path) {
+    return buf_getErrorType(path.steps);
+}
+
+void json_destroyPath(JSONPath * path) {
+    str_destroy(&path->chars);
+    buf_destroy(&path->steps);
+    path->stepCount = 0;
+}
+
+CLibErrorType json_find(String json, JSONPath path, JSONValue * value) {
+    if(str_isErrored(json) || json_isPathErrored(path))
+        return ERROR_ARG_INVALID;
+
+    char * data = json.data;
+    s64 length = json.length;
+    s64 index = json_skipWhitespaceFrom(data, 0, length);
+
+    JSONPathStep * steps = (JSONPathStep *) path.steps.start;
+
+    for(s64 stepIndex = 0; stepIndex < path.stepCount; ++stepIndex) {
+        JSONPathStep * step = &steps[stepIndex];
+
+        CLibErrorType errorType;
+        if(step->index < 0) {
+            errorType = json_findMember(data, length, &index, step->key);
+        } else {
+            errorType = json_findElement(data, length, &index, step->index);
+        }
+
+        if(errorType != ERROR_SUCCESS)
+            return errorType;
+    }
+
+    if(json_readValue(data, index, length, value) < 0)
+        return ERROR_JSON_SYNTAX;
+
+    return ERROR_SUCCESS;
+}
+
+CLibErrorType json_findC(String json, char * path, JSONValue * value) {
+    if(path == NULL)
+        return ERROR_ARG_NULL;
+
+    JSONPath compiled = json_compilePath(str_create(path));
+    if(json_isPathErrored(compiled))
+        return json_getPathErrorType(compiled);
+
+    CLibErrorType errorType = json_find(json, compiled, value);
+
+    json_destroyPath(&compiled);
+    return errorType;
+}
+
+CLibErrorType json_getValueBool(JSONValue value, bool * result) {
+    if(result == NULL)
+        return ERROR_ARG_NULL;
+    if(value.type != JSON_BOOL)
+        return ERROR_ARG_INVALID;
+
+    *result = (value.chars.data[0] == 't');
+    return ERROR_SUCCESS;
+}
+
+CLibErrorType json_getValueDouble(JSONValue value, double * result) {
+    if(result == NULL)
+        return ERROR_ARG_NULL;
+    if(value.type != JSON_NUMBER)
+        return ERROR_ARG_INVALID;
+
+    return str_parseDouble(value.chars, result);
+}
+
+CLibErrorType json_getValueS64(JSONValue value, s64 * result) {
+    if(result == NULL)
+        return ERROR_ARG_NULL;
+    if(value.type != JSON_NUMBER)
+        return ERROR_ARG_INVALID;
+
+    // Fractions and exponents are not integers, even when their value is whole.
+    for(s64 index = 0; index < value.chars.length; ++index) {
+        char character = value.chars.data[index];
+        if(character == '.' || character == 'e' || character == 'E')
+            return ERROR_CAST;
+    }
+
+    if(str_parseS64(value.chars, result) != ERROR_SUCCESS)
+        return ERROR_CAST;
+
+    return ERROR_SUCCESS;
+}
+
+String json_getValueString(JSONValue value) {
+    if(value.type != JSON_STRING)
+        return str_createErrored(ERROR_ARG_INVALID, 0);
+    if(!value.isEscaped)
+        return str_copy(value.chars);
+
+    String string = str_createUninitialised(value.chars.length);
+    if(str_isErrored(string))
+        return string;
+
+    CLibErrorType errorType;
+    s64 errorIndex;
+
+    s64 unescapedLength = json_unescape(value.chars.data, 0, value.chars.length, string.data, &errorType, &errorIndex);
+    if(unescapedLength < 0) {
+        str_destroy(&string);
+        return str_createErrored(errorType, 0);
+    }
+
+    string.length = unescapedLength;
+    string.data[unescapedLength] = '\0';
+
+    return string;
+}
+
+#ifdef JSON_SIMD_AVX2
+
+/*!
+ * The same as json_findStringSpecial, but checking 32 chars at a time using AVX2. Returns the index of
+ * the first special char, or the index from which fewer than 32 chars are left if there is none before it.
+ */
+__attribute__((target("avx2")))
+static s64 json_findStringSpecialAVX2(char * data, s64 index, s64 length) {
+    __m256i quote = _mm256_set1_epi8('"');
+    __m256i backslash = _mm256_set1_epi8('\\');
+    __m256i lastControl = _mm256_set1_epi8(0x1F);
+
+    for(; length - index >= 32; index += 32) {
+        __m256i chars = _mm256_loadu_si256((__m256i *) &data[index]);
+
+        // A char is at most 0x1F if the unsigned maximum of it and 0x1F is 0x1F.
+        __m256i special = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chars, quote), _mm256_cmpeq_epi8(chars, backslash)),
+            _mm256_cmpeq_epi8(_mm256_max_epu8(chars, lastControl), lastControl));
+
+        u32 mask = (u32) _mm256_movemask_epi8(special);
+        if(mask != 0)
+            return index + __builtin_ctz(mask);
+    }
+
+    return index;
+}
+
+#endif
+
+/*!
+ * Returns the index of the first char in {data} from {index} that must be escaped in a JSON string, or {length} if there is none.
+ */
+static inline s64 json_findEscapeNeeded(char * data, s64 index, s64 length) {
+#ifdef JSON_SIMD_AVX2
+    if(length - index >= 32 && __builtin_cpu_supports("avx2")) {
+        index = json_findStringSpecialAVX2(data, index, length);
+        if(length - index >= 32)
+            return index;
+    }
+#endif
+
+    return json_findStringSpecial(data, index, length);
+}
+
+/*!
+ * Append {string} to {output} as a quoted JSON string, escaping the chars that must be escaped.
+ *
+ * {output} must not use BUILDER_GROWTH_CHUNKED, as the chars are written straight into its buffer.
+ */
+static CLibErrorType json_appendEscaped(Builder * output, String string) {
+    static const char hexDigits[] = "0123456789abcdef";
+
+    char * data = string.data;
+    s64 length = string.length;
+
+    if(output->buffer.size - output->length < length + 2 && builder_ensureCapacity(output, output->length + length + 2) != ERROR_SUCCESS)
+        return ERROR_ALLOC;
+
+    char * destination = &output->buffer.start[output->length];
+    *destination++ = '"';
+
+    s64 index = 0;
+    while(true) {
+        s64 next = json_findEscapeNeeded(data, index, length);
+        if(next > index) {
+            memcpy(destination, &data[index], (size_t) (next - index));
+            destination += next - index;
+        }
+
+        if(next == length)
+            break;
+
+        // Make room for the longest escape, as well as the rest of the string and the closing quote.
+        output->length = destination - output->buffer.start;
+        if(builder_ensureCapacity(output, output->length + 6 + (length - next)) != ERROR_SUCCESS)
+            return ERROR_ALLOC;
+
+        destination = &output->buffer.start[output->length];
+
+        u8 character = (u8) data[next];
+        *destination++ = '\\';
+
+        switch(character) {
+            case '"':
+            case '\\':
+                *destination++ = (char) character;
+                break;
+            case '\b':
+                *destination++ = 'b';
+                break;
+            case '\f':
+                *destination++ = 'f';
+                break;
+            case '\n':
+                *destination++ = 'n';
+                break;
+            case '\r':
+                *destination++ = 'r';
+                break;
+            case '\t':
+                *destination++ = 't';
+                break;
+            default:
+                memcpy(destination, "u00", 3);
+                destination[3] = hexDigits[character >> 4];
+                destination[4] = hexDigits[character & 0xF];
+                destination += 5;
+                break;
+        }
+
+        index = next + 1;
+    }
+
+    *destination++ = '"';
+    output->length = destination - output->buffer.start;
+
+    return ERROR_SUCCESS;
+}
+
+/*!
+ * Record that {writer} failed with {errorType}, and return {errorType}.
+ */
+static CLibErrorType json_writerFail(JSONWriter * writer, CLibErrorType errorType) {
+    writer->error = errorType;
+    return errorType;
+}
+
+/*!
+ * Returns where the next {count} chars of the output of {writer} should be written, growing the output if it
+ * does not have room for them, or NULL if it could not be grown. The chars are added using json_writerAdvance.
+ */
+static inline char * json_writerReserve(JSONWriter * writer, s64 count) {
+    Builder * output = &writer->output;
+
+    // An errored output has a negative size, so it always takes the slow path.
+    if(output->buffer.size - output->length < count && builder_ensureCapacity(output, output->length + count) != ERROR_SUCCESS)
+        return NULL;
+
+    return &output->buffer.start[output->length];
+}
+
+/*!
+ * Add the chars written up to {end} to the output of {writer}.
+ */
+static inline void json_writerAdvance(JSONWriter * writer, char * end) {
+    writer->output.length = end - writer->output.buffer.start;
+}
+
+/*!
+ * Returns whether the innermost open container of {writer} is an object.
+ */
+static inline bool json_writerInObject(JSONWriter * writer) {
+    s64 top = writer->depth - 1;
+    return writer->depth > 0 && ((writer->containers[top >> 6] >> (top & 63)) & 1) != 0;
+}
+
+/*!
+ * Write a line break to {destination}, indented for {depth} levels of nesting, returning the end of what was written.
+ */
+static inline char * json_writerNewLine(JSONWriter * writer, char * destination, s64 depth) {
+    s64 count = depth * writer->indent;
+
+    *destination++ = '\n';
+    memset(destination, ' ', (size_t) count);
+
+    return destination + count;
+}
+
+/*!
+ * Write the separator that comes before the next key or element in the innermost open container
+ * of {writer} to {destination}, returning the end of what was written.
+ *
+ * {destination} must have room for 2 + depth * indent chars.
+ */
+static inline char * json_writerSeparate(JSONWriter * writer, char * destination) {
+    if(!writer->isFirst) {
+        *destination++ = ',';
+    }
+
+    writer->isFirst = false;
+
+    if(writer->indent > 0)
+        return json_writerNewLine(writer, destination, writer->depth);
+
+    return destination;
+}
+
+/*!
+ * Prepare {writer} to write a value of at most {count} chars, writing anything that must come before it.
+ *
+ * Returns where the value should be written, or NULL if {writer} is errored.
+ */
+static char * json_writerStartValue(JSONWriter * writer, s64 count) {
+    if(writer->error != ERROR_NONE)
+        return NULL;
+
+    bool inObject = json_writerInObject(writer);
+    if(inObject && writer->expectKey) {
+        json_writerFail(writer, ERROR_ARG_INVALID);
+        return NULL;
+    }
+
+    char * destination = json_writerReserve(writer, 2 + writer->depth * writer->indent + count);
+    if(destination == NULL) {
+        json_writerFail(writer, ERROR_ALLOC);
+        return NULL;
+    }
+
+    if(writer->depth == 0) {
+        // Top level values are written one per line.
+        if(writer->hasValue) {
+            *destination++ = '\n';
+        }
+
+        writer->hasValue = true;
+    } else if(inObject) {
+        writer->expectKey = true;
+    } else {
+        destination = json_writerSeparate(writer, destination);
+    }
+
+    return destination;
+}
+
+/*!
+ * Write the opening bracket of an array or object to {writer}.
+ */
+static CLibErrorType json_writeStart(JSONWriter * writer, bool isObject) {
+    if(writer->error != ERROR_NONE)
+        return writer->error;
+    if(writer->depth == JSON_MAX_DEPTH)
+        return json_writerFail(writer, ERROR_JSON_DEPTH);
+
+    char * destination = json_writerStartValue(writer, 1);
+    if(destination == NULL)
+        return writer->error;
+
+    *destination++ = (isObject ? '{' : '[');
+    json_writerAdvance(writer, destination);
+
+    u64 bit = 1ULL << (writer->depth & 63);
+    if(isObject) {
+        writer->containers[writer->depth >> 6] |= bit;
+    } else {
+        writer->containers[writer->depth >> 6] &= ~bit;
+    }
+
+    writer->depth += 1;
+    writer->isFirst = true;
+    writer->expectKey = isObject;
+
+    return ERROR_SUCCESS;
+}
+
+/*!
+ * Write the closing bracket of the innermost open container of {writer}, which must be an object if {isObject} is true.
+ */
+static CLibErrorType json_writeEnd(JSONWriter * writer, bool isObject) {
+    if(writer->error != ERROR_NONE)
+        return writer->error;
+
+    // An object cannot be closed between a key and its value.
+    if(writer->depth == 0 || json_writerInObject(writer) != isObject || (isObject && !writer->expectKey))
+        return json_writerFail(writer, ERROR_ARG_INVALID);
+
+    writer->depth -= 1;
+
+    char * destination = json_writerReserve(writer, 2 + writer->depth * writer->indent);
+    if(destination == NULL)
+        return json_writerFail(writer, ERROR_ALLOC);
+
+    if(writer->indent > 0 && !writer->isFirst) {
+        destination = json_writerNewLine(writer, destination, writer->depth);
+    }
+
+    *destination++ = (isObject ? '}' : ']');
+    json_writerAdvance(writer, destination);
+
+    // The container that was closed was a value of its parent.
+    writer->isFirst = false;
+    writer->expectKey = true;
+
+    return ERROR_SUCCESS;
+}
+
+/*!
+ * Append the chars of a literal {chars} to {writer} as a value.
+ */
+static CLibErrorType json_writeScalar(JSONWriter * writer, String chars) {
+    char * destination = json_writerStartValue(writer, chars.length);
+    if(destination == NULL)
+        return writer->error;
+
+    memcpy(destination, chars.data, (size_t) chars.length);
+    json_writerAdvance(writer, destination + chars.length);
+
+    return ERROR_SUCCESS;
+}
+
+JSONWriter json_createWriter(s64 indent) {
+    JSONWriter writer;
+    memset(&writer, 0, sizeof(JSONWriter));
+
+    writer.output = builder_create(0);
+    writer.indent = indent;
+    writer.error = ERROR_NONE;
+
+    if(indent < 0 || indent > JSON_MAX_INDENT) {
+        writer.error = ERROR_ARG_INVALID;
+    }
+
+    return writer;
+}
+
+bool json_isWriterErrored(JSONWriter writer) {
+    return writer.error != ERROR_NONE;
+}
+
+CLibErrorType json_getWriterErrorType(JSONWriter writer) {
+    return writer.error;
+}
+
+String json_writerStr(JSONWriter writer) {
+    if(writer.error != ERROR_NONE)
+        return str_createErrored(writer.error, 0);
+    if(writer.depth > 0)
+        return str_createErrored(ERROR_JSON_SYNTAX, 0);
+
+    return builder_str(writer.output);
+}
+
+void json_resetWriter(JSONWriter * writer) {
+    writer->output.length = 0;
+    writer->depth = 0;
+    writer->isFirst = false;
+    writer->expectKey = false;
+    writer->hasValue = false;
+
+    // Only errors from misuse are cleared, as an errored output cannot be written to again.
+    if(!builder_isErrored(writer->output) && writer->indent >= 0 && writer->indent <= JSON_MAX_INDENT) {
+        writer->error = ERROR_NONE;
+    }
+}
+
+void json_destroyWriter(JSONWriter * writer) {
+    builder_destroy(&writer->output);
+    writer->depth = 0;
+    writer->error = ERROR_FREED;
+}
+
+CLibErrorType json_writeStartObject(JSONWriter * writer) {
+    return json_writeStart(writer, true);
+}
+
+CLibErrorType json_writeEndObject(JSONWriter * writer) {
+    return json_writeEnd(writer, true);
+}
+
+CLibErrorType json_writeStartArray(JSONWriter * writer) {
+    return json_writeStart(writer, false);
+}
+
+CLibErrorType json_writeEndArray(JSONWriter * writer) {
+    return json_writeEnd(writer, false);
+}
+
+CLibErrorType json_writeKey(JSONWriter * writer, String key) {
+    if(writer->error != ERROR_NONE)
+        return writer->error;
+    if(str_isErrored(key) || !json_writerInObject(writer) || !writer->expectKey)
+        return json_writerFail(writer, ERROR_ARG_INVALID);
+
+    char * destination = json_writerReserve(writer, 2 + writer->depth * writer->indent);
+    if(destination == NULL)
+        return json_writerFail(writer, ERROR_ALLOC);
+
+    json_writerAdvance(writer, json_writerSeparate(writer, destination));
+
+    if(json_appendEscaped(&writer->output, key) != ERROR_SUCCESS)
+        return json_writerFail(writer, ERROR_ALLOC);
+
+    destination = json_writerReserve(writer, 2);
+    if(destination == NULL)
+        return json_writerFail(writer, ERROR_ALLOC);
+
+    *destination++ = ':';
+    if(writer->indent > 0) {
+        *destination++ = ' ';
+    }
+
+    json_writerAdvance(writer, destination);
+
+    writer->expectKey = false;
+    return ERROR_SUCCESS;
+}
+
+CLibErrorType json_writeKeyC(JSONWriter * writer, char * key) {
+    if(key == NULL)
+        return json_writerFail(writer, ERROR_ARG_NULL);
+
+    return json_writeKey(writer, str_create(key));
+}
+
+CLibErrorType json_writeString(JSONWriter * writer, String string) {
+    if(writer->error == ERROR_NONE && str_isErrored(string))
+        return json_writerFail(writer, ERROR_ARG_INVALID);
+
+    char * destination = json_writerStartValue(writer, 0);
+    if(destination == NULL)
+        return writer->error;
+
+    json_writerAdvance(writer, destination);
+
+    if(json_appendEscaped(&writer->output, string) != ERROR_SUCCESS)
+        return json_writerFail(writer, ERROR_ALLOC);
+
+    return ERROR_SUCCESS;
+}
+
+CLibErrorType json_writeStringC(JSONWriter * writer, char * string) {
+    if(string == NULL)
+        return json_writerFail(writer, ERROR_ARG_NULL);
+
+    return json_writeString(writer, str_create(string));
+}
+
+CLibErrorType json_writeS64(JSONWriter * writer, s64 value) {
+    char * destination = json_writerStartValue(writer, NUMBER_MAX_INTEGER_CHARS);
+    if(destination == NULL)
+        return writer->error;
+
+    u64 magnitude = (value < 0 ? (u64) 0 - (u64) value : (u64) value);
+    s64 digits = u64_countDigits(magnitude);
+
+    if(value < 0) {
+        *destination++ = '-';
+    }
+
+    u64_writeDigits(magnitude, digits, destination);
+    json_writerAdvance(writer, destination + digits);
+
+    return ERROR_SUCCESS;
+}
+
+CLibErrorType json_writeDouble(JSONWriter * writer, double value) {
+    if(writer->error == ERROR_NONE && !isfinite(value))
+        return json_writerFail(writer, ERROR_ARG_INVALID);
+
+    char * destination = json_writerStartValue(writer, NUMBER_MAX_DOUBLE_CHARS);
+    if(destination == NULL)
+        return writer->error;
+
+    json_writerAdvance(writer, destination + number_writeDouble(value, destination));
+
+    return ERROR_SUCCESS;
+}
+
+CLibErrorType json_writeBool(JSONWriter * writer, bool value) {
+    return json_writeScalar(writer, (value ? str_createOfLength("true", 4) : str_createOfLength("false", 5)));
+}
+
+CLibErrorType json_writeNull(JSONWriter * writer) {
+    return json_writeScalar(writer, str_createOfLength("null", 4));
+}
+
+/*!
+ * Write {node} and all of its children to {writer}, returning the node after them, or NULL if there was an error.
+ */
+static JSONNode * json_writeNodes(JSONWriter * writer, JSONNode * node) {
+    CLibErrorType result;
+    JSONNode * next = node + 1;
+
+    switch((JSONType) node->type) {
+        case JSON_NULL:
+            result = json_writeNull(writer);
+            break;
+        case JSON_BOOL:
+            result = json_writeBool(writer, node->value.boolean);
+            break;
+        case JSON_NUMBER:
+            if(node->flags & JSON_FLAG_INTEGER) {
+                result = json_writeS64(writer, node->value.integer);
+            } else {
+                result = json_writeDouble(writer, node->value.number);
+            }
+            break;
+        case JSON_STRING:
+            result = json_writeString(writer, json_getString(node));
+            break;
+        case JSON_ARRAY:
+        case JSON_OBJECT: {
+            bool isObject = (node->type == JSON_OBJECT);
+
+            result = json_writeStart(writer, isObject);
+            for(s64 index = 0; index < node->length && result == ERROR_SUCCESS; ++index) {
+                if(isObject) {
+                    result = json_writeKey(writer, json_getString(next));
+                    next += 1;
+                }
+
+                if(result == ERROR_SUCCESS) {
+                    next = json_writeNodes(writer, next);
+                    result = (next == NULL ? writer->error : ERROR_SUCCESS);
+                }
+            }
+
+            if(result == ERROR_SUCCESS) {
+                result = json_writeEnd(writer, isObject);
+            }
+            break;
+        }
+        default:
+            result = json_writerFail(writer, ERROR_ARG_INVALID);
+            break;
+    }
+
+    return (result == ERROR_SUCCESS ? next : NULL);
+}
+
+CLibErrorType json_writeNode(JSONWriter * writer, JSONNode * node) {
+    if(node == NULL)
+        return json_writerFail(writer, ERROR_ARG_NULL);
+
+    if(json_writeNodes(writer, node) == NULL)
+        return writer->error;
+
+    return ERROR_SUCCESS;
+}
+
+
+
+//
+// NDJSON
+//
+
+/*!
+ * A line parsed by ndjson_parallelParse that is waiting for the batches before it to be delivered.
+ */
+typedef struct NDJSONRecord {
+    String record;
+    s64 firstNode;
+    s64 nodeCount;
+    CLibErrorType error;
+    s64 errorOffset;
+} NDJSONRecord;
+
+/*!
+ * The state shared by the threads of ndjson_parallelParse.
+ */
+typedef struct NDJSONThreads {
+    String contents;
+    s64 batchCount;
+    bool ordered;
+    NDJSONCallback callback;
+    void * context;
+
+    /*!
+     * The index of the next batch to be parsed.
+     */
+    s64 nextBatch;
+
+    /*!
+     * The index of the next batch to be delivered when {ordered} is true, guarded by {lock}.
+     */
+    s64 deliverBatch;
+    pthread_mutex_t lock;
+    pthread_cond_t delivered;
+} NDJSONThreads;
+
+/*!
+ * The arguments and memory of each thread of ndjson_parallelParse.
+ */
+typedef struct NDJSONThread {
+    NDJSONThreads * state;
+    s64 thread;
+
+    /*!
+     * Holds the nodes and unescaped strings of the lines parsed by this thread, and is cleared for each batch.
+     */
+    JSONDoc doc;
+
+    /*!
+     * The NDJSONRecords of the batch being parsed, when delivering in order.
+     */
+    Buffer records;
+    s64 recordCount;
+} NDJSONThread;
+
+/*!
+ * Returns the index of the first line in {contents} that starts at or after {index}.
+ */
+static s64 ndjson_lineStart(String contents, s64 index) {
+    if(index <= 0)
+        return 0;
+    if(index >= contents.length)
+        return contents.length;
+
+    char * found = memchr(&contents.data[index - 1], '\n', (size_t) (contents.length - index + 1));
+
+    return (found == NULL ? contents.length : (found - contents.data) + 1);
+}
+
+/*!
+ * Returns whether {record} only contains JSON whitespace.
+ */
+static bool ndjson_isBlank(String record) {
+    return json_skipWhitespaceFrom(record.data, 0, record.length) == record.length;
+}
+
+/*!
+ * Call the callback of {thread} with the document of {record}, whose nodes are stored in the doc of {thread}.
+ */
+static void ndjson_deliver(NDJSONThread * thread, NDJSONRecord record) {
+    NDJSONThreads * state = thread->state;
+
+    JSONDoc doc;
+    if(record.error != ERROR_SUCCESS) {
+        doc = json_createErrored(record.error, record.errorOffset);
+    } else {
+        doc.nodes = buf_createUsing(&thread->doc.nodes.start[record.firstNode * (s64) sizeof(JSONNode)],
+                                    record.nodeCount * (s64) sizeof(JSONNode));
+        doc.nodeCount = record.nodeCount;
+        doc.strings = buf_createEmpty();
+        doc.stringsLength = 0;
+        doc.errorOffset = -1;
+    }
+
+    state->callback(doc, record.record, thread->thread, state->context);
+}
+
+/*!
+ * Block until every batch before {batch} has been delivered.
+ */
+static void ndjson_waitForTurn(NDJSONThreads * state, s64 batch) {
+    pthread_mutex_lock(&state->lock);
+
+    while(state->deliverBatch != batch) {
+        pthread_cond_wait(&state->delivered, &state->lock);
+    }
+
+    pthread_mutex_unlock(&state->lock);
+}
+
+/*!
+ * Record that the batch being delivered has finished, allowing the next batch to be delivered.
+ */
+static void ndjson_endTurn(NDJSONThreads * state) {
+    pthread_mutex_lock(&state->lock);
+
+    state->deliverBatch += 1;
+    pthread_cond_broadcast(&state->delivered);
+
+    pthread_mutex_unlock(&state->lock);
+}
+
+/*!
+ * Deliver the {recordCount} records in {records} that were parsed by {thread}, in order.
+ */
+static void ndjson_deliverRecords(NDJSONThread * thread, NDJSONRecord * records, s64 recordCount) {
+    for(s64 index = 0; index < recordCount; ++index) {
+        ndjson_deliver(thread, records[index]);
+    }
+}
+
+/*!
+ * Parse each of the lines in {batch}, and deliver them using {thread}.
+ */
+static void ndjson_parseBatch(NDJSONThread * thread, s64 batch) {
+    NDJSONThreads * state = thread->state;
+    String contents = state->contents;
+
+    s64 start = ndjson_lineStart(contents, batch * NDJSON_BATCH_SIZE);
+    s64 end = ndjson_lineStart(contents, (batch + 1) * NDJSON_BATCH_SIZE);
+
+    // Once the batches before this one have been delivered, each line can be delivered as soon as it is parsed.
+    bool hasTurn = !state->ordered;
+
+    json_clearDoc(&thread->doc);
+
+    while(start < end) {
+        char * found = memchr(&contents.data[start], '\n', (size_t) (end - start));
+        s64 recordEnd = (found == NULL ? end : found - contents.data);
+
+        NDJSONRecord record;
+        record.record = str_createOfLength(&contents.data[start], recordEnd - start);
+
+        start = recordEnd + 1;
+
+        if(ndjson_isBlank(record.record))
+            continue;
+
+        if(hasTurn) {
+            json_clearDoc(&thread->doc);
+        }
+
+        record.firstNode = thread->doc.nodeCount;
+        record.error = json_parseAppend(&thread->doc, record.record, &record.errorOffset);
+        record.nodeCount = thread->doc.nodeCount - record.firstNode;
+
+        if(hasTurn) {
+            ndjson_deliver(thread, record);
+            continue;
+        }
+
+        // A failed realloc leaves the records where they were, so they can still be delivered.
+        Buffer records = thread->records;
+
+        s64 requiredCapacity = (thread->recordCount + 1) * (s64) sizeof(NDJSONRecord);
+        if(buf_ensureCapacity(&thread->records, requiredCapacity) != ERROR_SUCCESS) {
+            // Without the memory to hold the rest of the batch, wait to deliver it as it is parsed instead.
+            ndjson_waitForTurn(state, batch);
+            hasTurn = true;
+
+            ndjson_deliverRecords(thread, (NDJSONRecord *) records.start, thread->recordCount);
+            ndjson_deliver(thread, record);
+
+            buf_destroy(&records);
+            thread->records = buf_createEmpty();
+            thread->recordCount = 0;
+            continue;
+        }
+
+        ((NDJSONRecord *) thread->records.start)[thread->recordCount] = record;
+        thread->recordCount += 1;
+    }
+
+    if(!state->ordered)
+        return;
+
+    if(!hasTurn) {
+        ndjson_waitForTurn(state, batch);
+        ndjson_deliverRecords(thread, (NDJSONRecord *) thread->records.start, thread->recordCount);
+        thread->recordCount = 0;
+    }
+
+    ndjson_endTurn(state);
+}
+
+/*!
+ * The entry point of the threads started by ndjson_parallelParse, which parse batches until there are none left.
+ */
+static void * ndjson_parseThread(void * argument) {
+    NDJSONThread * thread = argument;
+    NDJSONThreads * state = thread->state;
+
+    while(true) {
+        s64 batch = __atomic_fetch_add(&state->nextBatch, 1, __ATOMIC_RELAXED);
+        if(batch >= state->batchCount)
+            break;
+
+        ndjson_parseBatch(thread, batch);
+    }
+
+    return NULL;
+}
+
+CLibErrorType ndjson_parallelParse(char * filename, s64 threads, bool ordered,
+                                   NDJSONCallback callback, void * context) {
+    if(filename == NULL || callback == NULL)
+        return ERROR_ARG_NULL;
+    if(threads < 0)
+        return ERROR_ARG_INVALID;
+
+    if(threads == 0) {
+        threads = max((s64) sysconf(_SC_NPROCESSORS_ONLN), (s64) 1);
+    }
+
+    String contents = file_mapOrRead(filename);
+    if(str_isErrored(contents))
+        return str_getErrorType(contents);
+
+    if(str_isEmpty(contents)) {
+        str_destroy(&contents);
+        return ERROR_SUCCESS;
+    }
+
+    NDJSONThreads state;
+
+    state.contents = contents;
+    state.batchCount = (contents.length - 1) / NDJSON_BATCH_SIZE + 1;
+    state.ordered = ordered;
+    state.callback = callback;
+    state.context = context;
+    state.nextBatch = 0;
+    state.deliverBatch = 0;
+
+    s64 threadCount = min(threads, state.batchCount);
+
+    NDJSONThread * arguments = malloc((size_t) threadCount * sizeof(NDJSONThread));
+    pthread_t * handles = malloc((size_t) threadCount * sizeof(pthread_t));
+
+    if(arguments == NULL || handles == NULL) {
+        free(arguments);
+        free(handles);
+        str_destroy(&contents);
+        return ERROR_ALLOC;
+    }
+
+    pthread_mutex_init(&state.lock, NULL);
+    pthread_cond_init(&state.delivered, NULL);
+
+    for(s64 thread = 0; thread < threadCount; ++thread) {
+        arguments[thread].state = &state;
+        arguments[thread].thread = thread;
+        arguments[thread].doc.nodes = buf_createEmpty();
+        arguments[thread].doc.nodeCount = 0;
+        arguments[thread].doc.strings = buf_createEmpty();
+        arguments[thread].doc.stringsLength = 0;
+        arguments[thread].doc.errorOffset = -1;
+        arguments[thread].records = buf_createEmpty();
+        arguments[thread].recordCount = 0;
+    }
+
+    // The calling thread also parses batches, so this still completes if no threads could be started
+    s64 started = 1;
+    for(; started < threadCount; ++started) {
+        if(pthread_create(&handles[started], NULL, &ndjson_parseThread, &arguments[started]) != 0)
+            break;
+    }
+
+    ndjson_parseThread(&arguments[0]);
+
+    for(s64 thread = 1; thread < started; ++thread) {
+        pthread_join(handles[thread], NULL);
+    }
+
+    for(s64 thread = 0; thread < threadCount; ++thread) {
+        json_destroy(&arguments[thread].doc);
+        buf_destroy(&arguments[thread].records);
+    }
+
+    pthread_mutex_destroy(&state.lock);
+    pthread_cond_destroy(&state.delivered);
+
+    free(arguments);
+    free(handles);
+    str_destroy(&contents);
+
+    return ERROR_SUCCESS;
+}
+
+
+//
+// Queues
+//
+
+/*!
+ * Sleep until the futex {word} is woken, unless it no longer holds {expected}.
+ */
+static void queue_futexWait(u32 * word, u32 expected) {
+#ifdef CLIB_HAS_FUTEX
+    syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+#else
+    (void) word;
+    (void) expected;
+    sched_yield();
+#endif
+}
+
+/*!
+ * Wake all of the threads sleeping on the futex {word}.
+ */
+static void queue_futexWake(u32 * word) {
+#ifdef CLIB_HAS_FUTEX
+    syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+    (void) word;
+#endif
+}
+
+/*!
+ * Wake all of the threads sleeping on {event}, after the change they are waiting for has been published.
+ */
+static inline void queue_notify(QueueEvent * event) {
+    // Orders the change before checking for sleeping threads, pairing with the fence in queue_wait.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if(__atomic_load_n(&event->sleeping, __ATOMIC_RELAXED) == 0
+       || __atomic_exchange_n(&event->sleeping, 0, __ATOMIC_RELAXED) == 0)
+        return;
+
+    __atomic_fetch_add(&event->sequence, 1, __ATOMIC_RELEASE);
+    queue_futexWake(&event->sequence);
+}
+
+/*!
+ * Wait after a failed attempt to use a queue, before the next attempt. Spins for the first QUEUE_SPIN_LIMIT
+ * {attempts}, and then yields, or sleeps on {event} if {waitMode} is QUEUE_WAIT_FUTEX and {isReady} still
+ * returns false for {queue} once this thread is registered as a waiter.
+ */
+static void queue_wait(QueueEvent * event, QueueWaitMode waitMode, s64 * attempts,
+                       bool (*isReady)(void * queue), void * queue) {
+    static s64 spinLimit = 0;
+
+    s64 limit = __atomic_load_n(&spinLimit, __ATOMIC_RELAXED);
+    if(limit == 0) {
+        s64 processors = (s64) sysconf(_SC_NPROCESSORS_ONLN);
+        limit = (processors > 1 ? QUEUE_SPIN_LIMIT : 1);
+        __atomic_store_n(&spinLimit, limit, __ATOMIC_RELAXED);
+    }
+
+    *attempts += 1;
+
+    if(*attempts < limit) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+        return;
+    }
+
+    *attempts = 0;
+
+    if(waitMode != QUEUE_WAIT_FUTEX) {
+        sched_yield();
+        return;
+    }
+
+    u32 sequence = __atomic_load_n(&event->sequence, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&event->sleeping, 1, __ATOMIC_RELAXED);
+
+    // Orders marking the event before checking the queue, pairing with the fence in queue_notify.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    // Any notify after the event was marked changes the sequence, so the futex will not sleep through it.
+    if(!isReady(queue)) {
+        queue_futexWait(&event->sequence, sequence);
+    }
+}
+
+/*!
+ * Returns the number of slots a queue should have to hold {capacity} items, or 0 if it is too large.
+ */
+static s64 queue_slotCount(s64 capacity, s64 slotSize) {
+    s64 slots = s64_nextPowerOf2(capacity);
+    if(slots == 0 || slots > S64_MAX / slotSize)
+        return 0;
+
+    return slots;
+}
+
+/*!
+ * Returns whether the SPSCQueue {argument} has room for a String, or is closed.
+ */
+static bool spsc_hasRoom(void * argument) {
+    SPSCQueue * queue = argument;
+
+    s64 head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+    return queue->tail - head < queue->capacity || __atomic_load_n(&queue->closed, __ATOMIC_ACQUIRE);
+}
+
+/*!
+ * Returns whether the SPSCQueue {argument} has a String in it, or is closed.
+ */
+static bool spsc_hasItems(void * argument) {
+    SPSCQueue * queue = argument;
+
+    s64 tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+    return tail != queue->head || __atomic_load_n(&queue->closed, __ATOMIC_ACQUIRE);
+}
+
+SPSCQueue spsc_create(s64 capacity, QueueWaitMode waitMode) {
+    SPSCQueue queue;
+    memset(&queue, 0, sizeof(SPSCQueue));
+
+    queue.waitMode = waitMode;
+    queue.error = ERROR_NONE;
+
+    if(capacity <= 0) {
+        queue.error = ERROR_ARG_INVALID;
+        return queue;
+    }
+
+    queue.capacity = queue_slotCount(capacity, (s64) sizeof(String));
+    if(queue.capacity == 0) {
+        queue.error = ERROR_OVERFLOW;
+        return queue;
+    }
+
+    queue.slots = malloc((size_t) queue.capacity * sizeof(String));
+    if(queue.slots == NULL) {
+        queue.capacity = 0;
+        queue.error = ERROR_ALLOC;
+    }
+
+    return queue;
+}
+
+bool spsc_isErrored(SPSCQueue queue) {
+    return queue.error != ERROR_NONE;
+}
+
+CLibErrorType spsc_getErrorType(SPSCQueue queue) {
+    return queue.error;
+}
+
+void spsc_destroy(SPSCQueue * queue) {
+    if(queue->error != ERROR_NONE)
+        return;
+
+    for(s64 index = queue->head; index != queue->tail; ++index) {
+        str_destroy(&queue->slots[index & (queue->capacity - 1)]);
+    }
+
+    free(queue->slots);
+    queue->slots = NULL;
+    queue->capacity = 0;
+    queue->head = 0;
+    queue->tail = 0;
+    queue->error = ERROR_FREED;
+}
+
+void spsc_close(SPSCQueue * queue) {
+    __atomic_store_n(&queue->closed, 1, __ATOMIC_RELEASE);
+
+    queue_notify(&queue->pushed);
+    queue_notify(&queue->popped);
+}
+
+s64 spsc_tryPushBatch(SPSCQueue * queue, String * strings, s64 count) {
+    if(count <= 0 || queue->error != ERROR_NONE || __atomic_load_n(&queue->closed, __ATOMIC_RELAXED))
+        return 0;
+
+    s64 tail = queue->tail;
+    s64 room = queue->capacity - (tail - queue->cachedHead);
+
+    if(room < count) {
+        queue->cachedHead = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+        room = queue->capacity - (tail - queue->cachedHead);
+    }
+
+    s64 pushed = (count < room ? count : room);
+    if(pushed == 0)
+        return 0;
+
+    s64 mask = queue->capacity - 1;
+    for(s64 index = 0; index < pushed; ++index) {
+        queue->slots[(tail + index) & mask] = strings[index];
+    }
+
+    __atomic_store_n(&queue->tail, tail + pushed, __ATOMIC_RELEASE);
+    queue_notify(&queue->pushed);
+
+    return pushed;
+}
+
+s64 spsc_pushBatch(SPSCQueue * queue, String * strings, s64 count) {
+    s64 pushed = 0;
+    s64 attempts = 0;
+
+    while(pushed < count && queue->error == ERROR_NONE && !__atomic_load_n(&queue->closed, __ATOMIC_ACQUIRE)) {
+        s64 added = spsc_tryPushBatch(queue, &strings[pushed], count - pushed);
+
+        if(added > 0) {
+            pushed += added;
+            attempts = 0;
+        } else {
+            queue_wait(&queue->popped, queue->waitMode, &attempts, &spsc_hasRoom, queue);
+        }
+    }
+
+    return pushed;
+}
+
+bool spsc_tryPush(SPSCQueue * queue, String string) {
+    return spsc_tryPushBatch(queue, &string, 1) == 1;
+}
+
+CLibErrorType spsc_push(SPSCQueue * queue, String string) {
+    if(queue->error != ERROR_NONE)
+        return ERROR_ARG_INVALID;
+
+    return (spsc_pushBatch(queue, &string, 1) == 1 ? ERROR_SUCCESS : ERROR_QUEUE_CLOSED);
+}
+
+s64 spsc_tryPopBatch(SPSCQueue * queue, String * strings, s64 count) {
+    if(count <= 0 || queue->error != ERROR_NONE)
+        return 0;
+
+    s64 head = queue->head;
+    s64 available = queue->cachedTail - head;
+
+    if(available < count) {
+        queue->cachedTail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+        available = queue->cachedTail - head;
+    }
+
+    s64 popped = (count < available ? count : available);
+    if(popped == 0)
+        return 0;
+
+    s64 mask = queue->capacity - 1;
+    for(s64 index = 0; index < popped; ++index) {
+        strings[index] = queue->slots[(head + index) & mask];
+    }
+
+    __atomic_store_n(&queue->head, head + popped, __ATOMIC_RELEASE);
+    queue_notify(&queue->popped);
+
+    return popped;
+}
+
+s64 spsc_popBatch(SPSCQueue * queue, String * strings, s64 count) {
+    s64 attempts = 0;
+
+    while(count > 0 && queue->error == ERROR_NONE) {
+        // Check whether the queue is closed first, so that Strings pushed before it was closed are still popped.
+        bool closed = __atomic_load_n(&queue->closed, __ATOMIC_ACQUIRE);
+
+        s64 popped = spsc_tryPopBatch(queue, strings, count);
+        if(popped > 0 || closed)
+            return popped;
+
+        queue_wait(&queue->pushed, queue->waitMode, &attempts, &spsc_hasItems, queue);
+    }
+
+    return 0;
+}
+
+bool spsc_tryPop(SPSCQueue * queue, String * string) {
+    return spsc_tryPopBatch(queue, string, 1) == 1;
+}
+
+CLibErrorType spsc_pop(SPSCQueue * queue, String * string) {
+    if(queue->error != ERROR_NONE)
+        return ERROR_ARG_INVALID;
+    if(string == NULL)
+        return ERROR_ARG_NULL;
+
+    return (spsc_popBatch(queue, string, 1) == 1 ? ERROR_SUCCESS : ERROR_QUEUE_CLOSED);
+}
+
+/*!
+ * Returns whether the cell at the next push position of the MPMCQueue {argument} is free, or the queue is closed.
+ */
+static bool mpmc_hasRoom(void * argument) {
+    MPMCQueue * queue = argument;
+
+    s64 position = __atomic_load_n(&queue->pushPosition, __ATOMIC_RELAXED);
+    MPMCCell * cell = &queue->cells[position & (queue->capacity - 1)];
+
+    return __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) >= position
+        || __atomic_load_n(&queue->closed, __ATOMIC_ACQUIRE);
+}
+
+/*!
+ * Returns whether the cell at the next pop position of the MPMCQueue {argument} is full, or the queue is closed.
+ */
+static bool mpmc_hasItems(void * argument) {
+    MPMCQueue * queue = argument;
+
+    s64 position = __atomic_load_n(&queue->popPosition, __ATOMIC_RELAXED);
+    MPMCCell * cell = &queue->cells[position & (queue->capacity - 1)];
+
+    return __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) >= position + 1
+        || __atomic_load_n(&queue->closed, __ATOMIC_ACQUIRE);
+}
+
+/*!
+ * Claim up to {count} consecutive positions in {queue} from {claimPosition}, whose cells have a sequence of the
+ * position plus {offset}. Returns the number claimed, with the first stored in {first}, or 0 if there were none.
+ */
+static s64 mpmc_claim(MPMCQueue * queue, s64 * claimPosition, s64 offset, s64 count, s64 * first) {
+    s64 mask = queue->capacity - 1;
+    s64 position = __atomic_load_n(claimPosition, __ATOMIC_RELAXED);
+
+    if(count > queue->capacity) {
+        count = queue->capacity;
+    }
+
+    while(true) {
+        // Find how many cells from the position are ready, stopping at the first that is not.
+        s64 ready = 0;
+        s64 difference = 0;
+
+        for(; ready < count; ++ready) {
+            MPMCCell * cell = &queue->cells[(position + ready) & mask];
+            difference = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) - (position + ready + offset);
+
+            if(difference != 0)
+                break;
+        }
+
+        if(ready == 0) {
+            // The cell has not been finished with since the last lap, so the queue is full or empty.
+            if(difference < 0)
+                return 0;
+
+            // Another thread claimed the position, so try again from where it left off.
+            position = __atomic_load_n(claimPosition, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        if(__atomic_compare_exchange_n(claimPosition, &position, position + ready, true,
+                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            *first = position;
+            return ready;
+        }
+    }
+}
+
+MPMCQueue mpmc_create(s64 capacity, QueueWaitMode waitMode) {
+    MPMCQueue queue;
+    memset(&queue, 0, sizeof(MPMCQueue));
+
+    queue.waitMode = waitMode;
+    queue.error = ERROR_NONE;
+
+    if(capacity <= 0) {
+        queue.error = ERROR_ARG_INVALID;
+        return queue;
+    }
+
+    // A cell's sequence cannot tell a full queue of one cell from an empty one.
+    queue.capacity = queue_slotCount((capacity < 2 ? 2 : capacity), (s64) sizeof(MPMCCell));
+    if(queue.capacity == 0) {
+        queue.error = ERROR_OVERFLOW;
+        return queue;
+    }
+
+    queue.cells = malloc((size_t) queue.capacity * sizeof(MPMCCell));
+    if(queue.cells == NULL) {
+        queue.capacity = 0;
+        queue.error = ERROR_ALLOC;
+        return queue;
+    }
+
+    for(s64 index = 0; index < queue.capacity; ++index) {
+        queue.cells[index].sequence = index;
+    }
+
+    return queue;
+}
+
+bool mpmc_isErrored(MPMCQueue queue) {
+    return queue.error != ERROR_NONE;
+}
+
+CLibErrorType mpmc_getErrorType(MPMCQueue queue) {
+    return queue.error;
+}
+
+void mpmc_destroy(MPMCQueue * queue) {
+    if(queue->error != ERROR_NONE)
+        return;
+
+    for(s64 position = queue->popPosition; position != queue->pushPosition; ++position) {
+        str_destroy(&queue->cells[position & (queue->capacity - 1)].value);
+    }
+
+    free(queue->cells);
+    queue->cells = NULL;
+    queue->capacity = 0;
+    queue->pushPosition = 0;
+    queue->popPosition = 0;
+    queue->error = ERROR_FREED;
+}
+
+void mpmc_close(MPMCQueue * queue) {
+    __atomic_store_n(&queue->closed, 1, __ATOMIC_RELEASE);
+
+    queue_notify(&queue->pushed);
+    queue_notify(&queue->popped);
+}
+
+s64 mpmc_tryPushBatch(MPMCQueue * queue, String * strings, s64 count) {
+    if(count <= 0 || queue->error != ERROR_NONE || __atomic_load_n(&queue->closed, __ATOMIC_RELAXED))
+        return 0;
+
+    s64 first;
+    s64 pushed = mpmc_claim(queue, &queue->pushPosition, 0, count, &first);
+
+    for(s64 index = 0; index < pushed; ++index) {
+        MPMCCell * cell = &queue->cells[(first + index) & (queue->capacity - 1)];
+
+        cell->value = strings[index];
+        __atomic_store_n(&cell->sequence, first + index + 1, __ATOMIC_RELEASE);
+    }
+
+    if(pushed > 0) {
+        queue_notify(&queue->pushed);
+    }
+
+    return pushed;
+}
+
+s64 mpmc_pushBatch(MPMCQueue * queue, String * strings, s64 count) {
+    s64 pushed = 0;
+    s64 attempts = 0;
+
+    while(pushed < count && queue->error == ERROR_NONE && !__atomic_load_n(&queue->closed, __ATOMIC_ACQUIRE)) {
+        s64 added = mpmc_tryPushBatch(queue, &strings[pushed], count - pushed);
+
+        if(added > 0) {
+            pushed += added;
+            attempts = 0;
+        } else {
+            queue_wait(&queue->popped, queue->waitMode, &attempts, &mpmc_hasRoom, queue);
+        }
+    }
+
+    return pushed;
+}
+
+bool mpmc_tryPush(MPMCQueue * queue, String string) {
+    return mpmc_tryPushBatch(queue, &string, 1) == 1;
+}
+
+CLibErrorType mpmc_push(MPMCQueue * queue, String string) {
+    if(queue->error != ERROR_NONE)
+        return ERROR_ARG_INVALID;
+
+    return (mpmc_pushBatch(queue, &string, 1) == 1 ? ERROR_SUCCESS : ERROR_QUEUE_CLOSED);
+}
+
+s64 mpmc_tryPopBatch(MPMCQueue * queue, String * strings, s64 count) {
+    if(count <= 0 || queue->error != ERROR_NONE)
+        return 0;
+
+    s64 first;
+    s64 popped = mpmc_claim(queue, &queue->popPosition, 1, count, &first);
+
+    for(s64 index = 0; index < popped; ++index) {
+        MPMCCell * cell = &queue->cells[(first + index) & (queue->capacity - 1)];
+
+        strings[index] = cell->value;
+        __atomic_store_n(&cell->sequence, first + index + queue->capacity, __ATOMIC_RELEASE);
+    }
+
+    if(popped > 0) {
+        queue_notify(&queue->popped);
+    }
+
+    return popped;
+}
+
+s64 mpmc_popBatch(MPMCQueue * queue, String * strings, s64 count) {
+    s64 attempts = 0;
+
+    while(count > 0 && queue->error == ERROR_NONE) {
+        bool closed = __atomic_load_n(&queue->closed, __ATOMIC_ACQUIRE);
+
+        s64 popped = mpmc_tryPopBatch(queue, strings, count);
+        if(popped > 0)
+            return popped;
+
+        // Producers may still be filling cells they claimed before the queue was closed.
+        if(closed && __atomic_load_n(&queue->popPosition, __ATOMIC_ACQUIRE) == __atomic_load_n(&queue->pushPosition, __ATOMIC_ACQUIRE))
+            return 0;
+
+        queue_wait(&queue->pushed, queue->waitMode, &attempts, &mpmc_hasItems, queue);
+    }
+
+    return 0;
+}
+
+bool mpmc_tryPop(MPMCQueue * queue, String * string) {
+    return mpmc_tryPopBatch(queue, string, 1) == 1;
+}
+
+CLibErrorType mpmc_pop(MPMCQueue * queue, String * string) {
+    if(queue->error != ERROR_NONE)
+        return ERROR_ARG_INVALID;
+    if(string == NULL)
+        return ERROR_ARG_NULL;
+
+    return (mpmc_popBatch(queue, string, 1) == 1 ? ERROR_SUCCESS : ERROR_QUEUE_CLOSED);
+}
+
+
+
+//
+// Thread Pools
+//
+
+/*!
+ * A task waiting to be run by a ThreadPool. A task with a {rangeFunction} splits its
+ * range in half, spawning the upper half, until it is no larger than its {grain}.
+ */
+typedef struct PoolTask {
+    TaskFunction function;
+    ParallelForFunction rangeFunction;
+    void * context;
+    s64 start;
+    s64 end;
+    s64 grain;
+    TaskGroup * group;
+} PoolTask;
+
+vec_define(PoolTask)
+
+/*!
+ * A worker thread of a ThreadPool, and its Chase-Lev deque of tasks.
+ * The worker pushes and pops tasks at the {bottom}, while other threads steal them from the {top}.
+ */
+typedef struct PoolWorker {
+    struct PoolShared * shared;
+    pthread_t thread;
+    s64 index;
+    bool started;
+    bool pinned;
+
+    char padding0[QUEUE_CACHE_LINE];
+
+    s64 top;
+
+    char padding1[QUEUE_CACHE_LINE];
+
+    s64 bottom;
+
+    PoolTask tasks[POOL_DEQUE_CAPACITY];
+} PoolWorker;
+
+/*!
+ * The state of a ThreadPool shared by its workers.
+ */
+typedef struct PoolShared {
+    PoolWorker * workers;
+    s64 threads;
+    u32 stopping;
+
+    /*!
+     * Notified when tasks are spawned, when a TaskGroup finishes, and when the pool is stopping.
+     */
+    QueueEvent changed;
+
+    /*!
+     * Tasks spawned by threads that are not workers, taken in the order they were spawned from {queuedHead}.
+     */
+    pthread_mutex_t queuedMutex;
+    Vec(PoolTask) queued;
+    s64 queuedHead;
+    s64 queuedCount;
+} PoolShared;
+
+/*!
+ * The worker that is running on this thread, or NULL if this thread is not a worker.
+ */
+static __thread PoolWorker * pool_currentWorker = NULL;
+
+/*!
+ * The state of the xorshift generator this thread uses to pick which workers to steal from.
+ */
+static __thread u64 pool_random = 0;
+
+static void pool_runTask(PoolShared * shared, PoolTask task);
+
+/*!
+ * Copy {task} into the deque slot {slot}, which may be read by thieves at the same time.
+ */
+static inline void pool_storeTask(PoolTask * slot, PoolTask task) {
+    __atomic_store_n(&slot->function, task.function, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->rangeFunction, task.rangeFunction, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->context, task.context, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->start, task.start, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->end, task.end, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->grain, task.grain, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->group, task.group, __ATOMIC_RELAXED);
+}
+
+/*!
+ * Copy the task in the deque slot {slot}, which may be written by its worker at the same time.
+ * The copy is only used if claiming the slot afterwards succeeds, at which point it cannot have changed.
+ */
+static inline PoolTask pool_loadTask(PoolTask * slot) {
+    PoolTask task;
+
+    task.function = __atomic_load_n(&slot->function, __ATOMIC_RELAXED);
+    task.rangeFunction = __atomic_load_n(&slot->rangeFunction, __ATOMIC_RELAXED);
+    task.context = __atomic_load_n(&slot->context, __ATOMIC_RELAXED);
+    task.start = __atomic_load_n(&slot->start, __ATOMIC_RELAXED);
+    task.end = __atomic_load_n(&slot->end, __ATOMIC_RELAXED);
+    task.grain = __atomic_load_n(&slot->grain, __ATOMIC_RELAXED);
+    task.group = __atomic_load_n(&slot->group, __ATOMIC_RELAXED);
+
+    return task;
+}
+
+/*!
+ * Push {task} onto the bottom of the deque of {worker}. Returns false if the deque is full.
+ */
+static bool pool_pushTask(PoolWorker * worker, PoolTask task) {
+    s64 bottom = __atomic_load_n(&worker->bottom, __ATOMIC_RELAXED);
+    s64 top = __atomic_load_n(&worker->top, __ATOMIC_ACQUIRE);
+
+    if(bottom - top >= POOL_DEQUE_CAPACITY)
+        return false;
+
+    pool_storeTask(&worker->tasks[bottom & (POOL_DEQUE_CAPACITY - 1)], task);
+
+    __atomic_store_n(&worker->bottom, bottom + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/*!
+ * Pop the most recently pushed task from the bottom of the deque of {worker} into {task}.
+ * Returns false if the deque is empty, or its last task was stolen first.
+ */
+static bool pool_popTask(PoolWorker * worker, PoolTask * task) {
+    s64 bottom = __atomic_load_n(&worker->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&worker->bottom, bottom, __ATOMIC_RELAXED);
+
+    // Orders taking the slot before checking whether a thief has taken it, pairing with the fence in pool_stealTask.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    s64 top = __atomic_load_n(&worker->top, __ATOMIC_RELAXED);
+
+    if(top > bottom) {
+        __atomic_store_n(&worker->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    *task = pool_loadTask(&worker->tasks[bottom & (POOL_DEQUE_CAPACITY - 1)]);
+
+    if(top < bottom)
+        return true;
+
+    // This is the last task, so race any thieves for it.
+    bool taken = __atomic_compare_exchange_n(&worker->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+    __atomic_store_n(&worker->bottom, bottom + 1, __ATOMIC_RELAXED);
+
+    return taken;
+}
+
+/*!
+ * Steal the oldest task from the top of the deque of {worker} into {task}.
+ * Returns false if the deque is empty, or another thread took the task first.
+ */
+static bool pool_stealTask(PoolWorker * worker, PoolTask * task) {
+    s64 top = __atomic_load_n(&worker->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    s64 bottom = __atomic_load_n(&worker->bottom, __ATOMIC_ACQUIRE);
+
+    if(top >= bottom)
+        return false;
+
+    *task = pool_loadTask(&worker->tasks[top & (POOL_DEQUE_CAPACITY - 1)]);
+
+    return __atomic_compare_exchange_n(&worker->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+/*!
+ * Add {task} to the tasks queued by threads that are not workers. Returns false if there was no room for it.
+ */
+static bool pool_queueTask(PoolShared * shared, PoolTask task) {
+    pthread_mutex_lock(&shared->queuedMutex);
+
+    // Reclaim the room used by tasks that have been taken before growing the queue.
+    if(shared->queuedHead > 0 && shared->queued.length == Vec_PoolTask_capacity(shared->queued)) {
+        Vec_PoolTask_erase(&shared->queued, 0, shared->queuedHead);
+        shared->queuedHead = 0;
+    }
+
+    bool queued = (Vec_PoolTask_push(&shared->queued, task) == ERROR_SUCCESS);
+    if(queued) {
+        __atomic_add_fetch(&shared->queuedCount, 1, __ATOMIC_RELAXED);
+    }
+
+    pthread_mutex_unlock(&shared->queuedMutex);
+    return queued;
+}
+
+/*!
+ * Take the oldest of the tasks queued by threads that are not workers into {task}. Returns false if there are none.
+ */
+static bool pool_takeQueuedTask(PoolShared * shared, PoolTask * task) {
+    if(__atomic_load_n(&shared->queuedCount, __ATOMIC_RELAXED) == 0)
+        return false;
+
+    pthread_mutex_lock(&shared->queuedMutex);
+
+    bool taken = (shared->queuedHead < shared->queued.length);
+    if(taken) {
+        *task = shared->queued.items[shared->queuedHead];
+        shared->queuedHead += 1;
+        __atomic_sub_fetch(&shared->queuedCount, 1, __ATOMIC_RELAXED);
+
+        if(shared->queuedHead == shared->queued.length) {
+            shared->queued.length = 0;
+            shared->queuedHead = 0;
+        }
+    }
+
+    pthread_mutex_unlock(&shared->queuedMutex);
+    return taken;
+}
+
+/*!
+ * Find a task for the thread running {worker}, which is NULL for threads that are not workers, to run.
+ * Tries the worker's own deque first, then the queued tasks, and then steals from the other workers.
+ */
+static bool pool_findTask(PoolShared * shared, PoolWorker * worker, PoolTask * task) {
+    if(worker != NULL && pool_popTask(worker, task))
+        return true;
+
+    if(pool_takeQueuedTask(shared, task))
+        return true;
+
+    u64 random = (pool_random != 0 ? pool_random : (u64) (uintptr_t) &pool_random);
+    random ^= random << 13;
+    random ^= random >> 7;
+    random ^= random << 17;
+    pool_random = random;
+
+    s64 first = (s64) (random % (u64) shared->threads);
+    for(s64 offset = 0; offset < shared->threads; ++offset) {
+        PoolWorker * victim = &shared->workers[(first + offset) % shared->threads];
+
+        if(victim != worker && pool_stealTask(victim, task))
+            return true;
+    }
+
+    return false;
+}
+
+/*!
+ * Returns whether any tasks are waiting to be run in {shared}.
+ */
+static bool pool_hasTasks(PoolShared * shared) {
+    if(__atomic_load_n(&shared->queuedCount, __ATOMIC_RELAXED) > 0)
+        return true;
+
+    for(s64 index = 0; index < shared->threads; ++index) {
+        PoolWorker * worker = &shared->workers[index];
+
+        if(__atomic_load_n(&worker->bottom, __ATOMIC_RELAXED) > __atomic_load_n(&worker->top, __ATOMIC_RELAXED))
+            return true;
+    }
+
+    return false;
+}
+
+/*!
+ * Returns whether the worker {argument} has tasks to run, or should stop.
+ */
+static bool pool_isWorkerReady(void * argument) {
+    PoolWorker * worker = argument;
+
+    return __atomic_load_n(&worker->shared->stopping, __ATOMIC_ACQUIRE) || pool_hasTasks(worker->shared);
+}
+
+/*!
+ * Returns whether the TaskGroup {argument} has finished, or there are tasks to run while waiting for it.
+ */
+static bool taskgroup_isReady(void * argument) {
+    TaskGroup * group = argument;
+
+    return __atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) == 0 || pool_hasTasks(group->shared);
+}
+
+/*!
+ * Spawn {task} in {shared}, after adding it to its group. Runs the task straight away if it can't be queued.
+ */
+static void pool_spawnTask(PoolShared * shared, PoolTask task) {
+    __atomic_add_fetch(&task.group->pending, 1, __ATOMIC_RELAXED);
+
+    PoolWorker * worker = pool_currentWorker;
+    bool spawned;
+
+    if(worker != NULL && worker->shared == shared) {
+        spawned = pool_pushTask(worker, task);
+    } else {
+        spawned = pool_queueTask(shared, task);
+    }
+
+    if(spawned) {
+        queue_notify(&shared->changed);
+    } else {
+        pool_runTask(shared, task);
+    }
+}
+
+/*!
+ * Mark one of the tasks in {group} as finished, waking the threads waiting for it if it was the last.
+ */
+static void taskgroup_finishTask(PoolShared * shared, TaskGroup * group) {
+    // The group may no longer exist once the last task has finished, so only the pool is used after.
+    if(__atomic_sub_fetch(&group->pending, 1, __ATOMIC_ACQ_REL) == 0 && shared != NULL) {
+        queue_notify(&shared->changed);
+    }
+}
+
+static void pool_runTask(PoolShared * shared, PoolTask task) {
+    if(task.rangeFunction != NULL) {
+        while(task.end - task.start > task.grain) {
+            PoolTask upper = task;
+            upper.start = task.start + (task.end - task.start) / 2;
+            task.end = upper.start;
+
+            if(shared != NULL) {
+                pool_spawnTask(shared, upper);
+            } else {
+                __atomic_add_fetch(&task.group->pending, 1, __ATOMIC_RELAXED);
+                pool_runTask(shared, upper);
+            }
+        }
+
+        task.rangeFunction(task.start, task.end, task.context);
+    } else {
+        task.function(task.context);
+    }
+
+    taskgroup_finishTask(shared, task.group);
+}
+
+/*!
+ * Pin the calling thread to processor {index}, modulo the number of processors.
+ */
+static void pool_pinThread(s64 index) {
+#ifdef __linux__
+    s64 processors = max((s64) sysconf(_SC_NPROCESSORS_ONLN), (s64) 1);
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET((int) (index % min(processors, (s64) CPU_SETSIZE)), &set);
+
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set);
+#else
+    (void) index;
+#endif
+}
+
+/*!
+ * Run tasks on the worker {argument}, sleeping while there are none, until its pool is stopped.
+ */
+static void * pool_workerThread(void * argument) {
+    PoolWorker * worker = argument;
+    PoolShared * shared = worker->shared;
+
+    pool_currentWorker = worker;
+
+    if(worker->pinned) {
+        pool_pinThread(worker->index);
+    }
+
+    s64 attempts = 0;
+    while(!__atomic_load_n(&shared->stopping, __ATOMIC_ACQUIRE)) {
+        PoolTask task;
+
+        if(pool_findTask(shared, worker, &task)) {
+            pool_runTask(shared, task);
+            attempts = 0;
+        } else {
+            queue_wait(&shared->changed, QUEUE_WAIT_FUTEX, &attempts, &pool_isWorkerReady, worker);
+        }
+    }
+
+    return NULL;
+}
+
+ThreadPool pool_create(s64 threads, bool pinned) {
+    ThreadPool pool;
+    pool.shared = NULL;
+    pool.threads = 0;
+    pool.error = ERROR_NONE;
+
+    if(threads < 0) {
+        pool.error = ERROR_ARG_INVALID;
+        return pool;
+    }
+
+    if(threads == 0) {
+        threads = max((s64) sysconf(_SC_NPROCESSORS_ONLN), (s64) 1);
+    }
+
+    PoolShared * shared = calloc(1, sizeof(PoolShared));
+    PoolWorker * workers = (threads <= S64_MAX / (s64) sizeof(PoolWorker) ? calloc((size_t) threads, sizeof(PoolWorker)) : NULL);
+
+    if(shared == NULL || workers == NULL) {
+        free(shared);
+        free(workers);
+        pool.error = ERROR_ALLOC;
+        return pool;
+    }
+
+    shared->workers = workers;
+    shared->threads = threads;
+    shared->queued = Vec_PoolTask_create(0);
+    pthread_mutex_init(&shared->queuedMutex, NULL);
+
+    for(s64 index = 0; index < threads; ++index) {
+        PoolWorker * worker = &workers[index];
+
+        worker->shared = shared;
+        worker->index = index;
+        worker->pinned = pinned;
+    }
+
+    // Workers that fail to start keep empty deques, so the other workers can still look through them.
+    for(s64 index = 0; index < threads; ++index) {
+        PoolWorker * worker = &workers[index];
+
+        worker->started = (pthread_create(&worker->thread, NULL, &pool_workerThread, worker) == 0);
+    }
+
+    pool.shared = shared;
+    pool.threads = threads;
+    return pool;
+}
+
+bool pool_isErrored(ThreadPool pool) {
+    return pool.error != ERROR_NONE;
+}
+
+CLibErrorType pool_getErrorType(ThreadPool pool) {
+    return pool.error;
+}
+
+void pool_destroy(ThreadPool * pool) {
+    if(pool->error != ERROR_NONE)
+        return;
+
+    PoolShared * shared = pool->shared;
+
+    __atomic_store_n(&shared->stopping, 1, __ATOMIC_RELEASE);
+    queue_notify(&shared->changed);
+
+    for(s64 index = 0; index < shared->threads; ++index) {
+        if(shared->workers[index].started) {
+            pthread_join(shared->workers[index].thread, NULL);
+        }
+    }
+
+    Vec_PoolTask_destroy(&shared->queued);
+    pthread_mutex_destroy(&shared->queuedMutex);
+    free(shared->workers);
+    free(shared);
+
+    pool->shared = NULL;
+    pool->threads = 0;
+    pool->error = ERROR_FREED;
+}
+
+TaskGroup taskgroup_create(ThreadPool pool) {
+    TaskGroup group;
+    group.shared = (pool.error == ERROR_NONE ? pool.shared : NULL);
+    group.pending = 0;
+    return group;
+}
+
+void taskgroup_run(TaskGroup * group, TaskFunction function, void * context) {
+    PoolTask task;
+    memset(&task, 0, sizeof(PoolTask));
+
+    task.function = function;
+    task.context = context;
+    task.group = group;
+
+    if(group->shared != NULL) {
+        pool_spawnTask(group->shared, task);
+    } else {
+        __atomic_add_fetch(&group->pending, 1, __ATOMIC_RELAXED);
+        pool_runTask(NULL, task);
+    }
+}
+
+void taskgroup_wait(TaskGroup * group) {
+    PoolShared * shared = group->shared;
+    PoolWorker * worker = pool_currentWorker;
+
+    if(worker != NULL && worker->shared != shared) {
+        worker = NULL;
+    }
+
+    s64 attempts = 0;
+    while(__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) > 0) {
+        PoolTask task;
+
+        if(pool_findTask(shared, worker, &task)) {
+            pool_runTask(shared, task);
+            attempts = 0;
+        } else {
+            queue_wait(&shared->changed, QUEUE_WAIT_FUTEX, &attempts, &taskgroup_isReady, group);
+        }
+    }
+}
+
+CLibErrorType parallel_for(ThreadPool pool, s64 begin, s64 end, s64 grain, ParallelForFunction function, void * context) {
+    if(pool.error != ERROR_NONE)
+        return ERROR_ARG_INVALID;
+    if(begin >= end)
+        return ERROR_SUCCESS;
+
+    if(grain <= 0) {
+        grain = max((end - begin) / (8 * (pool.threads + 1)), (s64) 1);
+    }
+
+    TaskGroup group = taskgroup_create(pool);
+
+    PoolTask task;
+    task.function = NULL;
+    task.rangeFunction = function;
+    task.context = context;
+    task.start = begin;
+    task.end = end;
+    task.grain = grain;
+    task.group = &group;
+
+    // The calling thread takes the first part of the range itself, and helps with the rest while it waits.
+    __atomic_add_fetch(&group.pending, 1, __ATOMIC_RELAXED);
+    pool_runTask(pool.shared, task);
+    taskgroup_wait(&group);
+
+    return ERROR_SUCCESS;
+}
+
+/*!
+ * The shared state of a u64_parallelSort, which sorts runs of {width} values and then merges pairs of runs.
+ */
+typedef struct ParallelSort {
+    u64 * array;
+    u64 * buffer;
+    u64 length;
+    u64 width;
+} ParallelSort;
+
+/*!
+ * Sort the runs with indices in [{start}, {end}) of the ParallelSort {context}.
+ */
+static void u64_parallelSortRuns(s64 start, s64 end, void * context) {
+    ParallelSort * sort = context;
+
+    for(u64 run = (u64) start; run < (u64) end; ++run) {
+        u64 left = run * sort->width;
+        u64 length = min(sort->width, sort->length - left);
+
+        u64_mergeSort_withBuffer(&sort->array[left], &sort->buffer[left], length);
+    }
+}
+
+/*!
+ * Merge the pairs of runs with indices in [{start}, {end}) of the ParallelSort {context}.
+ */
+static void u64_parallelMergeRuns(s64 start, s64 end, void * context) {
+    ParallelSort * sort = context;
+
+    for(u64 pair = (u64) start; pair < (u64) end; ++pair) {
+        u64 left = pair * 2 * sort->width;
+        u64 middle = left + sort->width;
+
+        if(middle < sort->length) {
+            u64_merge(sort->array, sort->buffer, left, middle, min(middle + sort->width, sort->length) - 1);
+        }
+    }
+}
+
+bool u64_parallelSort(ThreadPool pool, u64 * array, u64 length) {
+    if(length < 2)
+        return true;
+    if(pool.error != ERROR_NONE)
+        return u64_mergeSort(array, length);
+
+    ParallelSort sort;
+    sort.array = array;
+    sort.length = length;
+    sort.buffer = malloc(length * sizeof(u64));
+
+    if(sort.buffer == NULL)
+        return false;
+
+    // Give each thread a few runs to sort, so that threads that finish early can steal the rest.
+    sort.width = max(length / (u64) (4 * (pool.threads + 1)), (u64) 1024);
+    u64 runs = (length + sort.width - 1) / sort.width;
+
+    parallel_for(pool, 0, (s64) runs, 1, &u64_parallelSortRuns, &sort);
+
+    while(runs > 1) {
+        runs = (runs + 1) / 2;
+        parallel_for(pool, 0, (s64) runs, 1, &u64_parallelMergeRuns, &sort);
+        sort.width *= 2;
+    }
+
+    free(sort.buffer);
+    return true;
+}
+
+/*!
+ * The shared state of a str_parallelIndexOfChar, where {index} is the lowest index of {find} found so far.
+ */
+typedef struct ParallelIndexOf {
+    String string;
+    char find;
+    s64 index;
+} ParallelIndexOf;
+
+/*!
+ * Search for the first {find} in [{start}, {end}) of the string of the ParallelIndexOf {context}.
+ */
+static void str_parallelIndexOfRange(s64 start, s64 end, void * context) {
+    ParallelIndexOf * search = context;
+
+    // Parts after a match that has already been found cannot hold the first match.
+    s64 found = __atomic_load_n(&search->index, __ATOMIC_RELAXED);
+    if(found >= 0 && found < start)
+        return;
+
+    char * match = memchr(&search->string.data[start], search->find, (size_t) (end - start));
+    if(match == NULL)
+        return;
+
+    s64 index = match - search->string.data;
+    while(found < 0 || index < found) {
+        if(__atomic_compare_exchange_n(&search->index, &found, index, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            return;
+    }
+}
+
+s64 str_parallelIndexOfChar(ThreadPool pool, String string, char find) {
+    if(pool.error != ERROR_NONE || str_isErrored(string))
+        return str_indexOfChar(string, find);
+
+    ParallelIndexOf search;
+    search.string = string;
+    search.find = find;
+    search.index = -1;
+
+    parallel_for(pool, 0, string.length, 256 * 1024, &str_parallelIndexOfRange, &search);
+
+    return search.index;
+}
+
+
+
+//
+// Concurrent Maps
+//
+
+/*!
+ * The number of entries each shard of a ConcurrentMap starts with room for.
+ */
+#define CMAP_INITIAL_CAPACITY 16
+
+/*!
+ * The longest key that is stored in its entry, rather than in its own allocation.
+ */
+#define CMAP_INLINE_KEY 16
+
+/*!
+ * A key in a ConcurrentMap and its value. The {hash} is 0 for empty entries, and is written last,
+ * so readers that see the hash also see the rest of the entry.
+ */
+typedef struct MapEntry {
+    u64 hash;
+    u64 value;
+    s64 length;
+
+    union {
+        char * data;
+        char chars[CMAP_INLINE_KEY];
+    };
+} MapEntry;
+
+/*!
+ * An open addressing table of entries, using linear probing.
+ */
+typedef struct MapTable {
+    s64 capacity;
+    MapEntry * entries;
+
+    /*!
+     * The table this replaced when its shard grew, kept until the map is destroyed for readers still using it.
+     */
+    struct MapTable * retired;
+} MapTable;
+
+/*!
+ * A shard of a ConcurrentMap, whose {table} is only changed while holding {mutex}.
+ */
+typedef struct MapShard {
+    pthread_mutex_t mutex;
+    MapTable * table;
+    s64 count;
+
+    char padding[QUEUE_CACHE_LINE];
+} MapShard;
+
+/*!
+ * Returns the hash used for {key} in {map}. Hashes are never 0, which marks an empty slot.
+ */
+static inline u64 cmap_hash(ConcurrentMap * map, String key) {
+    u64 hash = str_hash(key, map->seed);
+    return (hash == 0 ? 1 : hash);
+}
+
+/*!
+ * Returns the shard of {map} that holds keys with {hash}, using the high bits that slots do not use.
+ */
+static inline MapShard * cmap_shard(ConcurrentMap * map, u64 hash) {
+    return &map->shards[(s64) (hash >> 40) & (map->shardCount - 1)];
+}
+
+/*!
+ * Allocate an empty MapTable with room for {capacity} slots. Returns NULL if it could not be allocated.
+ */
+static MapTable * cmap_createTable(s64 capacity) {
+    if(capacity > (S64_MAX - (s64) sizeof(MapTable)) / (s64) sizeof(MapEntry))
+        return NULL;
+
+    MapTable * table = calloc(1, sizeof(MapTable) + (size_t) capacity * sizeof(MapEntry));
+    if(table == NULL)
+        return NULL;
+
+    table->capacity = capacity;
+    table->entries = (MapEntry *) (table + 1);
+    table->retired = NULL;
+
+    return table;
+}
+
+/*!
+ * Returns the chars of the key of {entry}.
+ */
+static inline char * cmap_entryData(MapEntry * entry) {
+    return (entry->length <= CMAP_INLINE_KEY ? entry->chars : entry->data);
+}
+
+/*!
+ * Returns a view of the key of {entry}.
+ */
+static inline String cmap_entryKey(MapEntry * entry) {
+    String key;
+    key.data = (entry->length > 0 ? cmap_entryData(entry) : NULL);
+    key.length = entry->length;
+    key.flags = 0;
+    return key;
+}
+
+/*!
+ * Find the entry for {key} with {hash} in {table}. Returns NULL if it is not in {table}.
+ * May be used while other threads add entries to {table}.
+ */
+static MapEntry * cmap_findEntry(MapTable * table, u64 hash, String key) {
+    s64 mask = table->capacity - 1;
+
+    for(s64 index = (s64) hash & mask; ; index = (index + 1) & mask) {
+        MapEntry * entry = &table->entries[index];
+        u64 entryHash = __atomic_load_n(&entry->hash, __ATOMIC_ACQUIRE);
+
+        if(entryHash == 0)
+            return NULL;
+
+        if(entryHash == hash && entry->length == key.length
+           && (key.length == 0 || memcmp(cmap_entryData(entry), key.data, (size_t) key.length) == 0))
+            return entry;
+    }
+}
+
+/*!
+ * Copy {entry} to an empty slot in {table}, which must have one.
+ * Must only be called while holding the lock of the shard that owns {table}.
+ */
+static void cmap_addEntry(MapTable * table, MapEntry * entry) {
+    s64 mask = table->capacity - 1;
+    s64 index = (s64) entry->hash & mask;
+
+    while(table->entries[index].hash != 0) {
+        index = (index + 1) & mask;
+    }
+
+    MapEntry * slot = &table->entries[index];
+
+    slot->value = entry->value;
+    slot->length = entry->length;
+    memcpy(slot->chars, entry->chars, CMAP_INLINE_KEY);
+    __atomic_store_n(&slot->hash, entry->hash, __ATOMIC_RELEASE);
+}
+
+/*!
+ * Make sure that {shard} has room for another entry, moving its entries to a table twice the size if not.
+ * Must only be called while holding the lock of {shard}. Returns false if the new table could not be allocated.
+ */
+static bool cmap_reserveEntry(MapShard * shard) {
+    MapTable * table = shard->table;
+
+    // Keep the table at most three quarters full, so that probes stay short and always find an empty slot.
+    if((shard->count + 1) * 4 <= table->capacity * 3)
+        return true;
+
+    MapTable * grown = (table->capacity <= S64_MAX / 2 ? cmap_createTable(table->capacity * 2) : NULL);
+    if(grown == NULL)
+        return false;
+
+    for(s64 index = 0; index < table->capacity; ++index) {
+        if(table->entries[index].hash != 0) {
+            cmap_addEntry(grown, &table->entries[index]);
+        }
+    }
+
+    grown->retired = table;
+    __atomic_store_n(&shard->table, grown, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/*!
+ * Add an entry for {key} with {hash} and {value} to {shard}, copying {key}.
+ * Must only be called while holding the lock of {shard}, once {key} is known not to be in it.
+ */
+static CLibErrorType cmap_insertEntry(MapShard * shard, u64 hash, String key, u64 value) {
+    if(!cmap_reserveEntry(shard))
+        return ERROR_ALLOC;
+
+    MapEntry entry;
+    entry.hash = hash;
+    entry.value = value;
+    entry.length = key.length;
+
+    if(key.length <= CMAP_INLINE_KEY) {
+        memset(entry.chars, 0, CMAP_INLINE_KEY);
+        if(key.length > 0) {
+            memcpy(entry.chars, key.data, (size_t) key.length);
+        }
+    } else {
+        entry.data = malloc((size_t) key.length);
+        if(entry.data == NULL)
+            return ERROR_ALLOC;
+
+        memcpy(entry.data, key.data, (size_t) key.length);
+    }
+
+    cmap_addEntry(shard->table, &entry);
+    __atomic_store_n(&shard->count, shard->count + 1, __ATOMIC_RELAXED);
+
+    return ERROR_SUCCESS;
+}
+
+ConcurrentMap cmap_create(s64 shards, u64 seed) {
+    ConcurrentMap map;
+    map.shards = NULL;
+    map.shardCount = 0;
+    map.seed = seed;
+    map.error = ERROR_NONE;
+
+    if(shards < 0 || shards > CMAP_MAX_SHARDS) {
+        map.error = ERROR_ARG_INVALID;
+        return map;
+    }
+
+    if(shards == 0) {
+        shards = min(4 * max((s64) sysconf(_SC_NPROCESSORS_ONLN), (s64) 1), CMAP_MAX_SHARDS);
+    }
+
+    map.shardCount = s64_nextPowerOf2(shards);
+    map.shards = calloc((size_t) map.shardCount, sizeof(MapShard));
+    if(map.shards == NULL) {
+        map.shardCount = 0;
+        map.error = ERROR_ALLOC;
+        return map;
+    }
+
+    for(s64 index = 0; index < map.shardCount; ++index) {
+        MapShard * shard = &map.shards[index];
+
+        shard->table = cmap_createTable(CMAP_INITIAL_CAPACITY);
+        if(shard->table == NULL) {
+            map.shardCount = index;
+            cmap_destroy(&map);
+
+            map.error = ERROR_ALLOC;
+            return map;
+        }
+
+        pthread_mutex_init(&shard->mutex, NULL);
+    }
+
+    return map;
+}
+
+bool cmap_isErrored(ConcurrentMap map) {
+    return map.error != ERROR_NONE;
+}
+
+CLibErrorType cmap_getErrorType(ConcurrentMap map) {
+    return map.error;
+}
+
+void cmap_destroy(ConcurrentMap * map) {
+    if(map->error != ERROR_NONE)
+        return;
+
+    for(s64 index = 0; index < map->shardCount; ++index) {
+        MapShard * shard = &map->shards[index];
+        MapTable * table = shard->table;
+
+        // Retired tables share the keys that are not stored inline with the current table.
+        for(s64 slot = 0; slot < table->capacity; ++slot) {
+            MapEntry * entry = &table->entries[slot];
+
+            if(entry->hash != 0 && entry->length > CMAP_INLINE_KEY) {
+                free(entry->data);
+            }
+        }
+
+        while(table != NULL) {
+            MapTable * retired = table->retired;
+            free(table);
+            table = retired;
+        }
+
+        pthread_mutex_destroy(&shard->mutex);
+    }
+
+    free(map->shards);
+    map->shards = NULL;
+    map->shardCount = 0;
+    map->error = ERROR_FREED;
+}
+
+s64 cmap_count(ConcurrentMap map) {
+    s64 count = 0;
+
+    for(s64 index = 0; index < map.shardCount; ++index) {
+        count += __atomic_load_n(&map.shards[index].count, __ATOMIC_RELAXED);
+    }
+
+    return count;
+}
+
+bool cmap_get(ConcurrentMap map, String key, u64 * value) {
+    if(map.error != ERROR_NONE || str_isErrored(key))
+        return false;
+
+    u64 hash = cmap_hash(&map, key);
+    MapTable * table = __atomic_load_n(&cmap_shard(&map, hash)->table, __ATOMIC_ACQUIRE);
+
+    MapEntry * entry = cmap_findEntry(table, hash, key);
+    if(entry == NULL)
+        return false;
+
+    if(value != NULL) {
+        *value = __atomic_load_n(&entry->value, __ATOMIC_RELAXED);
+    }
+
+    return true;
+}
+
+CLibErrorType cmap_insertIfAbsent(ConcurrentMap * map, String key, u64 value, u64 * current) {
+    if(map->error != ERROR_NONE || str_isErrored(key))
+        return ERROR_ARG_INVALID;
+
+    u64 hash = cmap_hash(map, key);
+    MapShard * shard = cmap_shard(map, hash);
+
+    // Check for the key before locking, as keys that are already present need no changes.
+    MapEntry * entry = cmap_findEntry(__atomic_load_n(&shard->table, __ATOMIC_ACQUIRE), hash, key);
+
+    if(entry == NULL) {
+        pthread_mutex_lock(&shard->mutex);
+
+        entry = cmap_findEntry(shard->table, hash, key);
+        if(entry == NULL) {
+            CLibErrorType error = cmap_insertEntry(shard, hash, key, value);
+            pthread_mutex_unlock(&shard->mutex);
+
+            if(error == ERROR_SUCCESS && current != NULL) {
+                *current = value;
+            }
+            return error;
+        }
+
+        pthread_mutex_unlock(&shard->mutex);
+    }
+
+    if(current != NULL) {
+        *current = __atomic_load_n(&entry->value, __ATOMIC_RELAXED);
+    }
+
+    return ERROR_MAP_KEY_EXISTS;
+}
+
+CLibErrorType cmap_upsert(ConcurrentMap * map, String key, MapUpsertFunction function, void * context, u64 * result) {
+    if(map->error != ERROR_NONE || str_isErrored(key))
+        return ERROR_ARG_INVALID;
+
+    u64 hash = cmap_hash(map, key);
+    MapShard * shard = cmap_shard(map, hash);
+
+    pthread_mutex_lock(&shard->mutex);
+
+    CLibErrorType error = ERROR_SUCCESS;
+    u64 value;
+
+    MapEntry * entry = cmap_findEntry(shard->table, hash, key);
+    if(entry != NULL) {
+        value = function(cmap_entryKey(entry), entry->value, true, context);
+        __atomic_store_n(&entry->value, value, __ATOMIC_RELAXED);
+    } else {
+        value = function(key, 0, false, context);
+        error = cmap_insertEntry(shard, hash, key, value);
+    }
+
+    pthread_mutex_unlock(&shard->mutex);
+
+    if(error == ERROR_SUCCESS && result != NULL) {
+        *result = value;
+    }
 
-    __utf16leAppendCodepoint_append(builder, lo, res);
-    __utf16leAppendCodepoint_append(builder, hi, res);
-    return res;
+    return error;
 }
 
-#undef __utf16leAppendCodepoint_append
 
 
 
@@ -4,6 +4,8 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
+#include <sys/uio.h>
 
 //
 // Colours
@@ -55,6 +57,21 @@ typedef enum {
 
     ERROR_INVALID_CODEPOINT,
 
+    ERROR_FILE_STAT,
+    ERROR_FILE_MAP,
+    ERROR_FILE_WRITE,
+    ERROR_FILE_SYNC,
+
+    ERROR_UNSUPPORTED,
+
+    ERROR_JSON_SYNTAX,
+    ERROR_JSON_DEPTH,
+    ERROR_JSON_NOT_FOUND,
+
+    ERROR_QUEUE_CLOSED,
+
+    ERROR_MAP_KEY_EXISTS,
+
     ERROR_COUNT
 
 } CLibErrorType;
@@ -339,6 +356,7 @@ typedef struct String {
 
 #define STRING_FLAG_IS_NULL_TERMINATED ((u8) 1)
 #define STRING_FLAG_IS_OWN_ALLOCATION ((u8) 2)
+#define STRING_FLAG_IS_MAPPED ((u8) 4)
 
 
 
@@ -441,6 +459,158 @@ bool buf_equals(Buffer buffer1, Buffer buffer2);
 
 
 
+//
+// Vectors
+//
+
+/*!
+ * The type of a growable array of {T} defined using vec_define({T}).
+ */
+#define Vec(T) Vec_##T
+
+/*!
+ * Define the growable array type Vec({T}) and its functions, named Vec_{T}_create, Vec_{T}_push and so on.
+ *
+ * {T} must be a single identifier, so pointer types should be given a typedef first.
+ * The elements are stored in {items}, which is the start of {buffer}, and are grown using buf_ensureCapacity.
+ * All of the functions are static inline, so that they compile to the same code as if they were written for {T}.
+ *
+ * A Vec is errored if its buffer is errored, and every function that may grow it returns a CLibErrorType.
+ * Pointers to elements are only valid until the Vec next grows.
+ */
+#define vec_define(T)                                                                                   \
+    typedef struct Vec_##T {                                                                            \
+        union {                                                                                         \
+            Buffer buffer;                                                                              \
+            T * items;                                                                                  \
+        };                                                                                              \
+        s64 length;                                                                                     \
+    } Vec_##T;                                                                                          \
+                                                                                                        \
+    /* Create an empty Vec with room for {capacity} elements. */                                        \
+    static inline Vec_##T Vec_##T##_create(s64 capacity) {                                              \
+        Vec_##T vec;                                                                                    \
+        vec.length = 0;                                                                                 \
+                                                                                                        \
+        if(capacity < 0) {                                                                              \
+            vec.buffer = buf_createErrored(ERROR_NEG_LENGTH, 0);                                        \
+        } else if(capacity > S64_MAX / (s64) sizeof(T)) {                                               \
+            vec.buffer = buf_createErrored(ERROR_OVERFLOW, 0);                                          \
+        } else {                                                                                        \
+            vec.buffer = buf_create(capacity * (s64) sizeof(T));                                        \
+        }                                                                                               \
+                                                                                                        \
+        return vec;                                                                                     \
+    }                                                                                                   \
+                                                                                                        \
+    static inline bool Vec_##T##_isErrored(Vec_##T vec) {                                               \
+        return buf_isErrored(vec.buffer);                                                               \
+    }                                                                                                   \
+                                                                                                        \
+    static inline CLibErrorType Vec_##T##_getErrorType(Vec_##T vec) {                                   \
+        return buf_getErrorType(vec.buffer);                                                            \
+    }                                                                                                   \
+                                                                                                        \
+    /* Free the storage of {vec}. The elements themselves are not destroyed, so any they own,           \
+       such as the data of Strings, must be destroyed by the caller first. */                           \
+    static inline void Vec_##T##_destroy(Vec_##T * vec) {                                               \
+        buf_destroy(&vec->buffer);                                                                      \
+        vec->length = 0;                                                                                \
+    }                                                                                                   \
+                                                                                                        \
+    /* Returns the number of elements {vec} can hold without growing. */                                \
+    static inline s64 Vec_##T##_capacity(Vec_##T vec) {                                                \
+        return (buf_isErrored(vec.buffer) ? 0 : vec.buffer.size / (s64) sizeof(T));                     \
+    }                                                                                                   \
+                                                                                                        \
+    /* Make room for at least {additional} more elements, growing to the next power of 2 chars. */      \
+    static inline CLibErrorType Vec_##T##_reserve(Vec_##T * vec, s64 additional) {                      \
+        if(additional < 0)                                                                              \
+            return ERROR_NEG_LENGTH;                                                                    \
+        if(additional > S64_MAX / (s64) sizeof(T) - vec->length)                                        \
+            return ERROR_OVERFLOW;                                                                      \
+                                                                                                        \
+        return buf_ensureCapacity(&vec->buffer, (vec->length + additional) * (s64) sizeof(T));          \
+    }                                                                                                   \
+                                                                                                        \
+    /* Free any memory of {vec} not used by its elements. */                                            \
+    static inline CLibErrorType Vec_##T##_shrink(Vec_##T * vec) {                                       \
+        return buf_setCapacity(&vec->buffer, vec->length * (s64) sizeof(T));                            \
+    }                                                                                                   \
+                                                                                                        \
+    /* Append {value} to the end of {vec}. */                                                           \
+    static inline CLibErrorType Vec_##T##_push(Vec_##T * vec, T value) {                                \
+        /* An errored buffer has a negative size, so it always takes the slow path. */                  \
+        if((vec->length + 1) * (s64) sizeof(T) > vec->buffer.size) {                                    \
+            CLibErrorType result = Vec_##T##_reserve(vec, 1);                                           \
+            if(result != ERROR_SUCCESS)                                                                 \
+                return result;                                                                          \
+        }                                                                                               \
+                                                                                                        \
+        vec->items[vec->length] = value;                                                                \
+        vec->length += 1;                                                                               \
+        return ERROR_SUCCESS;                                                                           \
+    }                                                                                                   \
+                                                                                                        \
+    /* Remove the last element of {vec}, storing it in {value} if it is not NULL. */                    \
+    static inline CLibErrorType Vec_##T##_pop(Vec_##T * vec, T * value) {                               \
+        if(vec->length == 0)                                                                            \
+            return ERROR_ARG_INVALID;                                                                   \
+                                                                                                        \
+        vec->length -= 1;                                                                               \
+        if(value != NULL) {                                                                             \
+            *value = vec->items[vec->length];                                                           \
+        }                                                                                               \
+                                                                                                        \
+        return ERROR_SUCCESS;                                                                           \
+    }                                                                                                   \
+                                                                                                        \
+    /* Insert {value} at {index} in {vec}, moving the elements from {index} along by one. */            \
+    static inline CLibErrorType Vec_##T##_insert(Vec_##T * vec, s64 index, T value) {                   \
+        if(index < 0 || index > vec->length)                                                            \
+            return ERROR_ARG_INVALID;                                                                   \
+                                                                                                        \
+        CLibErrorType result = Vec_##T##_reserve(vec, 1);                                               \
+        if(result != ERROR_SUCCESS)                                                                     \
+            return result;                                                                              \
+                                                                                                        \
+        memmove(&vec->items[index + 1], &vec->items[index], (size_t) (vec->length - index) * sizeof(T)); \
+        vec->items[index] = value;                                                                      \
+        vec->length += 1;                                                                               \
+        return ERROR_SUCCESS;                                                                           \
+    }                                                                                                   \
+                                                                                                        \
+    /* Remove the {count} elements from {index} in {vec}, moving the elements after them back. */       \
+    static inline CLibErrorType Vec_##T##_erase(Vec_##T * vec, s64 index, s64 count) {                  \
+        if(count < 0)                                                                                   \
+            return ERROR_NEG_LENGTH;                                                                    \
+        if(index < 0 || index > vec->length || count > vec->length - index)                             \
+            return ERROR_ARG_INVALID;                                                                   \
+        if(count == 0)                                                                                  \
+            return ERROR_SUCCESS;                                                                       \
+                                                                                                        \
+        s64 moved = vec->length - index - count;                                                        \
+        memmove(&vec->items[index], &vec->items[index + count], (size_t) moved * sizeof(T));            \
+        vec->length -= count;                                                                           \
+        return ERROR_SUCCESS;                                                                           \
+    }
+
+vec_define(u64)
+
+vec_define(String)
+
+/*!
+ * Sort the elements of {vec} in ascending order using u64_mergeSort, which allocates room for a copy of them.
+ */
+static inline CLibErrorType Vec_u64_sort(Vec(u64) * vec) {
+    if(vec->length < 2)
+        return ERROR_SUCCESS;
+
+    return (u64_mergeSort(vec->items, (u64) vec->length) ? ERROR_SUCCESS : ERROR_ALLOC);
+}
+
+
+
 //
 // Strings
 //
@@ -555,6 +725,11 @@ bool str_isNullTerminated(String string);
  */
 bool str_isOwnAllocation(String string);
 
+/*!
+ * Returns whether the data in {string} is a memory mapping that will be unmapped by str_destroy.
+ */
+bool str_isMapped(String string);
+
 /*!
  * Destroy {string}.
  *
@@ -620,6 +795,14 @@ bool str_equals(String string1, String string2);
  */
 bool str_equalsC(String string1, char * string2);
 
+/*!
+ * Hash the contents of {string}, mixed with {seed}. Errored Strings hash the same as empty Strings.
+ *
+ * The hash reads {string} eight chars at a time and mixes them using 64 bit multiplies, so it is fast for
+ * both short and long Strings, but it should not be relied upon where the hash must be hard to reverse.
+ */
+u64 str_hash(String string, u64 seed);
+
 /*!
  * Check if {string} starts with {prefix}.
  */
@@ -870,9 +1053,123 @@ String str_splitAtC(String * remaining, char * delimiter);
 /*!
  * Load the contents of the file {filename} into a String.
  *
+ * Regular files are read directly into the returned String using the size reported by fstat.
+ * Files that do not report their size, such as pipes and files in /proc, are read until their end.
+ *
  * The returned String should be destroyed when it is no longer in use.
  */
-String str_readFile(char *filename);
+String str_readFile(char * filename);
+
+/*!
+ * Hints passed to str_mapFile and buf_mapFile about how a mapped file will be accessed.
+ */
+#define FILE_MAP_SEQUENTIAL ((u8) 1)
+#define FILE_MAP_WILLNEED ((u8) 2)
+#define FILE_MAP_HUGEPAGE ((u8) 4)
+
+/*!
+ * Map the contents of the file {filename} into memory as a read-only String,
+ * without copying it into its own allocation.
+ *
+ * {hints} is a combination of the FILE_MAP_ flags, which are passed on to the
+ * kernel using madvise. The pages of the file are shared with the page cache,
+ * so the file is only read from disk as it is accessed.
+ *
+ * Only regular files that report their size can be mapped. Other files, such
+ * as pipes and files in /proc, return an errored String with CLibErrorType
+ * ERROR_FILE_MAP, and should be read using str_readFile instead.
+ *
+ * The data of the returned String must not be modified. The returned String
+ * should be destroyed using str_destroy, which will unmap it.
+ */
+String str_mapFile(char * filename, u8 hints);
+
+/*!
+ * Map the contents of the file {filename} into memory as a read-only Buffer.
+ *
+ * {hints} is a combination of the FILE_MAP_ flags, which are passed on to the kernel using madvise.
+ * Files that cannot be mapped, such as pipes and files in /proc, return an errored Buffer
+ * with CLibErrorType ERROR_FILE_MAP.
+ *
+ * The returned Buffer must be destroyed using buf_unmapFile, not buf_destroy.
+ */
+Buffer buf_mapFile(char * filename, u8 hints);
+
+/*!
+ * Unmap the Buffer {buffer} that was returned by buf_mapFile.
+ */
+void buf_unmapFile(Buffer * buffer);
+
+/*!
+ * The ways that file_loadAll can load files.
+ */
+typedef enum FileLoadMethod {
+    /*!
+     * Use io_uring if it is available, or else fall back to FILE_LOAD_THREADS.
+     */
+    FILE_LOAD_AUTO = 0,
+
+    /*!
+     * Submit the open, statx and read of many files at once using io_uring.
+     *
+     * Files that do not report their size, such as pipes and files in /proc, could block
+     * while they are read, so they are read using threads once the other files have loaded.
+     */
+    FILE_LOAD_IO_URING,
+
+    /*!
+     * Read the files using a pool of threads that each read one file at a time.
+     */
+    FILE_LOAD_THREADS
+} FileLoadMethod;
+
+/*!
+ * The maximum number of files that file_loadAll will load at once.
+ */
+#define FILE_LOAD_MAX_IN_FLIGHT 64
+
+/*!
+ * Load the contents of the {count} files in {filenames} into {contents}, using {method}.
+ *
+ * Each file is loaded into the String at the same index in {contents}. If a file
+ * cannot be loaded, its String will be errored with one of the ERROR_FILE_ CLibErrorTypes.
+ *
+ * Returns ERROR_UNSUPPORTED if FILE_LOAD_IO_URING is requested but io_uring is not available.
+ * If FILE_LOAD_IO_URING is requested and io_uring fails part way through loading the files,
+ * returns ERROR_FILE_READ or ERROR_ALLOC and every String in {contents} will be errored.
+ * FILE_LOAD_AUTO instead falls back to FILE_LOAD_THREADS if io_uring fails.
+ *
+ * Otherwise, returns ERROR_SUCCESS once every file has been loaded or has failed to load.
+ *
+ * Each of the Strings in {contents} should be destroyed when they are no longer in use.
+ */
+CLibErrorType file_loadAll(char ** filenames, s64 count, String * contents, FileLoadMethod method);
+
+/*!
+ * A function called by file_parallelForEachRecord for each record in a file.
+ *
+ * {record} points into the contents of the file, and is only valid until the callback returns.
+ * {thread} is the index of the thread that is calling the callback, from 0 up to the number of threads.
+ */
+typedef void (*FileRecordCallback)(String record, s64 thread, void * context);
+
+/*!
+ * Split the file {filename} into records separated by {delimiter}, and call {callback} with
+ * each record, and {context}, from {threads} threads at once.
+ *
+ * The file is split into one range per thread, with the boundaries of each range moved forward
+ * to the char after the next {delimiter}, so that each record is handled by exactly one thread.
+ * Records are passed to {callback} in order within each thread, but the threads run concurrently.
+ *
+ * Consecutive delimiters produce empty records, but a delimiter at the end of the file does not.
+ * If {threads} is 0, one thread will be used for each online processor.
+ *
+ * The file is memory mapped if possible. Files that cannot be mapped, such as pipes
+ * and files in /proc, are read into memory using str_readFile instead.
+ * Returns the errors of str_mapFile or str_readFile if the file cannot be read.
+ */
+CLibErrorType file_parallelForEachRecord(char * filename, char delimiter, s64 threads,
+                                         FileRecordCallback callback, void * context);
 
 
 
@@ -880,12 +1177,65 @@ String str_readFile(char *filename);
 // Builder
 //
 
+/*!
+ * The strategies a Builder can use to increase its capacity when it runs out of space.
+ */
+typedef enum {
+    /*!
+     * Round the required capacity up to the next power of 2. This is the default.
+     */
+    BUILDER_GROWTH_POWER_OF_2 = 0,
+
+    /*!
+     * Grow the capacity by a factor of 1.5, or to the required capacity if that is larger.
+     */
+    BUILDER_GROWTH_ONE_AND_A_HALF,
+
+    /*!
+     * Grow the capacity in multiples of the fixed increment given as the growth parameter.
+     */
+    BUILDER_GROWTH_FIXED,
+
+    /*!
+     * Grow the capacity by a factor of 1.5, moving the data into an anonymous memory mapping once
+     * the capacity exceeds the growth parameter. Mapped data is grown using mremap where it is
+     * available, so that the kernel can move the pages instead of copying the data.
+     *
+     * If the growth parameter is 0, BUILDER_DEFAULT_HUGE_THRESHOLD will be used.
+     */
+    BUILDER_GROWTH_HUGE,
+
+    /*!
+     * Append into a chain of separately allocated chunks, each at least the growth parameter in size,
+     * so that data that has already been appended is never copied as the Builder grows. The chunks
+     * can be written out using builder_iovecs, and are only joined into one contiguous allocation
+     * when builder_str or builder_buf is used.
+     *
+     * If the growth parameter is 0, BUILDER_DEFAULT_CHUNK_SIZE will be used.
+     */
+    BUILDER_GROWTH_CHUNKED,
+
+    BUILDER_GROWTH_COUNT
+} BuilderGrowth;
+
+/*!
+ * The default capacity above which a Builder using BUILDER_GROWTH_HUGE will use memory mappings.
+ */
+#define BUILDER_DEFAULT_HUGE_THRESHOLD ((s64) 64 * 1024 * 1024)
+
+/*!
+ * The default size of the chunks allocated by a Builder using BUILDER_GROWTH_CHUNKED.
+ */
+#define BUILDER_DEFAULT_CHUNK_SIZE ((s64) 64 * 1024)
+
 /*!
  * A utility for constructing Strings or Buffers of unknown length.
  */
 typedef struct Builder {
     /*!
      * The buffer to store the data as it is built.
+     *
+     * If the Builder is chunked, this is the chunk currently being appended to.
      */
     Buffer buffer;
 
@@ -893,6 +1243,41 @@ typedef struct Builder {
      * The length of the built data.
      */
     s64 length;
+
+    /*!
+     * The strategy used to increase the capacity of the buffer.
+     */
+    BuilderGrowth growth;
+
+    /*!
+     * The increment for BUILDER_GROWTH_FIXED, or the threshold for BUILDER_GROWTH_HUGE.
+     */
+    s64 growthParameter;
+
+    /*!
+     * The number of times the buffer has been reallocated since the Builder was created.
+     */
+    u64 reallocCount;
+
+    /*!
+     * Whether the buffer is stored in an anonymous memory mapping instead of being malloc'd.
+     */
+    bool isMapped;
+
+    /*!
+     * The full chunks of a chunked Builder, stored as an array of struct iovec.
+     */
+    Buffer chunks;
+
+    /*!
+     * The number of full chunks in the chunks array.
+     */
+    s64 chunkCount;
+
+    /*!
+     * The total length of the data in the full chunks.
+     */
+    s64 chunksLength;
 } Builder;
 
 /*!
@@ -908,6 +1293,14 @@ Builder builder_create(s64 initialSize);
  */
 Builder builder_createErrored(CLibErrorType errorType, int errnum);
 
+/*!
+ * Sets the strategy {builder} uses to increase its capacity to {growth}.
+ *
+ * {parameter} is the increment for BUILDER_GROWTH_FIXED, which must be positive, and the
+ * threshold for BUILDER_GROWTH_HUGE. It is ignored by the other strategies.
+ */
+CLibErrorType builder_setGrowth(Builder * builder, BuilderGrowth growth, s64 parameter);
+
 /*!
  * Returns whether {builder} is in an errored state.
  */
@@ -923,16 +1316,28 @@ bool builder_isValid(Builder builder);
  *
  * Only the {builder} itself, OR any Buffer or String constructed
  * using {builder} should be free'd, as they share the same data.
+ *
+ * If {builder} is mapped, only {builder} itself can be destroyed.
+ * Strings constructed from it will not free the mapped data.
  */
 void builder_destroy(Builder * builder);
 
 /*!
  * Returns the contents of {builder} as a String.
+ *
+ * If {builder} is chunked, its chunks are copied into a new String
+ * which should be destroyed separately from {builder}.
  */
 String builder_str(Builder builder);
 
 /*!
  * Returns the contents of {builder} as a Buffer.
+ *
+ * If {builder} is chunked, its chunks are copied into a new Buffer
+ * which should be destroyed separately from {builder}.
+ *
+ * If {builder} is mapped, its contents are also copied into a new
+ * Buffer, as a Buffer cannot refer to mapped data it does not own.
  */
 Buffer builder_buf(Builder builder);
 
@@ -946,19 +1351,45 @@ String builder_strCopy(Builder builder);
  */
 Buffer builder_bufCopy(Builder builder);
 
+/*!
+ * Returns the number of struct iovec's required to describe the contents of {builder}.
+ */
+s64 builder_iovecCount(Builder builder);
+
+/*!
+ * Fills {iovecs} with up to {maxIovecs} struct iovec's describing the contents of {builder}
+ * in order, so that they can be written using writev without copying them.
+ *
+ * Returns the number of iovecs filled, or -1 on error.
+ */
+s64 builder_iovecs(Builder builder, struct iovec * iovecs, s64 maxIovecs);
+
 /*!
  * Sets the capacity of {builder} to {capacity}.
  *
  * If {builder} contains more than {capacity} characters set, then this operation will error.
+ *
+ * If {builder} is chunked, only the chunk being appended to is resized.
  */
 CLibErrorType builder_setCapacity(Builder * builder, s64 capacity);
 
 /*!
  * If the capacity of {builder} is smaller than {requiredCapacity},
  * then the capacity of {builder} will be increased.
+ *
+ * If {builder} is chunked, this ensures that the chunk being appended to
+ * can fit {requiredCapacity} - length more chars.
  */
 CLibErrorType builder_ensureCapacity(Builder * builder, s64 requiredCapacity);
 
+/*!
+ * Ensures that at least {additional} more chars can be appended to {builder} without reallocating.
+ *
+ * Unlike builder_ensureCapacity, this does not use the growth strategy of {builder} to round up
+ * the capacity, so it should be used to pre-size {builder} when the final length is known.
+ */
+CLibErrorType builder_reserve(Builder * builder, s64 additional);
+
 /*!
  * Attempts to reduce the capacity of {builder} so it is equal to the length of its contents.
  *
@@ -991,47 +1422,1937 @@ CLibErrorType builder_appendC(Builder * builder, char * string);
  */
 CLibErrorType builder_appendSubstring(Builder * builder, String string, s64 start, s64 end);
 
+/*!
+ * Append the result of formatting the printf format string {format} with the given arguments to {builder}.
+ *
+ * The result is formatted directly into the spare capacity of {builder},
+ * only growing {builder} and formatting again if it does not fit.
+ *
+ * Any String's should be converted to null-terminated strings before use in this function.
+ */
+CLibErrorType builder_appendFormat(Builder * builder, char * format, ...);
+
+/*!
+ * Append the result of formatting the printf format string {format} with the arguments {arguments} to {builder}.
+ *
+ * The result is formatted directly into the spare capacity of {builder},
+ * only growing {builder} and formatting again if it does not fit.
+ *
+ * Any String's should be converted to null-terminated strings before use in this function.
+ */
+CLibErrorType builder_vappendFormat(Builder * builder, char * format, va_list arguments);
+
 
 
 //
-// Unicode
+// File Reader
 //
 
 /*!
- * Read a Unicode codepoint from the start of the UTF-8 String {remaining}, modifiying
- * {remaining} to be a substring not including the character that was read.
+ * The default capacity of the buffer of a FileReader.
+ */
+#define FILE_READER_DEFAULT_CAPACITY ((s64) 256 * 1024)
+
+/*!
+ * Reads a file incrementally through a refillable buffer.
  *
- * Will return 0 on failure or if the first character is the null character.
+ * The Strings returned by a FileReader point into its buffer, so they are only
+ * valid until the next call on the FileReader. Unread data is moved to the start
+ * of the buffer before it is refilled, so the buffer is only grown when a single
+ * record does not fit in it.
  */
-u32 utf8_toCodepoint(String * remaining);
+typedef struct FileReader {
+    /*!
+     * The file descriptor being read from.
+     */
+    int file;
+
+    /*!
+     * Whether the file descriptor should be closed when the FileReader is destroyed.
+     */
+    bool ownsFile;
+
+    /*!
+     * Whether the end of the file has been reached.
+     */
+    bool isEndOfFile;
+
+    /*!
+     * The buffer that data read from the file is stored in.
+     */
+    Buffer buffer;
+
+    /*!
+     * The index of the first char in the buffer that has not been consumed.
+     */
+    s64 start;
+
+    /*!
+     * The index after the last char in the buffer that has been read from the file.
+     */
+    s64 end;
+} FileReader;
 
 /*!
- * Construct a UTF-8 String from the character in the Unicode codepoint {codepoint}.
+ * Opens the file {filename} for reading using a buffer of {capacity} chars.
+ *
+ * If {capacity} is 0, FILE_READER_DEFAULT_CAPACITY will be used.
+ *
+ * The returned FileReader should be destroyed using reader_destroy once it is no longer in use.
  */
-String utf8_fromCodepoint(u32 codepoint);
+FileReader reader_create(char * filename, s64 capacity);
 
 /*!
- * Append the Unicode codepoint {codepoint} in UTF-8 into {builder}.
+ * Creates a FileReader that reads from the open file descriptor {file} using a buffer of {capacity} chars.
+ *
+ * If {capacity} is 0, FILE_READER_DEFAULT_CAPACITY will be used.
+ *
+ * {file} will not be closed when the FileReader is destroyed.
  */
-CLibErrorType utf8_appendCodepoint(Builder * builder, u32 codepoint);
+FileReader reader_createUsing(int file, s64 capacity);
 
 /*!
- * Read a Unicode codepoint from the start of the UTF-16LE String {remaining}, modifiying
- * {remaining} to be a substring not including the character that was read.
+ * Creates a FileReader that is in an errored state.
+ */
+FileReader reader_createErrored(CLibErrorType errorType, int errnum);
+
+/*!
+ * Check whether {reader} is in an errored state.
+ */
+bool reader_isErrored(FileReader reader);
+
+/*!
+ * Check whether {reader} is usable and not in an errored state.
+ */
+bool reader_isValid(FileReader reader);
+
+/*!
+ * Get the CLibErrorType for the errored FileReader {reader}.
  *
- * Will return 0 on failure or if the first character is the null character.
+ * Will return ERROR_NONE if {reader} is not errored.
  */
-u32 utf16le_toCodepoint(String * remaining);
+CLibErrorType reader_getErrorType(FileReader reader);
 
 /*!
- * Construct a UTF-16LE String containing the codepoint {codepoint}.
+ * Close the file of {reader} if it owns it, and free its buffer.
  */
-String utf16le_fromCodepoint(u32 codepoint);
+void reader_destroy(FileReader * reader);
 
 /*!
- * Append the Unicode codepoint {codepoint} in UTF-16LE into {builder}.
+ * Returns the chars up to the next occurence of {delimiter}, and consumes them and the delimiter.
+ *
+ * If {delimiter} is not found before the end of the file, the remaining chars will be returned.
+ * Once the file is exhausted, an errored String with CLibErrorType ERROR_STRING_EXHAUSTED will be returned.
+ *
+ * The returned String points into the buffer of {reader}, and is only valid until the next call on {reader}.
  */
-CLibErrorType utf16le_appendCodepoint(Builder * builder, u32 codepoint);
+String reader_nextUntil(FileReader * reader, char delimiter);
+
+/*!
+ * Returns the next line in {reader}, excluding its line ending.
+ *
+ * Both "\n" and "\r\n" line endings are supported.
+ * Once the file is exhausted, an errored String with CLibErrorType ERROR_STRING_EXHAUSTED will be returned.
+ *
+ * The returned String points into the buffer of {reader}, and is only valid until the next call on {reader}.
+ */
+String reader_nextLine(FileReader * reader);
+
+/*!
+ * Returns the next {count} chars in {reader}, or all of the remaining chars if there are fewer than {count} left.
+ *
+ * Once the file is exhausted, an errored String with CLibErrorType ERROR_STRING_EXHAUSTED will be returned.
+ *
+ * The returned String points into the buffer of {reader}, and is only valid until the next call on {reader}.
+ */
+String reader_read(FileReader * reader, s64 count);
+
+
+
+//
+// File Writer
+//
+
+/*!
+ * The default capacity of the buffer of a FileWriter.
+ */
+#define FILE_WRITER_DEFAULT_CAPACITY ((s64) 256 * 1024)
+
+/*!
+ * Writes to a file through a Builder, so that many small appends are written using few system calls.
+ *
+ * Appends that do not fit in the buffer are written together with the buffered data using writev,
+ * without first being copied into the buffer.
+ */
+typedef struct FileWriter {
+    /*!
+     * The file descriptor being written to.
+     */
+    int file;
+
+    /*!
+     * Whether the file descriptor should be closed when the FileWriter is destroyed.
+     */
+    bool ownsFile;
+
+    /*!
+     * The data that has been appended but not yet written to the file.
+     */
+    Builder builder;
+
+    /*!
+     * The number of flushes between each call to fdatasync, or 0 if fdatasync should not be called.
+     */
+    s64 syncInterval;
+
+    /*!
+     * The number of flushes since fdatasync was last called.
+     */
+    s64 unsyncedFlushes;
+} FileWriter;
+
+/*!
+ * Opens the file {filename} for writing using a buffer of {capacity} chars,
+ * creating it if it does not exist or truncating it if it does.
+ *
+ * If {capacity} is 0, FILE_WRITER_DEFAULT_CAPACITY will be used.
+ *
+ * The returned FileWriter should be destroyed using writer_destroy once it is no longer in use.
+ */
+FileWriter writer_create(char * filename, s64 capacity);
+
+/*!
+ * Creates a FileWriter that writes to the open file descriptor {file} using a buffer of {capacity} chars.
+ *
+ * If {capacity} is 0, FILE_WRITER_DEFAULT_CAPACITY will be used.
+ *
+ * {file} will not be closed when the FileWriter is destroyed.
+ */
+FileWriter writer_createUsing(int file, s64 capacity);
+
+/*!
+ * Creates a FileWriter that is in an errored state.
+ */
+FileWriter writer_createErrored(CLibErrorType errorType, int errnum);
+
+/*!
+ * Check whether {writer} is in an errored state.
+ */
+bool writer_isErrored(FileWriter writer);
+
+/*!
+ * Check whether {writer} is usable and not in an errored state.
+ */
+bool writer_isValid(FileWriter writer);
+
+/*!
+ * Get the CLibErrorType for the errored FileWriter {writer}.
+ *
+ * Will return ERROR_NONE if {writer} is not errored.
+ */
+CLibErrorType writer_getErrorType(FileWriter writer);
+
+/*!
+ * Flush {writer}, close its file if it owns it, and free its buffer.
+ *
+ * {writer} is destroyed even if flushing or closing its file fails, in which
+ * case the CLibErrorType of the failure is returned and buffered data may be lost.
+ */
+CLibErrorType writer_destroy(FileWriter * writer);
+
+/*!
+ * Call fdatasync every {interval} flushes of {writer}, so that data is regularly made durable
+ * without waiting for the disk after every write.
+ *
+ * If {interval} is 0, fdatasync will only be called by writer_sync.
+ */
+CLibErrorType writer_setSyncInterval(FileWriter * writer, s64 interval);
+
+/*!
+ * Write all of the data buffered in {writer} to its file.
+ */
+CLibErrorType writer_flush(FileWriter * writer);
+
+/*!
+ * Flush {writer}, and then wait for its data to be written to disk using fdatasync.
+ */
+CLibErrorType writer_sync(FileWriter * writer);
+
+/*!
+ * Append the char {character} to {writer}.
+ */
+CLibErrorType writer_appendChar(FileWriter * writer, char character);
+
+/*!
+ * Append {string} to {writer}.
+ */
+CLibErrorType writer_appendStr(FileWriter * writer, String string);
+
+/*!
+ * Append {buffer} to {writer}.
+ */
+CLibErrorType writer_appendBuf(FileWriter * writer, Buffer buffer);
+
+/*!
+ * Append the null-terminated string {string} to {writer}.
+ */
+CLibErrorType writer_appendC(FileWriter * writer, char * string);
+
+/*!
+ * Write the data buffered in {writer} followed by the contents of {builder} to the file of {writer},
+ * without copying the contents of {builder}.
+ */
+CLibErrorType writer_writeBuilder(FileWriter * writer, Builder builder);
+
+/*!
+ * Write the data buffered in {writer} followed by the {count} buffers in {iovecs} to the file of {writer},
+ * without copying them.
+ *
+ * {iovecs} will not be modified.
+ */
+CLibErrorType writer_writeIovecs(FileWriter * writer, struct iovec * iovecs, s64 count);
+
+
+
+//
+// Number Conversion
+//
+
+/*!
+ * The maximum number of chars needed to write a u64 or s64 in base 10.
+ */
+#define NUMBER_MAX_INTEGER_CHARS 20
+
+/*!
+ * The maximum number of chars needed to write a double using builder_appendDouble.
+ */
+#define NUMBER_MAX_DOUBLE_CHARS 32
+
+/*!
+ * Append {value} to {builder} in base 10.
+ */
+CLibErrorType builder_appendU64(Builder * builder, u64 value);
+
+/*!
+ * Append {value} to {builder} in base 10.
+ */
+CLibErrorType builder_appendS64(Builder * builder, s64 value);
+
+/*!
+ * Append a representation of {value} that parses back to exactly {value} to {builder}.
+ *
+ * The digits are generated using Grisu2, which produces the shortest representation for almost
+ * all values, but for a small fraction may produce one more digit than necessary.
+ *
+ * Values with a magnitude between 1e-6 and 1e21 are written in decimal notation (e.g. 0.001, 1.5, 300.0),
+ * and all others in exponential notation (e.g. 1e-7, 1.25e30). NaN and infinities are written as NaN,
+ * Infinity and -Infinity. The output does not depend on the current locale.
+ */
+CLibErrorType builder_appendDouble(Builder * builder, double value);
+
+/*!
+ * Parse the whole of {string} as an unsigned base 10 integer, storing it in {value}.
+ *
+ * Returns ERROR_ARG_INVALID if {string} is not an integer, or ERROR_OVERFLOW if it does not fit in a u64.
+ */
+CLibErrorType str_parseU64(String string, u64 * value);
+
+/*!
+ * Parse the whole of {string} as a signed base 10 integer with an optional leading '-' or '+', storing it in {value}.
+ *
+ * Returns ERROR_ARG_INVALID if {string} is not an integer, or ERROR_OVERFLOW if it does not fit in an s64.
+ */
+CLibErrorType str_parseS64(String string, s64 * value);
+
+/*!
+ * Parse the whole of {string} as a decimal floating point number, storing the closest double in {value}.
+ *
+ * Accepts an optional sign, digits with an optional fractional part, and an optional exponent (e.g. -1.5e-7),
+ * as well as NaN, Infinity and -Infinity. The current locale is not used.
+ *
+ * Returns ERROR_ARG_INVALID if {string} is not a number, or ERROR_OVERFLOW if it is too large for a double.
+ */
+CLibErrorType str_parseDouble(String string, double * value);
+
+
+
+//
+// Unicode
+//
+
+/*!
+ * Read a Unicode codepoint from the start of the UTF-8 String {remaining}, modifiying
+ * {remaining} to be a substring not including the character that was read.
+ *
+ * Will return 0 on failure or if the first character is the null character.
+ */
+u32 utf8_toCodepoint(String * remaining);
+
+/*!
+ * Construct a UTF-8 String from the character in the Unicode codepoint {codepoint}.
+ */
+String utf8_fromCodepoint(u32 codepoint);
+
+/*!
+ * Append the Unicode codepoint {codepoint} in UTF-8 into {builder}.
+ */
+CLibErrorType utf8_appendCodepoint(Builder * builder, u32 codepoint);
+
+/*!
+ * Append the {count} Unicode codepoints in {codepoints} in UTF-8 into {builder}.
+ *
+ * The length of all of the codepoints is found first so that {builder} only grows once.
+ * If any of the codepoints are invalid, ERROR_INVALID_CODEPOINT will be returned and nothing will be appended.
+ */
+CLibErrorType utf8_appendCodepoints(Builder * builder, const u32 * codepoints, s64 count);
+
+/*!
+ * Read a Unicode codepoint from the start of the UTF-16LE String {remaining}, modifiying
+ * {remaining} to be a substring not including the character that was read.
+ *
+ * Will return 0 on failure or if the first character is the null character.
+ */
+u32 utf16le_toCodepoint(String * remaining);
+
+/*!
+ * Construct a UTF-16LE String containing the codepoint {codepoint}.
+ */
+String utf16le_fromCodepoint(u32 codepoint);
+
+/*!
+ * Append the Unicode codepoint {codepoint} in UTF-16LE into {builder}.
+ *
+ * Returns ERROR_INVALID_CODEPOINT if {codepoint} is above U+10FFFF, as it cannot be stored in UTF-16.
+ */
+CLibErrorType utf16le_appendCodepoint(Builder * builder, u32 codepoint);
+
+/*!
+ * Returns the index of the first char in {string} that is not part of a valid UTF-8 character,
+ * or -1 if all of {string} is valid UTF-8.
+ *
+ * Validation is strict, so overlong encodings, surrogates, codepoints above U+10FFFF and
+ * the 5 and 6 char sequences accepted by utf8_toCodepoint are all invalid. A character that
+ * is cut off by the end of {string} is invalid from its first char.
+ *
+ * Will return -2 if {string} is errored.
+ */
+s64 utf8_validate(String string);
+
+/*!
+ * Returns the number of Unicode codepoints in the UTF-8 String {string}.
+ *
+ * Every char that is not a 10xxxxxx continuation char is counted as the start of a codepoint,
+ * so {string} should be checked using utf8_validate first if it may not be valid UTF-8.
+ *
+ * Will return -2 if {string} is errored.
+ */
+s64 utf8_countCodepoints(String string);
+
+/*!
+ * The default number of codepoints between each offset stored in a UTF8Index.
+ */
+#define UTF8_INDEX_DEFAULT_INTERVAL ((s64) 256)
+
+/*!
+ * The offsets of every {interval} codepoints in a UTF-8 String, so that
+ * codepoints can be found without counting from the start of the String.
+ */
+typedef struct UTF8Index {
+    /*!
+     * The number of codepoints between each stored offset.
+     */
+    s64 interval;
+
+    /*!
+     * The total number of codepoints in the indexed String.
+     */
+    s64 codepointCount;
+
+    /*!
+     * The char offset of every {interval}th codepoint, stored as an array of s64.
+     */
+    Buffer offsets;
+} UTF8Index;
+
+/*!
+ * Create a UTF8Index for the UTF-8 String {string}, storing the offset of every {interval} codepoints.
+ *
+ * If {interval} is 0, UTF8_INDEX_DEFAULT_INTERVAL will be used. Smaller intervals make lookups
+ * faster, at the cost of 8 chars of memory for each offset.
+ *
+ * The returned UTF8Index is only valid as long as {string} is not modified,
+ * and should be destroyed using utf8_destroyIndex once it is no longer in use.
+ */
+UTF8Index utf8_createIndex(String string, s64 interval);
+
+/*!
+ * Check whether {index} is in an errored state.
+ */
+bool utf8_isIndexErrored(UTF8Index index);
+
+/*!
+ * Free the offsets stored in {index}.
+ */
+void utf8_destroyIndex(UTF8Index * index);
+
+/*!
+ * Returns the index of the first char of codepoint number {codepoint} in the UTF-8 String {string},
+ * or the length of {string} if {codepoint} is the number of codepoints in {string}.
+ *
+ * If {index} is not NULL, it should be a UTF8Index of {string}, and will be used to skip to
+ * within {index->interval} codepoints of {codepoint}. Otherwise, the codepoints will be counted from the start.
+ *
+ * Will return -1 if {codepoint} is out of range, or -2 if {string} is errored.
+ */
+s64 utf8_offsetOfCodepoint(String string, UTF8Index * index, s64 codepoint);
+
+/*!
+ * Returns a substring of the UTF-8 String {string} from codepoint number {start}, inclusive, to codepoint number {end}, exclusive.
+ *
+ * If {index} is not NULL, it should be a UTF8Index of {string}, and will be used to find
+ * the codepoints without counting from the start of {string}.
+ *
+ * Will return an errored String with CLibErrorType ERROR_ARG_INVALID if {start} or {end} are out of range.
+ */
+String utf8_substringByCodepoint(String string, UTF8Index * index, s64 start, s64 end);
+
+/*!
+ * Convert the UTF-8 String {string} into a new UTF-16LE String.
+ *
+ * If {string} is not valid UTF-8, as checked by utf8_validate, an errored String with CLibErrorType
+ * ERROR_INVALID_CODEPOINT will be returned and {invalidIndex} will be set to the index of the first
+ * invalid char in {string}. Otherwise, {invalidIndex} will be set to -1. {invalidIndex} may be NULL.
+ *
+ * The returned String should be destroyed when it is no longer in use.
+ */
+String utf8_toUtf16le(String string, s64 * invalidIndex);
+
+/*!
+ * Convert the UTF-16LE String {string} into a new UTF-8 String.
+ *
+ * If {string} contains an unpaired surrogate or has an odd length, an errored String with CLibErrorType
+ * ERROR_INVALID_CODEPOINT will be returned and {invalidIndex} will be set to the index of the first char
+ * of the first invalid code unit in {string}. Otherwise, {invalidIndex} will be set to -1. {invalidIndex} may be NULL.
+ *
+ * The returned String should be destroyed when it is no longer in use.
+ */
+String utf16le_toUtf8(String string, s64 * invalidIndex);
+
+
+
+//
+// JSON
+//
+
+/*!
+ * The maximum depth of nested arrays and objects that json_parse will accept.
+ */
+#define JSON_MAX_DEPTH 1024
+
+/*!
+ * The minimum size of each block of memory that unescaped JSON strings are stored in.
+ */
+#define JSON_STRING_BLOCK_SIZE ((s64) 64 * 1024)
+
+/*!
+ * The types of JSON values.
+ */
+typedef enum JSONType {
+    JSON_NULL = 0,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT
+} JSONType;
+
+/*!
+ * Set on JSON_NUMBER nodes whose value is stored in value.integer rather than value.number.
+ */
+#define JSON_FLAG_INTEGER ((u8) 1)
+
+/*!
+ * Set on JSON_STRING nodes whose chars had to be unescaped into the JSONDoc,
+ * rather than pointing directly into the parsed String.
+ */
+#define JSON_FLAG_UNESCAPED ((u8) 2)
+
+/*!
+ * A single value in a parsed JSON document.
+ *
+ * The nodes of a JSONDoc are stored in one array in the order they appear in the document.
+ * The children of an array or object directly follow it, and the children of an object
+ * alternate between a JSON_STRING key and its value. json_next skips over a node and all of its children.
+ */
+typedef struct JSONNode {
+    /*!
+     * The JSONType of this node.
+     */
+    u8 type;
+
+    /*!
+     * Flags containing info about this node.
+     */
+    u8 flags;
+
+    /*!
+     * The number of chars in a string, the number of elements in an array,
+     * or the number of key and value pairs in an object.
+     */
+    s64 length;
+
+    union {
+        /*!
+         * The chars of a JSON_STRING.
+         */
+        char * chars;
+
+        /*!
+         * The value of a JSON_NUMBER with JSON_FLAG_INTEGER set.
+         */
+        s64 integer;
+
+        /*!
+         * The value of a JSON_NUMBER without JSON_FLAG_INTEGER set.
+         */
+        double number;
+
+        /*!
+         * The value of a JSON_BOOL.
+         */
+        bool boolean;
+
+        /*!
+         * The total number of nodes nested inside a JSON_ARRAY or JSON_OBJECT.
+         */
+        s64 descendants;
+    } value;
+} JSONNode;
+
+/*!
+ * A parsed JSON document.
+ *
+ * Strings without escape sequences point directly into the String that was parsed,
+ * so the JSONDoc is only valid for as long as that String is.
+ */
+typedef struct JSONDoc {
+    /*!
+     * The array of JSONNodes in the document.
+     */
+    Buffer nodes;
+
+    /*!
+     * The number of JSONNodes in {nodes}.
+     */
+    s64 nodeCount;
+
+    /*!
+     * The block of memory currently being used to store unescaped strings. The first
+     * chars of each block point to the block that was allocated before it.
+     */
+    Buffer strings;
+
+    /*!
+     * The number of chars of {strings} that have been used.
+     */
+    s64 stringsLength;
+
+    /*!
+     * The index of the char in the parsed String at which an error was found, or -1 if there was no error.
+     */
+    s64 errorOffset;
+} JSONDoc;
+
+/*!
+ * The ways that json_parseUsing can parse a document.
+ */
+typedef enum JSONParseMethod {
+    /*!
+     * Use the method that is fastest for typical documents, which is currently JSON_PARSE_SEQUENTIAL.
+     *
+     * Most of the time spent parsing goes to checking and storing values rather than finding them,
+     * so visiting only the positions in a JSONIndex does not save enough to pay for creating it.
+     */
+    JSON_PARSE_AUTO = 0,
+
+    /*!
+     * Find the positions of all the structural chars using json_createIndex,
+     * and then build the document by visiting only those positions.
+     */
+    JSON_PARSE_INDEXED,
+
+    /*!
+     * Build the document while moving through it one char at a time.
+     */
+    JSON_PARSE_SEQUENTIAL
+} JSONParseMethod;
+
+/*!
+ * Parse the JSON document {json}, using JSON_PARSE_AUTO.
+ *
+ * The returned JSONDoc should be destroyed using json_destroy once it is no longer in use.
+ *
+ * If {json} is not valid JSON, an errored JSONDoc will be returned, with the offset of the error available through
+ * json_getErrorOffset. The CLibErrorType will be ERROR_JSON_SYNTAX for malformed JSON, ERROR_JSON_DEPTH if arrays and
+ * objects are nested deeper than JSON_MAX_DEPTH, ERROR_INVALID_CODEPOINT for invalid UTF-8 or an unpaired surrogate
+ * escape, or ERROR_OVERFLOW for a number that is too large for a double.
+ */
+JSONDoc json_parse(String json);
+
+/*!
+ * Parse the JSON document {json} using {method}.
+ *
+ * Every method accepts and rejects the same documents, and builds the same JSONDoc.
+ * Returns an errored JSONDoc with CLibErrorType ERROR_ARG_INVALID if JSON_PARSE_INDEXED
+ * is requested for a document that is longer than JSON_INDEX_MAX_LENGTH chars.
+ */
+JSONDoc json_parseUsing(String json, JSONParseMethod method);
+
+/*!
+ * Creates a JSONDoc that is in an errored state, with the error found at {offset}.
+ */
+JSONDoc json_createErrored(CLibErrorType errorType, s64 offset);
+
+/*!
+ * Check whether {doc} is in an errored state.
+ */
+bool json_isErrored(JSONDoc doc);
+
+/*!
+ * Check whether {doc} is usable and not in an errored state.
+ */
+bool json_isValid(JSONDoc doc);
+
+/*!
+ * Get the CLibErrorType for the errored JSONDoc {doc}.
+ *
+ * Will return ERROR_NONE if {doc} is not errored.
+ */
+CLibErrorType json_getErrorType(JSONDoc doc);
+
+/*!
+ * Get the index of the char in the parsed String at which the errored JSONDoc {doc} found an error.
+ *
+ * Will return -1 if {doc} is not errored.
+ */
+s64 json_getErrorOffset(JSONDoc doc);
+
+/*!
+ * Free the nodes and unescaped strings of {doc}.
+ */
+void json_destroy(JSONDoc * doc);
+
+/*!
+ * Returns the top level value of {doc}, or NULL if {doc} is errored.
+ */
+JSONNode * json_root(JSONDoc doc);
+
+/*!
+ * Returns the node after {node} and all of its children, which is the next element of an array,
+ * or the next key or value of an object. The caller must keep track of how many siblings remain.
+ */
+JSONNode * json_next(JSONNode * node);
+
+/*!
+ * Returns element {index} of {array}, or NULL if {array} is not an array or {index} is out of range.
+ */
+JSONNode * json_arrayGet(JSONNode * array, s64 index);
+
+/*!
+ * Returns the value of the first member of {object} with the key {key},
+ * or NULL if {object} is not an object or has no member with that key.
+ */
+JSONNode * json_objectGet(JSONNode * object, String key);
+
+/*!
+ * Returns the value of the first member of {object} with the null-terminated key {key},
+ * or NULL if {object} is not an object or has no member with that key.
+ */
+JSONNode * json_objectGetC(JSONNode * object, char * key);
+
+/*!
+ * Returns the chars of the JSON_STRING {node}, or an errored String
+ * with CLibErrorType ERROR_ARG_INVALID if {node} is not a string.
+ *
+ * The returned String is only valid for as long as the JSONDoc of {node}.
+ */
+String json_getString(JSONNode * node);
+
+/*!
+ * Store the value of the JSON_BOOL {node} in {value}.
+ *
+ * Returns ERROR_ARG_INVALID if {node} is not a boolean.
+ */
+CLibErrorType json_getBool(JSONNode * node, bool * value);
+
+/*!
+ * Store the value of the JSON_NUMBER {node} in {value}.
+ *
+ * Returns ERROR_ARG_INVALID if {node} is not a number.
+ */
+CLibErrorType json_getDouble(JSONNode * node, double * value);
+
+/*!
+ * Store the value of the JSON_NUMBER {node} in {value}.
+ *
+ * Returns ERROR_ARG_INVALID if {node} is not a number, or ERROR_CAST if it is not an integer that fits in an s64.
+ */
+CLibErrorType json_getS64(JSONNode * node, s64 * value);
+
+/*!
+ * The maximum length of a JSON document that json_createIndex can index, as positions are stored as u32.
+ */
+#define JSON_INDEX_MAX_LENGTH ((s64) U32_MAX)
+
+/*!
+ * The positions of the structural chars of a JSON document.
+ *
+ * These are the chars {}[]:, outside of strings, the opening quote of every string, and
+ * the first char of every other run of chars that are not whitespace, such as numbers and literals.
+ */
+typedef struct JSONIndex {
+    /*!
+     * The offsets of the structural chars in the document, in order, stored as an array of u32.
+     */
+    Buffer positions;
+
+    /*!
+     * The number of offsets stored in {positions}.
+     */
+    s64 count;
+} JSONIndex;
+
+/*!
+ * Find the positions of the structural chars of the JSON document {json}.
+ *
+ * The document is processed 64 chars at a time, building bitmaps of its quotes, backslashes, whitespace and
+ * structural chars using AVX2 when it is available. The chars inside strings are then masked out by taking
+ * the prefix XOR of the unescaped quotes using a carry-less multiply.
+ *
+ * Returns an errored JSONIndex with CLibErrorType ERROR_JSON_SYNTAX if the last string in {json} is not closed,
+ * or ERROR_ARG_INVALID if {json} is longer than JSON_INDEX_MAX_LENGTH chars. Other syntax errors are not detected.
+ *
+ * The returned JSONIndex should be destroyed using json_destroyIndex once it is no longer in use.
+ */
+JSONIndex json_createIndex(String json);
+
+/*!
+ * Check whether {index} is in an errored state.
+ */
+bool json_isIndexErrored(JSONIndex index);
+
+/*!
+ * Get the CLibErrorType for the errored JSONIndex {index}.
+ *
+ * Will return ERROR_NONE if {index} is not errored.
+ */
+CLibErrorType json_getIndexErrorType(JSONIndex index);
+
+/*!
+ * Free the positions stored in {index}.
+ */
+void json_destroyIndex(JSONIndex * index);
+
+/*!
+ * The events reported by a JSONStream as it moves through a document.
+ */
+typedef enum JSONEvent {
+    /*!
+     * The start of an object, which will be followed by a JSON_EVENT_KEY and a value for each member.
+     */
+    JSON_EVENT_START_OBJECT = 0,
+
+    /*!
+     * The end of the innermost open object.
+     */
+    JSON_EVENT_END_OBJECT,
+
+    /*!
+     * The start of an array, which will be followed by each of its elements.
+     */
+    JSON_EVENT_START_ARRAY,
+
+    /*!
+     * The end of the innermost open array.
+     */
+    JSON_EVENT_END_ARRAY,
+
+    /*!
+     * The unescaped key of an object member.
+     */
+    JSON_EVENT_KEY,
+
+    /*!
+     * An unescaped string value.
+     */
+    JSON_EVENT_STRING,
+
+    /*!
+     * A number value, given as the chars of the number so that it can be parsed using str_parseS64 or str_parseDouble.
+     */
+    JSON_EVENT_NUMBER,
+
+    /*!
+     * A true or false value, given as the chars "true" or "false".
+     */
+    JSON_EVENT_BOOL,
+
+    /*!
+     * A null value, given as the chars "null".
+     */
+    JSON_EVENT_NULL,
+
+    /*!
+     * The end of a top level value.
+     */
+    JSON_EVENT_END_DOCUMENT
+} JSONEvent;
+
+/*!
+ * A function called by a JSONStream for each event in a document.
+ *
+ * {text} holds the chars of keys, strings, numbers, booleans and null, and is empty for all other events.
+ * It is only valid until the callback returns, as it may point into the chunk being parsed.
+ */
+typedef void (*JSONEventCallback)(JSONEvent event, String text, void * context);
+
+/*!
+ * Parses a JSON document that arrives in chunks, reporting events as they are found rather than building a JSONDoc.
+ *
+ * Only the open containers and the current token are kept between chunks, so the memory used does not depend
+ * on the length of the document. Keys, strings and numbers that are contained in a chunk are passed to the
+ * callback as views into that chunk, and only tokens that span chunks or contain escapes are copied.
+ */
+typedef struct JSONStream {
+    /*!
+     * The function called with each event.
+     */
+    JSONEventCallback callback;
+
+    /*!
+     * The context passed to {callback}.
+     */
+    void * context;
+
+    /*!
+     * Whether the stream may contain any number of top level values separated by whitespace,
+     * such as newline delimited JSON, rather than exactly one.
+     */
+    bool allowMultiple;
+
+    /*!
+     * What the stream expects next. Only used internally.
+     */
+    u8 state;
+
+    /*!
+     * The part of a number that has been read so far. Only used internally.
+     */
+    u8 numberState;
+
+    /*!
+     * Whether the string being read is a key.
+     */
+    bool isKey;
+
+    /*!
+     * The chars of the literal being read, and how many of them have been matched.
+     */
+    char * literal;
+    s64 literalIndex;
+
+    /*!
+     * The value of the \u escape being read, the number of its hex digits that have been read,
+     * and the high surrogate before it, or 0 if there is none.
+     */
+    u32 codepoint;
+    s64 hexDigits;
+    u32 highSurrogate;
+
+    /*!
+     * The number of open arrays and objects, and a bit for each that is set if it is an object.
+     */
+    s64 depth;
+    u64 containers[JSON_MAX_DEPTH / 64];
+
+    /*!
+     * The chars of the current token, if it spans chunks or contains escapes.
+     */
+    Builder pending;
+
+    /*!
+     * Whether the chars of the current token are being collected in {pending}.
+     */
+    bool isPending;
+
+    /*!
+     * The offset in the document of the start of the current token, and of the escape being read.
+     */
+    s64 tokenOffset;
+    s64 escapeOffset;
+
+    /*!
+     * The number of chars in all of the chunks that have been fed to the stream.
+     */
+    s64 offset;
+
+    /*!
+     * The error that stopped the stream, or ERROR_NONE, and the offset in the document at which it was found.
+     */
+    CLibErrorType error;
+    s64 errorOffset;
+} JSONStream;
+
+/*!
+ * Create a JSONStream that will call {callback} with {context} for each event.
+ *
+ * If {allowMultiple} is true, the stream may contain any number of top level values, each of which ends
+ * with a JSON_EVENT_END_DOCUMENT. Otherwise, it must contain exactly one.
+ *
+ * Returns an errored JSONStream with CLibErrorType ERROR_ARG_NULL if {callback} is NULL.
+ * The returned JSONStream should be destroyed using json_destroyStream once it is no longer in use.
+ */
+JSONStream json_createStream(JSONEventCallback callback, void * context, bool allowMultiple);
+
+/*!
+ * Check whether {stream} is in an errored state.
+ */
+bool json_isStreamErrored(JSONStream stream);
+
+/*!
+ * Get the CLibErrorType for the errored JSONStream {stream}.
+ *
+ * Will return ERROR_NONE if {stream} is not errored.
+ */
+CLibErrorType json_getStreamErrorType(JSONStream stream);
+
+/*!
+ * Get the offset in the whole document at which the errored JSONStream {stream} found an error.
+ *
+ * Will return -1 if {stream} is not errored.
+ */
+s64 json_getStreamErrorOffset(JSONStream stream);
+
+/*!
+ * Parse the next {chunk} of the document of {stream}, calling its callback for each event that is completed.
+ *
+ * Returns ERROR_JSON_SYNTAX for malformed JSON, ERROR_JSON_DEPTH if arrays and objects are nested deeper than
+ * JSON_MAX_DEPTH, or ERROR_INVALID_CODEPOINT for invalid UTF-8 in a string or an unpaired surrogate escape.
+ * Once an error is found, the stream is errored and every later call returns the same error.
+ *
+ * Numbers are checked against the JSON grammar, but are not parsed.
+ */
+CLibErrorType json_streamFeed(JSONStream * stream, String chunk);
+
+/*!
+ * Feed the rest of the file read by {reader} to {stream} one buffer at a time, and then finish it using json_streamFinish.
+ *
+ * Returns the errors of reader_read if the file cannot be read, or any error found in the document.
+ */
+CLibErrorType json_streamFeedReader(JSONStream * stream, FileReader * reader);
+
+/*!
+ * Mark the end of the document of {stream}, reporting a number that was cut off by the end of the last chunk.
+ *
+ * Returns ERROR_JSON_SYNTAX if the document is incomplete.
+ */
+CLibErrorType json_streamFinish(JSONStream * stream);
+
+/*!
+ * Free the chars that {stream} collected for tokens that spanned chunks.
+ */
+void json_destroyStream(JSONStream * stream);
+
+/*!
+ * One step of a JSONPath, which selects either the member of an object with a key, or the element of an array at an index.
+ */
+typedef struct JSONPathStep {
+    /*!
+     * The key of the member to select, which points into the chars of the JSONPath.
+     */
+    String key;
+
+    /*!
+     * The index of the element to select, or -1 if this step selects a member by its key.
+     */
+    s64 index;
+} JSONPathStep;
+
+/*!
+ * A compiled path to a value in a JSON document, such as "a.b[3].c", that can be used by json_find many times.
+ */
+typedef struct JSONPath {
+    /*!
+     * A copy of the chars of the path, which the keys of {steps} point into.
+     */
+    String chars;
+
+    /*!
+     * The steps of the path, stored as an array of JSONPathStep.
+     */
+    Buffer steps;
+
+    /*!
+     * The number of steps stored in {steps}.
+     */
+    s64 stepCount;
+} JSONPath;
+
+/*!
+ * A value found in a JSON document by json_find, which has not been parsed.
+ */
+typedef struct JSONValue {
+    /*!
+     * The type of the value.
+     */
+    JSONType type;
+
+    /*!
+     * The chars of the value in the document. For a string, this is the chars between its quotes, which may contain escapes.
+     */
+    String chars;
+
+    /*!
+     * Whether the chars of a string contain escapes, so that they must be unescaped using json_getValueString.
+     */
+    bool isEscaped;
+} JSONValue;
+
+/*!
+ * Compile {path} into a JSONPath for json_find.
+ *
+ * A path is made of keys separated by '.', each of which may be followed by any number of array indices such
+ * as "[3]". It may also start with an array index, and the empty path selects the top level value.
+ * Keys are matched against the unescaped keys of objects, and may contain any chars other than '.' and '['.
+ *
+ * Returns an errored JSONPath with CLibErrorType ERROR_FORMAT if {path} is malformed.
+ * The returned JSONPath should be destroyed using json_destroyPath once it is no longer in use.
+ */
+JSONPath json_compilePath(String path);
+
+/*!
+ * Check whether {path} is in an errored state.
+ */
+bool json_isPathErrored(JSONPath path);
+
+/*!
+ * Get the CLibErrorType for the errored JSONPath {path}.
+ *
+ * Will return ERROR_NONE if {path} is not errored.
+ */
+CLibErrorType json_getPathErrorType(JSONPath path);
+
+/*!
+ * Free the chars and steps of {path}.
+ */
+void json_destroyPath(JSONPath * path);
+
+/*!
+ * Find the value at {path} in the JSON document {json}, and store it in {value}.
+ *
+ * Only the chars along the path are parsed. Values that are not on the path are skipped without being checked,
+ * with arrays and objects skipped by matching their brackets outside of strings 64 chars at a time using AVX2
+ * when it is available. Nothing after the value that is found is checked either. The first member with a
+ * matching key is used if an object contains the same key more than once.
+ *
+ * Returns ERROR_JSON_NOT_FOUND if there is no value at {path}, including when a step expects an object or
+ * array but finds another type of value. Returns ERROR_JSON_SYNTAX if malformed JSON is found along the path,
+ * ERROR_INVALID_CODEPOINT for an unpaired surrogate escape in a key, or ERROR_ARG_INVALID if {path} is errored.
+ */
+CLibErrorType json_find(String json, JSONPath path, JSONValue * value);
+
+/*!
+ * Find the value at the null-terminated path {path} in the JSON document {json}, compiling it using json_compilePath.
+ *
+ * Returns ERROR_FORMAT if {path} is malformed, or otherwise the same errors as json_find.
+ */
+CLibErrorType json_findC(String json, char * path, JSONValue * value);
+
+/*!
+ * Store the value of the JSON_BOOL {value} in {result}.
+ *
+ * Returns ERROR_ARG_NULL if {result} is NULL, or ERROR_ARG_INVALID if {value} is not a boolean.
+ */
+CLibErrorType json_getValueBool(JSONValue value, bool * result);
+
+/*!
+ * Parse the JSON_NUMBER {value} into {result}.
+ *
+ * Returns ERROR_ARG_NULL if {result} is NULL, ERROR_ARG_INVALID if {value} is not a number,
+ * or the error from str_parseDouble if it cannot be parsed, such as ERROR_OVERFLOW if it is
+ * too large for a double.
+ */
+CLibErrorType json_getValueDouble(JSONValue value, double * result);
+
+/*!
+ * Parse the JSON_NUMBER {value} into {result}.
+ *
+ * Returns ERROR_ARG_NULL if {result} is NULL, ERROR_ARG_INVALID if {value} is not a number,
+ * or ERROR_CAST if it is not an integer that fits in an s64.
+ */
+CLibErrorType json_getValueS64(JSONValue value, s64 * result);
+
+/*!
+ * Returns a copy of the unescaped chars of the JSON_STRING {value}.
+ *
+ * Returns an errored String with CLibErrorType ERROR_ARG_INVALID if {value} is not a string, ERROR_JSON_SYNTAX
+ * if it contains an invalid escape, or ERROR_INVALID_CODEPOINT if it contains an unpaired surrogate escape.
+ * The chars of strings that are not escaped can be used directly from {value} without copying them.
+ *
+ * The returned String should be destroyed once it is no longer in use.
+ */
+String json_getValueString(JSONValue value);
+
+/*!
+ * The maximum number of spaces that a JSONWriter will indent each level of nesting by.
+ */
+#define JSON_MAX_INDENT 64
+
+/*!
+ * Writes JSON documents into a Builder, escaping strings and adding the commas, colons and any indentation between values.
+ *
+ * Any number of top level values may be written, each on its own line, such as for newline delimited JSON.
+ * The output can be taken using json_writerStr, and the writer reused for the next document using
+ * json_resetWriter, which keeps the memory that has already been allocated.
+ */
+typedef struct JSONWriter {
+    /*!
+     * The chars that have been written.
+     */
+    Builder output;
+
+    /*!
+     * The number of spaces to indent each level of nesting by, or 0 to write compact JSON without any whitespace.
+     */
+    s64 indent;
+
+    /*!
+     * The number of open arrays and objects, and a bit for each that is set if it is an object.
+     */
+    s64 depth;
+    u64 containers[JSON_MAX_DEPTH / 64];
+
+    /*!
+     * Whether nothing has been written in the innermost open array or object yet.
+     */
+    bool isFirst;
+
+    /*!
+     * Whether the innermost open object is waiting for a key, rather than for the value of a key.
+     */
+    bool expectKey;
+
+    /*!
+     * Whether any top level value has been started.
+     */
+    bool hasValue;
+
+    /*!
+     * The error caused by a misuse of the writer, or ERROR_NONE.
+     */
+    CLibErrorType error;
+} JSONWriter;
+
+/*!
+ * Create a JSONWriter that indents each level of nesting by {indent} spaces, or writes compact JSON if {indent} is 0.
+ *
+ * Returns an errored JSONWriter with CLibErrorType ERROR_ARG_INVALID if {indent} is negative or more than JSON_MAX_INDENT.
+ * The returned JSONWriter should be destroyed using json_destroyWriter once it is no longer in use.
+ */
+JSONWriter json_createWriter(s64 indent);
+
+/*!
+ * Check whether {writer} is in an errored state.
+ */
+bool json_isWriterErrored(JSONWriter writer);
+
+/*!
+ * Get the CLibErrorType for the errored JSONWriter {writer}.
+ *
+ * Will return ERROR_NONE if {writer} is not errored.
+ */
+CLibErrorType json_getWriterErrorType(JSONWriter writer);
+
+/*!
+ * Returns the chars written by {writer}.
+ *
+ * Returns an errored String with the CLibErrorType of {writer} if it is errored,
+ * or ERROR_JSON_SYNTAX if it has open arrays or objects.
+ *
+ * The returned String is only valid until {writer} is next used.
+ */
+String json_writerStr(JSONWriter writer);
+
+/*!
+ * Discard everything written by {writer} and any error, keeping its memory to write the next document into.
+ */
+void json_resetWriter(JSONWriter * writer);
+
+/*!
+ * Free the output of {writer}.
+ */
+void json_destroyWriter(JSONWriter * writer);
+
+/*!
+ * Write the start of an object, whose members can then be written using json_writeKey followed by a value.
+ *
+ * Like all of the json_write functions, a misuse such as writing a value in an object that is waiting for a
+ * key will make {writer} errored with CLibErrorType ERROR_ARG_INVALID, and every later call return that error.
+ * Returns ERROR_JSON_DEPTH if arrays and objects are nested deeper than JSON_MAX_DEPTH.
+ */
+CLibErrorType json_writeStartObject(JSONWriter * writer);
+
+/*!
+ * Write the end of the innermost open object.
+ */
+CLibErrorType json_writeEndObject(JSONWriter * writer);
+
+/*!
+ * Write the start of an array.
+ */
+CLibErrorType json_writeStartArray(JSONWriter * writer);
+
+/*!
+ * Write the end of the innermost open array.
+ */
+CLibErrorType json_writeEndArray(JSONWriter * writer);
+
+/*!
+ * Write {key} as the key of the next member of the innermost open object.
+ */
+CLibErrorType json_writeKey(JSONWriter * writer, String key);
+
+/*!
+ * Write the null-terminated string {key} as the key of the next member of the innermost open object.
+ */
+CLibErrorType json_writeKeyC(JSONWriter * writer, char * key);
+
+/*!
+ * Write {string} as a string value.
+ *
+ * Quotes, backslashes and control chars are escaped, and all other chars are copied as they are, so {string}
+ * should be valid UTF-8. The chars that need escaping are found 32 at a time using AVX2 when it is available,
+ * and the runs of chars between them are copied in bulk.
+ */
+CLibErrorType json_writeString(JSONWriter * writer, String string);
+
+/*!
+ * Write the null-terminated string {string} as a string value.
+ */
+CLibErrorType json_writeStringC(JSONWriter * writer, char * string);
+
+/*!
+ * Write {value} as an integer.
+ */
+CLibErrorType json_writeS64(JSONWriter * writer, s64 value);
+
+/*!
+ * Write {value} as a number that round-trips exactly, using builder_appendDouble.
+ *
+ * The number is almost always the shortest that parses back to {value}, but may occasionally
+ * have one more digit than necessary.
+ *
+ * Returns ERROR_ARG_INVALID if {value} is NaN or infinite, as JSON cannot represent them.
+ */
+CLibErrorType json_writeDouble(JSONWriter * writer, double value);
+
+/*!
+ * Write {value} as true or false.
+ */
+CLibErrorType json_writeBool(JSONWriter * writer, bool value);
+
+/*!
+ * Write a null value.
+ */
+CLibErrorType json_writeNull(JSONWriter * writer);
+
+/*!
+ * Write the value of {node} and all of its children, such as to write a JSONDoc built by json_parse.
+ */
+CLibErrorType json_writeNode(JSONWriter * writer, JSONNode * node);
+
+
+
+//
+// NDJSON
+//
+
+/*!
+ * The number of chars of a newline delimited JSON file that ndjson_parallelParse hands to a thread at a time.
+ */
+#define NDJSON_BATCH_SIZE ((s64) 1024 * 1024)
+
+/*!
+ * A function called by ndjson_parallelParse with the document parsed from each line of a file.
+ *
+ * {doc} is errored if {record} is not valid JSON, and otherwise is only valid until the callback returns.
+ * It must not be destroyed, as its memory is reused for the lines that follow.
+ * {record} is the line that was parsed, without its '\n', and points into the file.
+ * {thread} is the index of the thread that parsed the line, from 0 up to the number of threads.
+ */
+typedef void (*NDJSONCallback)(JSONDoc doc, String record, s64 thread, void * context);
+
+/*!
+ * Parse each line of the newline delimited JSON file {filename} as a JSON document, using {threads}
+ * threads, and call {callback} with each document and {context}. Lines that only contain whitespace are skipped.
+ *
+ * The file is split at the first '\n' after every NDJSON_BATCH_SIZE chars, and each thread takes the next
+ * unparsed batch. Each thread parses into its own JSONDoc, whose memory is reused for every line it parses.
+ *
+ * If {ordered} is true, {callback} is called for one line at a time in the order they appear in the file.
+ * Each thread parses a whole batch before waiting for the batches before it to be delivered.
+ * If {ordered} is false, {callback} is called from every thread at once, as soon as each line is parsed.
+ *
+ * If {threads} is 0, one thread will be used for each online processor.
+ * Returns the errors of str_mapFile or str_readFile if the file cannot be read.
+ */
+CLibErrorType ndjson_parallelParse(char * filename, s64 threads, bool ordered,
+                                   NDJSONCallback callback, void * context);
+
+
+
+//
+// Queues
+//
+
+/*!
+ * The size of a cache line, used to keep the parts of a queue that are written by different threads apart.
+ */
+#define QUEUE_CACHE_LINE 64
+
+/*!
+ * The number of times a blocking queue operation retries before it yields or sleeps.
+ * Only one retry is made between each yield or sleep when there is a single processor,
+ * as the other thread cannot change the queue while this one spins.
+ */
+#define QUEUE_SPIN_LIMIT 256
+
+/*!
+ * How a blocking queue operation waits for the queue to have room or items.
+ */
+typedef enum QueueWaitMode {
+    /*!
+     * Keep retrying, yielding the processor after every QUEUE_SPIN_LIMIT attempts.
+     * Has the lowest latency when each thread has a core to itself.
+     */
+    QUEUE_WAIT_SPIN = 0,
+
+    /*!
+     * Retry QUEUE_SPIN_LIMIT times, and then sleep using a futex until another thread changes the queue.
+     */
+    QUEUE_WAIT_FUTEX
+} QueueWaitMode;
+
+/*!
+ * Allows threads to sleep until a change to a queue that they are waiting for.
+ */
+typedef struct QueueEvent {
+    /*!
+     * Incremented when the event is notified while threads may be sleeping. Used as the futex word.
+     */
+    u32 sequence;
+
+    /*!
+     * Set by threads before they sleep on the event, and cleared when they are woken,
+     * so that notifying the event only makes a system call if a thread may be sleeping.
+     */
+    u32 sleeping;
+} QueueEvent;
+
+/*!
+ * A bounded queue of Strings from a single producer thread to a single consumer thread, which needs no locks.
+ *
+ * Strings are moved into and out of the queue by value, so only their pointer and length are copied,
+ * and the queue owns the Strings in it until they are popped. The head written by the consumer and the
+ * tail written by the producer are kept on separate cache lines, and each side keeps a copy of the other's
+ * index so that it only reads the other's cache line when the queue looks full or empty.
+ *
+ * The queue must not be copied or moved once it is in use by more than one thread.
+ */
+typedef struct SPSCQueue {
+    String * slots;
+    s64 capacity;
+    QueueWaitMode waitMode;
+    CLibErrorType error;
+    u32 closed;
+
+    char padding0[QUEUE_CACHE_LINE];
+
+    /*!
+     * The index of the next String to pop, written by the consumer.
+     */
+    s64 head;
+
+    /*!
+     * The consumer's copy of {tail}.
+     */
+    s64 cachedTail;
+
+    /*!
+     * Notified by the consumer when it makes room, for the producer to wait on.
+     */
+    QueueEvent popped;
+
+    char padding1[QUEUE_CACHE_LINE];
+
+    /*!
+     * The index after the last String pushed, written by the producer.
+     */
+    s64 tail;
+
+    /*!
+     * The producer's copy of {head}.
+     */
+    s64 cachedHead;
+
+    /*!
+     * Notified by the producer when it adds Strings, for the consumer to wait on.
+     */
+    QueueEvent pushed;
+
+    char padding2[QUEUE_CACHE_LINE];
+} SPSCQueue;
+
+/*!
+ * Create an SPSCQueue that can hold {capacity} Strings, rounded up to a power of 2, using {waitMode} to block.
+ *
+ * Returns an errored SPSCQueue with CLibErrorType ERROR_ARG_INVALID if {capacity} is not positive,
+ * ERROR_OVERFLOW if it is too large, or ERROR_ALLOC if the memory for it could not be allocated.
+ * The returned SPSCQueue should be destroyed using spsc_destroy once it is no longer in use.
+ */
+SPSCQueue spsc_create(s64 capacity, QueueWaitMode waitMode);
+
+/*!
+ * Check whether {queue} is in an errored state.
+ */
+bool spsc_isErrored(SPSCQueue queue);
+
+/*!
+ * Get the CLibErrorType for the errored SPSCQueue {queue}.
+ *
+ * Will return ERROR_NONE if {queue} is not errored.
+ */
+CLibErrorType spsc_getErrorType(SPSCQueue queue);
+
+/*!
+ * Destroy {queue}, and any Strings still in it. No other thread may be using {queue}.
+ */
+void spsc_destroy(SPSCQueue * queue);
+
+/*!
+ * Close {queue}, so that no more Strings can be pushed, and wake any threads waiting on it.
+ * The Strings already in {queue} can still be popped.
+ */
+void spsc_close(SPSCQueue * queue);
+
+/*!
+ * Push {string} to {queue} if it has room. Returns whether it was pushed.
+ */
+bool spsc_tryPush(SPSCQueue * queue, String string);
+
+/*!
+ * Push {string} to {queue}, waiting for room if it is full.
+ *
+ * Returns ERROR_QUEUE_CLOSED, without pushing {string}, if {queue} is closed.
+ */
+CLibErrorType spsc_push(SPSCQueue * queue, String string);
+
+/*!
+ * Push as many of the {count} Strings in {strings} to {queue} as it has room for, in order.
+ * Returns the number that were pushed.
+ */
+s64 spsc_tryPushBatch(SPSCQueue * queue, String * strings, s64 count);
+
+/*!
+ * Push all of the {count} Strings in {strings} to {queue} in order, waiting for room whenever it is full.
+ * Returns the number that were pushed, which is only less than {count} if {queue} was closed.
+ */
+s64 spsc_pushBatch(SPSCQueue * queue, String * strings, s64 count);
+
+/*!
+ * Pop the oldest String in {queue} into {string} if there is one. Returns whether a String was popped.
+ */
+bool spsc_tryPop(SPSCQueue * queue, String * string);
+
+/*!
+ * Pop the oldest String in {queue} into {string}, waiting for one if it is empty.
+ *
+ * Returns ERROR_QUEUE_CLOSED once {queue} is closed and empty.
+ */
+CLibErrorType spsc_pop(SPSCQueue * queue, String * string);
+
+/*!
+ * Pop up to {count} of the oldest Strings in {queue} into {strings}. Returns the number that were popped.
+ */
+s64 spsc_tryPopBatch(SPSCQueue * queue, String * strings, s64 count);
+
+/*!
+ * Pop up to {count} of the oldest Strings in {queue} into {strings}, waiting until there is at least one.
+ * Returns the number that were popped, which is only 0 once {queue} is closed and empty.
+ */
+s64 spsc_popBatch(SPSCQueue * queue, String * strings, s64 count);
+
+/*!
+ * A slot in an MPMCQueue.
+ */
+typedef struct MPMCCell {
+    /*!
+     * The position the cell can next be pushed to, or the position after the one it can next be popped from.
+     */
+    s64 sequence;
+
+    String value;
+} MPMCCell;
+
+/*!
+ * A bounded queue of Strings for any number of producer and consumer threads, using Dmitry Vyukov's design.
+ *
+ * Each cell has a sequence number that says whether it is ready to be pushed to or popped from at a position,
+ * so producers and consumers only contend on claiming positions, with a compare and swap. The positions
+ * claimed by producers and consumers are kept on separate cache lines. A batch is claimed with a single
+ * compare and swap over the run of cells that are ready from the next position.
+ *
+ * Strings are moved into and out of the queue by value, as in SPSCQueue.
+ * The queue must not be copied or moved once it is in use by more than one thread.
+ */
+typedef struct MPMCQueue {
+    MPMCCell * cells;
+    s64 capacity;
+    QueueWaitMode waitMode;
+    CLibErrorType error;
+    u32 closed;
+
+    char padding0[QUEUE_CACHE_LINE];
+
+    /*!
+     * The next position to be claimed by a producer.
+     */
+    s64 pushPosition;
+
+    /*!
+     * Notified by producers when they add Strings, for consumers to wait on.
+     */
+    QueueEvent pushed;
+
+    char padding1[QUEUE_CACHE_LINE];
+
+    /*!
+     * The next position to be claimed by a consumer.
+     */
+    s64 popPosition;
+
+    /*!
+     * Notified by consumers when they make room, for producers to wait on.
+     */
+    QueueEvent popped;
+
+    char padding2[QUEUE_CACHE_LINE];
+} MPMCQueue;
+
+/*!
+ * Create an MPMCQueue that can hold {capacity} Strings, rounded up to a power of 2 of at least 2,
+ * using {waitMode} to block.
+ *
+ * Returns an errored MPMCQueue with CLibErrorType ERROR_ARG_INVALID if {capacity} is not positive,
+ * ERROR_OVERFLOW if it is too large, or ERROR_ALLOC if the memory for it could not be allocated.
+ * The returned MPMCQueue should be destroyed using mpmc_destroy once it is no longer in use.
+ */
+MPMCQueue mpmc_create(s64 capacity, QueueWaitMode waitMode);
+
+/*!
+ * Check whether {queue} is in an errored state.
+ */
+bool mpmc_isErrored(MPMCQueue queue);
+
+/*!
+ * Get the CLibErrorType for the errored MPMCQueue {queue}.
+ *
+ * Will return ERROR_NONE if {queue} is not errored.
+ */
+CLibErrorType mpmc_getErrorType(MPMCQueue queue);
+
+/*!
+ * Destroy {queue}, and any Strings still in it. No other thread may be using {queue}.
+ */
+void mpmc_destroy(MPMCQueue * queue);
+
+/*!
+ * Close {queue}, so that no more Strings can be pushed, and wake any threads waiting on it.
+ * The Strings already in {queue} can still be popped.
+ */
+void mpmc_close(MPMCQueue * queue);
+
+/*!
+ * The same as spsc_tryPush, for an MPMCQueue.
+ */
+bool mpmc_tryPush(MPMCQueue * queue, String string);
+
+/*!
+ * The same as spsc_push, for an MPMCQueue.
+ */
+CLibErrorType mpmc_push(MPMCQueue * queue, String string);
+
+/*!
+ * The same as spsc_tryPushBatch, for an MPMCQueue. The Strings pushed are in consecutive
+ * positions, so they are not interleaved with Strings pushed by other threads.
+ */
+s64 mpmc_tryPushBatch(MPMCQueue * queue, String * strings, s64 count);
+
+/*!
+ * The same as spsc_pushBatch, for an MPMCQueue. Each time {queue} has room,
+ * the Strings that fit are pushed in consecutive positions.
+ */
+s64 mpmc_pushBatch(MPMCQueue * queue, String * strings, s64 count);
+
+/*!
+ * The same as spsc_tryPop, for an MPMCQueue.
+ */
+bool mpmc_tryPop(MPMCQueue * queue, String * string);
+
+/*!
+ * The same as spsc_pop, for an MPMCQueue.
+ */
+CLibErrorType mpmc_pop(MPMCQueue * queue, String * string);
+
+/*!
+ * The same as spsc_tryPopBatch, for an MPMCQueue. The Strings popped are from consecutive positions.
+ */
+s64 mpmc_tryPopBatch(MPMCQueue * queue, String * strings, s64 count);
+
+/*!
+ * The same as spsc_popBatch, for an MPMCQueue.
+ */
+s64 mpmc_popBatch(MPMCQueue * queue, String * strings, s64 count);
+
+
+
+//
+// Thread Pools
+//
+
+/*!
+ * The number of tasks each worker of a ThreadPool can hold waiting in its deque.
+ * A task spawned by a worker whose deque is full is run straight away instead.
+ */
+#define POOL_DEQUE_CAPACITY 1024
+
+/*!
+ * A task run by a ThreadPool, which is passed the {context} it was spawned with.
+ */
+typedef void (*TaskFunction)(void * context);
+
+/*!
+ * The body of a parallel_for, which should process the indices in [{start}, {end}).
+ */
+typedef void (*ParallelForFunction)(s64 start, s64 end, void * context);
+
+/*!
+ * A set of worker threads that run tasks, where each worker pushes the tasks it spawns onto its own deque,
+ * and workers that run out of tasks steal them from the other end of the deques of other workers.
+ *
+ * The lifecycle of a ThreadPool is:
+ *  1. pool_create starts the workers, which sleep until there are tasks to run.
+ *  2. Tasks are spawned in TaskGroups using taskgroup_run, or by parallel_for, from any thread.
+ *     Threads waiting for a TaskGroup, or a parallel_for, run the pool's tasks until it is complete.
+ *  3. pool_destroy stops and joins the workers, once every TaskGroup using the pool has been waited for.
+ *
+ * The ThreadPool itself may be copied, as the state shared with the workers is allocated separately.
+ */
+typedef struct ThreadPool {
+    struct PoolShared * shared;
+
+    /*!
+     * The number of worker threads in the pool.
+     */
+    s64 threads;
+
+    CLibErrorType error;
+} ThreadPool;
+
+/*!
+ * A set of tasks spawned using taskgroup_run that can be waited for together using taskgroup_wait.
+ * Tasks in a TaskGroup may spawn more tasks in the same TaskGroup, or wait for TaskGroups of their own.
+ *
+ * The TaskGroup must not be moved between spawning tasks in it and waiting for them.
+ */
+typedef struct TaskGroup {
+    struct PoolShared * shared;
+
+    /*!
+     * The number of tasks spawned in the group that have not yet finished.
+     */
+    s64 pending;
+} TaskGroup;
+
+/*!
+ * Create a ThreadPool with {threads} workers, or one worker per processor if {threads} is 0.
+ * If {pinned} is true, each worker is pinned to a processor, where that is supported.
+ *
+ * Workers that could not be started are skipped, as the threads waiting for tasks also run them.
+ *
+ * Returns an errored ThreadPool with CLibErrorType ERROR_ARG_INVALID if {threads} is negative,
+ * or ERROR_ALLOC if the pool could not be allocated.
+ * The returned ThreadPool should be destroyed using pool_destroy once it is no longer in use.
+ */
+ThreadPool pool_create(s64 threads, bool pinned);
+
+/*!
+ * Check whether {pool} is in an errored state.
+ */
+bool pool_isErrored(ThreadPool pool);
+
+/*!
+ * Get the CLibErrorType for the errored ThreadPool {pool}.
+ *
+ * Will return ERROR_NONE if {pool} is not errored.
+ */
+CLibErrorType pool_getErrorType(ThreadPool pool);
+
+/*!
+ * Stop and join the workers of {pool}, and free it.
+ * Every TaskGroup and parallel_for using {pool} must have finished waiting first.
+ */
+void pool_destroy(ThreadPool * pool);
+
+/*!
+ * Create an empty TaskGroup that spawns its tasks in {pool}.
+ * If {pool} is errored, the tasks are instead run as they are spawned.
+ */
+TaskGroup taskgroup_create(ThreadPool pool);
+
+/*!
+ * Spawn a task in {group} that calls {function} with {context}.
+ *
+ * When called from a worker the task is pushed onto the worker's deque, and otherwise
+ * it is queued for the workers to take. The task is run straight away if it can't be queued.
+ */
+void taskgroup_run(TaskGroup * group, TaskFunction function, void * context);
+
+/*!
+ * Wait for all of the tasks spawned in {group} to finish, running tasks from its pool while waiting.
+ */
+void taskgroup_wait(TaskGroup * group);
+
+/*!
+ * Call {function} over the range [{begin}, {end}) using the workers of {pool}, and wait for it to complete.
+ *
+ * The range is split in half recursively until the parts are no larger than {grain} indices,
+ * and workers steal the largest remaining parts from each other. If {grain} is not positive,
+ * it is picked to give each thread about eight parts. parallel_for may be called from within a task.
+ *
+ * Returns ERROR_SUCCESS, or ERROR_ARG_INVALID if {pool} is errored, in which case {function} is not called.
+ */
+CLibErrorType parallel_for(ThreadPool pool, s64 begin, s64 end, s64 grain, ParallelForFunction function, void * context);
+
+/*!
+ * The same as u64_mergeSort, with runs of {array} sorted and then merged in parallel using {pool}.
+ * Falls back to u64_mergeSort if {pool} is errored.
+ *
+ * Returns false if the buffer used to sort could not be allocated.
+ */
+bool u64_parallelSort(ThreadPool pool, u64 * array, u64 length);
+
+/*!
+ * The same as str_indexOfChar, with parts of {string} searched in parallel using {pool}.
+ * Falls back to str_indexOfChar if {pool} is errored.
+ */
+s64 str_parallelIndexOfChar(ThreadPool pool, String string, char find);
+
+
+
+//
+// Concurrent Maps
+//
+
+/*!
+ * The largest number of shards a ConcurrentMap can be split into.
+ */
+#define CMAP_MAX_SHARDS ((s64) 1 << 16)
+
+/*!
+ * Called by cmap_upsert with the {value} of {key}, or 0 if {exists} is false,
+ * and returns the value to store for {key}.
+ */
+typedef u64 (*MapUpsertFunction)(String key, u64 value, bool exists, void * context);
+
+/*!
+ * A hash map from Strings to u64 values that can be used by many threads at once.
+ *
+ * Keys are hashed using str_hash and split between shards by their hash. Each shard has an open addressing
+ * table that is only changed while holding the shard's lock, so threads writing to different shards don't
+ * contend. Reads take no locks: entries are published once they are complete, and when a shard grows its old
+ * table is kept until the map is destroyed, so readers that are part way through it can finish safely.
+ * Only the shard being grown is locked while it grows, and the rest of the map stays available.
+ *
+ * Keys are copied into the map, and entries are only removed when the map is destroyed.
+ * The ConcurrentMap itself may be copied, as its shards are allocated separately.
+ */
+typedef struct ConcurrentMap {
+    struct MapShard * shards;
+    s64 shardCount;
+    u64 seed;
+    CLibErrorType error;
+} ConcurrentMap;
+
+/*!
+ * Create an empty ConcurrentMap with {shards} shards, rounded up to a power of 2,
+ * or four per processor if {shards} is 0, that hashes its keys using {seed}.
+ * Picking a random {seed} stops keys being chosen that all collide.
+ *
+ * Returns an errored ConcurrentMap with CLibErrorType ERROR_ARG_INVALID if {shards} is negative
+ * or more than CMAP_MAX_SHARDS, or ERROR_ALLOC if the map could not be allocated.
+ * The returned ConcurrentMap should be destroyed using cmap_destroy once it is no longer in use.
+ */
+ConcurrentMap cmap_create(s64 shards, u64 seed);
+
+/*!
+ * Check whether {map} is in an errored state.
+ */
+bool cmap_isErrored(ConcurrentMap map);
+
+/*!
+ * Get the CLibErrorType for the errored ConcurrentMap {map}.
+ *
+ * Will return ERROR_NONE if {map} is not errored.
+ */
+CLibErrorType cmap_getErrorType(ConcurrentMap map);
+
+/*!
+ * Destroy {map}, and the copies of its keys. No other thread may be using {map}.
+ */
+void cmap_destroy(ConcurrentMap * map);
+
+/*!
+ * Returns the number of keys in {map}. If other threads are adding keys, the count may be out of date.
+ */
+s64 cmap_count(ConcurrentMap map);
+
+/*!
+ * Find the value of {key} in {map}, without taking any locks.
+ *
+ * Returns whether {key} was found, with its value stored in {value} if it is not NULL.
+ */
+bool cmap_get(ConcurrentMap map, String key, u64 * value);
+
+/*!
+ * Add {key} to {map} with {value}, unless it is already in {map}.
+ * Keys already in {map} are found without taking the shard's lock.
+ *
+ * Returns ERROR_SUCCESS if {key} was added, or ERROR_MAP_KEY_EXISTS if it was already in {map}, with
+ * the value of {key} stored in {current} if it is not NULL. Returns ERROR_ARG_INVALID if {map} or
+ * {key} is errored, or ERROR_ALLOC if there was not room to add {key}.
+ */
+CLibErrorType cmap_insertIfAbsent(ConcurrentMap * map, String key, u64 value, u64 * current);
+
+/*!
+ * Set the value of {key} in {map} to the value returned by {function}, which is called with the current
+ * value of {key} and {context}. {function} is called while holding the lock of the shard of {key},
+ * so it should be quick and must not use {map}.
+ *
+ * Returns ERROR_SUCCESS with the new value stored in {result} if it is not NULL, ERROR_ARG_INVALID
+ * if {map} or {key} is errored, or ERROR_ALLOC if {key} was not in {map} and there was not room to add it.
+ */
+CLibErrorType cmap_upsert(ConcurrentMap * map, String key, MapUpsertFunction function, void * context, u64 * result);
 
 
 
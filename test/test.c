@@ -7,7 +7,13 @@
 #include "testBuilder.h"
 #include "testUTF.h"
 #include "testBuffer.h"
+#include "testVec.h"
+#include "testQueue.h"
+#include "testPool.h"
+#include "testMap.h"
 #include "testErrors.h"
+#include "testFiles.h"
+#include "testJSON.h"
 #include "testExamples.h"
 
 void test_all(int * failures, int * successes) {
@@ -17,7 +23,13 @@ void test_all(int * failures, int * successes) {
     test_Builder(failures, successes);
     test_UTF(failures, successes);
     test_Buffer(failures, successes);
+    test_Vec(failures, successes);
+    test_Queue(failures, successes);
+    test_Pool(failures, successes);
+    test_Map(failures, successes);
     test_errors(failures, successes);
+    test_files(failures, successes);
+    test_JSON(failures, successes);
     test_examples(failures, successes);
 }
 
@@ -124,6 +124,69 @@ bool test_builder_bufCopy() {
     return true;
 }
 
+bool test_builder_iovecCount() {
+    Builder builder = builder_create(16);
+    {
+        assert(builder_iovecCount(builder) == 0);
+
+        builder_appendC(&builder, "Apple pie");
+        assert(builder_iovecCount(builder) == 1);
+
+        assertSuccess(builder_setGrowth(&builder, BUILDER_GROWTH_CHUNKED, 16));
+        builder_appendC(&builder, " is super nice man");
+        assert(builder_iovecCount(builder) == 2);
+    }
+    builder_destroy(&builder);
+
+    return true;
+}
+
+bool test_builder_iovecs() {
+    String expected = str_create("Apple pie is super nice man, and so is banana bread");
+    Builder builder = builder_create(0);
+    {
+        assertSuccess(builder_setGrowth(&builder, BUILDER_GROWTH_CHUNKED, 8));
+
+        builder_appendC(&builder, "Apple pie is ");
+        builder_appendC(&builder, "super nice");
+        builder_appendChar(&builder, ' ');
+        builder_appendC(&builder, "man, and so is banana bread");
+        assert(builder.length == expected.length);
+        assert(builder.reallocCount == 0);
+
+        struct iovec iovecs[16];
+        s64 count = builder_iovecs(builder, iovecs, 16);
+        assert(count == builder_iovecCount(builder));
+        assert(count > 1);
+
+        s64 offset = 0;
+        for(s64 index = 0; index < count; ++index) {
+            String chunk = str_createOfLength(iovecs[index].iov_base, (s64) iovecs[index].iov_len);
+            assert(str_equals(chunk, str_substring(expected, offset, offset + chunk.length)));
+            offset += chunk.length;
+        }
+        assert(offset == expected.length);
+
+        assert(builder_iovecs(builder, iovecs, 1) == 1);
+        assert(iovecs[0].iov_base != NULL);
+
+        String joined = builder_str(builder);
+        assert(str_equals(joined, expected));
+        str_destroy(&joined);
+
+        String copy = builder_strCopy(builder);
+        assert(str_equals(copy, expected));
+        str_destroy(&copy);
+
+        assertSuccess(builder_setGrowth(&builder, BUILDER_GROWTH_POWER_OF_2, 0));
+        assert(builder_iovecCount(builder) == 1);
+        assert(str_equals(builder_str(builder), expected));
+    }
+    builder_destroy(&builder);
+
+    return true;
+}
+
 bool test_builder_setCapacity() {
     Builder builder = builder_create(32);
     builder_appendC(&builder, "Testing testing, 1, 2, 3");
@@ -161,6 +224,106 @@ bool test_builder_ensureCapacity() {
     }
     builder_destroy(&builder);
 
+    builder = builder_create(0);
+    {
+        assertSuccess(builder_setGrowth(&builder, BUILDER_GROWTH_CHUNKED, 8));
+
+        for(int index = 0; index < 100; ++index) {
+            assertSuccess(builder_appendChar(&builder, 'x'));
+        }
+        assert(builder_iovecCount(builder) > 1);
+
+        // Failing to allocate a new chunk should free the existing chunks and error the Builder
+        assert(builder_ensureCapacity(&builder, S64_MAX / 2) == ERROR_ALLOC);
+        assert(buf_getErrorType(builder.buffer) == ERROR_ALLOC);
+        assert(builder.chunkCount == 0);
+        assert(builder_appendChar(&builder, 'x') == ERROR_ARG_INVALID);
+    }
+    builder_destroy(&builder);
+
+    return true;
+}
+
+bool test_builder_setGrowth() {
+    Builder builder = builder_create(32);
+    {
+        assertSuccess(builder_setGrowth(&builder, BUILDER_GROWTH_ONE_AND_A_HALF, 0));
+        assertSuccess(builder_ensureCapacity(&builder, 33));
+        assert(builder.buffer.size == 48);
+        assertSuccess(builder_ensureCapacity(&builder, 100));
+        assert(builder.buffer.size == 100);
+
+        assertSuccess(builder_setGrowth(&builder, BUILDER_GROWTH_FIXED, 10));
+        assertSuccess(builder_ensureCapacity(&builder, 125));
+        assert(builder.buffer.size == 130);
+
+        assert(builder_setGrowth(&builder, BUILDER_GROWTH_FIXED, 0) == ERROR_ARG_INVALID);
+        assert(builder_setGrowth(&builder, BUILDER_GROWTH_COUNT, 0) == ERROR_ARG_INVALID);
+        assert(builder_isValid(builder));
+    }
+    builder_destroy(&builder);
+
+    builder = builder_create(0);
+    {
+        assertSuccess(builder_setGrowth(&builder, BUILDER_GROWTH_HUGE, 4096));
+
+        for(s64 index = 0; index < 10000; ++index) {
+            assertSuccess(builder_appendChar(&builder, (char) ('a' + index % 26)));
+        }
+        assert(builder.isMapped);
+        assert(builder.length == 10000);
+
+        String string = builder_str(builder);
+        assert(!str_isOwnAllocation(string));
+        for(s64 index = 0; index < 10000; ++index) {
+            assert(string.data[index] == (char) ('a' + index % 26));
+        }
+
+        Buffer buffer = builder_buf(builder);
+        assert(buf_isValid(buffer));
+        assert(buffer.start != builder.buffer.start);
+        assert(buffer.size == 10000);
+        assert(memcmp(buffer.start, string.data, 10000) == 0);
+        buf_destroy(&buffer);
+
+        assertSuccess(builder_trimToLength(&builder));
+        assert(builder.buffer.size == 10000);
+        assert(builder.isMapped);
+
+        assertSuccess(builder_setGrowth(&builder, BUILDER_GROWTH_POWER_OF_2, 0));
+        assert(!builder.isMapped);
+        assert(builder_str(builder).data[9999] == (char) ('a' + 9999 % 26));
+    }
+    builder_destroy(&builder);
+
+    return true;
+}
+
+bool test_builder_reserve() {
+    Builder builder = builder_create(0);
+    {
+        assertSuccess(builder_reserve(&builder, 1000));
+        assert(builder.buffer.size == 1000);
+        assert(builder.reallocCount == 1);
+
+        for(s64 index = 0; index < 1000; ++index) {
+            assertSuccess(builder_appendChar(&builder, 'x'));
+        }
+        assert(builder.buffer.size == 1000);
+        assert(builder.reallocCount == 1);
+
+        assertSuccess(builder_reserve(&builder, 0));
+        assert(builder.reallocCount == 1);
+
+        assertSuccess(builder_reserve(&builder, 24));
+        assert(builder.buffer.size == 1024);
+        assert(builder.reallocCount == 2);
+
+        assert(builder_reserve(&builder, -1) == ERROR_NEG_LENGTH);
+        assert(builder_reserve(&builder, S64_MAX) == ERROR_OVERFLOW);
+    }
+    builder_destroy(&builder);
+
     return true;
 }
 
@@ -279,6 +442,67 @@ bool test_builder_appendSubstring() {
 }
 
 
+bool test_builder_appendFormat() {
+    String expected = str_create("name: CLib, version: 1, url: https://github.com/Sothatsit/CLib");
+    Builder builder = builder_create(32);
+    {
+        assertSuccess(builder_appendFormat(&builder, "name: %s, ", "CLib"));
+        assertSuccess(builder_appendFormat(&builder, "version: %i, ", 1));
+        assert(builder.reallocCount == 0);
+
+        assertSuccess(builder_appendFormat(&builder, "url: %s", "https://github.com/Sothatsit/CLib"));
+        assert(builder.reallocCount == 1);
+
+        assert(str_equals(builder_str(builder), expected));
+    }
+    builder_destroy(&builder);
+
+    builder = builder_create(0);
+    {
+        assertSuccess(builder_setGrowth(&builder, BUILDER_GROWTH_CHUNKED, 16));
+        assertSuccess(builder_appendFormat(&builder, "name: %s, version: %i, ", "CLib", 1));
+        assertSuccess(builder_appendFormat(&builder, "url: %s", "https://github.com/Sothatsit/CLib"));
+
+        String joined = builder_str(builder);
+        assert(str_equals(joined, expected));
+        str_destroy(&joined);
+    }
+    builder_destroy(&builder);
+
+    return true;
+}
+
+/*
+ * Calls builder_vappendFormat with the given arguments.
+ */
+static CLibErrorType test_builder_vappendFormat_curried(Builder * builder, char * format, ...) {
+    va_list argList;
+    va_start(argList, format);
+
+    CLibErrorType result = builder_vappendFormat(builder, format, argList);
+
+    va_end(argList);
+
+    return result;
+}
+
+bool test_builder_vappendFormat() {
+    Builder builder = builder_create(0);
+    {
+        assertSuccess(test_builder_vappendFormat_curried(&builder, "%s %d %c", "Apples", 42, '!'));
+        assert(str_equalsC(builder_str(builder), "Apples 42 !"));
+
+        assertSuccess(test_builder_vappendFormat_curried(&builder, ""));
+        assert(str_equalsC(builder_str(builder), "Apples 42 !"));
+
+        assert(test_builder_vappendFormat_curried(&builder, NULL) == ERROR_ARG_NULL);
+    }
+    builder_destroy(&builder);
+
+    return true;
+}
+
+
 
 //
 // Run Tests
@@ -291,8 +515,12 @@ void test_Builder(int * failures, int * successes) {
     test(builder_buf);
     test(builder_strCopy);
     test(builder_bufCopy);
+    test(builder_iovecCount);
+    test(builder_iovecs);
     test(builder_setCapacity);
     test(builder_ensureCapacity);
+    test(builder_setGrowth);
+    test(builder_reserve);
     test(builder_trimToLength);
 
     test(builder_appendChar);
@@ -300,4 +528,6 @@ void test_Builder(int * failures, int * successes) {
     test(builder_appendBuf);
     test(builder_appendC);
     test(builder_appendSubstring);
+    test(builder_appendFormat);
+    test(builder_vappendFormat);
 }
@@ -0,0 +1,564 @@
+#include <unistd.h>
+#include <fcntl.h>
+#include "test.h"
+#include "testString.h"
+#include "testFiles.h"
+
+//
+// Helpers
+//
+
+/*
+ * Write the {length} chars in {contents} to the file {filename}, replacing it if it exists.
+ */
+static bool writeTestFile(char * filename, char * contents, s64 length) {
+    FILE * file = fopen(filename, "wb");
+    if(file == NULL)
+        return false;
+
+    size_t written = (length > 0 ? fwrite(contents, 1, (size_t) length, file) : 0);
+
+    return fclose(file) == 0 && written == (size_t) length;
+}
+
+
+
+//
+// Tests
+//
+
+bool test_str_readFile() {
+    char * filename = "test_str_readFile.tmp";
+    char * contents = "some file contents\n";
+
+    assert(writeTestFile(filename, contents, (s64) strlen(contents)));
+    {
+        String read = str_readFile(filename);
+        assertStrValid(read);
+        assert(str_isOwnAllocation(read));
+        assert(str_equals(read, str_create(contents)));
+        assert(read.data[read.length] == '\0');
+
+        str_destroy(&read);
+    }
+
+    assert(writeTestFile(filename, "", 0));
+    {
+        String read = str_readFile(filename);
+        assert(str_isValid(read));
+        assert(str_isEmpty(read));
+    }
+    remove(filename);
+
+    String unsized = str_readFile("/proc/self/status");
+    assertStrValid(unsized);
+    assert(str_startsWith(unsized, str_create("Name:")));
+    assert(unsized.data[unsized.length] == '\0');
+    str_destroy(&unsized);
+
+    assert(str_getErrorType(str_readFile("test_str_readFile_missing.tmp")) == ERROR_FILE_OPEN);
+    assert(str_getErrorType(str_readFile(".")) == ERROR_FILE_READ);
+    assert(str_getErrorType(str_readFile(NULL)) == ERROR_ARG_NULL);
+
+    // Failing to read a file should not leak its file descriptor
+    int before = open("/dev/null", O_RDONLY);
+    close(before);
+    for(int index = 0; index < 100; ++index) {
+        str_readFile(".");
+    }
+    int after = open("/dev/null", O_RDONLY);
+    close(after);
+    assert(before == after);
+
+    return true;
+}
+
+bool test_str_mapFile() {
+    char * filename = "test_str_mapFile.tmp";
+    char * contents = "line one\nline two\n";
+
+    assert(writeTestFile(filename, contents, (s64) strlen(contents)));
+    {
+        String mapped = str_mapFile(filename, FILE_MAP_SEQUENTIAL | FILE_MAP_WILLNEED | FILE_MAP_HUGEPAGE);
+        assertStrValid(mapped);
+        assert(str_isMapped(mapped));
+        assert(!str_isOwnAllocation(mapped));
+        assert(str_equals(mapped, str_create(contents)));
+
+        str_destroy(&mapped);
+        assert(str_getErrorType(mapped) == ERROR_FREED);
+    }
+
+    assert(writeTestFile(filename, "", 0));
+    {
+        String mapped = str_mapFile(filename, 0);
+        assert(str_isValid(mapped));
+        assert(str_isEmpty(mapped));
+        assert(!str_isMapped(mapped));
+
+        str_destroy(&mapped);
+    }
+    remove(filename);
+
+    String missing = str_mapFile("test_str_mapFile_missing.tmp", 0);
+    assert(str_getErrorType(missing) == ERROR_FILE_OPEN);
+
+    String directory = str_mapFile(".", 0);
+    assert(str_getErrorType(directory) == ERROR_FILE_MAP);
+
+    // Files in /proc report a size of zero, but are not empty
+    String proc = str_mapFile("/proc/self/status", 0);
+    assert(str_getErrorType(proc) == ERROR_FILE_MAP);
+
+    int pipeFiles[2];
+    assert(pipe(pipeFiles) == 0);
+    {
+        char pipeName[64];
+        snprintf(pipeName, sizeof(pipeName), "/dev/fd/%d", pipeFiles[0]);
+
+        String piped = str_mapFile(pipeName, 0);
+        assert(str_getErrorType(piped) == ERROR_FILE_MAP);
+    }
+    close(pipeFiles[0]);
+    close(pipeFiles[1]);
+
+    return true;
+}
+
+bool test_buf_mapFile() {
+    char * filename = "test_buf_mapFile.tmp";
+
+    // Large enough to span several pages
+    s64 length = 3 * 4096 + 17;
+    char * contents = malloc((size_t) length);
+    for(s64 index = 0; index < length; ++index) {
+        contents[index] = (char) ('a' + index % 26);
+    }
+
+    assert(writeTestFile(filename, contents, length));
+    {
+        Buffer mapped = buf_mapFile(filename, FILE_MAP_SEQUENTIAL);
+        assert(buf_isValid(mapped));
+        assert(mapped.size == length);
+        assert(memcmp(mapped.start, contents, (size_t) length) == 0);
+
+        buf_unmapFile(&mapped);
+        assert(buf_getErrorType(mapped) == ERROR_FREED);
+    }
+    remove(filename);
+    free(contents);
+
+    Buffer missing = buf_mapFile("test_buf_mapFile_missing.tmp", 0);
+    assert(buf_getErrorType(missing) == ERROR_FILE_OPEN);
+
+    Buffer nullName = buf_mapFile(NULL, 0);
+    assert(buf_getErrorType(nullName) == ERROR_ARG_NULL);
+
+    return true;
+}
+
+bool test_reader_nextLine() {
+    char * filename = "test_reader_nextLine.tmp";
+    char * contents = "first\r\nsecond line\n\na much longer line that does not fit in the buffer\nlast";
+
+    assert(writeTestFile(filename, contents, (s64) strlen(contents)));
+    {
+        // A small buffer so that lines span refills and the buffer has to grow
+        FileReader reader = reader_create(filename, 8);
+        assert(reader_isValid(reader));
+
+        assert(str_equals(reader_nextLine(&reader), str_create("first")));
+        assert(str_equals(reader_nextLine(&reader), str_create("second line")));
+        assert(str_equals(reader_nextLine(&reader), str_createEmpty()));
+        assert(str_equals(reader_nextLine(&reader), str_create("a much longer line that does not fit in the buffer")));
+        assert(str_equals(reader_nextLine(&reader), str_create("last")));
+        assert(str_getErrorType(reader_nextLine(&reader)) == ERROR_STRING_EXHAUSTED);
+        assert(str_getErrorType(reader_nextLine(&reader)) == ERROR_STRING_EXHAUSTED);
+
+        reader_destroy(&reader);
+        assert(reader_getErrorType(reader) == ERROR_FREED);
+    }
+    remove(filename);
+
+    FileReader missing = reader_create("test_reader_nextLine_missing.tmp", 0);
+    assert(reader_getErrorType(missing) == ERROR_FILE_OPEN);
+    assert(str_isErrored(reader_nextLine(&missing)));
+
+    return true;
+}
+
+bool test_reader_nextUntil() {
+    int pipeFiles[2];
+    assert(pipe(pipeFiles) == 0);
+
+    char * contents = "a,bb,,ccc,";
+    assert(write(pipeFiles[1], contents, strlen(contents)) == (ssize_t) strlen(contents));
+    close(pipeFiles[1]);
+
+    FileReader reader = reader_createUsing(pipeFiles[0], 4);
+    assert(reader_isValid(reader));
+
+    assert(str_equals(reader_nextUntil(&reader, ','), str_create("a")));
+    assert(str_equals(reader_nextUntil(&reader, ','), str_create("bb")));
+    assert(str_equals(reader_nextUntil(&reader, ','), str_createEmpty()));
+    assert(str_equals(reader_nextUntil(&reader, ','), str_create("ccc")));
+    assert(str_getErrorType(reader_nextUntil(&reader, ',')) == ERROR_STRING_EXHAUSTED);
+
+    reader_destroy(&reader);
+
+    // The reader does not own the file, so it should still be open
+    assert(close(pipeFiles[0]) == 0);
+
+    return true;
+}
+
+bool test_reader_read() {
+    char * filename = "test_reader_read.tmp";
+    char * contents = "0123456789abcdefghij";
+
+    assert(writeTestFile(filename, contents, (s64) strlen(contents)));
+    {
+        FileReader reader = reader_create(filename, 6);
+
+        assert(str_equals(reader_read(&reader, 4), str_create("0123")));
+        assert(str_equals(reader_read(&reader, 0), str_createEmpty()));
+        assert(str_equals(reader_read(&reader, 10), str_create("456789abcd")));
+        assert(str_equals(reader_nextUntil(&reader, 'g'), str_create("ef")));
+        assert(str_equals(reader_read(&reader, 100), str_create("hij")));
+        assert(str_getErrorType(reader_read(&reader, 1)) == ERROR_STRING_EXHAUSTED);
+        assert(str_getErrorType(reader_read(&reader, -1)) == ERROR_NEG_LENGTH);
+
+        reader_destroy(&reader);
+    }
+    remove(filename);
+
+    return true;
+}
+
+bool test_writer_appendStr() {
+    char * filename = "test_writer_appendStr.tmp";
+
+    FileWriter writer = writer_create(filename, 16);
+    assert(writer_isValid(writer));
+
+    assertSuccess(writer_appendC(&writer, "small"));
+    assertSuccess(writer_appendChar(&writer, ' '));
+    assertSuccess(writer_appendStr(&writer, str_create("appends")));
+
+    // Nothing should have been written yet
+    String contents = str_readFile(filename);
+    assert(str_isEmpty(contents));
+
+    // Does not fit in the remaining space, so the buffer is flushed first
+    assertSuccess(writer_appendC(&writer, " flush"));
+    // Larger than the buffer, so it is written directly
+    assertSuccess(writer_appendC(&writer, ", then a long append that bypasses the buffer"));
+    assertSuccess(writer_appendBuf(&writer, buf_createUsingC("!")));
+
+    for(int index = 0; index < 40; ++index) {
+        assertSuccess(writer_appendChar(&writer, (char) ('0' + index % 10)));
+    }
+
+    assertSuccess(writer_flush(&writer));
+    assertSuccess(writer_flush(&writer));
+
+    contents = str_readFile(filename);
+    assert(str_equals(contents, str_create(
+        "small appends flush, then a long append that bypasses the buffer!"
+        "0123456789012345678901234567890123456789"
+    )));
+    str_destroy(&contents);
+
+    assertSuccess(writer_appendC(&writer, "written on destroy"));
+    assertSuccess(writer_destroy(&writer));
+    assert(writer_getErrorType(writer) == ERROR_FREED);
+    assert(writer_appendC(&writer, "a") == ERROR_ARG_INVALID);
+    assert(writer_destroy(&writer) == ERROR_ARG_INVALID);
+
+    contents = str_readFile(filename);
+    assert(str_endsWith(contents, str_create("789written on destroy")));
+    str_destroy(&contents);
+
+    remove(filename);
+
+    FileWriter missing = writer_create("missing_directory/test_writer_appendStr.tmp", 0);
+    assert(writer_getErrorType(missing) == ERROR_FILE_OPEN);
+
+    // Failing to write the buffered data on destroy should be reported
+    FileWriter full = writer_create("/dev/full", 0);
+    assert(writer_isValid(full));
+    assertSuccess(writer_appendC(&full, "lost"));
+    assert(writer_destroy(&full) == ERROR_FILE_WRITE);
+    assert(writer_getErrorType(full) == ERROR_FREED);
+
+    return true;
+}
+
+bool test_writer_writeBuilder() {
+    char * filename = "test_writer_writeBuilder.tmp";
+
+    Builder builder = builder_create(0);
+    assertSuccess(builder_setGrowth(&builder, BUILDER_GROWTH_CHUNKED, 8));
+    for(int index = 0; index < 100; ++index) {
+        assertSuccess(builder_appendChar(&builder, (char) ('a' + index % 26)));
+    }
+    assert(builder_iovecCount(builder) > 1);
+
+    FileWriter writer = writer_create(filename, 0);
+    assertSuccess(writer_setSyncInterval(&writer, 2));
+    assertSuccess(writer_appendC(&writer, "header:"));
+    assertSuccess(writer_writeBuilder(&writer, builder));
+
+    struct iovec iovecs[3];
+    iovecs[0].iov_base = ":a";
+    iovecs[0].iov_len = 2;
+    iovecs[1].iov_base = "";
+    iovecs[1].iov_len = 0;
+    iovecs[2].iov_base = ":b";
+    iovecs[2].iov_len = 2;
+    assertSuccess(writer_writeIovecs(&writer, iovecs, 3));
+    assert(iovecs[0].iov_len == 2);
+    assertSuccess(writer_sync(&writer));
+
+    String built = builder_strCopy(builder);
+    Builder expected = builder_create(0);
+    assertSuccess(builder_appendC(&expected, "header:"));
+    assertSuccess(builder_appendStr(&expected, built));
+    assertSuccess(builder_appendC(&expected, ":a:b"));
+
+    String contents = str_readFile(filename);
+    assert(str_equals(contents, builder_str(expected)));
+
+    str_destroy(&contents);
+    str_destroy(&built);
+    builder_destroy(&expected);
+    builder_destroy(&builder);
+    assertSuccess(writer_destroy(&writer));
+    remove(filename);
+
+    return true;
+}
+
+/*
+ * Load a mix of files using {method}, and check that each one is loaded correctly.
+ */
+static bool checkLoadAll(FileLoadMethod method) {
+    #define LOAD_FILE_COUNT 150
+
+    char * filenames[LOAD_FILE_COUNT];
+    String expected[LOAD_FILE_COUNT];
+    String contents[LOAD_FILE_COUNT];
+
+    for(int index = 0; index < LOAD_FILE_COUNT; ++index) {
+        String filename = str_format("test_file_loadAll_%d.tmp", index);
+        filenames[index] = str_c_destroy(&filename);
+        if(index % 50 == 7) {
+            expected[index] = str_createEmpty();
+        } else {
+            expected[index] = str_format("file %d: %0*d", index, index * 37, 0);
+        }
+
+        assert(writeTestFile(filenames[index], expected[index].data, expected[index].length));
+    }
+
+    // A missing file in the middle of the batch
+    remove(filenames[42]);
+
+    CLibErrorType result = file_loadAll(filenames, LOAD_FILE_COUNT, contents, method);
+    if(result == ERROR_UNSUPPORTED && method == FILE_LOAD_IO_URING)
+        return true;
+
+    assertSuccess(result);
+
+    for(int index = 0; index < LOAD_FILE_COUNT; ++index) {
+        if(index == 42) {
+            assert(str_getErrorType(contents[index]) == ERROR_FILE_OPEN);
+        } else {
+            assert(str_isValid(contents[index]));
+            assert(str_equals(contents[index], expected[index]));
+        }
+
+        str_destroy(&contents[index]);
+        str_destroy(&expected[index]);
+        remove(filenames[index]);
+        free(filenames[index]);
+    }
+
+    // Files that do not report their size up front, mixed with a regular file
+    int pipeFiles[2];
+    assert(pipe(pipeFiles) == 0);
+    assert(write(pipeFiles[1], "piped", 5) == 5);
+    close(pipeFiles[1]);
+
+    char pipeName[64];
+    snprintf(pipeName, sizeof(pipeName), "/dev/fd/%d", pipeFiles[0]);
+
+    char * regularName = "test_file_loadAll_regular.tmp";
+    assert(writeTestFile(regularName, "regular", 7));
+
+    char * unsized[3] = {"/proc/self/status", pipeName, regularName};
+    assertSuccess(file_loadAll(unsized, 3, contents, method));
+
+    assert(str_isValid(contents[0]));
+    assert(str_startsWith(contents[0], str_create("Name:")));
+    assert(str_equals(contents[1], str_create("piped")));
+    assert(contents[1].data[5] == '\0');
+    assert(str_equals(contents[2], str_create("regular")));
+
+    for(int index = 0; index < 3; ++index) {
+        str_destroy(&contents[index]);
+    }
+    close(pipeFiles[0]);
+    remove(regularName);
+
+    return true;
+}
+
+bool test_file_loadAll() {
+    assert(checkLoadAll(FILE_LOAD_AUTO));
+    assert(checkLoadAll(FILE_LOAD_IO_URING));
+    assert(checkLoadAll(FILE_LOAD_THREADS));
+
+    String contents[1];
+    assertSuccess(file_loadAll(NULL, 0, contents, FILE_LOAD_AUTO));
+    assert(file_loadAll(NULL, 1, contents, FILE_LOAD_AUTO) == ERROR_ARG_NULL);
+    assert(file_loadAll(NULL, -1, contents, FILE_LOAD_AUTO) == ERROR_NEG_LENGTH);
+
+    return true;
+}
+
+/*
+ * Totals of the records seen by recordCallback.
+ */
+typedef struct RecordTotals {
+    s64 records;
+    s64 emptyRecords;
+    s64 sum;
+    s64 chars;
+} RecordTotals;
+
+/*
+ * Adds the number in {record} to the RecordTotals {context}.
+ */
+static void recordCallback(String record, s64 thread, void * context) {
+    RecordTotals * totals = context;
+
+    __atomic_fetch_add(&totals->records, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&totals->chars, record.length, __ATOMIC_RELAXED);
+
+    if(str_isEmpty(record)) {
+        __atomic_fetch_add(&totals->emptyRecords, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    s64 value;
+    if(str_parseS64(record, &value) == ERROR_SUCCESS) {
+        __atomic_fetch_add(&totals->sum, value, __ATOMIC_RELAXED);
+    }
+}
+
+bool test_file_parallelForEachRecord() {
+    char * filename = "test_file_parallelForEachRecord.tmp";
+
+    Builder builder = builder_create(0);
+    s64 expectedSum = 0;
+    for(s64 index = 0; index < 10000; ++index) {
+        assertSuccess(builder_appendS64(&builder, index));
+        assertSuccess(builder_appendChar(&builder, '\n'));
+        expectedSum += index;
+    }
+    assert(writeTestFile(filename, builder.buffer.start, builder.length));
+
+    s64 threadCounts[5] = {0, 1, 3, 8, 64};
+    for(int index = 0; index < 5; ++index) {
+        RecordTotals totals = {0, 0, 0, 0};
+
+        assertSuccess(file_parallelForEachRecord(filename, '\n', threadCounts[index], &recordCallback, &totals));
+        assert(totals.records == 10000);
+        assert(totals.emptyRecords == 0);
+        assert(totals.sum == expectedSum);
+        assert(totals.chars == builder.length - 10000);
+    }
+    builder_destroy(&builder);
+
+    // Empty records and no trailing delimiter
+    char * contents = ",1,,20,300";
+    assert(writeTestFile(filename, contents, (s64) strlen(contents)));
+    for(s64 threads = 1; threads <= 12; ++threads) {
+        RecordTotals totals = {0, 0, 0, 0};
+
+        assertSuccess(file_parallelForEachRecord(filename, ',', threads, &recordCallback, &totals));
+        assert(totals.records == 5);
+        assert(totals.emptyRecords == 2);
+        assert(totals.sum == 321);
+    }
+
+    assert(writeTestFile(filename, "", 0));
+    {
+        RecordTotals totals = {0, 0, 0, 0};
+
+        assertSuccess(file_parallelForEachRecord(filename, ',', 4, &recordCallback, &totals));
+        assert(totals.records == 0);
+    }
+    remove(filename);
+
+    // Pipes cannot be mapped, so their records are read into memory first
+    int pipeFiles[2];
+    assert(pipe(pipeFiles) == 0);
+    {
+        char * piped = "1\n20\n300\n";
+        assert(write(pipeFiles[1], piped, strlen(piped)) == (ssize_t) strlen(piped));
+        close(pipeFiles[1]);
+
+        char pipeName[64];
+        snprintf(pipeName, sizeof(pipeName), "/dev/fd/%d", pipeFiles[0]);
+
+        RecordTotals totals = {0, 0, 0, 0};
+        assertSuccess(file_parallelForEachRecord(pipeName, '\n', 4, &recordCallback, &totals));
+        assert(totals.records == 3);
+        assert(totals.sum == 321);
+    }
+    close(pipeFiles[0]);
+
+    // Files in /proc report a size of zero, but are not empty
+    String status = str_readFile("/proc/self/status");
+    assertStrValid(status);
+    {
+        s64 lines = 0;
+        for(s64 index = 0; index < status.length; ++index) {
+            lines += (status.data[index] == '\n');
+        }
+        assert(lines > 0);
+
+        RecordTotals totals = {0, 0, 0, 0};
+        assertSuccess(file_parallelForEachRecord("/proc/self/status", '\n', 4, &recordCallback, &totals));
+        assert(totals.records == lines);
+    }
+    str_destroy(&status);
+
+    RecordTotals totals = {0, 0, 0, 0};
+    assert(file_parallelForEachRecord(filename, ',', 4, &recordCallback, &totals) == ERROR_FILE_OPEN);
+    assert(file_parallelForEachRecord(filename, ',', 4, NULL, &totals) == ERROR_ARG_NULL);
+    assert(file_parallelForEachRecord(filename, ',', -1, &recordCallback, &totals) == ERROR_ARG_INVALID);
+
+    return true;
+}
+
+
+
+//
+// Run Tests
+//
+
+void test_files(int * failures, int * successes) {
+    test(str_readFile);
+    test(str_mapFile);
+    test(buf_mapFile);
+    test(reader_nextLine);
+    test(reader_nextUntil);
+    test(reader_read);
+    test(writer_appendStr);
+    test(writer_writeBuilder);
+    test(file_loadAll);
+    test(file_parallelForEachRecord);
+}
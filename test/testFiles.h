@@ -0,0 +1,9 @@
+#ifndef __CLIB_testFiles_h
+#define __CLIB_testFiles_h
+
+/*
+ * Test file IO.
+ */
+void test_files(int * failures, int * successes);
+
+#endif
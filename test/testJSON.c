@@ -0,0 +1,1637 @@
+#include <dirent.h>
+#include <math.h>
+#include <unistd.h>
+#include "test.h"
+#include "testString.h"
+#include "testJSON.h"
+
+//
+// Helpers
+//
+
+/*
+ * Text used to fill strings of varying lengths.
+ */
+#define LONG_STRING_FILLER "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 []{}:,abcdefghijklmnopqrstu"
+
+/*
+ * Parse every file in the directory {directory} using {method}, checking
+ * that each is accepted if {shouldPass} is true, or rejected if it is false.
+ */
+static bool parseTestDirectory(char * directory, JSONParseMethod method, bool shouldPass) {
+    DIR * dir = opendir(directory);
+    if(dir == NULL)
+        return false;
+
+    s64 fileCount = 0;
+
+    struct dirent * entry;
+    while((entry = readdir(dir)) != NULL) {
+        if(!str_endsWith(str_create(entry->d_name), str_create(".json")))
+            continue;
+
+        char * filename = str_formatC("%s/%s", directory, entry->d_name);
+        String contents = str_readFile(filename);
+        assertStrValid(contents);
+
+        JSONDoc doc = json_parseUsing(contents, method);
+        assertOrError(json_isValid(doc) == shouldPass, "%s was %s", entry->d_name, (shouldPass ? "rejected" : "accepted"));
+
+        if(!shouldPass) {
+            assert(json_getErrorType(doc) == ERROR_JSON_SYNTAX);
+            assert(json_getErrorOffset(doc) >= 0 && json_getErrorOffset(doc) <= contents.length);
+        }
+
+        json_destroy(&doc);
+        str_destroy(&contents);
+        free(filename);
+
+        fileCount += 1;
+    }
+
+    closedir(dir);
+    return fileCount > 0;
+}
+
+/*
+ * Parse {json} using each JSONParseMethod, checking that it fails with {errorType} at the char {offset}.
+ */
+static bool parseFails(char * json, CLibErrorType errorType, s64 offset) {
+    JSONParseMethod methods[3] = {JSON_PARSE_AUTO, JSON_PARSE_INDEXED, JSON_PARSE_SEQUENTIAL};
+
+    for(s64 index = 0; index < 3; ++index) {
+        JSONDoc doc = json_parseUsing(str_create(json), methods[index]);
+
+        assertOrError(json_getErrorType(doc) == errorType, "%s gave %s", json, errtype_c(json_getErrorType(doc)));
+        assertOrError(json_getErrorOffset(doc) == offset, "%s failed at %lld", json, (long long) json_getErrorOffset(doc));
+        assert(json_root(doc) == NULL);
+
+        json_destroy(&doc);
+    }
+
+    return true;
+}
+
+/*
+ * Find the positions that json_createIndex should find in the {length} chars of {data} one char at a time.
+ */
+static s64 referenceIndex(char * data, s64 length, u32 * positions) {
+    s64 count = 0;
+    bool inString = false;
+    bool inScalar = false;
+
+    for(s64 index = 0; index < length; ++index) {
+        char character = data[index];
+
+        if(inString) {
+            if(character == '\\') {
+                index += 1;
+            } else if(character == '"') {
+                inString = false;
+            }
+            continue;
+        }
+
+        bool isScalar = false;
+
+        if(character == '"') {
+            inString = true;
+            positions[count++] = (u32) index;
+        } else if(character == '\\') {
+            // Outside of strings, backslashes are part of scalars but still escape the next char.
+            if(!inScalar) {
+                positions[count++] = (u32) index;
+            }
+            isScalar = true;
+
+            if(index + 1 < length && data[index + 1] != ' ' && data[index + 1] != '\t'
+               && data[index + 1] != '\n' && data[index + 1] != '\r' && strchr("{}[]:,", data[index + 1]) == NULL) {
+                index += 1;
+            }
+        } else if(strchr("{}[]:,", character) != NULL) {
+            positions[count++] = (u32) index;
+        } else if(character != ' ' && character != '\t' && character != '\n' && character != '\r') {
+            if(!inScalar) {
+                positions[count++] = (u32) index;
+            }
+            isScalar = true;
+        }
+
+        inScalar = isScalar;
+    }
+
+    return (inString ? -1 : count);
+}
+
+/*
+ * Create a random document of {length} chars, mostly made of JSON tokens so that some of them are valid.
+ */
+static String randomJSON(s64 length) {
+    static char * tokens[] = {
+        "[", "]", "{", "}", ",", ":", " ", "\n", "\"", "\"key\":", "\"a\\\"b\"", "\\", "\\\\",
+        "1", "-2.5e3", "0", "true", "false", "null", "\"\\u00e9\"", "x", "\"str\"", "\t", "[1,2]", "{\"k\":[]}"
+    };
+    s64 tokenCount = (s64) (sizeof(tokens) / sizeof(tokens[0]));
+
+    Builder builder = builder_create(length + 16);
+    while(builder.length < length) {
+        builder_appendC(&builder, tokens[rand() % tokenCount]);
+    }
+
+    return builder_str(builder);
+}
+
+/*
+ * Check that the JSONDocs {doc1} and {doc2} are errored in the same way or contain the same nodes.
+ */
+static bool docsEqual(JSONDoc doc1, JSONDoc doc2) {
+    assert(json_getErrorType(doc1) == json_getErrorType(doc2));
+    assert(json_getErrorOffset(doc1) == json_getErrorOffset(doc2));
+    assert(doc1.nodeCount == doc2.nodeCount);
+
+    for(s64 index = 0; index < doc1.nodeCount; ++index) {
+        JSONNode * node1 = &((JSONNode *) doc1.nodes.start)[index];
+        JSONNode * node2 = &((JSONNode *) doc2.nodes.start)[index];
+
+        assert(node1->type == node2->type);
+        assert(node1->flags == node2->flags);
+        assert(node1->length == node2->length);
+
+        if(node1->type == JSON_STRING) {
+            assert(str_equals(json_getString(node1), json_getString(node2)));
+        } else if(node1->type == JSON_NUMBER || node1->type == JSON_ARRAY || node1->type == JSON_OBJECT) {
+            assert(node1->value.integer == node2->value.integer);
+        } else if(node1->type == JSON_BOOL) {
+            assert(node1->value.boolean == node2->value.boolean);
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Append {node} and all of its children to {events} in the format used by recordEvent, returning the node after them.
+ */
+static JSONNode * nodeEvents(JSONNode * node, Builder * events) {
+    switch((JSONType) node->type) {
+        case JSON_NULL:
+            builder_appendC(events, "z\n");
+            return node + 1;
+        case JSON_BOOL:
+            builder_appendC(events, (node->value.boolean ? "btrue\n" : "bfalse\n"));
+            return node + 1;
+        case JSON_NUMBER: {
+            double number = (node->flags & JSON_FLAG_INTEGER ? (double) node->value.integer : node->value.number);
+            builder_appendFormat(events, "n%.17g\n", number);
+            return node + 1;
+        }
+        case JSON_STRING:
+            builder_appendChar(events, 's');
+            builder_appendStr(events, json_getString(node));
+            builder_appendChar(events, '\n');
+            return node + 1;
+        case JSON_ARRAY: {
+            builder_appendC(events, "[\n");
+
+            JSONNode * child = node + 1;
+            for(s64 index = 0; index < node->length; ++index) {
+                child = nodeEvents(child, events);
+            }
+
+            builder_appendC(events, "]\n");
+            return child;
+        }
+        case JSON_OBJECT: {
+            builder_appendC(events, "{\n");
+
+            JSONNode * child = node + 1;
+            for(s64 index = 0; index < node->length; ++index) {
+                builder_appendChar(events, 'k');
+                builder_appendStr(events, json_getString(child));
+                builder_appendChar(events, '\n');
+                child = nodeEvents(child + 1, events);
+            }
+
+            builder_appendC(events, "}\n");
+            return child;
+        }
+    }
+
+    return node + 1;
+}
+
+/*
+ * A JSONEventCallback that appends each event to the Builder {context}, one per line.
+ */
+static void recordEvent(JSONEvent event, String text, void * context) {
+    Builder * events = context;
+
+    switch(event) {
+        case JSON_EVENT_START_OBJECT:
+            builder_appendC(events, "{\n");
+            break;
+        case JSON_EVENT_END_OBJECT:
+            builder_appendC(events, "}\n");
+            break;
+        case JSON_EVENT_START_ARRAY:
+            builder_appendC(events, "[\n");
+            break;
+        case JSON_EVENT_END_ARRAY:
+            builder_appendC(events, "]\n");
+            break;
+        case JSON_EVENT_KEY:
+        case JSON_EVENT_STRING:
+        case JSON_EVENT_BOOL:
+            builder_appendChar(events, (event == JSON_EVENT_KEY ? 'k' : (event == JSON_EVENT_STRING ? 's' : 'b')));
+            builder_appendStr(events, text);
+            builder_appendChar(events, '\n');
+            break;
+        case JSON_EVENT_NUMBER: {
+            double number = 0;
+            str_parseDouble(text, &number);
+            builder_appendFormat(events, "n%.17g\n", number);
+            break;
+        }
+        case JSON_EVENT_NULL:
+            builder_appendC(events, "z\n");
+            break;
+        case JSON_EVENT_END_DOCUMENT:
+            builder_appendC(events, ".\n");
+            break;
+    }
+}
+
+/*
+ * The chunk being streamed by countCopies, and the number of tokens that were not passed as views into it.
+ */
+typedef struct ViewCheck {
+    String chunk;
+    s64 copies;
+} ViewCheck;
+
+/*
+ * A JSONEventCallback that counts the keys, strings and numbers that do not point into the chunk of the ViewCheck {context}.
+ */
+static void countCopies(JSONEvent event, String text, void * context) {
+    ViewCheck * check = context;
+
+    if((event != JSON_EVENT_KEY && event != JSON_EVENT_STRING && event != JSON_EVENT_NUMBER) || text.length == 0)
+        return;
+
+    if(text.data < check->chunk.data || text.data + text.length > check->chunk.data + check->chunk.length) {
+        check->copies += 1;
+    }
+}
+
+/*
+ * Stream {json} in chunks of {chunkSize} chars, appending its events to {events}, and return the resulting error.
+ */
+static CLibErrorType streamChunks(String json, s64 chunkSize, Builder * events) {
+    JSONStream stream = json_createStream(recordEvent, events, false);
+
+    CLibErrorType errorType = ERROR_SUCCESS;
+    for(s64 start = 0; start < json.length && errorType == ERROR_SUCCESS; start += chunkSize) {
+        s64 end = (json.length - start < chunkSize ? json.length : start + chunkSize);
+        errorType = json_streamFeed(&stream, str_substring(json, start, end));
+    }
+
+    if(errorType == ERROR_SUCCESS) {
+        errorType = json_streamFinish(&stream);
+    }
+
+    json_destroyStream(&stream);
+    return errorType;
+}
+
+/*
+ * Check that streaming {json} in chunks of several sizes reports the same events as
+ * visiting the nodes of json_parse, or fails whenever json_parse fails.
+ */
+static bool streamMatchesParse(String json) {
+    JSONDoc doc = json_parse(json);
+
+    Builder expected = builder_create(0);
+    if(json_isValid(doc)) {
+        nodeEvents(json_root(doc), &expected);
+        builder_appendC(&expected, ".\n");
+    }
+
+    s64 chunkSizes[4] = {1, 3, 64, json.length + 1};
+    for(s64 index = 0; index < 4; ++index) {
+        Builder events = builder_create(0);
+        CLibErrorType errorType = streamChunks(json, chunkSizes[index], &events);
+
+        assertOrError((errorType == ERROR_SUCCESS) == json_isValid(doc), "%.*s", (int) json.length, json.data);
+        if(errorType == ERROR_SUCCESS) {
+            assertOrError(str_equals(builder_str(events), builder_str(expected)), "%.*s", (int) json.length, json.data);
+        }
+
+        builder_destroy(&events);
+    }
+
+    builder_destroy(&expected);
+    json_destroy(&doc);
+    return true;
+}
+
+/*
+ * Stream {json} in chunks of 2 chars, checking that it fails with {errorType} at the char {offset}.
+ */
+static bool streamFails(char * json, CLibErrorType errorType, s64 offset) {
+    Builder events = builder_create(0);
+    JSONStream stream = json_createStream(recordEvent, &events, false);
+
+    String string = str_create(json);
+    for(s64 start = 0; start < string.length; start += 2) {
+        json_streamFeed(&stream, str_substring(string, start, (string.length - start < 2 ? string.length : start + 2)));
+    }
+    json_streamFinish(&stream);
+
+    assertOrError(json_getStreamErrorType(stream) == errorType, "%s gave %s", json, errtype_c(json_getStreamErrorType(stream)));
+    assertOrError(json_getStreamErrorOffset(stream) == offset, "%s failed at %lld", json, (long long) json_getStreamErrorOffset(stream));
+    assert(json_streamFeed(&stream, str_create("[]")) == errorType);
+
+    json_destroyStream(&stream);
+    builder_destroy(&events);
+    return true;
+}
+
+
+/*
+ * Check that json_find finds each child of {node} in {json} at the path in {path}, and that it matches the child.
+ */
+static bool findMatchesChildren(String json, JSONNode * node, Builder * path) {
+    if(node->type != JSON_ARRAY && node->type != JSON_OBJECT)
+        return true;
+
+    s64 pathLength = path->length;
+    JSONNode * child = node + 1;
+
+    for(s64 index = 0; index < node->length; ++index, child = json_next(child)) {
+        path->length = pathLength;
+
+        if(node->type == JSON_ARRAY) {
+            builder_appendFormat(path, "[%lld]", (long long) index);
+        } else {
+            String key = json_getString(child);
+            child += 1;
+
+            // Paths cannot express these keys, and only the first of a repeated key can be found.
+            if(key.length == 0 || str_containsChar(key, '.') || str_containsChar(key, '[')
+               || json_objectGet(node, key) != child)
+                continue;
+
+            if(pathLength > 0) {
+                builder_appendChar(path, '.');
+            }
+            builder_appendStr(path, key);
+        }
+
+        JSONPath compiled = json_compilePath(builder_str(*path));
+        assert(!json_isPathErrored(compiled));
+
+        JSONValue value;
+        assertSuccess(json_find(json, compiled, &value));
+        assert(value.type == (JSONType) child->type);
+
+        if(child->type == JSON_STRING) {
+            String string = json_getValueString(value);
+            assert(str_equals(string, json_getString(child)));
+            str_destroy(&string);
+        } else if(child->type == JSON_NUMBER) {
+            double expected;
+            double number;
+            assertSuccess(json_getDouble(child, &expected));
+            assertSuccess(json_getValueDouble(value, &number));
+            assert(number == expected);
+        } else if(child->type == JSON_BOOL) {
+            bool boolean;
+            assertSuccess(json_getValueBool(value, &boolean));
+            assert(boolean == child->value.boolean);
+        }
+
+        json_destroyPath(&compiled);
+        assert(findMatchesChildren(json, child, path));
+    }
+
+    path->length = pathLength;
+    return true;
+}
+
+/*
+ * Check that finding {path} in {json} fails with {errorType}.
+ */
+static bool findFails(char * json, char * path, CLibErrorType errorType) {
+    JSONValue value;
+    CLibErrorType result = json_findC(str_create(json), path, &value);
+
+    assertOrError(result == errorType, "%s in %s gave %s", path, json, errtype_c(result));
+    return true;
+}
+
+
+/*
+ * Escape {length} chars of {data} as a quoted JSON string into {output} one char at a time.
+ */
+static void referenceEscape(char * data, s64 length, Builder * output) {
+    builder_appendChar(output, '"');
+
+    for(s64 index = 0; index < length; ++index) {
+        u8 character = (u8) data[index];
+
+        if(character == '"' || character == '\\') {
+            builder_appendChar(output, '\\');
+            builder_appendChar(output, (char) character);
+        } else if(character == '\n') {
+            builder_appendC(output, "\\n");
+        } else if(character == '\t') {
+            builder_appendC(output, "\\t");
+        } else if(character == '\r') {
+            builder_appendC(output, "\\r");
+        } else if(character == '\b') {
+            builder_appendC(output, "\\b");
+        } else if(character == '\f') {
+            builder_appendC(output, "\\f");
+        } else if(character < 0x20) {
+            builder_appendFormat(output, "\\u%04x", character);
+        } else {
+            builder_appendChar(output, (char) character);
+        }
+    }
+
+    builder_appendChar(output, '"');
+}
+
+/*
+ * Check that writing the document {json} using {writer} and parsing it again gives the same values as parsing {json}.
+ */
+static bool writeMatchesParse(JSONWriter * writer, String json) {
+    JSONDoc doc = json_parse(json);
+    assert(json_isValid(doc));
+
+    json_resetWriter(writer);
+    assertSuccess(json_writeNode(writer, json_root(doc)));
+
+    JSONDoc written = json_parse(json_writerStr(*writer));
+    assertOrError(json_isValid(written), "%.*s", (int) json_writerStr(*writer).length, json_writerStr(*writer).data);
+
+    Builder expected = builder_create(0);
+    Builder actual = builder_create(0);
+    nodeEvents(json_root(doc), &expected);
+    nodeEvents(json_root(written), &actual);
+    assert(str_equals(builder_str(expected), builder_str(actual)));
+
+    builder_destroy(&expected);
+    builder_destroy(&actual);
+    json_destroy(&written);
+    json_destroy(&doc);
+    return true;
+}
+
+/*
+ * Totals of the documents seen by checkRecord.
+ */
+typedef struct NDJSONTotals {
+    s64 records;
+    s64 errors;
+    s64 idSum;
+    s64 lastId;
+    bool inOrder;
+    bool matchesParse;
+} NDJSONTotals;
+
+/*
+ * Check that {doc} is the same as the document parsed from {record} by json_parse.
+ */
+static bool recordMatchesParse(JSONDoc doc, String record) {
+    JSONDoc expected = json_parse(record);
+    bool equal = docsEqual(doc, expected);
+    json_destroy(&expected);
+
+    return equal;
+}
+
+/*
+ * Check {doc} against its {record}, and add its id to the NDJSONTotals {context}.
+ */
+static void checkRecord(JSONDoc doc, String record, s64 thread, void * context) {
+    NDJSONTotals * totals = context;
+
+    __atomic_fetch_add(&totals->records, 1, __ATOMIC_RELAXED);
+
+    if(!recordMatchesParse(doc, record)) {
+        __atomic_store_n(&totals->matchesParse, false, __ATOMIC_RELAXED);
+    }
+
+    s64 id;
+    if(json_isErrored(doc) || json_getS64(json_objectGetC(json_root(doc), "id"), &id) != ERROR_SUCCESS) {
+        __atomic_fetch_add(&totals->errors, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    __atomic_fetch_add(&totals->idSum, id, __ATOMIC_RELAXED);
+
+    // Only meaningful when the documents are delivered one at a time in order.
+    if(id != __atomic_exchange_n(&totals->lastId, id, __ATOMIC_RELAXED) + 1) {
+        __atomic_store_n(&totals->inOrder, false, __ATOMIC_RELAXED);
+    }
+}
+
+/*
+ * Write {contents} to the file {filename}, replacing anything already in it.
+ */
+static bool writeNDJSON(char * filename, String contents) {
+    FileWriter file = writer_create(filename, 0);
+    assert(writer_isValid(file));
+
+    assertSuccess(writer_appendStr(&file, contents));
+    assertSuccess(writer_destroy(&file));
+
+    return true;
+}
+
+
+
+//
+// Tests
+//
+
+bool test_json_parse() {
+    assert(parseTestDirectory("jsonTests/pass", JSON_PARSE_AUTO, true));
+    assert(parseTestDirectory("jsonTests/fail", JSON_PARSE_AUTO, false));
+    assert(parseTestDirectory("jsonTests/pass", JSON_PARSE_INDEXED, true));
+    assert(parseTestDirectory("jsonTests/fail", JSON_PARSE_INDEXED, false));
+    assert(parseTestDirectory("jsonTests/pass", JSON_PARSE_SEQUENTIAL, true));
+    assert(parseTestDirectory("jsonTests/fail", JSON_PARSE_SEQUENTIAL, false));
+
+    {
+        JSONDoc doc = json_parse(str_create(" [1, {\"a\": [true, false, null]}, \"b\", []] "));
+        assert(json_isValid(doc));
+        assert(json_getErrorType(doc) == ERROR_NONE);
+        assert(json_getErrorOffset(doc) == -1);
+        assert(doc.nodeCount == 10);
+
+        JSONNode * root = json_root(doc);
+        assert(root->type == JSON_ARRAY);
+        assert(root->length == 4);
+        assert(root->value.descendants == 9);
+
+        JSONNode * object = json_arrayGet(root, 1);
+        assert(object->type == JSON_OBJECT);
+        assert(object->length == 1);
+        assert(json_next(object) == json_arrayGet(root, 2));
+
+        json_destroy(&doc);
+        assert(json_isErrored(doc));
+        json_destroy(&doc);
+    }
+
+    {
+        JSONDoc doc = json_parse(str_create("\"top level\""));
+        assert(json_isValid(doc));
+        assert(str_equalsC(json_getString(json_root(doc)), "top level"));
+        json_destroy(&doc);
+    }
+
+    assert(parseFails("", ERROR_JSON_SYNTAX, 0));
+    assert(parseFails("   ", ERROR_JSON_SYNTAX, 3));
+    assert(parseFails("[1, 2", ERROR_JSON_SYNTAX, 5));
+    assert(parseFails("{\"a\" 1}", ERROR_JSON_SYNTAX, 5));
+    assert(parseFails("[1] [2]", ERROR_JSON_SYNTAX, 4));
+    assert(parseFails("[nul]", ERROR_JSON_SYNTAX, 1));
+    assert(parseFails("[\"abc", ERROR_JSON_SYNTAX, 5));
+    assert(parseFails("[\"a\\qb\"]", ERROR_JSON_SYNTAX, 3));
+    assert(parseFails("[\"\\u12\"]", ERROR_JSON_SYNTAX, 2));
+    assert(parseFails("[\"\\uDC00\"]", ERROR_INVALID_CODEPOINT, 2));
+    assert(parseFails("[\"a\\uD800b\"]", ERROR_INVALID_CODEPOINT, 3));
+    assert(parseFails("[\"\xC0\xAF\"]", ERROR_INVALID_CODEPOINT, 2));
+    assert(parseFails("[-]", ERROR_JSON_SYNTAX, 2));
+    assert(parseFails("[1.]", ERROR_JSON_SYNTAX, 3));
+    assert(parseFails("[1e999]", ERROR_OVERFLOW, 1));
+    assert(parseFails("[truex]", ERROR_JSON_SYNTAX, 5));
+    assert(parseFails("[12a]", ERROR_JSON_SYNTAX, 3));
+    assert(parseFails("[1 x \"abc", ERROR_JSON_SYNTAX, 3));
+    assert(parseFails("[\"a\"b]", ERROR_JSON_SYNTAX, 4));
+    assert(parseFails("[\f]", ERROR_JSON_SYNTAX, 1));
+
+    {
+        Builder builder = builder_create(0);
+        for(s64 index = 0; index < JSON_MAX_DEPTH; ++index) {
+            builder_appendChar(&builder, '[');
+        }
+        for(s64 index = 0; index < JSON_MAX_DEPTH; ++index) {
+            builder_appendChar(&builder, ']');
+        }
+
+        JSONDoc doc = json_parse(builder_str(builder));
+        assert(json_isValid(doc));
+        assert(json_root(doc)->value.descendants == JSON_MAX_DEPTH - 1);
+        json_destroy(&doc);
+
+        doc = json_parseUsing(builder_str(builder), JSON_PARSE_SEQUENTIAL);
+        assert(json_isValid(doc));
+        json_destroy(&doc);
+
+        // One more array than the maximum depth fails when it is opened.
+        Builder tooDeep = builder_create(0);
+        for(s64 index = 0; index <= JSON_MAX_DEPTH; ++index) {
+            builder_appendChar(&tooDeep, '[');
+        }
+
+        doc = json_parse(builder_str(tooDeep));
+        assert(json_getErrorType(doc) == ERROR_JSON_DEPTH);
+        assert(json_getErrorOffset(doc) == JSON_MAX_DEPTH);
+        json_destroy(&doc);
+
+        doc = json_parseUsing(builder_str(tooDeep), JSON_PARSE_SEQUENTIAL);
+        assert(json_getErrorType(doc) == ERROR_JSON_DEPTH);
+        assert(json_getErrorOffset(doc) == JSON_MAX_DEPTH);
+        json_destroy(&doc);
+
+        builder_destroy(&tooDeep);
+        builder_destroy(&builder);
+    }
+
+    {
+        JSONDoc doc = json_parse(str_createErrored(ERROR_ALLOC, 0));
+        assert(json_getErrorType(doc) == ERROR_ARG_INVALID);
+        json_destroy(&doc);
+
+        doc = json_parseUsing(str_create("[]"), (JSONParseMethod) 17);
+        assert(json_getErrorType(doc) == ERROR_ARG_INVALID);
+        json_destroy(&doc);
+    }
+
+    return true;
+}
+
+bool test_json_parseUsing() {
+    srand(41);
+
+    for(s64 iteration = 0; iteration < 20000; ++iteration) {
+        String json = randomJSON(1 + rand() % 200);
+
+        JSONDoc indexed = json_parseUsing(json, JSON_PARSE_INDEXED);
+        JSONDoc sequential = json_parseUsing(json, JSON_PARSE_SEQUENTIAL);
+
+        assertOrError(docsEqual(indexed, sequential), "%.*s", (int) json.length, json.data);
+
+        json_destroy(&indexed);
+        json_destroy(&sequential);
+        str_destroy(&json);
+    }
+
+    // Valid documents made of many records, so that strings and escapes cross the 64 char blocks.
+    for(s64 iteration = 0; iteration < 50; ++iteration) {
+        Builder builder = builder_create(0);
+        builder_appendChar(&builder, '[');
+        for(s64 record = 0; record < 200; ++record) {
+            builder_appendFormat(&builder, "%s{\"id\": %d, \"text\": \"%.*s\\\\\\\"\", \"list\": [%d.5, true]}",
+                                 (record == 0 ? "" : ",\n"), rand(), rand() % 90, LONG_STRING_FILLER, rand() % 1000);
+        }
+        builder_appendChar(&builder, ']');
+
+        String json = builder_str(builder);
+        JSONDoc indexed = json_parseUsing(json, JSON_PARSE_INDEXED);
+        JSONDoc sequential = json_parseUsing(json, JSON_PARSE_SEQUENTIAL);
+
+        assert(json_isValid(indexed));
+        assert(json_root(indexed)->length == 200);
+        assert(docsEqual(indexed, sequential));
+
+        json_destroy(&indexed);
+        json_destroy(&sequential);
+        builder_destroy(&builder);
+    }
+
+    return true;
+}
+
+bool test_json_createIndex() {
+    {
+        String json = str_create(" {\"a\\\"]\": [1, true], \"b\": -2.5}");
+        JSONIndex index = json_createIndex(json);
+        assert(!json_isIndexErrored(index));
+        assert(json_getIndexErrorType(index) == ERROR_NONE);
+
+        u32 expected[] = {1, 2, 8, 10, 11, 12, 14, 18, 19, 21, 24, 26, 30};
+        assert(index.count == (s64) (sizeof(expected) / sizeof(expected[0])));
+        for(s64 position = 0; position < index.count; ++position) {
+            assert(((u32 *) index.positions.start)[position] == expected[position]);
+        }
+
+        json_destroyIndex(&index);
+        assert(json_isIndexErrored(index));
+    }
+
+    {
+        JSONIndex index = json_createIndex(str_create("[\"unclosed\\\"]"));
+        assert(json_getIndexErrorType(index) == ERROR_JSON_SYNTAX);
+        json_destroyIndex(&index);
+
+        index = json_createIndex(str_createErrored(ERROR_ALLOC, 0));
+        assert(json_getIndexErrorType(index) == ERROR_ARG_INVALID);
+        json_destroyIndex(&index);
+
+        index = json_createIndex(str_create(""));
+        assert(!json_isIndexErrored(index));
+        assert(index.count == 0);
+        json_destroyIndex(&index);
+    }
+
+    srand(42);
+    u32 * expected = malloc(2000 * sizeof(u32));
+
+    for(s64 iteration = 0; iteration < 5000; ++iteration) {
+        String json = randomJSON(1 + rand() % 1000);
+
+        s64 expectedCount = referenceIndex(json.data, json.length, expected);
+        JSONIndex index = json_createIndex(json);
+
+        if(expectedCount < 0) {
+            assert(json_getIndexErrorType(index) == ERROR_JSON_SYNTAX);
+        } else {
+            assertOrError(index.count == expectedCount, "%.*s", (int) json.length, json.data);
+            assert(memcmp(index.positions.start, expected, (size_t) expectedCount * sizeof(u32)) == 0);
+        }
+
+        json_destroyIndex(&index);
+        str_destroy(&json);
+    }
+
+    free(expected);
+    return true;
+}
+
+bool test_json_getString() {
+    char * json = "[\"plain\", \"\", \"tab\\there\", \"\\\"\\\\\\/\\b\\f\\n\\r\\t\", \"\\u0041\\u00e9\\u20AC\\uD83D\\uDE00\", \"caf\xC3\xA9\"]";
+
+    String input = str_create(json);
+    JSONDoc doc = json_parse(input);
+    assert(json_isValid(doc));
+
+    JSONNode * root = json_root(doc);
+
+    JSONNode * plain = json_arrayGet(root, 0);
+    assert(str_equalsC(json_getString(plain), "plain"));
+    assert(plain->flags == 0);
+    assert(plain->value.chars == &json[2]);
+
+    assert(str_equalsC(json_getString(json_arrayGet(root, 1)), ""));
+
+    JSONNode * tab = json_arrayGet(root, 2);
+    assert(str_equalsC(json_getString(tab), "tab\there"));
+    assert(tab->flags == JSON_FLAG_UNESCAPED);
+    assert(tab->value.chars < input.data || tab->value.chars >= input.data + input.length);
+
+    assert(str_equalsC(json_getString(json_arrayGet(root, 3)), "\"\\/\b\f\n\r\t"));
+    assert(str_equalsC(json_getString(json_arrayGet(root, 4)), "A\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80"));
+    assert(str_equalsC(json_getString(json_arrayGet(root, 5)), "caf\xC3\xA9"));
+
+    assert(str_getErrorType(json_getString(root)) == ERROR_ARG_INVALID);
+    assert(str_getErrorType(json_getString(NULL)) == ERROR_ARG_INVALID);
+
+    json_destroy(&doc);
+
+    // Enough unescaped strings to need several blocks, with specials at every offset of the 8 char chunks.
+    Builder builder = builder_create(0);
+    builder_appendChar(&builder, '[');
+    for(s64 index = 0; index < 20000; ++index) {
+        builder_appendFormat(&builder, "%s\"%.*s\\n\"", (index == 0 ? "" : ","), (int) (index % 17), "abcdefghijklmnopq");
+    }
+    builder_appendChar(&builder, ']');
+
+    doc = json_parse(builder_str(builder));
+    assert(json_isValid(doc));
+
+    JSONNode * element = json_arrayGet(json_root(doc), 0);
+    for(s64 index = 0; index < 20000; ++index) {
+        String expected = str_format("%.*s\n", (int) (index % 17), "abcdefghijklmnopq");
+        assert(str_equals(json_getString(element), expected));
+        str_destroy(&expected);
+
+        element = json_next(element);
+    }
+
+    json_destroy(&doc);
+    builder_destroy(&builder);
+
+    return true;
+}
+
+bool test_json_getNumber() {
+    char * json = "[0, -12, 9007199254740993, -9223372036854775808, 9223372036854775808, 1.5, -2.5e-3, 1E2, -0]";
+
+    JSONDoc doc = json_parse(str_create(json));
+    assert(json_isValid(doc));
+
+    JSONNode * root = json_root(doc);
+    s64 integer;
+    double number;
+
+    assertSuccess(json_getS64(json_arrayGet(root, 0), &integer));
+    assert(integer == 0);
+    assertSuccess(json_getS64(json_arrayGet(root, 1), &integer));
+    assert(integer == -12);
+    assertSuccess(json_getS64(json_arrayGet(root, 2), &integer));
+    assert(integer == 9007199254740993LL);
+    assertSuccess(json_getS64(json_arrayGet(root, 3), &integer));
+    assert(integer == S64_MIN);
+
+    assert(json_getS64(json_arrayGet(root, 4), &integer) == ERROR_CAST);
+    assertSuccess(json_getDouble(json_arrayGet(root, 4), &number));
+    assert(number == 9223372036854775808.0);
+
+    assertSuccess(json_getDouble(json_arrayGet(root, 5), &number));
+    assert(number == 1.5);
+    assertSuccess(json_getDouble(json_arrayGet(root, 6), &number));
+    assert(number == -2.5e-3);
+    assert(json_getS64(json_arrayGet(root, 7), &integer) == ERROR_CAST);
+    assertSuccess(json_getDouble(json_arrayGet(root, 7), &number));
+    assert(number == 100.0);
+
+    assertSuccess(json_getDouble(json_arrayGet(root, 8), &number));
+    assert(number == 0.0 && signbit(number));
+
+    assertSuccess(json_getDouble(json_arrayGet(root, 1), &number));
+    assert(number == -12.0);
+
+    assert(json_getDouble(root, &number) == ERROR_ARG_INVALID);
+    assert(json_getS64(json_arrayGet(root, 0), NULL) == ERROR_ARG_NULL);
+
+    json_destroy(&doc);
+    return true;
+}
+
+bool test_json_objectGet() {
+    char * json = "{\"name\": \"CLib\", \"nested\": {\"list\": [1, [2, 3], {\"deep\": true}]}, \"\": null, \"flag\": false}";
+
+    JSONDoc doc = json_parse(str_create(json));
+    assert(json_isValid(doc));
+
+    JSONNode * root = json_root(doc);
+    assert(root->length == 4);
+
+    assert(str_equalsC(json_getString(json_objectGetC(root, "name")), "CLib"));
+    assert(json_objectGetC(root, "")->type == JSON_NULL);
+    assert(json_objectGetC(root, "missing") == NULL);
+    assert(json_objectGetC(root, "nam") == NULL);
+
+    bool flag = true;
+    assertSuccess(json_getBool(json_objectGetC(root, "flag"), &flag));
+    assert(!flag);
+    assert(json_getBool(json_objectGetC(root, ""), &flag) == ERROR_ARG_INVALID);
+
+    JSONNode * list = json_objectGetC(json_objectGetC(root, "nested"), "list");
+    assert(list->type == JSON_ARRAY);
+    assert(list->length == 3);
+    assert(json_arrayGet(list, 1)->length == 2);
+    assert(json_arrayGet(list, 3) == NULL);
+    assert(json_arrayGet(list, -1) == NULL);
+
+    bool deep = false;
+    assertSuccess(json_getBool(json_objectGetC(json_arrayGet(list, 2), "deep"), &deep));
+    assert(deep);
+
+    assert(json_objectGetC(list, "deep") == NULL);
+    assert(json_arrayGet(root, 0) == NULL);
+
+    json_destroy(&doc);
+    return true;
+}
+
+
+bool test_json_streamFeed() {
+    char * directories[2] = {"jsonTests/pass", "jsonTests/fail"};
+
+    for(s64 index = 0; index < 2; ++index) {
+        DIR * dir = opendir(directories[index]);
+        assertNonNull(dir);
+
+        struct dirent * entry;
+        while((entry = readdir(dir)) != NULL) {
+            if(!str_endsWith(str_create(entry->d_name), str_create(".json")))
+                continue;
+
+            char * filename = str_formatC("%s/%s", directories[index], entry->d_name);
+            String contents = str_readFile(filename);
+            assertStrValid(contents);
+
+            assertOrError(streamMatchesParse(contents), "%s", entry->d_name);
+
+            str_destroy(&contents);
+            free(filename);
+        }
+
+        closedir(dir);
+    }
+
+    srand(43);
+    for(s64 iteration = 0; iteration < 5000; ++iteration) {
+        String json = randomJSON(1 + rand() % 100);
+        assert(streamMatchesParse(json));
+        str_destroy(&json);
+    }
+
+    {
+        Builder builder = builder_create(0);
+        builder_appendChar(&builder, '[');
+        for(s64 record = 0; record < 50; ++record) {
+            builder_appendFormat(&builder, "%s{\"id\": %d, \"text\": \"%.*s\\\\\\\"\\u00e9\\ud83d\\ude00\", \"list\": [%d.5e-3, null]}",
+                                 (record == 0 ? "" : ",\n"), rand(), rand() % 90, LONG_STRING_FILLER, rand() % 1000);
+        }
+        builder_appendChar(&builder, ']');
+
+        assert(streamMatchesParse(builder_str(builder)));
+        builder_destroy(&builder);
+    }
+
+    // Keys, strings, numbers and literals may be split between chunks at any char.
+    {
+        Builder events = builder_create(0);
+        JSONStream stream = json_createStream(recordEvent, &events, false);
+
+        assertSuccess(json_streamFeed(&stream, str_create("{\"ke")));
+        assert(events.length == 2);
+        assertSuccess(json_streamFeed(&stream, str_create("y\": [12, \"a\\nb\", 3")));
+        assertSuccess(json_streamFeed(&stream, str_create("4], \"e\": \"\", \"t\": tr")));
+        assertSuccess(json_streamFeed(&stream, str_create("ue}  ")));
+        assertSuccess(json_streamFinish(&stream));
+        assert(str_equalsC(builder_str(events), "{\nkkey\n[\nn12\nsa\nb\nn34\n]\nke\ns\nkt\nbtrue\n}\n.\n"));
+
+        json_destroyStream(&stream);
+        builder_destroy(&events);
+    }
+
+    // Only tokens that span chunks or contain escapes are copied.
+    {
+        ViewCheck check = {str_create("{\"key\": [\"value\", -1.5e3, \"a\\nb\", \"\"], \"sp"), 0};
+        JSONStream stream = json_createStream(countCopies, &check, false);
+
+        assertSuccess(json_streamFeed(&stream, check.chunk));
+        assert(check.copies == 1);
+
+        check.chunk = str_create("lit\": 12}");
+        assertSuccess(json_streamFeed(&stream, check.chunk));
+        assertSuccess(json_streamFinish(&stream));
+        assert(check.copies == 2);
+
+        json_destroyStream(&stream);
+    }
+
+    // Many top level values, such as newline delimited JSON.
+    {
+        Builder events = builder_create(0);
+        JSONStream stream = json_createStream(recordEvent, &events, true);
+
+        assertSuccess(json_streamFeed(&stream, str_create("1 [2]\n{\"a\":null}\n\"s\"\n-0.5")));
+        assert(str_equalsC(builder_str(events), "n1\n.\n[\nn2\n]\n.\n{\nka\nz\n}\n.\nss\n.\n"));
+        assertSuccess(json_streamFinish(&stream));
+        assert(str_endsWith(builder_str(events), str_create("n-0.5\n.\n")));
+
+        json_destroyStream(&stream);
+        builder_destroy(&events);
+    }
+
+    {
+        Builder events = builder_create(0);
+        JSONStream stream = json_createStream(recordEvent, &events, true);
+        assertSuccess(json_streamFinish(&stream));
+        assert(events.length == 0);
+        json_destroyStream(&stream);
+        builder_destroy(&events);
+    }
+
+    {
+        JSONStream stream = json_createStream(NULL, NULL, false);
+        assert(json_isStreamErrored(stream));
+        assert(json_getStreamErrorType(stream) == ERROR_ARG_NULL);
+        assert(json_streamFeed(&stream, str_create("1")) == ERROR_ARG_NULL);
+        json_destroyStream(&stream);
+    }
+
+    assert(streamFails("", ERROR_JSON_SYNTAX, 0));
+    assert(streamFails("   ", ERROR_JSON_SYNTAX, 3));
+    assert(streamFails("[1, 2", ERROR_JSON_SYNTAX, 5));
+    assert(streamFails("{\"a\" 1}", ERROR_JSON_SYNTAX, 5));
+    assert(streamFails("[1] [2]", ERROR_JSON_SYNTAX, 4));
+    assert(streamFails("[nul]", ERROR_JSON_SYNTAX, 1));
+    assert(streamFails("[\"abc", ERROR_JSON_SYNTAX, 5));
+    assert(streamFails("[\"a\\qb\"]", ERROR_JSON_SYNTAX, 3));
+    assert(streamFails("[\"\\u12\"]", ERROR_JSON_SYNTAX, 2));
+    assert(streamFails("[\"\\uDC00\"]", ERROR_INVALID_CODEPOINT, 2));
+    assert(streamFails("[\"a\\uD800b\"]", ERROR_INVALID_CODEPOINT, 3));
+    assert(streamFails("[\"xy\xC0\xAF\"]", ERROR_INVALID_CODEPOINT, 4));
+    assert(streamFails("[-]", ERROR_JSON_SYNTAX, 2));
+    assert(streamFails("[1.]", ERROR_JSON_SYNTAX, 3));
+    assert(streamFails("-", ERROR_JSON_SYNTAX, 1));
+    assert(streamFails("[truex]", ERROR_JSON_SYNTAX, 5));
+    assert(streamFails("[12a]", ERROR_JSON_SYNTAX, 3));
+    assert(streamFails("[\"a\"b]", ERROR_JSON_SYNTAX, 4));
+    assert(streamFails("[1,]", ERROR_JSON_SYNTAX, 3));
+    assert(streamFails("{\"a\":1,}", ERROR_JSON_SYNTAX, 7));
+    assert(streamFails("[\f]", ERROR_JSON_SYNTAX, 1));
+
+    {
+        char json[JSON_MAX_DEPTH + 2];
+        memset(json, '[', JSON_MAX_DEPTH + 1);
+        json[JSON_MAX_DEPTH + 1] = '\0';
+        assert(streamFails(json, ERROR_JSON_DEPTH, JSON_MAX_DEPTH));
+    }
+
+    return true;
+}
+
+bool test_json_streamFeedReader() {
+    String contents = str_readFile("jsonTests/pass/pass1.json");
+    assertStrValid(contents);
+
+    Builder expected = builder_create(0);
+    assertSuccess(streamChunks(contents, contents.length, &expected));
+
+    FileReader reader = reader_create("jsonTests/pass/pass1.json", 16);
+    assert(reader_isValid(reader));
+
+    Builder events = builder_create(0);
+    JSONStream stream = json_createStream(recordEvent, &events, false);
+    assertSuccess(json_streamFeedReader(&stream, &reader));
+    assert(str_equals(builder_str(events), builder_str(expected)));
+
+    json_destroyStream(&stream);
+    reader_destroy(&reader);
+    builder_destroy(&events);
+    builder_destroy(&expected);
+    str_destroy(&contents);
+
+    // Errors in the document are returned, rather than the end of the file.
+    reader = reader_create("jsonTests/fail/fail2.json", 8);
+    assert(reader_isValid(reader));
+
+    events = builder_create(0);
+    stream = json_createStream(recordEvent, &events, false);
+    assert(json_streamFeedReader(&stream, &reader) == ERROR_JSON_SYNTAX);
+    assert(json_isStreamErrored(stream));
+
+    json_destroyStream(&stream);
+    reader_destroy(&reader);
+    builder_destroy(&events);
+
+    return true;
+}
+
+bool test_json_compilePath() {
+    {
+        JSONPath path = json_compilePath(str_create("a.bc[3][0].d e"));
+        assert(!json_isPathErrored(path));
+        assert(json_getPathErrorType(path) == ERROR_NONE);
+        assert(path.stepCount == 5);
+
+        JSONPathStep * steps = (JSONPathStep *) path.steps.start;
+        assert(str_equalsC(steps[0].key, "a") && steps[0].index == -1);
+        assert(str_equalsC(steps[1].key, "bc") && steps[1].index == -1);
+        assert(steps[2].index == 3);
+        assert(steps[3].index == 0);
+        assert(str_equalsC(steps[4].key, "d e") && steps[4].index == -1);
+
+        json_destroyPath(&path);
+        assert(json_isPathErrored(path));
+    }
+
+    {
+        JSONPath path = json_compilePath(str_create("[12].x]"));
+        assert(path.stepCount == 2);
+        assert(((JSONPathStep *) path.steps.start)[0].index == 12);
+        assert(str_equalsC(((JSONPathStep *) path.steps.start)[1].key, "x]"));
+        json_destroyPath(&path);
+    }
+
+    {
+        JSONPath path = json_compilePath(str_createEmpty());
+        assert(!json_isPathErrored(path));
+        assert(path.stepCount == 0);
+        json_destroyPath(&path);
+    }
+
+    char * malformed[] = {".a", "a.", "a..b", "a.[0]", "a[", "a[]", "a[1", "a[x]", "a[-1]", "a[0]b", "[0][1]c", "a[1234567890123456789]"};
+    for(s64 index = 0; index < (s64) (sizeof(malformed) / sizeof(malformed[0])); ++index) {
+        JSONPath path = json_compilePath(str_create(malformed[index]));
+        assertOrError(json_getPathErrorType(path) == ERROR_FORMAT, "%s was accepted", malformed[index]);
+        json_destroyPath(&path);
+    }
+
+    return true;
+}
+
+bool test_json_find() {
+    String json = str_create(" {\"name\": \"CLib\", \"nested\": {\"list\": [1, [2, 3], {\"deep\": true}], \"x\": \"]}\\\"\"},"
+                             " \"\": null, \"esc\\u0061ped\": -5, \"flag\": false, \"name\": 2} ");
+
+    JSONValue value;
+
+    assertSuccess(json_findC(json, "name", &value));
+    assert(value.type == JSON_STRING);
+    assert(!value.isEscaped);
+    assert(str_equalsC(value.chars, "CLib"));
+    assert(value.chars.data == json.data + 11);
+
+    assertSuccess(json_findC(json, "nested.list[1][0]", &value));
+    assert(value.type == JSON_NUMBER);
+    assert(str_equalsC(value.chars, "2"));
+
+    assertSuccess(json_findC(json, "nested.list", &value));
+    assert(value.type == JSON_ARRAY);
+    assert(str_equalsC(value.chars, "[1, [2, 3], {\"deep\": true}]"));
+
+    assertSuccess(json_findC(json, "nested.list[2].deep", &value));
+    assert(value.type == JSON_BOOL);
+    assert(str_equalsC(value.chars, "true"));
+
+    assertSuccess(json_findC(json, "nested.x", &value));
+    assert(value.type == JSON_STRING);
+    assert(value.isEscaped);
+
+    assertSuccess(json_findC(json, "escaped", &value));
+    assert(value.type == JSON_NUMBER);
+    assert(str_equalsC(value.chars, "-5"));
+
+    assertSuccess(json_findC(json, "flag", &value));
+    assert(value.type == JSON_BOOL);
+
+    assertSuccess(json_findC(json, "", &value));
+    assert(value.type == JSON_OBJECT);
+    assert(value.chars.data == json.data + 1);
+    assert(value.chars.length == json.length - 2);
+
+    // Reusing a compiled path.
+    {
+        JSONPath path = json_compilePath(str_create("[1].id"));
+        char * records[3] = {"[{\"id\": 1}, {\"id\": 2}]", "[[], {\"name\": \"x\", \"id\": 3}]", "[0, {}]"};
+
+        assertSuccess(json_find(str_create(records[0]), path, &value));
+        assert(str_equalsC(value.chars, "2"));
+        assertSuccess(json_find(str_create(records[1]), path, &value));
+        assert(str_equalsC(value.chars, "3"));
+        assert(json_find(str_create(records[2]), path, &value) == ERROR_JSON_NOT_FOUND);
+
+        json_destroyPath(&path);
+        assert(json_find(str_create(records[0]), path, &value) == ERROR_ARG_INVALID);
+    }
+
+    assert(findFails(json.data, "missing", ERROR_JSON_NOT_FOUND));
+    assert(findFails(json.data, "nam", ERROR_JSON_NOT_FOUND));
+    assert(findFails(json.data, "name.x", ERROR_JSON_NOT_FOUND));
+    assert(findFails(json.data, "nested.list[3]", ERROR_JSON_NOT_FOUND));
+    assert(findFails(json.data, "nested.list.a", ERROR_JSON_NOT_FOUND));
+    assert(findFails(json.data, "[0]", ERROR_JSON_NOT_FOUND));
+    assert(findFails(json.data, "a..b", ERROR_FORMAT));
+    assert(findFails("{}", "a", ERROR_JSON_NOT_FOUND));
+    assert(findFails("[]", "[0]", ERROR_JSON_NOT_FOUND));
+
+    assert(findFails("", "", ERROR_JSON_SYNTAX));
+    assert(findFails("{\"a\" 1}", "a", ERROR_JSON_SYNTAX));
+    assert(findFails("[1, 2", "[5]", ERROR_JSON_SYNTAX));
+    assert(findFails("[1 2]", "[1]", ERROR_JSON_SYNTAX));
+    assert(findFails("{\"a\": [1, {\"b\": 2}, \"c\": 3}", "c", ERROR_JSON_SYNTAX));
+    assert(findFails("{\"a\": x, \"b\": 1}", "b", ERROR_JSON_SYNTAX));
+    assert(findFails("{\"a\": tru}", "a", ERROR_JSON_SYNTAX));
+    assert(findFails("{\"a\": 1.}", "a", ERROR_JSON_SYNTAX));
+    assert(findFails("{\"\\uDC00\": 1, \"b\": 2}", "b", ERROR_INVALID_CODEPOINT));
+    assert(findFails("x", "a", ERROR_JSON_SYNTAX));
+
+    // The contents of skipped values are not checked.
+    assertSuccess(json_findC(str_create("{\"a\": [1 2 x}, \"b\": 3}"), "b", &value));
+    assert(str_equalsC(value.chars, "3"));
+    assertSuccess(json_findC(str_create("{\"a\": tru, \"b\": 3}"), "b", &value));
+    assert(str_equalsC(value.chars, "3"));
+
+    // Every value that can be reached by a path is found, and matches the value parsed by json_parse.
+    {
+        String contents = str_readFile("jsonTests/pass/pass1.json");
+        assertStrValid(contents);
+
+        JSONDoc doc = json_parse(contents);
+        assert(json_isValid(doc));
+
+        Builder path = builder_create(0);
+        assert(findMatchesChildren(contents, json_root(doc), &path));
+
+        builder_destroy(&path);
+        json_destroy(&doc);
+        str_destroy(&contents);
+    }
+
+    {
+        srand(44);
+
+        Builder builder = builder_create(0);
+        builder_appendChar(&builder, '[');
+        for(s64 record = 0; record < 100; ++record) {
+            builder_appendFormat(&builder, "%s{\"id\": %d, \"text\": \"%.*s\\\\\\\"\", \"list\": [%d.5, {\"a\": [true, null]}]}",
+                                 (record == 0 ? "" : ",\n"), rand(), rand() % 90, LONG_STRING_FILLER, rand() % 1000);
+        }
+        builder_appendChar(&builder, ']');
+
+        JSONDoc doc = json_parse(builder_str(builder));
+        assert(json_isValid(doc));
+
+        Builder path = builder_create(0);
+        assert(findMatchesChildren(builder_str(builder), json_root(doc), &path));
+
+        builder_destroy(&path);
+        json_destroy(&doc);
+        builder_destroy(&builder);
+    }
+
+    return true;
+}
+
+bool test_json_getValue() {
+    JSONValue value;
+    String json = str_create("[12, -3.5, 1e999, 9223372036854775808, 2.0, true, false, null, \"a\\u00e9\\n\", \"\\q\", \"\\uDC00\", \"\"]");
+
+    s64 integer;
+    double number;
+    bool boolean;
+
+    assertSuccess(json_findC(json, "[0]", &value));
+    assertSuccess(json_getValueS64(value, &integer));
+    assert(integer == 12);
+    assertSuccess(json_getValueDouble(value, &number));
+    assert(number == 12.0);
+    assert(json_getValueBool(value, &boolean) == ERROR_ARG_INVALID);
+    assert(str_getErrorType(json_getValueString(value)) == ERROR_ARG_INVALID);
+    assert(json_getValueS64(value, NULL) == ERROR_ARG_NULL);
+    assert(json_getValueDouble(value, NULL) == ERROR_ARG_NULL);
+    assert(json_getValueBool(value, NULL) == ERROR_ARG_NULL);
+
+    assertSuccess(json_findC(json, "[1]", &value));
+    assertSuccess(json_getValueDouble(value, &number));
+    assert(number == -3.5);
+    assert(json_getValueS64(value, &integer) == ERROR_CAST);
+
+    assertSuccess(json_findC(json, "[2]", &value));
+    assert(json_getValueDouble(value, &number) == ERROR_OVERFLOW);
+
+    assertSuccess(json_findC(json, "[3]", &value));
+    assert(json_getValueS64(value, &integer) == ERROR_CAST);
+
+    assertSuccess(json_findC(json, "[4]", &value));
+    assert(json_getValueS64(value, &integer) == ERROR_CAST);
+
+    assertSuccess(json_findC(json, "[5]", &value));
+    assertSuccess(json_getValueBool(value, &boolean));
+    assert(boolean);
+    assert(json_getValueS64(value, &integer) == ERROR_ARG_INVALID);
+
+    assertSuccess(json_findC(json, "[6]", &value));
+    assertSuccess(json_getValueBool(value, &boolean));
+    assert(!boolean);
+
+    assertSuccess(json_findC(json, "[7]", &value));
+    assert(value.type == JSON_NULL);
+    assert(json_getValueBool(value, &boolean) == ERROR_ARG_INVALID);
+
+    assertSuccess(json_findC(json, "[8]", &value));
+    String string = json_getValueString(value);
+    assert(str_equalsC(string, "a\xC3\xA9\n"));
+    str_destroy(&string);
+
+    assertSuccess(json_findC(json, "[9]", &value));
+    assert(str_getErrorType(json_getValueString(value)) == ERROR_JSON_SYNTAX);
+
+    assertSuccess(json_findC(json, "[10]", &value));
+    assert(str_getErrorType(json_getValueString(value)) == ERROR_INVALID_CODEPOINT);
+
+    assertSuccess(json_findC(json, "[11]", &value));
+    string = json_getValueString(value);
+    assert(!str_isErrored(string));
+    assert(string.length == 0);
+    str_destroy(&string);
+
+    return true;
+}
+
+bool test_json_createWriter() {
+    JSONWriter writer = json_createWriter(0);
+    assert(!json_isWriterErrored(writer));
+
+    assertSuccess(json_writeStartObject(&writer));
+    assertSuccess(json_writeKeyC(&writer, "id"));
+    assertSuccess(json_writeS64(&writer, -42));
+    assertSuccess(json_writeKeyC(&writer, "list"));
+    assertSuccess(json_writeStartArray(&writer));
+    assertSuccess(json_writeDouble(&writer, 0.1));
+    assertSuccess(json_writeDouble(&writer, 1e300));
+    assertSuccess(json_writeBool(&writer, true));
+    assertSuccess(json_writeNull(&writer));
+    assertSuccess(json_writeStartObject(&writer));
+    assertSuccess(json_writeEndObject(&writer));
+    assertSuccess(json_writeStartArray(&writer));
+    assertSuccess(json_writeEndArray(&writer));
+    assertSuccess(json_writeEndArray(&writer));
+    assertSuccess(json_writeKeyC(&writer, "name"));
+    assertSuccess(json_writeStringC(&writer, "C\"Lib\""));
+    assertSuccess(json_writeEndObject(&writer));
+    assert(str_equalsC(json_writerStr(writer), "{\"id\":-42,\"list\":[0.1,1e300,true,null,{},[]],\"name\":\"C\\\"Lib\\\"\"}"));
+
+    // Top level values are written one per line.
+    assertSuccess(json_writeS64(&writer, 7));
+    assertSuccess(json_writeStringC(&writer, "x"));
+    assert(str_endsWith(json_writerStr(writer), str_create("}\n7\n\"x\"")));
+
+    // Resetting keeps the memory of the output.
+    char * outputStart = writer.output.buffer.start;
+    json_resetWriter(&writer);
+    assert(json_writerStr(writer).length == 0);
+    assertSuccess(json_writeStartArray(&writer));
+    assert(str_getErrorType(json_writerStr(writer)) == ERROR_JSON_SYNTAX);
+    assertSuccess(json_writeEndArray(&writer));
+    assert(str_equalsC(json_writerStr(writer), "[]"));
+    assert(writer.output.buffer.start == outputStart);
+
+    // Misuses make the writer errored until it is reset.
+    json_resetWriter(&writer);
+    assertSuccess(json_writeStartObject(&writer));
+    assert(json_writeS64(&writer, 1) == ERROR_ARG_INVALID);
+    assert(json_isWriterErrored(writer));
+    assert(json_writeKeyC(&writer, "a") == ERROR_ARG_INVALID);
+    assert(str_getErrorType(json_writerStr(writer)) == ERROR_ARG_INVALID);
+
+    json_resetWriter(&writer);
+    assert(!json_isWriterErrored(writer));
+    assert(json_writeKeyC(&writer, "a") == ERROR_ARG_INVALID);
+
+    json_resetWriter(&writer);
+    assertSuccess(json_writeStartObject(&writer));
+    assertSuccess(json_writeKeyC(&writer, "a"));
+    assert(json_writeEndObject(&writer) == ERROR_ARG_INVALID);
+
+    json_resetWriter(&writer);
+    assertSuccess(json_writeStartArray(&writer));
+    assert(json_writeEndObject(&writer) == ERROR_ARG_INVALID);
+
+    json_resetWriter(&writer);
+    assert(json_writeEndArray(&writer) == ERROR_ARG_INVALID);
+
+    json_resetWriter(&writer);
+    assert(json_writeDouble(&writer, NAN) == ERROR_ARG_INVALID);
+    json_resetWriter(&writer);
+    assert(json_writeDouble(&writer, -INFINITY) == ERROR_ARG_INVALID);
+
+    json_resetWriter(&writer);
+    for(s64 depth = 0; depth < JSON_MAX_DEPTH; ++depth) {
+        assertSuccess(json_writeStartArray(&writer));
+    }
+    assert(json_writeStartArray(&writer) == ERROR_JSON_DEPTH);
+
+    json_destroyWriter(&writer);
+    assert(json_isWriterErrored(writer));
+
+    writer = json_createWriter(-1);
+    assert(json_getWriterErrorType(writer) == ERROR_ARG_INVALID);
+    json_resetWriter(&writer);
+    assert(json_getWriterErrorType(writer) == ERROR_ARG_INVALID);
+    json_destroyWriter(&writer);
+
+    writer = json_createWriter(JSON_MAX_INDENT + 1);
+    assert(json_getWriterErrorType(writer) == ERROR_ARG_INVALID);
+    json_resetWriter(&writer);
+    assert(json_getWriterErrorType(writer) == ERROR_ARG_INVALID);
+    json_destroyWriter(&writer);
+
+    return true;
+}
+
+bool test_json_writeString() {
+    JSONWriter writer = json_createWriter(0);
+
+    assertSuccess(json_writeString(&writer, str_createOfLength("a\0b\x1F\x7F\xC3\xA9\b\f\n\r\t\\/\"", 15)));
+    assert(str_equalsC(json_writerStr(writer), "\"a\\u0000b\\u001f\x7F\xC3\xA9\\b\\f\\n\\r\\t\\\\/\\\"\""));
+
+    json_resetWriter(&writer);
+    assertSuccess(json_writeString(&writer, str_createEmpty()));
+    assert(str_equalsC(json_writerStr(writer), "\"\""));
+
+    // Strings with special chars at every position, so that each is found by both the vector and scalar searches.
+    srand(45);
+    for(s64 iteration = 0; iteration < 3000; ++iteration) {
+        char data[200];
+        s64 length = rand() % (s64) sizeof(data);
+
+        for(s64 index = 0; index < length; ++index) {
+            data[index] = (char) ('a' + rand() % 26);
+        }
+
+        s64 specials = rand() % 4;
+        for(s64 special = 0; special < specials && length > 0; ++special) {
+            char choices[6] = {'"', '\\', '\n', '\x01', '\x1F', (char) 0xE9};
+            data[rand() % length] = choices[rand() % 6];
+        }
+
+        Builder expected = builder_create(0);
+        referenceEscape(data, length, &expected);
+
+        json_resetWriter(&writer);
+        assertSuccess(json_writeString(&writer, str_createOfLength(data, length)));
+        assert(str_equals(json_writerStr(writer), builder_str(expected)));
+
+        builder_destroy(&expected);
+    }
+
+    json_destroyWriter(&writer);
+    return true;
+}
+
+bool test_json_writeNode() {
+    JSONWriter writer = json_createWriter(0);
+    JSONWriter pretty = json_createWriter(2);
+
+    char * files[3] = {"jsonTests/pass/pass1.json", "jsonTests/pass/pass2.json", "jsonTests/pass/pass3.json"};
+    for(s64 index = 0; index < 3; ++index) {
+        String contents = str_readFile(files[index]);
+        assertStrValid(contents);
+
+        assert(writeMatchesParse(&writer, contents));
+        assert(writeMatchesParse(&pretty, contents));
+
+        str_destroy(&contents);
+    }
+
+    srand(46);
+    for(s64 iteration = 0; iteration < 2000; ++iteration) {
+        String json = randomJSON(1 + rand() % 100);
+        JSONDoc doc = json_parse(json);
+
+        if(json_isValid(doc)) {
+            assert(writeMatchesParse(&writer, json));
+            assert(writeMatchesParse(&pretty, json));
+        }
+
+        json_destroy(&doc);
+        str_destroy(&json);
+    }
+
+    // Writing what was written gives the same output again.
+    {
+        String json = str_create("{\"a\": [1, -0.0, 2.5e-8, 123456789012345678901234567890, \"\\u00e9\\ud83d\\ude00\"], \"b\": {}}");
+        JSONDoc doc = json_parse(json);
+
+        json_resetWriter(&writer);
+        assertSuccess(json_writeNode(&writer, json_root(doc)));
+        String first = str_copy(json_writerStr(writer));
+        assert(str_equalsC(first, "{\"a\":[1,-0.0,2.5e-8,1.2345678901234568e29,\"\xC3\xA9\xF0\x9F\x98\x80\"],\"b\":{}}"));
+
+        JSONDoc again = json_parse(first);
+        json_resetWriter(&writer);
+        assertSuccess(json_writeNode(&writer, json_root(again)));
+        assert(str_equals(json_writerStr(writer), first));
+
+        json_destroy(&again);
+        str_destroy(&first);
+        json_destroy(&doc);
+    }
+
+    {
+        JSONDoc doc = json_parse(str_create("{\"a\": [1, [], {\"b\": null}], \"c\": {}}"));
+
+        json_resetWriter(&pretty);
+        assertSuccess(json_writeNode(&pretty, json_root(doc)));
+        assert(str_equalsC(json_writerStr(pretty),
+                           "{\n  \"a\": [\n    1,\n    [],\n    {\n      \"b\": null\n    }\n  ],\n  \"c\": {}\n}"));
+
+        json_destroy(&doc);
+    }
+
+    assert(json_writeNode(&writer, NULL) == ERROR_ARG_NULL);
+
+    json_destroyWriter(&writer);
+    json_destroyWriter(&pretty);
+    return true;
+}
+
+bool test_ndjson_parallelParse() {
+    char * filename = "test_ndjson_parallelParse.tmp";
+
+    // Enough lines for several batches, with escaped strings that must be unescaped into each thread's doc.
+    JSONWriter writer = json_createWriter(0);
+    s64 recordCount = 40000;
+    s64 expectedSum = 0;
+
+    for(s64 id = 0; id < recordCount; ++id) {
+        assertSuccess(json_writeStartObject(&writer));
+        assertSuccess(json_writeKeyC(&writer, "id"));
+        assertSuccess(json_writeS64(&writer, id));
+        assertSuccess(json_writeKeyC(&writer, "text"));
+        assertSuccess(json_writeString(&writer, str_createOfLength(LONG_STRING_FILLER, id % 90)));
+        assertSuccess(json_writeKeyC(&writer, "quote"));
+        assertSuccess(json_writeStringC(&writer, "\"\\\n"));
+        assertSuccess(json_writeEndObject(&writer));
+
+        expectedSum += id;
+    }
+
+    String lines = json_writerStr(writer);
+    assertStrValid(lines);
+
+    // Blank lines are skipped, lines may end in "\r\n", and an invalid line is delivered as an errored JSONDoc.
+    s64 middle = str_indexOfCharAfter(lines, '\n', lines.length / 2);
+    assert(middle > 0);
+
+    Builder contents = builder_create(0);
+    assertSuccess(builder_appendStr(&contents, str_substring(lines, 0, middle)));
+    assertSuccess(builder_appendC(&contents, "\r\n  \t\n\n{\"id\": "));
+    assertSuccess(builder_appendStr(&contents, str_substring(lines, middle, lines.length)));
+    assert(writeNDJSON(filename, builder_str(contents)));
+    builder_destroy(&contents);
+
+    s64 threadCounts[4] = {0, 1, 3, 8};
+    for(int index = 0; index < 4; ++index) {
+        for(int ordered = 0; ordered < 2; ++ordered) {
+            NDJSONTotals totals = {0, 0, 0, -1, true, true};
+
+            assertSuccess(ndjson_parallelParse(filename, threadCounts[index], ordered, &checkRecord, &totals));
+            assert(totals.records == recordCount + 1);
+            assert(totals.errors == 1);
+            assert(totals.idSum == expectedSum);
+            assert(totals.matchesParse);
+
+            if(ordered) {
+                assert(totals.inOrder);
+                assert(totals.lastId == recordCount - 1);
+            }
+        }
+    }
+
+    json_destroyWriter(&writer);
+
+    assert(writeNDJSON(filename, str_create("\n[1,\"\\u00e9\"]\n\"a\"  \n\n1")));
+    {
+        NDJSONTotals totals = {0, 0, 0, -1, true, true};
+
+        assertSuccess(ndjson_parallelParse(filename, 4, true, &checkRecord, &totals));
+        assert(totals.records == 3);
+        assert(totals.errors == 3);
+        assert(totals.matchesParse);
+    }
+
+    assert(writeNDJSON(filename, str_createEmpty()));
+    {
+        NDJSONTotals totals = {0, 0, 0, -1, true, true};
+
+        assertSuccess(ndjson_parallelParse(filename, 4, false, &checkRecord, &totals));
+        assert(totals.records == 0);
+    }
+    remove(filename);
+
+    // Pipes cannot be mapped, so their lines are read into memory first
+    int pipeFiles[2];
+    assert(pipe(pipeFiles) == 0);
+    {
+        char * piped = "{\"id\": 0}\n{\"id\": 1}\n{\"id\": 2}\n";
+        assert(write(pipeFiles[1], piped, strlen(piped)) == (ssize_t) strlen(piped));
+        close(pipeFiles[1]);
+
+        char pipeName[64];
+        snprintf(pipeName, sizeof(pipeName), "/dev/fd/%d", pipeFiles[0]);
+
+        NDJSONTotals totals = {0, 0, 0, -1, true, true};
+
+        assertSuccess(ndjson_parallelParse(pipeName, 2, true, &checkRecord, &totals));
+        assert(totals.records == 3);
+        assert(totals.errors == 0);
+        assert(totals.idSum == 3);
+        assert(totals.inOrder);
+    }
+    close(pipeFiles[0]);
+
+    NDJSONTotals totals = {0, 0, 0, -1, true, true};
+    assert(ndjson_parallelParse(filename, 4, true, &checkRecord, &totals) == ERROR_FILE_OPEN);
+    assert(ndjson_parallelParse(filename, 4, true, NULL, &totals) == ERROR_ARG_NULL);
+    assert(ndjson_parallelParse(NULL, 4, true, &checkRecord, &totals) == ERROR_ARG_NULL);
+    assert(ndjson_parallelParse(filename, -1, true, &checkRecord, &totals) == ERROR_ARG_INVALID);
+
+    return true;
+}
+
+
+//
+// Run Tests
+//
+
+void test_JSON(int * failures, int * successes) {
+    test(json_parse);
+    test(json_parseUsing);
+    test(json_createIndex);
+    test(json_getString);
+    test(json_getNumber);
+    test(json_objectGet);
+    test(json_streamFeed);
+    test(json_streamFeedReader);
+    test(json_compilePath);
+    test(json_find);
+    test(json_getValue);
+    test(json_createWriter);
+    test(json_writeString);
+    test(json_writeNode);
+    test(ndjson_parallelParse);
+}
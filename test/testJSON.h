@@ -0,0 +1,9 @@
+#ifndef __CLIB_testJSON_h
+#define __CLIB_testJSON_h
+
+/*
+ * Test JSON parsing.
+ */
+void test_JSON(int * failures, int * successes);
+
+#endif
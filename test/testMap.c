@@ -0,0 +1,330 @@
+#include <pthread.h>
+#include "test.h"
+#include "testString.h"
+#include "testMap.h"
+
+#define MAP_TEST_KEYS 20000
+#define MAP_TEST_THREADS 8
+
+/*
+ * Write the key for {number} into {buffer}, returning a view of it.
+ */
+static String mapKey(char * buffer, s64 number) {
+    int length = snprintf(buffer, 32, "key-%lld", (long long) number);
+    return str_createOfLength(buffer, length);
+}
+
+/*
+ * Adds {context}, a pointer to a u64, to the value of the key.
+ */
+static u64 addToValue(String key, u64 value, bool exists, void * context) {
+    (void) key;
+    return (exists ? value : 0) + *(u64 *) context;
+}
+
+/*
+ * A thread of a concurrent test, using the keys in [start, end).
+ */
+typedef struct MapTestThread {
+    ConcurrentMap * map;
+    s64 start;
+    s64 end;
+    s64 inserted;
+    bool valid;
+} MapTestThread;
+
+/*
+ * Insert the keys of the thread with the value of their number, counting the ones that were new.
+ */
+static void * insertKeys(void * argument) {
+    MapTestThread * thread = argument;
+    char buffer[32];
+    thread->valid = true;
+
+    for(s64 number = thread->start; number < thread->end; ++number) {
+        u64 current;
+        CLibErrorType error = cmap_insertIfAbsent(thread->map, mapKey(buffer, number), (u64) number, &current);
+
+        thread->inserted += (error == ERROR_SUCCESS ? 1 : 0);
+        thread->valid &= (error == ERROR_SUCCESS || error == ERROR_MAP_KEY_EXISTS) && current == (u64) number;
+    }
+
+    return NULL;
+}
+
+/*
+ * Check that the keys of the thread have the value of their number, many times over.
+ */
+static void * readKeys(void * argument) {
+    MapTestThread * thread = argument;
+    char buffer[32];
+    thread->valid = true;
+
+    for(s64 repeat = 0; repeat < 20; ++repeat) {
+        for(s64 number = thread->start; number < thread->end; ++number) {
+            u64 value = 0;
+            thread->valid &= cmap_get(*thread->map, mapKey(buffer, number), &value) && value == (u64) number;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Add one to the values of the keys of the thread, from 0 to MAP_TEST_KEYS / 16.
+ */
+static void * incrementKeys(void * argument) {
+    MapTestThread * thread = argument;
+    char buffer[32];
+    u64 one = 1;
+    thread->valid = true;
+
+    for(s64 number = thread->start; number < thread->end; ++number) {
+        thread->valid &= cmap_upsert(thread->map, mapKey(buffer, number % (MAP_TEST_KEYS / 16)), &addToValue, &one, NULL) == ERROR_SUCCESS;
+    }
+
+    return NULL;
+}
+
+/*
+ * Run {function} on MAP_TEST_THREADS threads, each given {perThread} keys starting from {offset} times its index.
+ */
+static bool runMapThreads(ConcurrentMap * map, void * (*function)(void *), s64 offset, s64 perThread, s64 * inserted) {
+    MapTestThread threads[MAP_TEST_THREADS];
+    pthread_t handles[MAP_TEST_THREADS];
+
+    for(s64 index = 0; index < MAP_TEST_THREADS; ++index) {
+        threads[index] = (MapTestThread) {.map = map, .start = index * offset, .end = index * offset + perThread};
+        assert(pthread_create(&handles[index], NULL, function, &threads[index]) == 0);
+    }
+
+    bool valid = true;
+    *inserted = 0;
+    for(s64 index = 0; index < MAP_TEST_THREADS; ++index) {
+        pthread_join(handles[index], NULL);
+        valid &= threads[index].valid;
+        *inserted += threads[index].inserted;
+    }
+
+    return valid;
+}
+
+
+
+//
+// Tests
+//
+
+bool test_str_hash() {
+    char buffer[256];
+    for(int index = 0; index < 256; ++index) {
+        buffer[index] = (char) (index * 7 + 3);
+    }
+
+    // Every length has its own hash, and so does every offset for each length.
+    u64 hashes[129];
+    for(s64 length = 0; length <= 128; ++length) {
+        hashes[length] = str_hash(str_createOfLength(buffer, length), 0);
+
+        for(s64 previous = 0; previous < length; ++previous) {
+            assert(hashes[previous] != hashes[length]);
+        }
+
+        // The same contents hash the same wherever they are.
+        String copy = str_copy(str_createOfLength(buffer, length));
+        assert(str_hash(copy, 0) == hashes[length]);
+        str_destroy(&copy);
+
+        if(length > 0) {
+            assert(str_hash(str_createOfLength(&buffer[1], length), 0) != hashes[length]);
+        }
+    }
+
+    // Changing any char changes the hash.
+    for(s64 index = 0; index < 100; ++index) {
+        buffer[index] ^= 1;
+        assert(str_hash(str_createOfLength(buffer, 100), 0) != hashes[100]);
+        buffer[index] ^= 1;
+    }
+
+    assert(str_hash(str_create("hello"), 1) != str_hash(str_create("hello"), 2));
+    assert(str_hash(str_create("hello"), 1) == str_hash(str_create("hello"), 1));
+    assert(str_hash(str_createErrored(ERROR_ALLOC, 0), 5) == str_hash(str_createEmpty(), 5));
+
+    return true;
+}
+
+bool test_ConcurrentMap_create() {
+    ConcurrentMap map = cmap_create(3, 0);
+    {
+        assert(!cmap_isErrored(map));
+        assert(map.shardCount == 4);
+        assert(cmap_count(map) == 0);
+        assert(!cmap_get(map, str_create("missing"), NULL));
+    }
+    cmap_destroy(&map);
+    assert(cmap_getErrorType(map) == ERROR_FREED);
+
+    map = cmap_create(0, 0);
+    {
+        assert(!cmap_isErrored(map));
+        assert(map.shardCount >= 4);
+    }
+    cmap_destroy(&map);
+
+    map = cmap_create(-1, 0);
+    assert(cmap_getErrorType(map) == ERROR_ARG_INVALID);
+    assert(cmap_insertIfAbsent(&map, str_create("key"), 1, NULL) == ERROR_ARG_INVALID);
+    assert(cmap_upsert(&map, str_create("key"), &addToValue, NULL, NULL) == ERROR_ARG_INVALID);
+    assert(!cmap_get(map, str_create("key"), NULL));
+
+    map = cmap_create(CMAP_MAX_SHARDS + 1, 0);
+    assert(cmap_getErrorType(map) == ERROR_ARG_INVALID);
+
+    return true;
+}
+
+bool test_ConcurrentMap_insertIfAbsent() {
+    ConcurrentMap map = cmap_create(1, 42);
+    {
+        u64 current = 0;
+        char buffer[32];
+
+        assertSuccess(cmap_insertIfAbsent(&map, str_create("apple"), 1, &current));
+        assert(current == 1);
+        assert(cmap_insertIfAbsent(&map, str_create("apple"), 2, &current) == ERROR_MAP_KEY_EXISTS);
+        assert(current == 1);
+
+        assertSuccess(cmap_insertIfAbsent(&map, str_createEmpty(), 3, NULL));
+        assert(cmap_get(map, str_create(""), &current) && current == 3);
+
+        // Keys are copied, so the memory they came from can be reused.
+        strcpy(buffer, "banana");
+        assertSuccess(cmap_insertIfAbsent(&map, str_create(buffer), 4, NULL));
+        strcpy(buffer, "cherry");
+        assert(!cmap_get(map, str_create(buffer), NULL));
+        assert(cmap_get(map, str_create("banana"), &current) && current == 4);
+
+        assert(cmap_insertIfAbsent(&map, str_createErrored(ERROR_ALLOC, 0), 5, NULL) == ERROR_ARG_INVALID);
+        assert(cmap_count(map) == 3);
+
+        // Growing the single shard many times keeps every key.
+        for(s64 number = 0; number < MAP_TEST_KEYS; ++number) {
+            assertSuccess(cmap_insertIfAbsent(&map, mapKey(buffer, number), (u64) number * 3, NULL));
+        }
+        assert(cmap_count(map) == MAP_TEST_KEYS + 3);
+
+        for(s64 number = 0; number < MAP_TEST_KEYS; ++number) {
+            assert(cmap_get(map, mapKey(buffer, number), &current) && current == (u64) number * 3);
+        }
+        assert(!cmap_get(map, mapKey(buffer, MAP_TEST_KEYS), NULL));
+
+        // Keys too long to be stored in their entry.
+        char longBuffer[64];
+        for(s64 number = 0; number < 1000; ++number) {
+            int length = snprintf(longBuffer, sizeof(longBuffer), "a key that is too long to be inline %lld", (long long) number);
+            assertSuccess(cmap_insertIfAbsent(&map, str_createOfLength(longBuffer, length), (u64) number, NULL));
+        }
+
+        for(s64 number = 0; number < 1000; ++number) {
+            int length = snprintf(longBuffer, sizeof(longBuffer), "a key that is too long to be inline %lld", (long long) number);
+            assert(cmap_get(map, str_createOfLength(longBuffer, length), &current) && current == (u64) number);
+            assert(!cmap_get(map, str_createOfLength(&longBuffer[1], length - 1), NULL));
+        }
+        assert(cmap_count(map) == MAP_TEST_KEYS + 1003);
+    }
+    cmap_destroy(&map);
+
+    return true;
+}
+
+bool test_ConcurrentMap_upsert() {
+    ConcurrentMap map = cmap_create(8, 7);
+    {
+        char * words[] = {"the", "cat", "sat", "on", "the", "mat", "the", "end of a rather long sentence"};
+        u64 one = 1;
+        u64 result;
+
+        for(int index = 0; index < 8; ++index) {
+            assertSuccess(cmap_upsert(&map, str_create(words[index]), &addToValue, &one, &result));
+        }
+        assert(result == 1);
+
+        assert(cmap_count(map) == 6);
+        assert(cmap_get(map, str_create("the"), &result) && result == 3);
+        assert(cmap_get(map, str_create("cat"), &result) && result == 1);
+
+        assertSuccess(cmap_upsert(&map, str_create("end of a rather long sentence"), &addToValue, &one, &result));
+        assert(result == 2);
+
+        u64 ten = 10;
+        assertSuccess(cmap_upsert(&map, str_create("cat"), &addToValue, &ten, &result));
+        assert(result == 11);
+    }
+    cmap_destroy(&map);
+
+    return true;
+}
+
+bool test_ConcurrentMap_threads() {
+    ConcurrentMap map = cmap_create(4, 99);
+    {
+        s64 inserted;
+        s64 perThread = MAP_TEST_KEYS / MAP_TEST_THREADS;
+
+        // Each key is inserted by two threads, but only one of them adds it.
+        assert(runMapThreads(&map, &insertKeys, perThread / 2, perThread, &inserted));
+        s64 keys = perThread / 2 * (MAP_TEST_THREADS + 1);
+        assert(inserted == keys);
+        assert(cmap_count(map) == keys);
+
+        // Read the existing keys while more keys are added, growing the shards under the readers.
+        MapTestThread readers[2];
+        pthread_t readerThreads[2];
+        for(s64 index = 0; index < 2; ++index) {
+            readers[index] = (MapTestThread) {.map = &map, .start = index * keys / 2, .end = (index + 1) * keys / 2};
+            assert(pthread_create(&readerThreads[index], NULL, &readKeys, &readers[index]) == 0);
+        }
+
+        assert(runMapThreads(&map, &insertKeys, perThread, perThread, &inserted));
+        assert(inserted == MAP_TEST_KEYS - keys);
+
+        for(s64 index = 0; index < 2; ++index) {
+            pthread_join(readerThreads[index], NULL);
+            assert(readers[index].valid);
+        }
+
+        assert(cmap_count(map) == MAP_TEST_KEYS);
+    }
+    cmap_destroy(&map);
+
+    map = cmap_create(2, 5);
+    {
+        s64 inserted;
+        assert(runMapThreads(&map, &incrementKeys, 0, MAP_TEST_KEYS, &inserted));
+
+        char buffer[32];
+        for(s64 number = 0; number < MAP_TEST_KEYS / 16; ++number) {
+            u64 value = 0;
+            assert(cmap_get(map, mapKey(buffer, number), &value));
+            assert(value == 16 * MAP_TEST_THREADS);
+        }
+    }
+    cmap_destroy(&map);
+
+    return true;
+}
+
+
+
+//
+// Run Tests
+//
+
+void test_Map(int * failures, int * successes) {
+    test(str_hash);
+    test(ConcurrentMap_create);
+    test(ConcurrentMap_insertIfAbsent);
+    test(ConcurrentMap_upsert);
+    test(ConcurrentMap_threads);
+}
@@ -0,0 +1,9 @@
+#ifndef __CLIB_testMap_h
+#define __CLIB_testMap_h
+
+/*
+ * Test str_hash and ConcurrentMap.
+ */
+void test_Map(int * failures, int * successes);
+
+#endif
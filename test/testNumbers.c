@@ -1,3 +1,4 @@
+#include <math.h>
 #include "test.h"
 #include "testNumbers.h"
 
@@ -196,6 +197,192 @@ bool test_can_cast_long_to_s64() {
     return true;
 }
 
+/*
+ * Assert that appending {value} to an empty Builder using {function} produces {expected}.
+ */
+#define assertAppends(function, value, expected)                    \
+    do {                                                            \
+        Builder builder = builder_create(0);                        \
+        assertSuccess(function(&builder, value));                   \
+        assertOrError(str_equalsC(builder_str(builder), expected),  \
+                      #value " was not appended as " expected);     \
+        builder_destroy(&builder);                                  \
+    } while(0)
+
+bool test_builder_appendU64() {
+    assertAppends(builder_appendU64, 0, "0");
+    assertAppends(builder_appendU64, 7, "7");
+    assertAppends(builder_appendU64, 10, "10");
+    assertAppends(builder_appendU64, 99, "99");
+    assertAppends(builder_appendU64, 100, "100");
+    assertAppends(builder_appendU64, 12345678, "12345678");
+    assertAppends(builder_appendU64, 10000000000000000000ULL, "10000000000000000000");
+    assertAppends(builder_appendU64, U64_MAX, "18446744073709551615");
+
+    return true;
+}
+
+bool test_builder_appendS64() {
+    assertAppends(builder_appendS64, 0, "0");
+    assertAppends(builder_appendS64, -1, "-1");
+    assertAppends(builder_appendS64, 4096, "4096");
+    assertAppends(builder_appendS64, -123456789, "-123456789");
+    assertAppends(builder_appendS64, S64_MAX, "9223372036854775807");
+    assertAppends(builder_appendS64, S64_MIN, "-9223372036854775808");
+
+    return true;
+}
+
+bool test_builder_appendDouble() {
+    assertAppends(builder_appendDouble, 0.0, "0.0");
+    assertAppends(builder_appendDouble, -0.0, "-0.0");
+    assertAppends(builder_appendDouble, 1.0, "1.0");
+    assertAppends(builder_appendDouble, 1.5, "1.5");
+    assertAppends(builder_appendDouble, -300.0, "-300.0");
+    assertAppends(builder_appendDouble, 0.1, "0.1");
+    assertAppends(builder_appendDouble, 0.3, "0.3");
+    assertAppends(builder_appendDouble, 123456.789, "123456.789");
+    assertAppends(builder_appendDouble, 0.000025, "0.000025");
+    assertAppends(builder_appendDouble, 1e-7, "1e-7");
+    assertAppends(builder_appendDouble, 1e21, "1e21");
+    assertAppends(builder_appendDouble, 1.25e30, "1.25e30");
+    assertAppends(builder_appendDouble, 5e-324, "5e-324");
+    assertAppends(builder_appendDouble, 1.7976931348623157e308, "1.7976931348623157e308");
+    assertAppends(builder_appendDouble, NAN, "NaN");
+    assertAppends(builder_appendDouble, INFINITY, "Infinity");
+    assertAppends(builder_appendDouble, -INFINITY, "-Infinity");
+
+    // Every double should parse back to exactly the same value.
+    u64 bits = 88172645463325252ULL;
+    for(int index = 0; index < 10000; ++index) {
+        bits ^= bits << 13;
+        bits ^= bits >> 7;
+        bits ^= bits << 17;
+
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        if(isnan(value))
+            continue;
+
+        Builder builder = builder_create(0);
+        assertSuccess(builder_appendDouble(&builder, value));
+
+        double parsed;
+        assertSuccess(str_parseDouble(builder_str(builder), &parsed));
+        assert(memcmp(&parsed, &value, sizeof(value)) == 0);
+
+        builder_destroy(&builder);
+    }
+
+    return true;
+}
+
+bool test_str_parseU64() {
+    u64 value;
+
+    assertSuccess(str_parseU64(str_create("0"), &value));
+    assert(value == 0);
+    assertSuccess(str_parseU64(str_create("42"), &value));
+    assert(value == 42);
+    assertSuccess(str_parseU64(str_create("12345678"), &value));
+    assert(value == 12345678);
+    assertSuccess(str_parseU64(str_create("1234567890123456"), &value));
+    assert(value == 1234567890123456ULL);
+    assertSuccess(str_parseU64(str_create("18446744073709551615"), &value));
+    assert(value == U64_MAX);
+    assertSuccess(str_parseU64(str_create("0000000000000000000000000123"), &value));
+    assert(value == 123);
+
+    value = 5;
+    assert(str_parseU64(str_create("18446744073709551616"), &value) == ERROR_OVERFLOW);
+    assert(str_parseU64(str_create("100000000000000000000"), &value) == ERROR_OVERFLOW);
+    assert(str_parseU64(str_create(""), &value) == ERROR_ARG_INVALID);
+    assert(str_parseU64(str_create("-1"), &value) == ERROR_ARG_INVALID);
+    assert(str_parseU64(str_create("12a"), &value) == ERROR_ARG_INVALID);
+    assert(str_parseU64(str_create("1234567/"), &value) == ERROR_ARG_INVALID);
+    assert(str_parseU64(str_create("123456789012345:"), &value) == ERROR_ARG_INVALID);
+    assert(str_parseU64(str_create("1844674407370955161x"), &value) == ERROR_ARG_INVALID);
+    assert(str_parseU64(str_createErrored(ERROR_FREED, 0), &value) == ERROR_ARG_INVALID);
+    assert(str_parseU64(str_create("1"), NULL) == ERROR_ARG_NULL);
+    assert(value == 5);
+
+    return true;
+}
+
+bool test_str_parseS64() {
+    s64 value;
+
+    assertSuccess(str_parseS64(str_create("0"), &value));
+    assert(value == 0);
+    assertSuccess(str_parseS64(str_create("-42"), &value));
+    assert(value == -42);
+    assertSuccess(str_parseS64(str_create("+42"), &value));
+    assert(value == 42);
+    assertSuccess(str_parseS64(str_create("9223372036854775807"), &value));
+    assert(value == S64_MAX);
+    assertSuccess(str_parseS64(str_create("-9223372036854775808"), &value));
+    assert(value == S64_MIN);
+
+    assert(str_parseS64(str_create("9223372036854775808"), &value) == ERROR_OVERFLOW);
+    assert(str_parseS64(str_create("-9223372036854775809"), &value) == ERROR_OVERFLOW);
+    assert(str_parseS64(str_create("-"), &value) == ERROR_ARG_INVALID);
+    assert(str_parseS64(str_create("--1"), &value) == ERROR_ARG_INVALID);
+    assert(str_parseS64(str_create(" 1"), &value) == ERROR_ARG_INVALID);
+
+    return true;
+}
+
+/*
+ * Assert that {string} parses to the same double as strtod.
+ */
+#define assertParsesLikeStrtod(string)                                        \
+    do {                                                                      \
+        double parsed;                                                        \
+        double expected = strtod(string, NULL);                               \
+        assertSuccess(str_parseDouble(str_create(string), &parsed));          \
+        assertOrError(memcmp(&parsed, &expected, sizeof(double)) == 0,        \
+                      string " was parsed as %.17g", parsed);                 \
+    } while(0)
+
+bool test_str_parseDouble() {
+    assertParsesLikeStrtod("0");
+    assertParsesLikeStrtod("-0.0");
+    assertParsesLikeStrtod("1");
+    assertParsesLikeStrtod("1.5");
+    assertParsesLikeStrtod("-273.15");
+    assertParsesLikeStrtod("0.1");
+    assertParsesLikeStrtod(".5");
+    assertParsesLikeStrtod("5.");
+    assertParsesLikeStrtod("1e10");
+    assertParsesLikeStrtod("1E+10");
+    assertParsesLikeStrtod("2.5e-3");
+    assertParsesLikeStrtod("0.000000000000000000000000000001");
+    assertParsesLikeStrtod("123456789012345678901234567890");
+    assertParsesLikeStrtod("3.141592653589793238462643383279");
+    assertParsesLikeStrtod("9007199254740993");
+    assertParsesLikeStrtod("2.2250738585072011e-308");
+    assertParsesLikeStrtod("4.9406564584124654e-324");
+    assertParsesLikeStrtod("1.7976931348623157e308");
+    assertParsesLikeStrtod("1e-400");
+
+    double value;
+    assertSuccess(str_parseDouble(str_create("NaN"), &value));
+    assert(isnan(value));
+    assertSuccess(str_parseDouble(str_create("-Infinity"), &value));
+    assert(isinf(value) && value < 0);
+
+    assert(str_parseDouble(str_create("1e400"), &value) == ERROR_OVERFLOW);
+    assert(str_parseDouble(str_create("-1e400"), &value) == ERROR_OVERFLOW);
+    assert(str_parseDouble(str_create(""), &value) == ERROR_ARG_INVALID);
+    assert(str_parseDouble(str_create("."), &value) == ERROR_ARG_INVALID);
+    assert(str_parseDouble(str_create("1e"), &value) == ERROR_ARG_INVALID);
+    assert(str_parseDouble(str_create("1.5x"), &value) == ERROR_ARG_INVALID);
+    assert(str_parseDouble(str_create("1,5"), &value) == ERROR_ARG_INVALID);
+
+    return true;
+}
+
+
 
 //
 // Run Tests
@@ -222,4 +409,11 @@ void test_numbers(int * failures, int * successes) {
     test(can_cast_sizet_to_s64);
     test(can_cast_s64_to_long);
     test(can_cast_long_to_s64);
+
+    test(builder_appendU64);
+    test(builder_appendS64);
+    test(builder_appendDouble);
+    test(str_parseU64);
+    test(str_parseS64);
+    test(str_parseDouble);
 }
@@ -0,0 +1,311 @@
+#include <pthread.h>
+#include "test.h"
+#include "testString.h"
+#include "testPool.h"
+
+#define POOL_TEST_LENGTH 100000
+
+/*
+ * Adds one to each of the counters in [start, end) of the s64 array {context}.
+ */
+static void countIndices(s64 start, s64 end, void * context) {
+    s64 * counts = context;
+
+    for(s64 index = start; index < end; ++index) {
+        __atomic_add_fetch(&counts[index], 1, __ATOMIC_RELAXED);
+    }
+}
+
+/*
+ * Check that parallel_for over [begin, end) with {grain} visits each index once.
+ */
+static bool checkParallelFor(ThreadPool pool, s64 begin, s64 end, s64 grain) {
+    s64 * counts = calloc(POOL_TEST_LENGTH, sizeof(s64));
+    assert(counts != NULL);
+
+    assertSuccess(parallel_for(pool, begin, end, grain, &countIndices, counts));
+
+    for(s64 index = 0; index < POOL_TEST_LENGTH; ++index) {
+        assert(counts[index] == (index >= begin && index < end ? 1 : 0));
+    }
+
+    free(counts);
+    return true;
+}
+
+/*
+ * Adds one to the s64 {context}.
+ */
+static void incrementTask(void * context) {
+    __atomic_add_fetch((s64 *) context, 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * Computes the {n}th Fibonacci number by forking and joining a TaskGroup for each call.
+ */
+typedef struct FibonacciTask {
+    ThreadPool pool;
+    s64 n;
+    s64 result;
+} FibonacciTask;
+
+static void fibonacciTask(void * context) {
+    FibonacciTask * task = context;
+
+    if(task->n < 2) {
+        task->result = task->n;
+        return;
+    }
+
+    FibonacciTask first = {.pool = task->pool, .n = task->n - 1};
+    FibonacciTask second = {.pool = task->pool, .n = task->n - 2};
+
+    TaskGroup group = taskgroup_create(task->pool);
+    taskgroup_run(&group, &fibonacciTask, &first);
+    fibonacciTask(&second);
+    taskgroup_wait(&group);
+
+    task->result = first.result + second.result;
+}
+
+/*
+ * Runs parallel_for from within a task, or from another thread.
+ */
+typedef struct NestedTask {
+    ThreadPool pool;
+    s64 * counts;
+    s64 begin;
+    s64 end;
+} NestedTask;
+
+static void nestedTask(void * context) {
+    NestedTask * task = context;
+    parallel_for(task->pool, task->begin, task->end, 16, &countIndices, task->counts);
+}
+
+static void * nestedThread(void * context) {
+    nestedTask(context);
+    return NULL;
+}
+
+/*
+ * Spawns more tasks than fit in a worker's deque.
+ */
+static void spawnManyTask(void * context) {
+    NestedTask * task = context;
+
+    TaskGroup group = taskgroup_create(task->pool);
+    for(s64 index = 0; index < 4 * POOL_DEQUE_CAPACITY; ++index) {
+        taskgroup_run(&group, &incrementTask, task->counts);
+    }
+    taskgroup_wait(&group);
+}
+
+
+
+//
+// Tests
+//
+
+bool test_ThreadPool_create() {
+    ThreadPool pool = pool_create(3, false);
+    {
+        assert(!pool_isErrored(pool));
+        assert(pool.threads == 3);
+    }
+    pool_destroy(&pool);
+    assert(pool_getErrorType(pool) == ERROR_FREED);
+
+    pool = pool_create(0, true);
+    {
+        assert(!pool_isErrored(pool));
+        assert(pool.threads >= 1);
+        assert(checkParallelFor(pool, 0, POOL_TEST_LENGTH, 100));
+    }
+    pool_destroy(&pool);
+
+    pool = pool_create(-1, false);
+    assert(pool_getErrorType(pool) == ERROR_ARG_INVALID);
+
+    // The tasks of an errored pool are run by the thread that spawns them.
+    s64 count = 0;
+    TaskGroup group = taskgroup_create(pool);
+    taskgroup_run(&group, &incrementTask, &count);
+    assert(count == 1);
+    taskgroup_wait(&group);
+
+    s64 counts[4];
+    assert(parallel_for(pool, 0, 4, 1, &countIndices, counts) == ERROR_ARG_INVALID);
+
+    return true;
+}
+
+bool test_parallel_for() {
+    ThreadPool pool = pool_create(4, false);
+    {
+        assert(checkParallelFor(pool, 0, POOL_TEST_LENGTH, 1));
+        assert(checkParallelFor(pool, 0, POOL_TEST_LENGTH, 0));
+        assert(checkParallelFor(pool, 17, POOL_TEST_LENGTH - 3, 7));
+        assert(checkParallelFor(pool, 5, 6, 1));
+        assert(checkParallelFor(pool, 0, POOL_TEST_LENGTH, POOL_TEST_LENGTH * 2));
+        assert(checkParallelFor(pool, 10, 10, 1));
+        assert(checkParallelFor(pool, 10, 5, 1));
+    }
+    pool_destroy(&pool);
+
+    return true;
+}
+
+bool test_TaskGroup() {
+    ThreadPool pool = pool_create(4, false);
+    {
+        s64 count = 0;
+        TaskGroup group = taskgroup_create(pool);
+        for(s64 index = 0; index < 10000; ++index) {
+            taskgroup_run(&group, &incrementTask, &count);
+        }
+        taskgroup_wait(&group);
+        assert(count == 10000);
+
+        // Waiting again, or for an empty group, returns straight away.
+        taskgroup_wait(&group);
+
+        FibonacciTask fibonacci = {.pool = pool, .n = 20};
+        group = taskgroup_create(pool);
+        taskgroup_run(&group, &fibonacciTask, &fibonacci);
+        taskgroup_wait(&group);
+        assert(fibonacci.result == 6765);
+
+        count = 0;
+        NestedTask many = {.pool = pool, .counts = &count};
+        group = taskgroup_create(pool);
+        taskgroup_run(&group, &spawnManyTask, &many);
+        taskgroup_run(&group, &spawnManyTask, &many);
+        taskgroup_wait(&group);
+        assert(count == 8 * POOL_DEQUE_CAPACITY);
+    }
+    pool_destroy(&pool);
+
+    return true;
+}
+
+bool test_ThreadPool_nested() {
+    ThreadPool pool = pool_create(3, false);
+    {
+        s64 * counts = calloc(POOL_TEST_LENGTH, sizeof(s64));
+        assert(counts != NULL);
+
+        NestedTask tasks[8];
+        s64 share = POOL_TEST_LENGTH / 8;
+        for(s64 index = 0; index < 8; ++index) {
+            tasks[index] = (NestedTask) {.pool = pool, .counts = counts, .begin = index * share, .end = (index + 1) * share};
+        }
+
+        // parallel_for from within tasks.
+        TaskGroup group = taskgroup_create(pool);
+        for(s64 index = 0; index < 4; ++index) {
+            taskgroup_run(&group, &nestedTask, &tasks[index]);
+        }
+        taskgroup_wait(&group);
+
+        // parallel_for from several threads that are not workers at once.
+        pthread_t threads[4];
+        for(s64 index = 0; index < 4; ++index) {
+            assert(pthread_create(&threads[index], NULL, &nestedThread, &tasks[4 + index]) == 0);
+        }
+        for(s64 index = 0; index < 4; ++index) {
+            pthread_join(threads[index], NULL);
+        }
+
+        for(s64 index = 0; index < POOL_TEST_LENGTH; ++index) {
+            assert(counts[index] == (index < 8 * share ? 1 : 0));
+        }
+
+        free(counts);
+    }
+    pool_destroy(&pool);
+
+    return true;
+}
+
+bool test_u64_parallelSort() {
+    ThreadPool pool = pool_create(4, false);
+    {
+        u64 lengths[] = {0, 1, 2, 1000, 1025, 4096, 100003};
+        u64 * array = malloc(100003 * sizeof(u64));
+        u64 * expected = malloc(100003 * sizeof(u64));
+        assert(array != NULL && expected != NULL);
+
+        srand(49);
+        for(u64 lengthIndex = 0; lengthIndex < sizeof(lengths) / sizeof(lengths[0]); ++lengthIndex) {
+            u64 length = lengths[lengthIndex];
+
+            for(u64 pattern = 0; pattern < 3; ++pattern) {
+                for(u64 index = 0; index < length; ++index) {
+                    array[index] = (pattern == 0 ? (u64) rand() * (u64) rand() : (pattern == 1 ? index : length - index));
+                }
+                memcpy(expected, array, length * sizeof(u64));
+
+                assert(u64_parallelSort(pool, array, length));
+                u64_insertionSort(expected, length < 5000 ? length : 0);
+                if(length >= 5000) {
+                    assert(u64_mergeSort(expected, length));
+                }
+
+                assert(memcmp(array, expected, length * sizeof(u64)) == 0);
+            }
+        }
+
+        free(array);
+        free(expected);
+    }
+    pool_destroy(&pool);
+
+    return true;
+}
+
+bool test_str_parallelIndexOfChar() {
+    ThreadPool pool = pool_create(4, false);
+    {
+        String string = str_createUninitialised(3 * 1024 * 1024 + 5);
+        assertStrValid(string);
+        memset(string.data, 'a', (size_t) string.length);
+
+        assert(str_parallelIndexOfChar(pool, string, 'b') == -1);
+
+        string.data[string.length - 1] = 'b';
+        assert(str_parallelIndexOfChar(pool, string, 'b') == string.length - 1);
+
+        for(s64 index = string.length - 1; index > 0; index -= 300007) {
+            string.data[index] = 'b';
+            assert(str_parallelIndexOfChar(pool, string, 'b') == index);
+        }
+
+        string.data[0] = 'b';
+        assert(str_parallelIndexOfChar(pool, string, 'b') == 0);
+
+        ThreadPool errored = pool_create(-1, false);
+        assert(str_parallelIndexOfChar(errored, string, 'b') == 0);
+
+        str_destroy(&string);
+        assert(str_parallelIndexOfChar(pool, str_createErrored(ERROR_ALLOC, 0), 'b') == -2);
+    }
+    pool_destroy(&pool);
+
+    return true;
+}
+
+
+
+//
+// Run Tests
+//
+
+void test_Pool(int * failures, int * successes) {
+    test(ThreadPool_create);
+    test(parallel_for);
+    test(TaskGroup);
+    test(ThreadPool_nested);
+    test(u64_parallelSort);
+    test(str_parallelIndexOfChar);
+}
@@ -0,0 +1,9 @@
+#ifndef __CLIB_testPool_h
+#define __CLIB_testPool_h
+
+/*
+ * Test ThreadPool, TaskGroup and parallel_for.
+ */
+void test_Pool(int * failures, int * successes);
+
+#endif
@@ -0,0 +1,414 @@
+#include <pthread.h>
+#include "test.h"
+#include "testQueue.h"
+
+#define QUEUE_TEST_ITEMS 20000
+#define QUEUE_TEST_THREADS 4
+
+/*
+ * Returns a new String holding {number}.
+ */
+String queueItem(s64 number) {
+    return str_format("%lld", (long long) number);
+}
+
+/*
+ * Returns the number held in {item}, and destroys it.
+ */
+s64 queueItemNumber(String item) {
+    s64 number = strtoll(item.data, NULL, 10);
+    str_destroy(&item);
+    return number;
+}
+
+/*
+ * One side of a threaded test, pushing or popping the items in [start, end).
+ */
+typedef struct QueueTestThread {
+    SPSCQueue * spsc;
+    MPMCQueue * mpmc;
+    s64 start;
+    s64 end;
+    s64 batch;
+    s64 sum;
+    s64 count;
+    bool inOrder;
+} QueueTestThread;
+
+void * spscProducer(void * argument) {
+    QueueTestThread * thread = argument;
+    String items[64];
+
+    for(s64 number = thread->start; number < thread->end; number += thread->batch) {
+        s64 count = min(thread->batch, thread->end - number);
+        for(s64 index = 0; index < count; ++index) {
+            items[index] = queueItem(number + index);
+        }
+
+        if(spsc_pushBatch(thread->spsc, items, count) != count)
+            break;
+    }
+
+    spsc_close(thread->spsc);
+    return NULL;
+}
+
+void * spscConsumer(void * argument) {
+    QueueTestThread * thread = argument;
+    String items[64];
+    thread->inOrder = true;
+
+    s64 popped;
+    while((popped = spsc_popBatch(thread->spsc, items, thread->batch)) > 0) {
+        for(s64 index = 0; index < popped; ++index) {
+            s64 number = queueItemNumber(items[index]);
+
+            thread->inOrder &= (number == thread->start + thread->count);
+            thread->sum += number;
+            thread->count += 1;
+        }
+    }
+
+    return NULL;
+}
+
+void * mpmcProducer(void * argument) {
+    QueueTestThread * thread = argument;
+    String items[64];
+
+    for(s64 number = thread->start; number < thread->end; number += thread->batch) {
+        s64 count = min(thread->batch, thread->end - number);
+        for(s64 index = 0; index < count; ++index) {
+            items[index] = queueItem(number + index);
+        }
+
+        if(mpmc_pushBatch(thread->mpmc, items, count) != count)
+            break;
+    }
+
+    return NULL;
+}
+
+void * mpmcConsumer(void * argument) {
+    QueueTestThread * thread = argument;
+    String items[64];
+
+    s64 popped;
+    while((popped = mpmc_popBatch(thread->mpmc, items, thread->batch)) > 0) {
+        for(s64 index = 0; index < popped; ++index) {
+            thread->sum += queueItemNumber(items[index]);
+            thread->count += 1;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Pass QUEUE_TEST_ITEMS items from one thread to another through an SPSCQueue of {capacity}.
+ */
+bool runSPSCThreads(s64 capacity, QueueWaitMode waitMode, s64 batch) {
+    SPSCQueue queue = spsc_create(capacity, waitMode);
+    assert(!spsc_isErrored(queue));
+
+    QueueTestThread producer = {.spsc = &queue, .start = 0, .end = QUEUE_TEST_ITEMS, .batch = batch};
+    QueueTestThread consumer = {.spsc = &queue, .start = 0, .batch = batch};
+
+    pthread_t producerThread;
+    pthread_t consumerThread;
+    assert(pthread_create(&producerThread, NULL, &spscProducer, &producer) == 0);
+    assert(pthread_create(&consumerThread, NULL, &spscConsumer, &consumer) == 0);
+    pthread_join(producerThread, NULL);
+    pthread_join(consumerThread, NULL);
+
+    assert(consumer.inOrder);
+    assert(consumer.count == QUEUE_TEST_ITEMS);
+    assert(consumer.sum == (s64) QUEUE_TEST_ITEMS * (QUEUE_TEST_ITEMS - 1) / 2);
+
+    spsc_destroy(&queue);
+    return true;
+}
+
+/*
+ * Pass QUEUE_TEST_ITEMS items between QUEUE_TEST_THREADS producers and consumers through an MPMCQueue.
+ */
+bool runMPMCThreads(s64 capacity, QueueWaitMode waitMode, s64 batch) {
+    MPMCQueue queue = mpmc_create(capacity, waitMode);
+    assert(!mpmc_isErrored(queue));
+
+    QueueTestThread producers[QUEUE_TEST_THREADS];
+    QueueTestThread consumers[QUEUE_TEST_THREADS];
+    pthread_t producerThreads[QUEUE_TEST_THREADS];
+    pthread_t consumerThreads[QUEUE_TEST_THREADS];
+
+    s64 share = QUEUE_TEST_ITEMS / QUEUE_TEST_THREADS;
+    for(s64 index = 0; index < QUEUE_TEST_THREADS; ++index) {
+        producers[index] = (QueueTestThread) {.mpmc = &queue, .start = index * share, .end = (index + 1) * share, .batch = batch};
+        consumers[index] = (QueueTestThread) {.mpmc = &queue, .batch = batch};
+
+        assert(pthread_create(&producerThreads[index], NULL, &mpmcProducer, &producers[index]) == 0);
+        assert(pthread_create(&consumerThreads[index], NULL, &mpmcConsumer, &consumers[index]) == 0);
+    }
+
+    for(s64 index = 0; index < QUEUE_TEST_THREADS; ++index) {
+        pthread_join(producerThreads[index], NULL);
+    }
+
+    mpmc_close(&queue);
+
+    s64 sum = 0;
+    s64 count = 0;
+    for(s64 index = 0; index < QUEUE_TEST_THREADS; ++index) {
+        pthread_join(consumerThreads[index], NULL);
+        sum += consumers[index].sum;
+        count += consumers[index].count;
+    }
+
+    assert(count == QUEUE_TEST_ITEMS);
+    assert(sum == (s64) QUEUE_TEST_ITEMS * (QUEUE_TEST_ITEMS - 1) / 2);
+
+    mpmc_destroy(&queue);
+    return true;
+}
+
+
+
+//
+// Tests
+//
+
+bool test_SPSCQueue_create() {
+    SPSCQueue queue = spsc_create(10, QUEUE_WAIT_SPIN);
+    {
+        assert(!spsc_isErrored(queue));
+        assert(queue.capacity == 16);
+    }
+    spsc_destroy(&queue);
+    assert(spsc_getErrorType(queue) == ERROR_FREED);
+
+    queue = spsc_create(0, QUEUE_WAIT_SPIN);
+    assert(spsc_getErrorType(queue) == ERROR_ARG_INVALID);
+    assert(!spsc_tryPush(&queue, str_createEmpty()));
+    assert(spsc_push(&queue, str_createEmpty()) == ERROR_ARG_INVALID);
+
+    queue = spsc_create(S64_MAX / 2, QUEUE_WAIT_SPIN);
+    assert(spsc_getErrorType(queue) == ERROR_OVERFLOW);
+
+    return true;
+}
+
+bool test_SPSCQueue_pushPop() {
+    SPSCQueue queue = spsc_create(4, QUEUE_WAIT_SPIN);
+    {
+        String item;
+        assert(!spsc_tryPop(&queue, &item));
+
+        for(s64 round = 0; round < 3; ++round) {
+            for(s64 number = 0; number < 4; ++number) {
+                assert(spsc_tryPush(&queue, queueItem(round * 4 + number)));
+            }
+
+            item = queueItem(-1);
+            assert(!spsc_tryPush(&queue, item));
+            str_destroy(&item);
+
+            for(s64 number = 0; number < 4; ++number) {
+                assertSuccess(spsc_pop(&queue, &item));
+                assert(queueItemNumber(item) == round * 4 + number);
+            }
+            assert(!spsc_tryPop(&queue, &item));
+        }
+
+        // Items left in the queue are destroyed with it.
+        assertSuccess(spsc_push(&queue, queueItem(1)));
+        assertSuccess(spsc_push(&queue, queueItem(2)));
+    }
+    spsc_destroy(&queue);
+
+    return true;
+}
+
+bool test_SPSCQueue_batch() {
+    SPSCQueue queue = spsc_create(8, QUEUE_WAIT_SPIN);
+    {
+        String items[12];
+        for(s64 index = 0; index < 12; ++index) {
+            items[index] = queueItem(index);
+        }
+
+        assert(spsc_tryPushBatch(&queue, items, 12) == 8);
+        assert(spsc_tryPushBatch(&queue, &items[8], 4) == 0);
+
+        String popped[12];
+        assert(spsc_tryPopBatch(&queue, popped, 3) == 3);
+        assert(spsc_tryPushBatch(&queue, &items[8], 4) == 3);
+        assert(spsc_tryPopBatch(&queue, &popped[3], 12) == 8);
+        assert(spsc_popBatch(&queue, &popped[11], 0) == 0);
+        assert(spsc_tryPushBatch(&queue, &items[11], 1) == 1);
+        assert(spsc_popBatch(&queue, &popped[11], 1) == 1);
+
+        for(s64 index = 0; index < 12; ++index) {
+            assert(queueItemNumber(popped[index]) == index);
+        }
+    }
+    spsc_destroy(&queue);
+
+    return true;
+}
+
+bool test_SPSCQueue_close() {
+    SPSCQueue queue = spsc_create(4, QUEUE_WAIT_FUTEX);
+    {
+        assertSuccess(spsc_push(&queue, queueItem(7)));
+        spsc_close(&queue);
+
+        String item = queueItem(8);
+        assert(spsc_push(&queue, item) == ERROR_QUEUE_CLOSED);
+        assert(spsc_pushBatch(&queue, &item, 1) == 0);
+        str_destroy(&item);
+
+        // Items pushed before the queue was closed can still be popped.
+        assertSuccess(spsc_pop(&queue, &item));
+        assert(queueItemNumber(item) == 7);
+        assert(spsc_pop(&queue, &item) == ERROR_QUEUE_CLOSED);
+        assert(spsc_popBatch(&queue, &item, 1) == 0);
+    }
+    spsc_destroy(&queue);
+
+    return true;
+}
+
+bool test_SPSCQueue_threads() {
+    assert(runSPSCThreads(4, QUEUE_WAIT_SPIN, 1));
+    assert(runSPSCThreads(4, QUEUE_WAIT_FUTEX, 1));
+    assert(runSPSCThreads(64, QUEUE_WAIT_SPIN, 16));
+    assert(runSPSCThreads(64, QUEUE_WAIT_FUTEX, 64));
+    assert(runSPSCThreads(1024, QUEUE_WAIT_FUTEX, 7));
+
+    return true;
+}
+
+bool test_MPMCQueue_create() {
+    MPMCQueue queue = mpmc_create(1, QUEUE_WAIT_SPIN);
+    {
+        assert(!mpmc_isErrored(queue));
+        assert(queue.capacity == 2);
+    }
+    mpmc_destroy(&queue);
+    assert(mpmc_getErrorType(queue) == ERROR_FREED);
+
+    queue = mpmc_create(-4, QUEUE_WAIT_SPIN);
+    assert(mpmc_getErrorType(queue) == ERROR_ARG_INVALID);
+    assert(!mpmc_tryPush(&queue, str_createEmpty()));
+    assert(mpmc_push(&queue, str_createEmpty()) == ERROR_ARG_INVALID);
+
+    queue = mpmc_create(S64_MAX / 2, QUEUE_WAIT_SPIN);
+    assert(mpmc_getErrorType(queue) == ERROR_OVERFLOW);
+
+    return true;
+}
+
+bool test_MPMCQueue_pushPop() {
+    MPMCQueue queue = mpmc_create(4, QUEUE_WAIT_SPIN);
+    {
+        String item;
+        assert(!mpmc_tryPop(&queue, &item));
+
+        for(s64 round = 0; round < 3; ++round) {
+            for(s64 number = 0; number < 4; ++number) {
+                assert(mpmc_tryPush(&queue, queueItem(round * 4 + number)));
+            }
+
+            item = queueItem(-1);
+            assert(!mpmc_tryPush(&queue, item));
+            str_destroy(&item);
+
+            for(s64 number = 0; number < 4; ++number) {
+                assertSuccess(mpmc_pop(&queue, &item));
+                assert(queueItemNumber(item) == round * 4 + number);
+            }
+            assert(!mpmc_tryPop(&queue, &item));
+        }
+
+        assertSuccess(mpmc_push(&queue, queueItem(1)));
+        assertSuccess(mpmc_push(&queue, queueItem(2)));
+    }
+    mpmc_destroy(&queue);
+
+    return true;
+}
+
+bool test_MPMCQueue_batch() {
+    MPMCQueue queue = mpmc_create(8, QUEUE_WAIT_SPIN);
+    {
+        String items[12];
+        for(s64 index = 0; index < 12; ++index) {
+            items[index] = queueItem(index);
+        }
+
+        assert(mpmc_tryPushBatch(&queue, items, 12) == 8);
+        assert(mpmc_tryPushBatch(&queue, &items[8], 4) == 0);
+
+        String popped[12];
+        assert(mpmc_tryPopBatch(&queue, popped, 3) == 3);
+        assert(mpmc_tryPushBatch(&queue, &items[8], 4) == 3);
+        assert(mpmc_tryPopBatch(&queue, &popped[3], 12) == 8);
+        assert(mpmc_tryPushBatch(&queue, &items[11], 1) == 1);
+        assert(mpmc_popBatch(&queue, &popped[11], 1) == 1);
+
+        for(s64 index = 0; index < 12; ++index) {
+            assert(queueItemNumber(popped[index]) == index);
+        }
+    }
+    mpmc_destroy(&queue);
+
+    return true;
+}
+
+bool test_MPMCQueue_close() {
+    MPMCQueue queue = mpmc_create(4, QUEUE_WAIT_FUTEX);
+    {
+        assertSuccess(mpmc_push(&queue, queueItem(7)));
+        mpmc_close(&queue);
+
+        String item = queueItem(8);
+        assert(mpmc_push(&queue, item) == ERROR_QUEUE_CLOSED);
+        str_destroy(&item);
+
+        assertSuccess(mpmc_pop(&queue, &item));
+        assert(queueItemNumber(item) == 7);
+        assert(mpmc_pop(&queue, &item) == ERROR_QUEUE_CLOSED);
+    }
+    mpmc_destroy(&queue);
+
+    return true;
+}
+
+bool test_MPMCQueue_threads() {
+    assert(runMPMCThreads(2, QUEUE_WAIT_SPIN, 1));
+    assert(runMPMCThreads(2, QUEUE_WAIT_FUTEX, 1));
+    assert(runMPMCThreads(64, QUEUE_WAIT_SPIN, 16));
+    assert(runMPMCThreads(64, QUEUE_WAIT_FUTEX, 64));
+    assert(runMPMCThreads(1024, QUEUE_WAIT_FUTEX, 7));
+
+    return true;
+}
+
+
+
+//
+// Run Tests
+//
+
+void test_Queue(int * failures, int * successes) {
+    test(SPSCQueue_create);
+    test(SPSCQueue_pushPop);
+    test(SPSCQueue_batch);
+    test(SPSCQueue_close);
+    test(SPSCQueue_threads);
+    test(MPMCQueue_create);
+    test(MPMCQueue_pushPop);
+    test(MPMCQueue_batch);
+    test(MPMCQueue_close);
+    test(MPMCQueue_threads);
+}
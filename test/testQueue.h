@@ -0,0 +1,9 @@
+#ifndef __CLIB_testQueue_h
+#define __CLIB_testQueue_h
+
+/*
+ * Test SPSCQueue and MPMCQueue.
+ */
+void test_Queue(int * failures, int * successes);
+
+#endif
@@ -366,6 +366,26 @@ bool test_str_vformat() {
     str_destroy(&formatted);
     str_destroy(&expected);
 
+    // Longer than the scratch space used to format short Strings.
+    String longFormatted = _call_str_vformat("%0*d|%s", 1000, 7, "end");
+    {
+        assertStrValid(longFormatted);
+
+        assert(longFormatted.length == 1004);
+        assert(str_isNullTerminated(longFormatted));
+        assert(longFormatted.data[1004] == '\0');
+        assert(str_get(longFormatted, 998) == '0');
+        assert(str_get(longFormatted, 999) == '7');
+        assert(str_endsWith(longFormatted, str_create("|end")));
+    }
+    str_destroy(&longFormatted);
+
+    String empty = _call_str_vformat("");
+    {
+        assert(str_isValid(empty));
+        assert(str_isEmpty(empty));
+    }
+
     return true;
 }
 
@@ -2,6 +2,73 @@
 #include "testUTF.h"
 
 
+//
+// Helpers
+//
+
+/*
+ * A straightforward validator to check utf8_validate against, which decodes
+ * each character and then checks the range of its codepoint.
+ */
+static s64 referenceValidate(u8 * data, s64 length) {
+    s64 index = 0;
+
+    while(index < length) {
+        u8 lead = data[index];
+
+        s64 sequenceLength;
+        u32 codepoint;
+        u32 minimum;
+
+        if(lead < 0x80) {
+            index += 1;
+            continue;
+        } else if((lead & 0xE0) == 0xC0) {
+            sequenceLength = 2;
+            codepoint = lead & 0x1F;
+            minimum = 0x80;
+        } else if((lead & 0xF0) == 0xE0) {
+            sequenceLength = 3;
+            codepoint = lead & 0x0F;
+            minimum = 0x800;
+        } else if((lead & 0xF8) == 0xF0) {
+            sequenceLength = 4;
+            codepoint = lead & 0x07;
+            minimum = 0x10000;
+        } else {
+            return index;
+        }
+
+        // A character is invalid from its first char if any of its chars are invalid
+        for(s64 offset = 1; offset < sequenceLength; ++offset) {
+            if(index + offset >= length || (data[index + offset] & 0xC0) != 0x80)
+                return index;
+
+            codepoint = (codepoint << 6) | (data[index + offset] & 0x3F);
+        }
+
+        if(codepoint < minimum || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF))
+            return index;
+
+        index += sequenceLength;
+    }
+
+    return -1;
+}
+
+/*
+ * Returns a random byte that is often part of a valid multi-byte UTF-8 character.
+ */
+static u8 randomUTF8Byte() {
+    static const u8 interesting[] = {
+        'a', ' ', 0x7F, 0x80, 0x8F, 0x90, 0x9F, 0xA0, 0xBF, 0xC0, 0xC1, 0xC2, 0xDF,
+        0xE0, 0xE1, 0xEC, 0xED, 0xEE, 0xEF, 0xF0, 0xF1, 0xF3, 0xF4, 0xF5, 0xF8, 0xFC, 0xFF
+    };
+
+    return interesting[rand() % (int) sizeof(interesting)];
+}
+
+
 
 //
 // Tests
@@ -120,6 +187,296 @@ bool test_utf8_appendCodepoint() {
     return true;
 }
 
+bool test_utf8_appendCodepoints() {
+    // Every length of encoding, and runs of ASCII long enough to be converted in blocks
+    u32 codepoints[100];
+    for(int index = 0; index < 100; ++index) {
+        codepoints[index] = (u32) ('a' + index % 26);
+    }
+    codepoints[20] = 0xA2;
+    codepoints[50] = 0x20AC;
+    codepoints[51] = 0x10348;
+    codepoints[70] = 0x03FFFFFF;
+    codepoints[99] = 0x7FFFFFFF;
+
+    for(s64 count = 0; count <= 100; ++count) {
+        Builder expected = builder_create(0);
+        Builder fromCodepoints = builder_create(0);
+
+        assertSuccess(builder_appendC(&fromCodepoints, "prefix"));
+        assertSuccess(builder_appendC(&expected, "prefix"));
+
+        for(s64 index = 0; index < count; ++index) {
+            assertSuccess(utf8_appendCodepoint(&expected, codepoints[index]));
+        }
+        assertSuccess(utf8_appendCodepoints(&fromCodepoints, codepoints, count));
+
+        assert(str_equals(builder_str(expected), builder_str(fromCodepoints)));
+
+        builder_destroy(&expected);
+        builder_destroy(&fromCodepoints);
+    }
+
+    // Nothing is appended if any codepoint is invalid
+    Builder builder = builder_create(0);
+    codepoints[60] = 0x80000000;
+    assert(utf8_appendCodepoints(&builder, codepoints, 100) == ERROR_INVALID_CODEPOINT);
+    assert(builder.length == 0);
+    assert(utf8_appendCodepoints(&builder, codepoints, -1) == ERROR_NEG_LENGTH);
+    assert(utf8_appendCodepoints(&builder, NULL, 1) == ERROR_ARG_NULL);
+    builder_destroy(&builder);
+
+    return true;
+}
+
+bool test_utf8_countCodepoints() {
+    assert(utf8_countCodepoints(str_createEmpty()) == 0);
+    assert(utf8_countCodepoints(str_create("abc")) == 3);
+    assert(utf8_countCodepoints(str_create("\xC2\xA2\xE2\x82\xAC\xF0\x90\x8D\x88!")) == 4);
+    assert(utf8_countCodepoints(str_createErrored(ERROR_ARG_INVALID, 0)) == -2);
+
+    // Long enough to be counted in blocks, including more than 255 blocks at once
+    srand(43);
+    for(int iteration = 0; iteration < 50; ++iteration) {
+        Builder builder = builder_create(0);
+
+        s64 codepoints = rand() % (iteration < 45 ? 300 : 20000);
+        for(s64 index = 0; index < codepoints; ++index) {
+            u32 codepoint = (u32) (rand() % 2 == 0 ? 'a' : rand() % 0x110000);
+            if(codepoint >= 0xD800 && codepoint <= 0xDFFF) {
+                codepoint = 'b';
+            }
+
+            assertSuccess(utf8_appendCodepoint(&builder, codepoint));
+        }
+
+        assert(utf8_countCodepoints(builder_str(builder)) == codepoints);
+
+        builder_destroy(&builder);
+    }
+
+    return true;
+}
+
+bool test_utf8_substringByCodepoint() {
+    // 1000 codepoints, where codepoint i has length (i % 4) + 1 and can be identified by its offset
+    Builder builder = builder_create(0);
+    u32 lengths[4] = {0x41, 0xA2, 0x20AC, 0x10348};
+    s64 offsets[1001];
+
+    for(int index = 0; index < 1000; ++index) {
+        offsets[index] = builder.length;
+        assertSuccess(utf8_appendCodepoint(&builder, lengths[index % 4]));
+    }
+    offsets[1000] = builder.length;
+
+    String string = builder_str(builder);
+
+    s64 intervals[4] = {0, 1, 7, 1000};
+    for(int intervalIndex = 0; intervalIndex < 4; ++intervalIndex) {
+        UTF8Index index = utf8_createIndex(string, intervals[intervalIndex]);
+        assert(!utf8_isIndexErrored(index));
+        assert(index.codepointCount == 1000);
+
+        for(s64 codepoint = 0; codepoint <= 1000; ++codepoint) {
+            assert(utf8_offsetOfCodepoint(string, &index, codepoint) == offsets[codepoint]);
+        }
+        assert(utf8_offsetOfCodepoint(string, &index, 1001) == -1);
+        assert(utf8_offsetOfCodepoint(string, &index, -1) == -1);
+
+        for(s64 start = 0; start <= 1000; start += 37) {
+            for(s64 end = start; end <= 1000; end += 91) {
+                String substring = utf8_substringByCodepoint(string, &index, start, end);
+                String expected = (start == end ? str_createEmpty() : str_substring(string, offsets[start], offsets[end]));
+
+                assert(str_equals(substring, expected));
+                assert(str_equals(utf8_substringByCodepoint(string, NULL, start, end), expected));
+            }
+        }
+
+        assert(str_getErrorType(utf8_substringByCodepoint(string, &index, 0, 1001)) == ERROR_ARG_INVALID);
+        assert(str_getErrorType(utf8_substringByCodepoint(string, &index, 5, 4)) == ERROR_ARG_INVALID);
+
+        utf8_destroyIndex(&index);
+    }
+
+    assert(utf8_offsetOfCodepoint(string, NULL, 1000) == offsets[1000]);
+    assert(utf8_offsetOfCodepoint(string, NULL, 1001) == -1);
+    assert(str_getErrorType(utf8_substringByCodepoint(string, NULL, 999, 1001)) == ERROR_ARG_INVALID);
+
+    assert(utf8_isIndexErrored(utf8_createIndex(string, -1)));
+
+    builder_destroy(&builder);
+    return true;
+}
+
+bool test_utf8_validate() {
+    assert(utf8_validate(str_createEmpty()) == -1);
+    assert(utf8_validate(str_create("plain ASCII")) == -1);
+    assert(utf8_validate(str_create("\xC2\xA2 \xE2\x82\xAC \xF0\x90\x8D\x88 \xEF\xBF\xBF \xF4\x8F\xBF\xBF")) == -1);
+    assert(utf8_validate(str_createErrored(ERROR_ARG_INVALID, 0)) == -2);
+
+    // Stray continuation, overlong, surrogate, too large, 5 char and cut off characters
+    assert(utf8_validate(str_create("ab\x80")) == 2);
+    assert(utf8_validate(str_create("a\xC0\xAF")) == 1);
+    assert(utf8_validate(str_create("a\xE0\x80\xAF")) == 1);
+    assert(utf8_validate(str_create("a\xF0\x80\x80\xAF")) == 1);
+    assert(utf8_validate(str_create("a\xED\xA0\x80")) == 1);
+    assert(utf8_validate(str_create("a\xF4\x90\x80\x80")) == 1);
+    assert(utf8_validate(str_create("a\xF8\x88\x80\x80\x80")) == 1);
+    assert(utf8_validate(str_create("abc\xE2\x82")) == 3);
+    assert(utf8_validate(str_create("abc\xE2\x82z")) == 3);
+
+    // Errors at every position of inputs long enough to use SIMD
+    for(s64 length = 60; length < 200; length += 7) {
+        for(s64 position = 0; position < length; ++position) {
+            String string = str_createUninitialised(length);
+            memset(string.data, 'x', (size_t) length);
+
+            // A valid 3 char character just before the error, when there is room
+            if(position >= 3) {
+                memcpy(&string.data[position - 3], "\xE2\x82\xAC", 3);
+            }
+
+            string.data[position] = (char) 0xE2;
+            assert(utf8_validate(string) == position);
+
+            assert(utf8_validate(str_substring(string, 0, position)) == -1);
+
+            str_destroy(&string);
+        }
+    }
+
+    // Random inputs compared against a straightforward implementation
+    srand(37);
+    for(int iteration = 0; iteration < 20000; ++iteration) {
+        s64 length = rand() % 300;
+        String string = str_createUninitialised(length);
+
+        for(s64 index = 0; index < length; ++index) {
+            string.data[index] = (char) (rand() % 4 == 0 ? randomUTF8Byte() : 'a');
+        }
+
+        // Mostly valid inputs, so that errors are found after long runs of SIMD validated input
+        if(iteration % 2 == 0) {
+            s64 index = 0;
+            while(index < length) {
+                u32 codepoint = (u32) (rand() % 4 == 0 ? rand() % 0x110000 : rand() % 0x80);
+                if(codepoint >= 0xD800 && codepoint <= 0xDFFF)
+                    continue;
+
+                String encoded = utf8_fromCodepoint(codepoint);
+                if(index + encoded.length > length) {
+                    str_destroy(&encoded);
+                    break;
+                }
+
+                memcpy(&string.data[index], encoded.data, (size_t) encoded.length);
+                index += encoded.length;
+                str_destroy(&encoded);
+            }
+
+            if(length > 0 && rand() % 2 == 0) {
+                string.data[rand() % length] = (char) randomUTF8Byte();
+            }
+        }
+
+        s64 expected = referenceValidate((u8 *) string.data, length);
+        assertOrError(utf8_validate(string) == expected, "expected %lld for iteration %d", (long long) expected, iteration);
+
+        str_destroy(&string);
+    }
+
+    return true;
+}
+
+bool test_utf8_toUtf16le() {
+    s64 invalidIndex = 0;
+
+    String empty = utf8_toUtf16le(str_createEmpty(), &invalidIndex);
+    assert(str_isValid(empty) && str_isEmpty(empty));
+    assert(invalidIndex == -1);
+
+    // Random codepoints, with long runs of ASCII, compared to appending each codepoint
+    srand(41);
+    for(int iteration = 0; iteration < 500; ++iteration) {
+        Builder utf8 = builder_create(0);
+        Builder expected = builder_create(0);
+
+        s64 codepoints = rand() % 200;
+        for(s64 index = 0; index < codepoints; ++index) {
+            u32 codepoint = (u32) (rand() % 3 == 0 ? rand() % 0x110000 : 'a' + rand() % 26);
+            if(codepoint >= 0xD800 && codepoint <= 0xDFFF)
+                continue;
+
+            assertSuccess(utf8_appendCodepoint(&utf8, codepoint));
+            assertSuccess(utf16le_appendCodepoint(&expected, codepoint));
+        }
+
+        String utf16 = utf8_toUtf16le(builder_str(utf8), &invalidIndex);
+        assert(invalidIndex == -1);
+        assert(str_equals(utf16, builder_str(expected)));
+
+        String roundTrip = utf16le_toUtf8(utf16, &invalidIndex);
+        assert(invalidIndex == -1);
+        assert(str_equals(roundTrip, builder_str(utf8)));
+
+        str_destroy(&utf16);
+        str_destroy(&roundTrip);
+        builder_destroy(&utf8);
+        builder_destroy(&expected);
+    }
+
+    String invalid = utf8_toUtf16le(str_create("valid then \xED\xA0\x80"), &invalidIndex);
+    assert(str_getErrorType(invalid) == ERROR_INVALID_CODEPOINT);
+    assert(invalidIndex == 11);
+
+    invalid = utf8_toUtf16le(str_create("\xC0"), NULL);
+    assert(str_getErrorType(invalid) == ERROR_INVALID_CODEPOINT);
+
+    return true;
+}
+
+bool test_utf16le_toUtf8() {
+    s64 invalidIndex = 0;
+
+    String utf8 = utf16le_toUtf8(str_createOfLength("h\0i\0\xAC\x20\x3D\xD8\x00\xDE", 10), &invalidIndex);
+    assert(invalidIndex == -1);
+    assert(str_equals(utf8, str_create("hi\xE2\x82\xAC\xF0\x9F\x98\x80")));
+    str_destroy(&utf8);
+
+    // Long ASCII runs are converted in blocks
+    Builder utf16 = builder_create(0);
+    for(int index = 0; index < 100; ++index) {
+        assertSuccess(utf16le_appendCodepoint(&utf16, (u32) ('a' + index % 26)));
+    }
+    assertSuccess(utf16le_appendCodepoint(&utf16, 0x20AC));
+
+    utf8 = utf16le_toUtf8(builder_str(utf16), &invalidIndex);
+    assert(utf8.length == 103);
+    assert(str_startsWith(utf8, str_create("abcdefghijklmnopqrstuvwxyzabcd")));
+    assert(str_endsWith(utf8, str_create("uv\xE2\x82\xAC")));
+    str_destroy(&utf8);
+    builder_destroy(&utf16);
+
+    // A lone high surrogate, a lone low surrogate, a high surrogate at the end, and an odd length
+    String invalid = utf16le_toUtf8(str_createOfLength("a\0\x3D\xD8" "b\0", 6), &invalidIndex);
+    assert(str_getErrorType(invalid) == ERROR_INVALID_CODEPOINT);
+    assert(invalidIndex == 2);
+
+    invalid = utf16le_toUtf8(str_createOfLength("a\0\x00\xDE", 4), &invalidIndex);
+    assert(invalidIndex == 2);
+
+    invalid = utf16le_toUtf8(str_createOfLength("a\0\x3D\xD8", 4), &invalidIndex);
+    assert(invalidIndex == 2);
+
+    invalid = utf16le_toUtf8(str_createOfLength("a\0b", 3), &invalidIndex);
+    assert(str_getErrorType(invalid) == ERROR_INVALID_CODEPOINT);
+    assert(invalidIndex == 2);
+
+    return true;
+}
+
 bool test_utf16le_toCodepoint() {
     Builder utf16 = builder_create(16);
     {
@@ -256,6 +613,10 @@ bool test_utf16le_appendCodepoint() {
 
     assert(str_equals(builder_str(expected), builder_str(fromCodepoints)));
 
+    s64 length = fromCodepoints.length;
+    assert(utf16le_appendCodepoint(&fromCodepoints, 0x110000) == ERROR_INVALID_CODEPOINT);
+    assert(fromCodepoints.length == length);
+
     return true;
 }
 
@@ -269,8 +630,14 @@ void test_UTF(int *failures, int *successes) {
     test(utf8_toCodepoint);
     test(utf8_fromCodepoint);
     test(utf8_appendCodepoint);
+    test(utf8_appendCodepoints);
+    test(utf8_validate);
+    test(utf8_countCodepoints);
+    test(utf8_substringByCodepoint);
 
     test(utf16le_toCodepoint);
     test(utf16le_fromCodepoint);
     test(utf16le_appendCodepoint);
+    test(utf8_toUtf16le);
+    test(utf16le_toUtf8);
 }
@@ -0,0 +1,210 @@
+#include "test.h"
+#include "testVec.h"
+
+/*
+ * An element larger than a pointer, to check that elements are moved whole.
+ */
+typedef struct VecPoint {
+    s64 x;
+    s64 y;
+    s64 z;
+} VecPoint;
+
+vec_define(VecPoint)
+
+
+
+//
+// Tests
+//
+
+bool test_Vec_create() {
+    Vec(u64) vec = Vec_u64_create(10);
+    {
+        assert(!Vec_u64_isErrored(vec));
+        assert(vec.length == 0);
+        assert(Vec_u64_capacity(vec) == 10);
+    }
+    Vec_u64_destroy(&vec);
+
+    vec = Vec_u64_create(0);
+    {
+        assert(!Vec_u64_isErrored(vec));
+        assert(Vec_u64_capacity(vec) == 0);
+    }
+    Vec_u64_destroy(&vec);
+
+    vec = Vec_u64_create(-1);
+    assert(Vec_u64_getErrorType(vec) == ERROR_NEG_LENGTH);
+
+    vec = Vec_u64_create(S64_MAX / 4);
+    assert(Vec_u64_getErrorType(vec) == ERROR_OVERFLOW);
+    assert(Vec_u64_capacity(vec) == 0);
+    assert(Vec_u64_push(&vec, 1) == ERROR_ARG_INVALID);
+    assert(Vec_u64_pop(&vec, NULL) == ERROR_ARG_INVALID);
+
+    return true;
+}
+
+bool test_Vec_push() {
+    Vec(u64) vec = Vec_u64_create(0);
+    {
+        for(u64 index = 0; index < 10000; ++index) {
+            assertSuccess(Vec_u64_push(&vec, index * 3));
+            assert(vec.length == (s64) index + 1);
+        }
+
+        // Grown by buf_ensureCapacity to a power of 2 chars.
+        assert(vec.buffer.size == 128 * 1024);
+        assert(Vec_u64_capacity(vec) == 16 * 1024);
+
+        for(u64 index = 0; index < 10000; ++index) {
+            assert(vec.items[index] == index * 3);
+        }
+
+        for(u64 index = 10000; index > 0; --index) {
+            u64 value;
+            assertSuccess(Vec_u64_pop(&vec, &value));
+            assert(value == (index - 1) * 3);
+        }
+
+        assert(vec.length == 0);
+        assert(Vec_u64_pop(&vec, NULL) == ERROR_ARG_INVALID);
+    }
+    Vec_u64_destroy(&vec);
+
+    Vec(VecPoint) points = Vec_VecPoint_create(1);
+    {
+        for(s64 index = 0; index < 1000; ++index) {
+            assertSuccess(Vec_VecPoint_push(&points, (VecPoint) {index, -index, index * index}));
+        }
+
+        for(s64 index = 0; index < 1000; ++index) {
+            assert(points.items[index].x == index);
+            assert(points.items[index].y == -index);
+            assert(points.items[index].z == index * index);
+        }
+    }
+    Vec_VecPoint_destroy(&points);
+
+    return true;
+}
+
+bool test_Vec_reserve() {
+    Vec(VecPoint) points = Vec_VecPoint_create(0);
+    {
+        assertSuccess(Vec_VecPoint_reserve(&points, 100));
+        assert(Vec_VecPoint_capacity(points) >= 100);
+
+        char * start = points.buffer.start;
+        for(s64 index = 0; index < 100; ++index) {
+            assertSuccess(Vec_VecPoint_push(&points, (VecPoint) {index, index, index}));
+        }
+        assert(points.buffer.start == start);
+
+        assert(Vec_VecPoint_reserve(&points, -1) == ERROR_NEG_LENGTH);
+        assert(Vec_VecPoint_reserve(&points, S64_MAX / 8) == ERROR_OVERFLOW);
+        assert(points.length == 100);
+
+        assertSuccess(Vec_VecPoint_shrink(&points));
+        assert(Vec_VecPoint_capacity(points) == 100);
+        assert(points.items[99].x == 99);
+
+        points.length = 0;
+        assertSuccess(Vec_VecPoint_shrink(&points));
+        assert(Vec_VecPoint_capacity(points) == 0);
+        assert(!Vec_VecPoint_isErrored(points));
+
+        assertSuccess(Vec_VecPoint_push(&points, (VecPoint) {1, 2, 3}));
+        assert(points.items[0].z == 3);
+    }
+    Vec_VecPoint_destroy(&points);
+
+    return true;
+}
+
+bool test_Vec_insert() {
+    Vec(String) vec = Vec_String_create(0);
+    {
+        assertSuccess(Vec_String_insert(&vec, 0, str_create("b")));
+        assertSuccess(Vec_String_insert(&vec, 0, str_create("a")));
+        assertSuccess(Vec_String_insert(&vec, 2, str_create("d")));
+        assertSuccess(Vec_String_insert(&vec, 2, str_create("c")));
+
+        assert(Vec_String_insert(&vec, 5, str_create("x")) == ERROR_ARG_INVALID);
+        assert(Vec_String_insert(&vec, -1, str_create("x")) == ERROR_ARG_INVALID);
+
+        assert(vec.length == 4);
+        assert(str_equalsC(vec.items[0], "a"));
+        assert(str_equalsC(vec.items[1], "b"));
+        assert(str_equalsC(vec.items[2], "c"));
+        assert(str_equalsC(vec.items[3], "d"));
+    }
+    Vec_String_destroy(&vec);
+
+    return true;
+}
+
+bool test_Vec_erase() {
+    Vec(u64) vec = Vec_u64_create(0);
+    {
+        for(u64 index = 0; index < 10; ++index) {
+            assertSuccess(Vec_u64_push(&vec, index));
+        }
+
+        assertSuccess(Vec_u64_erase(&vec, 2, 3));
+        assertSuccess(Vec_u64_erase(&vec, 6, 1));
+        assertSuccess(Vec_u64_erase(&vec, 0, 0));
+        assertSuccess(Vec_u64_erase(&vec, 6, 0));
+
+        u64 expected[6] = {0, 1, 5, 6, 7, 8};
+        assert(vec.length == 6);
+        assert(memcmp(vec.items, expected, sizeof(expected)) == 0);
+
+        assert(Vec_u64_erase(&vec, 5, 2) == ERROR_ARG_INVALID);
+        assert(Vec_u64_erase(&vec, 7, 0) == ERROR_ARG_INVALID);
+        assert(Vec_u64_erase(&vec, -1, 1) == ERROR_ARG_INVALID);
+        assert(Vec_u64_erase(&vec, 0, -1) == ERROR_NEG_LENGTH);
+
+        assertSuccess(Vec_u64_erase(&vec, 0, 6));
+        assert(vec.length == 0);
+    }
+    Vec_u64_destroy(&vec);
+
+    return true;
+}
+
+bool test_Vec_sort() {
+    Vec(u64) vec = Vec_u64_create(0);
+    {
+        assertSuccess(Vec_u64_sort(&vec));
+
+        srand(47);
+        for(s64 index = 0; index < 5000; ++index) {
+            assertSuccess(Vec_u64_push(&vec, (u64) rand() % 1000));
+        }
+
+        assertSuccess(Vec_u64_sort(&vec));
+        for(s64 index = 1; index < vec.length; ++index) {
+            assert(vec.items[index - 1] <= vec.items[index]);
+        }
+    }
+    Vec_u64_destroy(&vec);
+
+    return true;
+}
+
+
+
+//
+// Run Tests
+//
+
+void test_Vec(int * failures, int * successes) {
+    test(Vec_create);
+    test(Vec_push);
+    test(Vec_reserve);
+    test(Vec_insert);
+    test(Vec_erase);
+    test(Vec_sort);
+}
@@ -0,0 +1,9 @@
+#ifndef __CLIB_testVec_h
+#define __CLIB_testVec_h
+
+/*
+ * Test the Vec types defined using vec_define.
+ */
+void test_Vec(int * failures, int * successes);
+
+#endif